@@ -0,0 +1,4 @@
+#include "BleCombo.h"
+
+BleComboKeyboard Keyboard;
+BleComboMouse Mouse(&Keyboard);
@@ -0,0 +1,10 @@
+#ifndef ESP32_BLE_COMBO_H
+#define ESP32_BLE_COMBO_H
+
+#include "BleComboKeyboard.h"
+#include "BleComboMouse.h"
+
+extern BleComboKeyboard Keyboard;
+extern BleComboMouse Mouse;
+
+#endif // ESP32_BLE_COMBO_H
@@ -0,0 +1,154 @@
+#ifndef ESP32_BLE_COMBO_KEYBOARD_H
+#define ESP32_BLE_COMBO_KEYBOARD_H
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include "BleConnectionStatus.h"
+#include "BLEHIDDevice.h"
+#include "BLECharacteristic.h"
+#include "Print.h"
+#include <atomic>
+
+const uint8_t KEY_LEFT_CTRL = 0x80;
+const uint8_t KEY_LEFT_SHIFT = 0x81;
+const uint8_t KEY_LEFT_ALT = 0x82;
+const uint8_t KEY_LEFT_GUI = 0x83;
+const uint8_t KEY_RIGHT_CTRL = 0x84;
+const uint8_t KEY_RIGHT_SHIFT = 0x85;
+const uint8_t KEY_RIGHT_ALT = 0x86;
+const uint8_t KEY_RIGHT_GUI = 0x87;
+
+const uint8_t KEY_UP_ARROW = 0xDA;
+const uint8_t KEY_DOWN_ARROW = 0xD9;
+const uint8_t KEY_LEFT_ARROW = 0xD8;
+const uint8_t KEY_RIGHT_ARROW = 0xD7;
+const uint8_t KEY_BACKSPACE = 0xB2;
+const uint8_t KEY_TAB = 0xB3;
+const uint8_t KEY_RETURN = 0xB0;
+const uint8_t KEY_ESC = 0xB1;
+const uint8_t KEY_INSERT = 0xD1;
+const uint8_t KEY_DELETE = 0xD4;
+const uint8_t KEY_PAGE_UP = 0xD3;
+const uint8_t KEY_PAGE_DOWN = 0xD6;
+const uint8_t KEY_HOME = 0xD2;
+const uint8_t KEY_END = 0xD5;
+const uint8_t KEY_CAPS_LOCK = 0xC1;
+const uint8_t KEY_F1 = 0xC2;
+const uint8_t KEY_F2 = 0xC3;
+const uint8_t KEY_F3 = 0xC4;
+const uint8_t KEY_F4 = 0xC5;
+const uint8_t KEY_F5 = 0xC6;
+const uint8_t KEY_F6 = 0xC7;
+const uint8_t KEY_F7 = 0xC8;
+const uint8_t KEY_F8 = 0xC9;
+const uint8_t KEY_F9 = 0xCA;
+const uint8_t KEY_F10 = 0xCB;
+const uint8_t KEY_F11 = 0xCC;
+const uint8_t KEY_F12 = 0xCD;
+const uint8_t KEY_F13 = 0xF0;
+const uint8_t KEY_F14 = 0xF1;
+const uint8_t KEY_F15 = 0xF2;
+const uint8_t KEY_F16 = 0xF3;
+const uint8_t KEY_F17 = 0xF4;
+const uint8_t KEY_F18 = 0xF5;
+const uint8_t KEY_F19 = 0xF6;
+const uint8_t KEY_F20 = 0xF7;
+const uint8_t KEY_F21 = 0xF8;
+const uint8_t KEY_F22 = 0xF9;
+const uint8_t KEY_F23 = 0xFA;
+const uint8_t KEY_F24 = 0xFB;
+
+typedef uint8_t MediaKeyReport[2];
+
+const MediaKeyReport KEY_MEDIA_NEXT_TRACK = {1, 0};
+const MediaKeyReport KEY_MEDIA_PREVIOUS_TRACK = {2, 0};
+const MediaKeyReport KEY_MEDIA_STOP = {4, 0};
+const MediaKeyReport KEY_MEDIA_PLAY_PAUSE = {8, 0};
+const MediaKeyReport KEY_MEDIA_MUTE = {16, 0};
+const MediaKeyReport KEY_MEDIA_VOLUME_UP = {32, 0};
+const MediaKeyReport KEY_MEDIA_VOLUME_DOWN = {64, 0};
+const MediaKeyReport KEY_MEDIA_WWW_HOME = {128, 0};
+const MediaKeyReport KEY_MEDIA_LOCAL_MACHINE_BROWSER = {0, 1}; // Opens "My Computer" on Windows
+const MediaKeyReport KEY_MEDIA_CALCULATOR = {0, 2};
+const MediaKeyReport KEY_MEDIA_WWW_BOOKMARKS = {0, 4};
+const MediaKeyReport KEY_MEDIA_WWW_SEARCH = {0, 8};
+const MediaKeyReport KEY_MEDIA_WWW_STOP = {0, 16};
+const MediaKeyReport KEY_MEDIA_WWW_BACK = {0, 32};
+const MediaKeyReport KEY_MEDIA_CONSUMER_CONTROL_CONFIGURATION = {0, 64}; // Media Selection
+const MediaKeyReport KEY_MEDIA_EMAIL_READER = {0, 128};
+
+//  Low level key report: up to 6 keys and shift, ctrl etc at once
+typedef struct
+{
+  uint8_t modifiers;
+  uint8_t reserved;
+  uint8_t keys[6];
+} KeyReport;
+
+class BleComboKeyboard : public Print
+{
+public:
+  // Fork addition: collections appended to the report map by addCollection(). The HID
+  // service is created with 40 handles; the built-in reports use 24 and each extra input
+  // report takes 4 (declaration, value, CCCD, report reference).
+  static const size_t kMaxExtraInputReports = 4;
+  static const size_t kMaxReportMapBytes = 512;
+
+private:
+  BleConnectionStatus* connectionStatus;
+  BLEHIDDevice* hid;
+  KeyReport _keyReport;
+  MediaKeyReport _mediaKeyReport;
+  uint8_t _reportMap[kMaxReportMapBytes];
+  size_t _reportMapSize;
+  // IDs and count are fixed before begin(). The characteristics are created later on the
+  // server task, which publishes them through _extraInputsReady.
+  uint8_t _extraReportIds[kMaxExtraInputReports];
+  BLECharacteristic* _extraInputs[kMaxExtraInputReports];
+  size_t _extraReportCount;
+  std::atomic<size_t> _extraInputsReady;
+  bool _started;
+  static void taskServer(void* pvParameter);
+
+public:
+  BleComboKeyboard(std::string deviceName = "ESP32 Keyboard/Mouse", std::string deviceManufacturer = "Espressif", uint8_t batteryLevel = 100);
+  void begin(void);
+  void end(void);
+  void sendReport(KeyReport* keys);
+  void sendReport(MediaKeyReport* keys);
+  size_t press(uint8_t k);
+  size_t press(const MediaKeyReport k);
+  size_t release(uint8_t k);
+  size_t release(const MediaKeyReport k);
+  size_t write(uint8_t c);
+  size_t write(const MediaKeyReport c);
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+
+  void releaseAll(void);
+  bool isConnected(void);
+  void setBatteryLevel(uint8_t level);
+
+  // Appends a report map fragment and creates an input report characteristic for each of
+  // its report IDs. Only before begin(); false (and nothing registered) when the report map
+  // or the HID service is out of room.
+  bool addCollection(const uint8_t* fragment, size_t size, const uint8_t* reportIds, size_t reportIdCount);
+  bool hasInputReport(uint8_t reportId) const;
+  // Notifies the input report registered for `reportId`; false when there is none or no
+  // host is connected.
+  bool sendInputReport(uint8_t reportId, const uint8_t* report, size_t length);
+
+  uint8_t batteryLevel;
+  std::string deviceManufacturer;
+  std::string deviceName;
+  BLECharacteristic* inputKeyboard;
+  BLECharacteristic* outputKeyboard;
+  BLECharacteristic* inputMediaKeys;
+  BLECharacteristic* inputMouse;
+
+protected:
+  virtual void onStarted(BLEServer *pServer) { };
+};
+
+#endif // CONFIG_BT_ENABLED
+#endif // ESP32_BLE_COMBO_KEYBOARD_H
@@ -0,0 +1,33 @@
+#include "BleConnectionStatus.h"
+
+BleConnectionStatus::BleConnectionStatus(void) {
+}
+
+void BleConnectionStatus::addInputReport(BLECharacteristic* characteristic)
+{
+  if (inputReportCount < kMaxInputReports) {
+    inputReports[inputReportCount++] = characteristic;
+  }
+}
+
+void BleConnectionStatus::setNotifications(bool enabled)
+{
+  for (int i = 0; i < inputReportCount; i++) {
+    BLE2902* desc = (BLE2902*)inputReports[i]->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+    if (desc) {
+      desc->setNotifications(enabled);
+    }
+  }
+}
+
+void BleConnectionStatus::onConnect(BLEServer* pServer)
+{
+  this->connected = true;
+  setNotifications(true);
+}
+
+void BleConnectionStatus::onDisconnect(BLEServer* pServer)
+{
+  this->connected = false;
+  setNotifications(false);
+}
@@ -0,0 +1,29 @@
+#ifndef ESP32_BLE_CONNECTION_STATUS_H
+#define ESP32_BLE_CONNECTION_STATUS_H
+#include "sdkconfig.h"
+#if defined(CONFIG_BT_ENABLED)
+
+#include <BLEServer.h>
+#include "BLE2902.h"
+#include "BLECharacteristic.h"
+
+class BleConnectionStatus : public BLEServerCallbacks
+{
+public:
+  BleConnectionStatus(void);
+  bool connected = false;
+  void onConnect(BLEServer* pServer);
+  void onDisconnect(BLEServer* pServer);
+
+  // Every input report characteristic; notifications follow the connection.
+  static const int kMaxInputReports = 8;
+  BLECharacteristic* inputReports[kMaxInputReports] = {};
+  int inputReportCount = 0;
+  void addInputReport(BLECharacteristic* characteristic);
+
+private:
+  void setNotifications(bool enabled);
+};
+
+#endif // CONFIG_BT_ENABLED
+#endif // ESP32_BLE_CONNECTION_STATUS_H
@@ -0,0 +1,66 @@
+#include "alloc_counter.h"
+
+#include <esp_attr.h>
+
+#include <atomic>
+#include <cstddef>
+
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t count, size_t size);
+  void *__real_realloc(void *ptr, size_t size);
+}
+
+namespace alloc_counter
+{
+  namespace
+  {
+    // Wrappers can run before static constructors and from any task, so the state is
+    // plain trivially-initialised atomics.
+    std::atomic<TaskHandle_t> tracked_task_{nullptr};
+    std::atomic<uint32_t> allocation_count_{0};
+
+    inline void IRAM_ATTR note_allocation()
+    {
+      TaskHandle_t task = tracked_task_.load(std::memory_order_relaxed);
+      if (task && xTaskGetCurrentTaskHandle() == task)
+      {
+        allocation_count_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  } // namespace
+
+  void track_task(TaskHandle_t task)
+  {
+    tracked_task_.store(nullptr, std::memory_order_relaxed);
+    allocation_count_.store(0, std::memory_order_relaxed);
+    tracked_task_.store(task, std::memory_order_relaxed);
+  }
+
+  uint32_t allocations()
+  {
+    return allocation_count_.load(std::memory_order_relaxed);
+  }
+} // namespace alloc_counter
+
+extern "C"
+{
+  void *IRAM_ATTR __wrap_malloc(size_t size)
+  {
+    alloc_counter::note_allocation();
+    return __real_malloc(size);
+  }
+
+  void *IRAM_ATTR __wrap_calloc(size_t count, size_t size)
+  {
+    alloc_counter::note_allocation();
+    return __real_calloc(count, size);
+  }
+
+  void *IRAM_ATTR __wrap_realloc(void *ptr, size_t size)
+  {
+    alloc_counter::note_allocation();
+    return __real_realloc(ptr, size);
+  }
+}
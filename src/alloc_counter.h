@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Counts heap allocations made by one task. The firmware links with
+// -Wl,--wrap=malloc/calloc/realloc (see platformio.ini) so every allocation passes
+// through the wrappers in alloc_counter.cpp, including those made by ArduinoJson,
+// Arduino String and the C++ runtime.
+namespace alloc_counter
+{
+  // Starts counting allocations made by `task` and resets the counter. Passing nullptr
+  // stops counting.
+  void track_task(TaskHandle_t task);
+  uint32_t allocations();
+} // namespace alloc_counter
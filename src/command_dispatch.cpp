@@ -0,0 +1,64 @@
+#include "command_dispatch.h"
+
+#include <cstring>
+
+namespace command_dispatch
+{
+  namespace
+  {
+    char to_lower(char c)
+    {
+      return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    bool equals_ignore_case(const char *name, const char *lower)
+    {
+      for (; *lower != '\0'; ++name, ++lower)
+      {
+        if (to_lower(*name) != *lower)
+        {
+          return false;
+        }
+      }
+      return *name == '\0';
+    }
+  } // namespace
+
+  const DeviceName *find_device(const char *name)
+  {
+    // A handful of fixed names; new commands are routes, not devices.
+    for (const DeviceName &device : kDevices)
+    {
+      if (equals_ignore_case(name, device.name))
+      {
+        return &device;
+      }
+    }
+    return nullptr;
+  }
+
+  Command find_command(const DeviceName &device, const char *action)
+  {
+    uint32_t hash = detail::mix(detail::kFnvOffset, static_cast<uint8_t>(device.device));
+    for (const char *cursor = action; *cursor != '\0'; ++cursor)
+    {
+      hash = detail::mix(hash, static_cast<uint8_t>(*cursor));
+    }
+
+    const Bucket &bucket = kBuckets.buckets[detail::bucket_of(hash, kRouteSeed)];
+    const uint8_t slots[] = {bucket.first, bucket.second};
+    for (uint8_t index : slots)
+    {
+      if (index == kNoRoute)
+      {
+        break;
+      }
+      const Route &route = kRoutes[index];
+      if (route.device == device.device && strcmp(route.action, action) == 0)
+      {
+        return route.command;
+      }
+    }
+    return device.any_action;
+  }
+} // namespace command_dispatch
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Routing for {"device":...,"action":...} commands. Every accepted (device, action) pair,
+// aliases included, is one row of kRoutes. The rows are hashed into a bucket table at
+// compile time, so finding a command costs one pass over the action string and at most two
+// string comparisons no matter how many actions are registered. Registering an action is a
+// new Command value, a kRoutes row per spelling and a handler in main.cpp's table; the
+// static_asserts below reject duplicate rows and bucket overflows. Free of Arduino so the
+// host tools can check it.
+namespace command_dispatch
+{
+  // Values double as the device ids of CommandEnd trace events (see trace_to_chrome.py).
+  enum class Device : uint8_t
+  {
+    Unknown = 0,
+    Keyboard = 1,
+    Mouse = 2,
+    Consumer = 3,
+    System = 4,
+    Pointer = 5,
+    Gamepad = 6
+  };
+
+  // Indexes main.cpp's handler table, which static_asserts that it lists them in this order.
+  enum class Command : uint8_t
+  {
+    KeyboardWrite,
+    KeyboardPrintln,
+    KeyboardReleaseAll,
+    KeyboardPress,
+    KeyboardRelease,
+    KeyboardTap,
+    MouseMove,
+    MouseReleaseAll,
+    MouseClick,
+    MousePress,
+    MouseRelease,
+    ConsumerSend,
+    GamepadStats,
+    GamepadConfig,
+    GamepadState,
+    GamepadPress,
+    GamepadRelease,
+    GamepadAxis,
+    GamepadHat,
+    GamepadReset,
+    SystemBench,
+    SystemParseBench,
+    SystemTrace,
+    SystemStackReport,
+    SystemStackStress,
+    SystemEcho,
+    SystemWebsocket,
+    SystemMemory,
+    Count,
+    None = 0xFF
+  };
+
+  constexpr size_t kCommandCount = static_cast<size_t>(Command::Count);
+
+  struct DeviceName
+  {
+    // Lower case; "device"/"type" values match it case-insensitively.
+    const char *name;
+    Device device;
+    // Action assumed when the command has none.
+    const char *default_action;
+    // Command for any action the device does not register, or Command::None.
+    Command any_action;
+  };
+
+  constexpr DeviceName kDevices[] = {
+      {"keyboard", Device::Keyboard, "press", Command::None},
+      {"mouse", Device::Mouse, "move", Command::None},
+      {"consumer", Device::Consumer, "", Command::ConsumerSend},
+      {"media", Device::Consumer, "", Command::ConsumerSend},
+      {"system", Device::System, "", Command::None},
+      {"gamepad", Device::Gamepad, "state", Command::None}};
+
+  constexpr size_t kDeviceCount = sizeof(kDevices) / sizeof(kDevices[0]);
+
+  struct Route
+  {
+    Device device;
+    // Compared case-sensitively, as the handlers always have.
+    const char *action;
+    Command command;
+  };
+
+  constexpr Route kRoutes[] = {
+      {Device::Keyboard, "write", Command::KeyboardWrite},
+      {Device::Keyboard, "print", Command::KeyboardWrite},
+      {Device::Keyboard, "println", Command::KeyboardPrintln},
+      {Device::Keyboard, "releaseAll", Command::KeyboardReleaseAll},
+      {Device::Keyboard, "release_all", Command::KeyboardReleaseAll},
+      {Device::Keyboard, "press", Command::KeyboardPress},
+      {Device::Keyboard, "release", Command::KeyboardRelease},
+      {Device::Keyboard, "tap", Command::KeyboardTap},
+      {Device::Keyboard, "click", Command::KeyboardTap},
+      {Device::Mouse, "move", Command::MouseMove},
+      {Device::Mouse, "releaseAll", Command::MouseReleaseAll},
+      {Device::Mouse, "release_all", Command::MouseReleaseAll},
+      {Device::Mouse, "click", Command::MouseClick},
+      {Device::Mouse, "press", Command::MousePress},
+      {Device::Mouse, "release", Command::MouseRelease},
+      {Device::Gamepad, "stats", Command::GamepadStats},
+      {Device::Gamepad, "config", Command::GamepadConfig},
+      {Device::Gamepad, "state", Command::GamepadState},
+      {Device::Gamepad, "press", Command::GamepadPress},
+      {Device::Gamepad, "release", Command::GamepadRelease},
+      {Device::Gamepad, "axis", Command::GamepadAxis},
+      {Device::Gamepad, "hat", Command::GamepadHat},
+      {Device::Gamepad, "reset", Command::GamepadReset},
+      {Device::Gamepad, "releaseAll", Command::GamepadReset},
+      {Device::Gamepad, "release_all", Command::GamepadReset},
+      {Device::System, "bench", Command::SystemBench},
+      {Device::System, "parse_bench", Command::SystemParseBench},
+      {Device::System, "parseBench", Command::SystemParseBench},
+      {Device::System, "trace", Command::SystemTrace},
+      {Device::System, "stack_report", Command::SystemStackReport},
+      {Device::System, "stackReport", Command::SystemStackReport},
+      {Device::System, "stack_stress", Command::SystemStackStress},
+      {Device::System, "stackStress", Command::SystemStackStress},
+      {Device::System, "echo", Command::SystemEcho},
+      {Device::System, "websocket", Command::SystemWebsocket},
+      {Device::System, "memory", Command::SystemMemory}};
+
+  constexpr size_t kRouteCount = sizeof(kRoutes) / sizeof(kRoutes[0]);
+
+  // 2^kBucketBits buckets of two slots. The hash seed is the first one that leaves no bucket
+  // with a third row, found by the compiler.
+  constexpr unsigned kBucketBits = 7;
+  constexpr size_t kBucketCount = size_t(1) << kBucketBits;
+  constexpr uint32_t kMaxRouteSeed = 64;
+  constexpr uint8_t kNoRoute = 0xFF;
+
+  struct Bucket
+  {
+    uint8_t first;
+    uint8_t second;
+  };
+
+  struct BucketTable
+  {
+    Bucket buckets[kBucketCount];
+  };
+
+  namespace detail
+  {
+    constexpr uint32_t kFnvOffset = 2166136261u;
+    constexpr uint32_t kFnvPrime = 16777619u;
+
+    constexpr uint32_t mix(uint32_t hash, uint8_t byte)
+    {
+      return static_cast<uint32_t>((hash ^ byte) * kFnvPrime);
+    }
+
+    // FNV-1a over the device id followed by the action.
+    constexpr uint32_t hash_action(uint32_t hash, const char *action)
+    {
+      return *action == '\0' ? hash : hash_action(mix(hash, static_cast<uint8_t>(*action)), action + 1);
+    }
+
+    constexpr uint32_t route_hash(Device device, const char *action)
+    {
+      return hash_action(mix(kFnvOffset, static_cast<uint8_t>(device)), action);
+    }
+
+    constexpr size_t bucket_of(uint32_t hash, uint32_t seed)
+    {
+      return static_cast<size_t>(static_cast<uint32_t>((hash ^ seed) * 0x9E3779B1u) >> (32 - kBucketBits));
+    }
+
+    constexpr bool same_text(const char *a, const char *b)
+    {
+      return *a == *b && (*a == '\0' || same_text(a + 1, b + 1));
+    }
+
+    // Index of the `skip`th row from `route` on that lands in `bucket`, or kNoRoute.
+    constexpr uint8_t route_in_bucket(size_t bucket, uint32_t seed, size_t route, size_t skip)
+    {
+      return route >= kRouteCount ? kNoRoute
+             : bucket_of(route_hash(kRoutes[route].device, kRoutes[route].action), seed) != bucket
+                 ? route_in_bucket(bucket, seed, route + 1, skip)
+             : skip == 0 ? static_cast<uint8_t>(route)
+                         : route_in_bucket(bucket, seed, route + 1, skip - 1);
+    }
+
+    constexpr bool buckets_fit_from(uint32_t seed, size_t bucket)
+    {
+      return bucket >= kBucketCount ||
+             (route_in_bucket(bucket, seed, 0, 2) == kNoRoute && buckets_fit_from(seed, bucket + 1));
+    }
+
+    constexpr bool unique_against(size_t route, size_t other)
+    {
+      return other >= kRouteCount ||
+             (!(kRoutes[route].device == kRoutes[other].device &&
+                same_text(kRoutes[route].action, kRoutes[other].action)) &&
+              unique_against(route, other + 1));
+    }
+
+    constexpr bool unique_from(size_t route)
+    {
+      return route >= kRouteCount || (unique_against(route, route + 1) && unique_from(route + 1));
+    }
+
+    constexpr uint32_t first_fitting_seed(uint32_t seed)
+    {
+      return seed >= kMaxRouteSeed || buckets_fit_from(seed, 0) ? seed : first_fitting_seed(seed + 1);
+    }
+
+    template <size_t... I>
+    struct Indices
+    {
+    };
+
+    template <size_t N, size_t... I>
+    struct MakeIndices : MakeIndices<N - 1, N - 1, I...>
+    {
+    };
+
+    template <size_t... I>
+    struct MakeIndices<0, I...>
+    {
+      typedef Indices<I...> type;
+    };
+
+    template <size_t... I>
+    constexpr BucketTable make_buckets(uint32_t seed, Indices<I...>)
+    {
+      return BucketTable{{{route_in_bucket(I, seed, 0, 0), route_in_bucket(I, seed, 0, 1)}...}};
+    }
+  } // namespace detail
+
+  constexpr uint32_t kRouteSeed = detail::first_fitting_seed(0);
+
+  static_assert(kRouteCount < kNoRoute, "command_dispatch::kRoutes outgrew its 8-bit row index");
+  static_assert(detail::unique_from(0), "command_dispatch::kRoutes lists a (device, action) pair twice");
+  static_assert(kRouteSeed < kMaxRouteSeed, "no seed spreads command_dispatch::kRoutes two to a bucket; raise kBucketBits");
+
+  constexpr BucketTable kBuckets = detail::make_buckets(kRouteSeed, detail::MakeIndices<kBucketCount>::type());
+
+  // Device for a "device"/"type" value; nullptr when unknown.
+  const DeviceName *find_device(const char *name);
+
+  // Command registered for `action` on `device`, its any_action when there is none.
+  Command find_command(const DeviceName &device, const char *action);
+} // namespace command_dispatch
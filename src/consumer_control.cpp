@@ -0,0 +1,68 @@
+#include "consumer_control.h"
+
+namespace consumer_control
+{
+  const uint8_t kReportDescriptor[] = {
+      0x05, 0x0C,                   // Usage Page (Consumer)
+      0x09, 0x01,                   // Usage (Consumer Control)
+      0xA1, 0x01,                   // Collection (Application)
+      0x85, kConsumerReportId,      //   Report ID
+      0x15, 0x00,                   //   Logical Minimum (0)
+      0x27, 0xFF, 0xFF, 0x00, 0x00, //   Logical Maximum (65535)
+      0x19, 0x00,                   //   Usage Minimum (0)
+      0x2A, 0xFF, 0xFF,             //   Usage Maximum (65535)
+      0x75, 0x10,                   //   Report Size (16)
+      0x95, 0x01,                   //   Report Count (1)
+      0x81, 0x00,                   //   Input (Data, Array, Absolute)
+      0xC0,                         // End Collection
+      0x05, 0x01,                   // Usage Page (Generic Desktop)
+      0x09, 0x80,                   // Usage (System Control)
+      0xA1, 0x01,                   // Collection (Application)
+      0x85, kSystemReportId,        //   Report ID
+      0x15, 0x01,                   //   Logical Minimum (1)
+      0x25, 0x03,                   //   Logical Maximum (3)
+      0x19, 0x81,                   //   Usage Minimum (System Power Down)
+      0x29, 0x83,                   //   Usage Maximum (System Wake Up)
+      0x75, 0x02,                   //   Report Size (2)
+      0x95, 0x01,                   //   Report Count (1)
+      0x81, 0x60,                   //   Input (Data, Array, Absolute, No Preferred, Null State)
+      0x75, 0x06,                   //   Report Size (6)
+      0x81, 0x03,                   //   Input (Constant) padding
+      0xC0                          // End Collection
+  };
+  const size_t kReportDescriptorSize = sizeof(kReportDescriptor);
+
+  void encode_consumer(uint16_t usage, uint8_t (&report)[kConsumerReportBytes])
+  {
+    report[0] = static_cast<uint8_t>(usage & 0xFF);
+    report[1] = static_cast<uint8_t>(usage >> 8);
+  }
+
+  void encode_system(uint16_t usage, uint8_t (&report)[kSystemReportBytes])
+  {
+    bool valid = usage >= kSystemPowerDown && usage <= kSystemWakeUp;
+    report[0] = valid ? static_cast<uint8_t>(usage - kSystemPowerDown + 1) : 0;
+  }
+
+  bool can_send(const Usage &usage)
+  {
+    if (hid_supported())
+    {
+      return usage.page == Page::Consumer || (usage.id >= kSystemPowerDown && usage.id <= kSystemWakeUp);
+    }
+    return usage.page == Page::Consumer && legacy_mask(usage.id) != 0;
+  }
+
+  __attribute__((weak)) bool hid_supported()
+  {
+    return false;
+  }
+
+  __attribute__((weak)) bool hid_send_report(uint8_t report_id, const uint8_t *report, size_t length)
+  {
+    (void)report_id;
+    (void)report;
+    (void)length;
+    return false;
+  }
+} // namespace consumer_control
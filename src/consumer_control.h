@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Consumer-control and system-control usages for {"device":"consumer"}. Names resolve at
+// compile time where they are constants and by binary search over a sorted constexpr table
+// otherwise; the table stays free of Arduino so the host tools can share it.
+//
+// BleCombo's media-key report is a 16-bit bitmap of fixed usages, so on its own it reaches
+// only the usages listed in kLegacyUsages. hid_collections::begin() adds kReportDescriptor
+// (a 16-bit consumer usage array and a Power/Sleep/Wake system-control collection) to the
+// combo device, and src/hid_collections.cpp overrides hid_supported() and hid_send_report()
+// so any usage can be sent.
+namespace consumer_control
+{
+  constexpr uint8_t kConsumerReportId = 5;
+  constexpr uint8_t kSystemReportId = 6;
+  constexpr size_t kConsumerReportBytes = 2;
+  constexpr size_t kSystemReportBytes = 1;
+
+  enum class Page : uint8_t
+  {
+    Consumer = 0x0C,
+    // Generic Desktop System Control: Power Down (0x81), Sleep (0x82), Wake Up (0x83).
+    System = 0x01
+  };
+
+  constexpr uint16_t kSystemPowerDown = 0x81;
+  constexpr uint16_t kSystemWakeUp = 0x83;
+
+  struct Usage
+  {
+    Page page;
+    uint16_t id;
+  };
+
+  struct NamedUsage
+  {
+    const char *name;
+    Usage usage;
+  };
+
+  // Sorted by name (byte order) for find(); a static_assert below keeps it that way.
+  constexpr NamedUsage kUsageNames[] = {
+      {"AC_PAN", {Page::Consumer, 0x0238}},
+      {"BRIGHTNESS_DOWN", {Page::Consumer, 0x0070}},
+      {"BRIGHTNESS_UP", {Page::Consumer, 0x006F}},
+      {"CALCULATOR", {Page::Consumer, 0x0192}},
+      {"CONTROL_PANEL", {Page::Consumer, 0x019F}},
+      {"EJECT", {Page::Consumer, 0x00B8}},
+      {"EMAIL", {Page::Consumer, 0x018A}},
+      {"FAST_FORWARD", {Page::Consumer, 0x00B3}},
+      {"FILE_BROWSER", {Page::Consumer, 0x0194}},
+      {"KEY_MEDIA_CALCULATOR", {Page::Consumer, 0x0192}},
+      {"KEY_MEDIA_CONSUMER_CONTROL_CONFIGURATION", {Page::Consumer, 0x0183}},
+      {"KEY_MEDIA_EMAIL_READER", {Page::Consumer, 0x018A}},
+      {"KEY_MEDIA_LOCAL_MACHINE_BROWSER", {Page::Consumer, 0x0194}},
+      {"KEY_MEDIA_MUTE", {Page::Consumer, 0x00E2}},
+      {"KEY_MEDIA_NEXT_TRACK", {Page::Consumer, 0x00B5}},
+      {"KEY_MEDIA_PLAY_PAUSE", {Page::Consumer, 0x00CD}},
+      {"KEY_MEDIA_PREVIOUS_TRACK", {Page::Consumer, 0x00B6}},
+      {"KEY_MEDIA_STOP", {Page::Consumer, 0x00B7}},
+      {"KEY_MEDIA_VOLUME_DOWN", {Page::Consumer, 0x00EA}},
+      {"KEY_MEDIA_VOLUME_UP", {Page::Consumer, 0x00E9}},
+      {"KEY_MEDIA_WWW_BACK", {Page::Consumer, 0x0224}},
+      {"KEY_MEDIA_WWW_BOOKMARKS", {Page::Consumer, 0x022A}},
+      {"KEY_MEDIA_WWW_HOME", {Page::Consumer, 0x0223}},
+      {"KEY_MEDIA_WWW_SEARCH", {Page::Consumer, 0x0221}},
+      {"KEY_MEDIA_WWW_STOP", {Page::Consumer, 0x0226}},
+      {"LOCAL_BROWSER", {Page::Consumer, 0x0194}},
+      {"MEDIA_NEXT", {Page::Consumer, 0x00B5}},
+      {"MEDIA_PLAY_PAUSE", {Page::Consumer, 0x00CD}},
+      {"MEDIA_PREV", {Page::Consumer, 0x00B6}},
+      {"MEDIA_PREVIOUS", {Page::Consumer, 0x00B6}},
+      {"MEDIA_SELECT", {Page::Consumer, 0x0183}},
+      {"MEDIA_STOP", {Page::Consumer, 0x00B7}},
+      {"MENU", {Page::Consumer, 0x0040}},
+      {"MUTE", {Page::Consumer, 0x00E2}},
+      {"NEXT_TRACK", {Page::Consumer, 0x00B5}},
+      {"PAUSE", {Page::Consumer, 0x00B1}},
+      {"PLAY", {Page::Consumer, 0x00B0}},
+      {"PLAY_PAUSE", {Page::Consumer, 0x00CD}},
+      {"POWER", {Page::System, 0x0081}},
+      {"PREVIOUS_TRACK", {Page::Consumer, 0x00B6}},
+      {"RECORD", {Page::Consumer, 0x00B2}},
+      {"REWIND", {Page::Consumer, 0x00B4}},
+      {"SCREEN_SAVER", {Page::Consumer, 0x01B1}},
+      {"SLEEP", {Page::System, 0x0082}},
+      {"SPREADSHEET", {Page::Consumer, 0x0186}},
+      {"SYSTEM_POWER", {Page::System, 0x0081}},
+      {"SYSTEM_SLEEP", {Page::System, 0x0082}},
+      {"SYSTEM_WAKE", {Page::System, 0x0083}},
+      {"TASK_MANAGER", {Page::Consumer, 0x01A6}},
+      {"TERMINAL_LOCK", {Page::Consumer, 0x019E}},
+      {"TEXT_EDITOR", {Page::Consumer, 0x0185}},
+      {"VOLUME_DOWN", {Page::Consumer, 0x00EA}},
+      {"VOLUME_UP", {Page::Consumer, 0x00E9}},
+      {"WAKE", {Page::System, 0x0083}},
+      {"WORD_PROCESSOR", {Page::Consumer, 0x0184}},
+      {"WWW_BACK", {Page::Consumer, 0x0224}},
+      {"WWW_BOOKMARKS", {Page::Consumer, 0x022A}},
+      {"WWW_FORWARD", {Page::Consumer, 0x0225}},
+      {"WWW_HOME", {Page::Consumer, 0x0223}},
+      {"WWW_REFRESH", {Page::Consumer, 0x0227}},
+      {"WWW_SEARCH", {Page::Consumer, 0x0221}},
+      {"WWW_STOP", {Page::Consumer, 0x0226}},
+      {"ZOOM_IN", {Page::Consumer, 0x022D}},
+      {"ZOOM_OUT", {Page::Consumer, 0x022E}}
+  };
+
+  constexpr size_t kUsageNameCount = sizeof(kUsageNames) / sizeof(kUsageNames[0]);
+
+  // Usages of BleCombo's media-key bitmap, in bit order (bit 0 of byte 0 first).
+  constexpr uint16_t kLegacyUsages[] = {0x00B5, 0x00B6, 0x00B7, 0x00CD, 0x00E2, 0x00E9, 0x00EA, 0x0223,
+                                        0x0194, 0x0192, 0x022A, 0x0221, 0x0226, 0x0224, 0x0183, 0x018A};
+
+  namespace detail
+  {
+    constexpr int compare(const char *a, const char *b)
+    {
+      return (*a != *b || *a == '\0') ? static_cast<int>(static_cast<unsigned char>(*a)) -
+                                            static_cast<int>(static_cast<unsigned char>(*b))
+                                      : compare(a + 1, b + 1);
+    }
+
+    constexpr bool sorted_from(size_t index)
+    {
+      return index >= kUsageNameCount ||
+             (compare(kUsageNames[index - 1].name, kUsageNames[index].name) < 0 && sorted_from(index + 1));
+    }
+
+    constexpr const NamedUsage *search(const char *name, size_t low, size_t high)
+    {
+      return low >= high ? nullptr
+             : compare(name, kUsageNames[low + (high - low) / 2].name) == 0
+                 ? &kUsageNames[low + (high - low) / 2]
+             : compare(name, kUsageNames[low + (high - low) / 2].name) < 0
+                 ? search(name, low, low + (high - low) / 2)
+                 : search(name, low + (high - low) / 2 + 1, high);
+    }
+
+    constexpr int legacy_bit_from(uint16_t usage, size_t bit)
+    {
+      return bit >= sizeof(kLegacyUsages) / sizeof(kLegacyUsages[0]) ? -1
+             : kLegacyUsages[bit] == usage                             ? static_cast<int>(bit)
+                                                                       : legacy_bit_from(usage, bit + 1);
+    }
+  } // namespace detail
+
+  static_assert(detail::sorted_from(1), "consumer_control::kUsageNames must stay sorted by name");
+
+  // Looks up an upper-case name; nullptr when unknown.
+  constexpr const NamedUsage *find(const char *name)
+  {
+    return detail::search(name, 0, kUsageNameCount);
+  }
+
+  // Bitmap of BleCombo's media-key report for a consumer usage, or 0 when it has no bit.
+  constexpr uint16_t legacy_mask(uint16_t usage)
+  {
+    return detail::legacy_bit_from(usage, 0) < 0 ? 0 : static_cast<uint16_t>(1u << detail::legacy_bit_from(usage, 0));
+  }
+
+  static_assert(find("VOLUME_UP") != nullptr && find("VOLUME_UP")->usage.id == 0x00E9, "name lookup");
+  static_assert(find("SLEEP")->usage.page == Page::System, "system-control names");
+  static_assert(find("VOLUME") == nullptr, "unknown names");
+  static_assert(legacy_mask(0x00CD) == 0x0008 && legacy_mask(0x018A) == 0x8000 && legacy_mask(0x006F) == 0,
+                "legacy bitmap order");
+
+  // Report map fragment for Report IDs kConsumerReportId and kSystemReportId.
+  extern const uint8_t kReportDescriptor[];
+  extern const size_t kReportDescriptorSize;
+
+  // Input report for `usage` without the report ID; id 0 encodes "released".
+  void encode_consumer(uint16_t usage, uint8_t (&report)[kConsumerReportBytes]);
+  void encode_system(uint16_t usage, uint8_t (&report)[kSystemReportBytes]);
+
+  // True when the usage can be sent by this build: any usage once hid_supported(),
+  // otherwise only consumer usages with a bit in kLegacyUsages.
+  bool can_send(const Usage &usage);
+
+  // Weak defaults for a report map with only BleCombo's media-key bitmap; overridden in
+  // src/hid_collections.cpp.
+  bool hid_supported();
+  bool hid_send_report(uint8_t report_id, const uint8_t *report, size_t length);
+} // namespace consumer_control
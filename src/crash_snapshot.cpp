@@ -0,0 +1,318 @@
+#include "crash_snapshot.h"
+
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#if __has_include("sdkconfig.h")
+#include <sdkconfig.h>
+#endif
+#if __has_include(<esp_core_dump.h>)
+#include <esp_core_dump.h>
+#endif
+
+#include <cstring>
+
+#if (defined(CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH) && CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH) || \
+    (defined(CONFIG_ESP32_ENABLE_COREDUMP_TO_FLASH) && CONFIG_ESP32_ENABLE_COREDUMP_TO_FLASH)
+#define CRASH_SNAPSHOT_HAS_FLASH_COREDUMP 1
+#else
+#define CRASH_SNAPSHOT_HAS_FLASH_COREDUMP 0
+#endif
+
+extern "C"
+{
+  void __real_esp_panic_handler(void *info);
+}
+
+namespace crash_snapshot
+{
+  namespace
+  {
+    constexpr size_t kCopyChunk = 256;
+
+    struct WatchedQueue
+    {
+      const char *name;
+      const QueueHandle_t *queue;
+      uint32_t capacity;
+    };
+
+    WatchedQueue watched_queues_[kMaxQueues] = {};
+    size_t watched_queue_count_ = 0;
+    const TaskHandle_t *watched_tasks_[kMaxTasks] = {};
+    size_t watched_task_count_ = 0;
+
+    // RTC slow memory is left alone by the bootloader on software and panic resets.
+    RTC_NOINIT_ATTR Snapshot saved_;
+    bool saved_valid_ = false;
+    volatile bool capturing_ = false;
+
+    uint32_t IRAM_ATTR checksum(const Snapshot &snapshot)
+    {
+      const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&snapshot);
+      uint32_t hash = 2166136261u;
+      for (size_t idx = 0; idx < offsetof(Snapshot, checksum); ++idx)
+      {
+        hash = (hash ^ bytes[idx]) * 16777619u;
+      }
+      return hash;
+    }
+
+    void IRAM_ATTR copy_name(char *out, const char *name)
+    {
+      size_t idx = 0;
+      if (name)
+      {
+        for (; idx + 1 < kNameLength && name[idx] != '\0'; ++idx)
+        {
+          out[idx] = name[idx];
+        }
+      }
+      for (; idx < kNameLength; ++idx)
+      {
+        out[idx] = '\0';
+      }
+    }
+
+    uint8_t IRAM_ATTR running_core(TaskHandle_t task)
+    {
+      for (BaseType_t core = 0; core < portNUM_PROCESSORS && core < static_cast<BaseType_t>(kCoreSlots); ++core)
+      {
+        if (xTaskGetCurrentTaskHandleForCPU(core) == task)
+        {
+          return static_cast<uint8_t>(core);
+        }
+      }
+      return kNotRunning;
+    }
+
+    // Only lock-free reads are used here: the other core is halted and may be holding
+    // any spinlock, so nothing that enters a critical section is safe to call.
+    void IRAM_ATTR capture(Snapshot &snapshot)
+    {
+      memset(&snapshot, 0, sizeof(snapshot));
+      snapshot.magic = kSnapshotMagic;
+      snapshot.version = kSnapshotVersion;
+      snapshot.size = sizeof(Snapshot);
+      snapshot.uptime_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+      snapshot.free_heap = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+      snapshot.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+      snapshot.task_total = uxTaskGetNumberOfTasks();
+      snapshot.panic_core = static_cast<uint8_t>(xPortGetCoreID());
+
+      for (BaseType_t core = 0; core < portNUM_PROCESSORS && core < static_cast<BaseType_t>(kCoreSlots); ++core)
+      {
+        TaskHandle_t current = xTaskGetCurrentTaskHandleForCPU(core);
+        copy_name(snapshot.current_task[core], current ? pcTaskGetName(current) : nullptr);
+      }
+
+      for (size_t idx = 0; idx < watched_queue_count_; ++idx)
+      {
+        const WatchedQueue &watched = watched_queues_[idx];
+        QueueSample &sample = snapshot.queues[snapshot.queue_count++];
+        copy_name(sample.name, watched.name);
+        sample.capacity = watched.capacity;
+        QueueHandle_t queue = watched.queue ? *watched.queue : nullptr;
+        sample.waiting = queue ? uxQueueMessagesWaitingFromISR(queue) : 0;
+      }
+
+      for (size_t idx = 0; idx < watched_task_count_; ++idx)
+      {
+        TaskHandle_t task = watched_tasks_[idx] ? *watched_tasks_[idx] : nullptr;
+        if (!task)
+        {
+          continue;
+        }
+        TaskSample &sample = snapshot.tasks[snapshot.task_count++];
+        copy_name(sample.name, pcTaskGetName(task));
+        sample.stack_free_bytes = uxTaskGetStackHighWaterMark(task);
+        sample.running_on_core = running_core(task);
+      }
+
+      for (size_t core = 0; core < portNUM_PROCESSORS && core < kCoreSlots; ++core)
+      {
+        snapshot.trace_count[core] = static_cast<uint16_t>(
+            trace::copy_recent(static_cast<uint8_t>(core), snapshot.trace[core], kTraceEventsPerCore));
+      }
+
+      snapshot.checksum = checksum(snapshot);
+    }
+
+    const esp_partition_t *coredump_partition()
+    {
+      return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_COREDUMP, nullptr);
+    }
+
+    bool coredump_location(size_t &offset, size_t &size)
+    {
+#if CRASH_SNAPSHOT_HAS_FLASH_COREDUMP
+      const esp_partition_t *partition = coredump_partition();
+      size_t address = 0;
+      if (!partition || esp_core_dump_image_get(&address, &size) != ESP_OK || size == 0)
+      {
+        return false;
+      }
+      if (address < partition->address || address + size > partition->address + partition->size)
+      {
+        return false;
+      }
+      offset = address - partition->address;
+      return true;
+#else
+      (void)offset;
+      (void)size;
+      return false;
+#endif
+    }
+  } // namespace
+
+  void begin()
+  {
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool survived = reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+                    reason == ESP_RST_WDT || reason == ESP_RST_SW;
+    saved_valid_ = survived && saved_.magic == kSnapshotMagic && saved_.version == kSnapshotVersion &&
+                   saved_.size == sizeof(Snapshot) && saved_.checksum == checksum(saved_);
+    if (!saved_valid_)
+    {
+      memset(&saved_, 0, sizeof(saved_));
+    }
+  }
+
+  void watch_queue(const char *name, const QueueHandle_t *queue, uint32_t capacity)
+  {
+    if (!queue || watched_queue_count_ >= kMaxQueues)
+    {
+      return;
+    }
+    for (size_t idx = 0; idx < watched_queue_count_; ++idx)
+    {
+      if (watched_queues_[idx].queue == queue)
+      {
+        return;
+      }
+    }
+    watched_queues_[watched_queue_count_++] = {name, queue, capacity};
+  }
+
+  void watch_task(const TaskHandle_t *task)
+  {
+    if (!task || watched_task_count_ >= kMaxTasks)
+    {
+      return;
+    }
+    for (size_t idx = 0; idx < watched_task_count_; ++idx)
+    {
+      if (watched_tasks_[idx] == task)
+      {
+        return;
+      }
+    }
+    watched_tasks_[watched_task_count_++] = task;
+  }
+
+  bool has_snapshot()
+  {
+    return saved_valid_;
+  }
+
+  bool has_coredump()
+  {
+    size_t offset = 0;
+    size_t size = 0;
+    return coredump_location(offset, size);
+  }
+
+  size_t write_container(bool (*write)(void *context, const uint8_t *data, size_t length), void *context)
+  {
+    if (!write)
+    {
+      return 0;
+    }
+
+    size_t coredump_offset = 0;
+    size_t coredump_size = 0;
+    bool coredump = coredump_location(coredump_offset, coredump_size);
+    if (!saved_valid_ && !coredump)
+    {
+      return 0;
+    }
+
+    ContainerHeader header = {};
+    header.magic = kContainerMagic;
+    header.version = kContainerVersion;
+    header.header_size = sizeof(ContainerHeader);
+    header.reset_reason = static_cast<uint32_t>(esp_reset_reason());
+    header.snapshot_size = saved_valid_ ? sizeof(Snapshot) : 0;
+    header.coredump_size = coredump ? coredump_size : 0;
+
+    size_t written = 0;
+    if (!write(context, reinterpret_cast<const uint8_t *>(&header), sizeof(header)))
+    {
+      return 0;
+    }
+    written += sizeof(header);
+
+    if (saved_valid_)
+    {
+      // Copy out of RTC memory first; it is only word-addressable on the ESP32.
+      Snapshot copy;
+      memcpy(&copy, &saved_, sizeof(copy));
+      if (!write(context, reinterpret_cast<const uint8_t *>(&copy), sizeof(copy)))
+      {
+        return 0;
+      }
+      written += sizeof(copy);
+    }
+
+    if (coredump)
+    {
+      const esp_partition_t *partition = coredump_partition();
+      uint8_t chunk[kCopyChunk];
+      size_t remaining = coredump_size;
+      size_t offset = coredump_offset;
+      while (remaining > 0)
+      {
+        size_t length = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+        if (esp_partition_read(partition, offset, chunk, length) != ESP_OK || !write(context, chunk, length))
+        {
+          return 0;
+        }
+        offset += length;
+        remaining -= length;
+        written += length;
+      }
+    }
+    return written;
+  }
+
+  bool erase()
+  {
+    saved_valid_ = false;
+    memset(&saved_, 0, sizeof(saved_));
+
+    const esp_partition_t *partition = coredump_partition();
+    if (!partition)
+    {
+      return true;
+    }
+    return esp_partition_erase_range(partition, 0, partition->size) == ESP_OK;
+  }
+} // namespace crash_snapshot
+
+extern "C"
+{
+  // ESP-IDF calls this for every panic, abort and interrupt watchdog before the core dump
+  // is written. A fault inside capture() re-enters the handler, so it only runs once.
+  void IRAM_ATTR __wrap_esp_panic_handler(void *info)
+  {
+    if (!crash_snapshot::capturing_)
+    {
+      crash_snapshot::capturing_ = true;
+      crash_snapshot::capture(crash_snapshot::saved_);
+    }
+    __real_esp_panic_handler(info);
+  }
+}
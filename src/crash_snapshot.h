@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "trace.h"
+
+// Panic-time capture of the firmware's perf counters. The panic handler is wrapped
+// (-Wl,--wrap=esp_panic_handler) so a snapshot of queue depths, heap statistics, watched
+// task stacks and the most recent trace events lands in RTC memory that survives the
+// reset, right before ESP-IDF writes its core dump to the coredump partition. After the
+// reboot both are served together from /api/coredump; tools/coredump_decode.py splits
+// and decodes the download.
+namespace crash_snapshot
+{
+  constexpr size_t kNameLength = 16;
+  constexpr size_t kMaxQueues = 4;
+  constexpr size_t kMaxTasks = 8;
+  constexpr size_t kCoreSlots = 2;
+  constexpr size_t kTraceEventsPerCore = 32;
+
+  constexpr uint32_t kSnapshotMagic = 0x50534E43; // "CNSP"
+  constexpr uint16_t kSnapshotVersion = 1;
+  constexpr uint8_t kNotRunning = 0xFF;
+
+  struct QueueSample
+  {
+    char name[kNameLength];
+    uint32_t waiting;
+    uint32_t capacity;
+  };
+  static_assert(sizeof(QueueSample) == 24, "crash_snapshot::QueueSample is part of the dump format");
+
+  struct TaskSample
+  {
+    char name[kNameLength];
+    uint32_t stack_free_bytes;
+    uint8_t running_on_core; // kNotRunning when the task was not on a CPU
+    uint8_t reserved[3];
+  };
+  static_assert(sizeof(TaskSample) == 24, "crash_snapshot::TaskSample is part of the dump format");
+
+  // Layout is little endian and mirrored by tools/coredump_decode.py.
+  struct Snapshot
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t uptime_ms;
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t task_total;
+    uint8_t panic_core;
+    uint8_t queue_count;
+    uint8_t task_count;
+    uint8_t reserved;
+    char current_task[kCoreSlots][kNameLength];
+    QueueSample queues[kMaxQueues];
+    TaskSample tasks[kMaxTasks];
+    uint16_t trace_count[kCoreSlots];
+    trace::Event trace[kCoreSlots][kTraceEventsPerCore];
+    uint32_t checksum; // FNV-1a over every preceding byte
+  };
+  static_assert(sizeof(Snapshot) == 1124, "crash_snapshot::Snapshot is part of the dump format");
+
+  // /api/coredump download: ContainerHeader, snapshot_size bytes of Snapshot, then
+  // coredump_size bytes of the raw core dump image as stored in flash.
+  constexpr uint32_t kContainerMagic = 0x43444348; // "HCDC"
+  constexpr uint16_t kContainerVersion = 1;
+
+  struct ContainerHeader
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t reset_reason;
+    uint32_t snapshot_size;
+    uint32_t coredump_size;
+  };
+  static_assert(sizeof(ContainerHeader) == 20, "crash_snapshot::ContainerHeader is part of the dump format");
+
+  // Validates whatever the previous boot left in RTC memory. Call once early in setup().
+  void begin();
+
+  // Registers state to sample at panic time. Handles are read through the pointer so
+  // queues and tasks that are recreated later are still picked up.
+  void watch_queue(const char *name, const QueueHandle_t *queue, uint32_t capacity);
+  void watch_task(const TaskHandle_t *task);
+
+  bool has_snapshot();
+  bool has_coredump();
+
+  // Streams the container through `write`, which returns false to abort. Returns the
+  // number of bytes written, or 0 when there is nothing to download or on failure.
+  size_t write_container(bool (*write)(void *context, const uint8_t *data, size_t length), void *context);
+
+  // Drops the saved snapshot and erases the coredump partition.
+  bool erase();
+} // namespace crash_snapshot
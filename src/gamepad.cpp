@@ -0,0 +1,255 @@
+#include "gamepad.h"
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#if __has_include("sdkconfig.h")
+#include <sdkconfig.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+
+#include "crash_snapshot.h"
+#include "memory_budget.h"
+#include "task_monitor.h"
+#include "trace.h"
+
+namespace gamepad
+{
+  const uint8_t kReportDescriptor[] = {
+      0x05, 0x01,             // Usage Page (Generic Desktop)
+      0x09, 0x05,             // Usage (Game Pad)
+      0xA1, 0x01,             // Collection (Application)
+      0x85, kReportId,        //   Report ID
+      0x05, 0x09,             //   Usage Page (Button)
+      0x19, 0x01,             //   Usage Minimum (1)
+      0x29, kButtonCount,     //   Usage Maximum (32)
+      0x15, 0x00,             //   Logical Minimum (0)
+      0x25, 0x01,             //   Logical Maximum (1)
+      0x75, 0x01,             //   Report Size (1)
+      0x95, kButtonCount,     //   Report Count (32)
+      0x81, 0x02,             //   Input (Data, Variable, Absolute)
+      0x05, 0x01,             //   Usage Page (Generic Desktop)
+      0x09, 0x30,             //   Usage (X)      left stick
+      0x09, 0x31,             //   Usage (Y)
+      0x09, 0x32,             //   Usage (Z)      right stick
+      0x09, 0x35,             //   Usage (Rz)
+      0x16, 0x01, 0x80,       //   Logical Minimum (-32767)
+      0x26, 0xFF, 0x7F,       //   Logical Maximum (32767)
+      0x75, 0x10,             //   Report Size (16)
+      0x95, kAxisCount,       //   Report Count (4)
+      0x81, 0x02,             //   Input (Data, Variable, Absolute)
+      0x09, 0x33,             //   Usage (Rx)     left trigger
+      0x09, 0x34,             //   Usage (Ry)     right trigger
+      0x15, 0x00,             //   Logical Minimum (0)
+      0x26, 0xFF, 0x00,       //   Logical Maximum (255)
+      0x75, 0x08,             //   Report Size (8)
+      0x95, kTriggerCount,    //   Report Count (2)
+      0x81, 0x02,             //   Input (Data, Variable, Absolute)
+      0x09, 0x39,             //   Usage (Hat Switch)
+      0x15, 0x00,             //   Logical Minimum (0)
+      0x25, 0x07,             //   Logical Maximum (7)
+      0x35, 0x00,             //   Physical Minimum (0)
+      0x46, 0x3B, 0x01,       //   Physical Maximum (315)
+      0x65, 0x14,             //   Unit (Degrees)
+      0x75, 0x04,             //   Report Size (4)
+      0x95, 0x01,             //   Report Count (1)
+      0x81, 0x42,             //   Input (Data, Variable, Absolute, Null State)
+      0x65, 0x00,             //   Unit (None)
+      0x81, 0x03,             //   Input (Constant) padding nibble
+      0xC0                    // End Collection
+  };
+  const size_t kReportDescriptorSize = sizeof(kReportDescriptor);
+
+  namespace
+  {
+#if defined(CONFIG_BT_NIMBLE_PINNED_TO_CORE)
+    constexpr BaseType_t kGamepadTaskCore = (CONFIG_BT_NIMBLE_PINNED_TO_CORE == 0) ? 1 : 0;
+#elif defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
+    constexpr BaseType_t kGamepadTaskCore = tskNO_AFFINITY;
+#elif defined(CONFIG_ARDUINO_RUNNING_CORE)
+    constexpr BaseType_t kGamepadTaskCore = (CONFIG_ARDUINO_RUNNING_CORE == 0) ? 1 : 0;
+#else
+    constexpr BaseType_t kGamepadTaskCore = 0;
+#endif
+
+    static_assert(sizeof(State) <= memory_budget::kGamepadStateBytes, "gamepad::State outgrew its entry in memory_budget.h");
+
+    Callbacks callbacks_;
+    QueueHandle_t mailbox_ = nullptr;
+    TaskHandle_t task_handle_ = nullptr;
+    uint8_t mailbox_storage_[memory_budget::kGamepadQueueLength * sizeof(State)];
+    StaticQueue_t mailbox_buffer_;
+    StackType_t task_stack_[memory_budget::kGamepadStackBytes];
+    StaticTask_t task_buffer_;
+
+    std::atomic<uint16_t> interval_ms_{kDefaultIntervalMs};
+    std::atomic<uint32_t> submitted_{0};
+    std::atomic<uint32_t> sent_{0};
+    std::atomic<uint32_t> unchanged_{0};
+    std::atomic<uint32_t> failed_{0};
+
+    void put_u16(uint8_t *out, uint16_t value)
+    {
+      out[0] = static_cast<uint8_t>(value & 0xFF);
+      out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void gamepad_task(void *param)
+    {
+      (void)param;
+      State pending;
+      State last_sent;
+      bool have_sent = false;
+
+      for (;;)
+      {
+        if (xQueueReceive(mailbox_, &pending, portMAX_DELAY) != pdPASS)
+        {
+          continue;
+        }
+        trace::record(trace::EventType::TaskWake, trace::TaskId::Gamepad);
+        if (have_sent && pending == last_sent)
+        {
+          // Several updates that cancelled out within one interval.
+          unchanged_.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        uint8_t report[kReportBytes];
+        encode(pending, report);
+        bool ok = callbacks_.is_connected && callbacks_.is_connected() && callbacks_.send_report &&
+                  callbacks_.send_report(report, sizeof(report));
+        if (ok)
+        {
+          last_sent = pending;
+          have_sent = true;
+          sent_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+          // The host's view is unknown after a failure, so the next state is sent even if
+          // it matches the last one that went out.
+          have_sent = false;
+          failed_.fetch_add(1, std::memory_order_relaxed);
+        }
+        // One report per interval; anything submitted meanwhile collapses in the mailbox.
+        vTaskDelay(pdMS_TO_TICKS(interval_ms_.load(std::memory_order_relaxed)));
+      }
+    }
+  } // namespace
+
+  bool State::operator==(const State &other) const
+  {
+    return buttons == other.buttons && memcmp(axes, other.axes, sizeof(axes)) == 0 &&
+           memcmp(triggers, other.triggers, sizeof(triggers)) == 0 && hat == other.hat;
+  }
+
+  void encode(const State &state, uint8_t (&report)[kReportBytes])
+  {
+    report[0] = static_cast<uint8_t>(state.buttons & 0xFF);
+    report[1] = static_cast<uint8_t>((state.buttons >> 8) & 0xFF);
+    report[2] = static_cast<uint8_t>((state.buttons >> 16) & 0xFF);
+    report[3] = static_cast<uint8_t>((state.buttons >> 24) & 0xFF);
+    for (size_t axis = 0; axis < kAxisCount; ++axis)
+    {
+      put_u16(report + 4 + axis * 2, static_cast<uint16_t>(state.axes[axis]));
+    }
+    report[12] = state.triggers[LeftTrigger];
+    report[13] = state.triggers[RightTrigger];
+    report[14] = state.hat <= 7 ? state.hat : kHatCentered;
+  }
+
+  bool begin(const Callbacks &callbacks)
+  {
+    if (task_handle_)
+    {
+      return true;
+    }
+    callbacks_ = callbacks;
+    if (!mailbox_)
+    {
+      mailbox_ = xQueueCreateStatic(memory_budget::kGamepadQueueLength, sizeof(State), mailbox_storage_,
+                                    &mailbox_buffer_);
+      crash_snapshot::watch_queue("gamepad", &mailbox_, memory_budget::kGamepadQueueLength);
+    }
+    if (!mailbox_)
+    {
+      return false;
+    }
+
+    constexpr uint32_t stack_size = sizeof(task_stack_);
+    // Above the transport pump, so a burst of commands cannot starve the report stream.
+    constexpr UBaseType_t priority = tskIDLE_PRIORITY + 3;
+#if defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
+    task_handle_ = xTaskCreateStatic(gamepad_task, "gamepad", stack_size, nullptr, priority, task_stack_, &task_buffer_);
+#else
+    task_handle_ = xTaskCreateStaticPinnedToCore(gamepad_task,
+                                                 "gamepad",
+                                                 stack_size,
+                                                 nullptr,
+                                                 priority,
+                                                 task_stack_,
+                                                 &task_buffer_,
+                                                 kGamepadTaskCore);
+#endif
+    if (!task_handle_)
+    {
+      return false;
+    }
+    crash_snapshot::watch_task(&task_handle_);
+    task_monitor::watch("gamepad", &task_handle_, stack_size);
+    return true;
+  }
+
+  bool submit(const State &state)
+  {
+    if (!mailbox_ || xQueueOverwrite(mailbox_, &state) != pdPASS)
+    {
+      return false;
+    }
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  void set_interval_ms(uint16_t interval_ms)
+  {
+    if (interval_ms < kMinIntervalMs)
+    {
+      interval_ms = kMinIntervalMs;
+    }
+    if (interval_ms > kMaxIntervalMs)
+    {
+      interval_ms = kMaxIntervalMs;
+    }
+    interval_ms_.store(interval_ms, std::memory_order_relaxed);
+  }
+
+  uint16_t interval_ms()
+  {
+    return interval_ms_.load(std::memory_order_relaxed);
+  }
+
+  void append_stats_json(JsonVariant doc)
+  {
+    doc["supported"] = hid_supported();
+    doc["intervalMs"] = interval_ms();
+    doc["submitted"] = submitted_.load(std::memory_order_relaxed);
+    doc["sent"] = sent_.load(std::memory_order_relaxed);
+    doc["unchanged"] = unchanged_.load(std::memory_order_relaxed);
+    doc["failed"] = failed_.load(std::memory_order_relaxed);
+  }
+
+  __attribute__((weak)) bool hid_supported()
+  {
+    return false;
+  }
+
+  __attribute__((weak)) bool hid_send_report(const uint8_t *report, size_t length)
+  {
+    (void)report;
+    (void)length;
+    return false;
+  }
+} // namespace gamepad
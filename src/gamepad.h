@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ArduinoJson.h>
+
+// Gamepad input report and the task that streams it. Commands update a desired State and
+// hand it over with submit(); the "gamepad" task sends the newest state it has, skips it
+// when it equals the last report sent, and then waits one report interval. States
+// submitted while it waits replace each other, so a controller driven faster than the BLE
+// connection interval costs one notification per interval rather than a growing backlog.
+namespace gamepad
+{
+  // Report ID of the gamepad collection, after BleCombo's keyboard (1), media keys (2)
+  // and mouse (3).
+  constexpr uint8_t kReportId = 4;
+  constexpr size_t kButtonCount = 32;
+  constexpr size_t kAxisCount = 4;
+  constexpr size_t kTriggerCount = 2;
+  // Buttons (4), four 16-bit axes (8), two 8-bit triggers (2), hat switch (1).
+  constexpr size_t kReportBytes = 15;
+  constexpr int16_t kAxisMax = 32767;
+  constexpr uint8_t kTriggerMax = 255;
+  // Hat positions run clockwise from 0 (up) to 7 (up-left); anything outside is the null
+  // state the descriptor declares, i.e. centred.
+  constexpr uint8_t kHatCentered = 0x0F;
+
+  // The minimum BLE connection interval is 7.5 ms; most hosts settle on 7.5 to 15 ms.
+  constexpr uint16_t kDefaultIntervalMs = 8;
+  constexpr uint16_t kMinIntervalMs = 1;
+  constexpr uint16_t kMaxIntervalMs = 100;
+
+  enum Axis : uint8_t
+  {
+    LeftX = 0,
+    LeftY = 1,
+    RightX = 2,
+    RightY = 3
+  };
+
+  enum Trigger : uint8_t
+  {
+    LeftTrigger = 0,
+    RightTrigger = 1
+  };
+
+  struct State
+  {
+    // Bit n is button n + 1.
+    uint32_t buttons = 0;
+    int16_t axes[kAxisCount] = {};
+    uint8_t triggers[kTriggerCount] = {};
+    uint8_t hat = kHatCentered;
+
+    bool operator==(const State &other) const;
+    bool operator!=(const State &other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  // Report map fragment for the gamepad collection (Report ID kReportId), appended to the
+  // combo device's report map by hid_collections::begin().
+  extern const uint8_t kReportDescriptor[];
+  extern const size_t kReportDescriptorSize;
+
+  // Little-endian input report for `state`, without the report ID.
+  void encode(const State &state, uint8_t (&report)[kReportBytes]);
+
+  struct Callbacks
+  {
+    bool (*is_connected)() = nullptr;
+    // Sends one input report; false when it was not sent.
+    bool (*send_report)(const uint8_t *report, size_t length) = nullptr;
+  };
+
+  // Creates the mailbox and the streaming task; safe to call more than once.
+  bool begin(const Callbacks &callbacks);
+  // Passes the desired state to the streaming task, replacing one it has not sent yet.
+  // False before begin().
+  bool submit(const State &state);
+
+  void set_interval_ms(uint16_t interval_ms);
+  uint16_t interval_ms();
+
+  void append_stats_json(JsonVariant doc);
+
+  // HID hooks. The weak defaults here support nothing and send nothing; src/hid_collections.cpp
+  // overrides both to notify the gamepad input report on the vendored combo device.
+  bool hid_supported();
+  bool hid_send_report(const uint8_t *report, size_t length);
+} // namespace gamepad
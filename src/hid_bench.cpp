@@ -0,0 +1,400 @@
+#include "hid_bench.h"
+
+#include "alloc_counter.h"
+#include "command_dispatch.h"
+
+#include <Arduino.h>
+#include <BleCombo.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <strings.h>
+
+namespace hid_bench
+{
+  namespace
+  {
+    constexpr size_t kChannelCount = 3;
+    constexpr const MediaKeyReport kEmptyMediaReport = {0, 0};
+
+    size_t channel_index(ReportKind kind)
+    {
+      return static_cast<size_t>(kind) % kChannelCount;
+    }
+
+    ReportKind kind_for_slot(const Config &config, uint32_t slot)
+    {
+      if (config.kind != ReportKind::Mixed)
+      {
+        return config.kind;
+      }
+      return static_cast<ReportKind>(slot % kChannelCount);
+    }
+
+    // Each synthetic report is chosen so the host sees no net effect: empty keyboard and consumer
+    // reports, and mouse moves that alternate direction.
+    void send_report(ReportKind kind, uint32_t slot)
+    {
+      switch (kind)
+      {
+      case ReportKind::Keyboard:
+        Keyboard.releaseAll();
+        break;
+      case ReportKind::Consumer:
+        Keyboard.release(kEmptyMediaReport);
+        break;
+      case ReportKind::Mouse:
+      default:
+        Mouse.move((slot & 0x2) ? -1 : 1, 0, 0, 0);
+        break;
+      }
+    }
+
+    void wait_until(int64_t deadline_us)
+    {
+      int64_t remaining = deadline_us - esp_timer_get_time();
+      if (remaining > 2000)
+      {
+        vTaskDelay(pdMS_TO_TICKS(static_cast<uint32_t>((remaining - 1000) / 1000)));
+        remaining = deadline_us - esp_timer_get_time();
+      }
+      if (remaining > 0)
+      {
+        delayMicroseconds(static_cast<uint32_t>(remaining));
+      }
+    }
+
+    struct CorpusEntry
+    {
+      const char *name;
+      const char *payload;
+    };
+
+    // Representative payloads for each handler path. Delays are zeroed so the numbers
+    // reflect parsing and dispatch rather than typing pauses.
+    const CorpusEntry PARSE_CORPUS[kParseCorpusSize] = {
+        {"mouse_move", "{\"device\":\"mouse\",\"action\":\"move\",\"dx\":5,\"dy\":-3}"},
+        {"mouse_click", "{\"device\":\"mouse\",\"action\":\"click\",\"buttons\":[\"left\"]}"},
+        {"key_tap", "{\"device\":\"keyboard\",\"action\":\"tap\",\"keys\":[\"CTRL\",\"ALT\",\"DELETE\"],\"holdMs\":0}"},
+        {"key_fn", "{\"device\":\"keyboard\",\"action\":\"press\",\"keys\":[\"KEY_F12\"]}"},
+        {"key_write", "{\"device\":\"keyboard\",\"action\":\"write\",\"text\":\"The quick brown fox jumps over the lazy dog\",\"charDelayMs\":0}"},
+        {"consumer", "{\"device\":\"consumer\",\"keys\":[\"VOLUME_UP\"],\"gapMs\":0}"},
+        {"invalid_key", "{\"device\":\"keyboard\",\"action\":\"press\",\"keys\":[\"NOT_A_KEY\"]}"}};
+
+    uint32_t clamp_u32(int64_t value, uint32_t min_value, uint32_t max_value)
+    {
+      if (value < static_cast<int64_t>(min_value))
+      {
+        return min_value;
+      }
+      if (value > static_cast<int64_t>(max_value))
+      {
+        return max_value;
+      }
+      return static_cast<uint32_t>(value);
+    }
+
+    const command_dispatch::DeviceName *device_name(command_dispatch::Device device)
+    {
+      for (const command_dispatch::DeviceName &name : command_dispatch::kDevices)
+      {
+        if (name.device == device)
+        {
+          return &name;
+        }
+      }
+      return nullptr;
+    }
+
+    void time_dispatch(uint32_t iterations, ParseResult &result)
+    {
+      for (const command_dispatch::Route &route : command_dispatch::kRoutes)
+      {
+        const command_dispatch::DeviceName *device = device_name(route.device);
+        if (!device)
+        {
+          continue;
+        }
+        uint32_t start = ESP.getCycleCount();
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+        {
+          if (command_dispatch::find_command(*device, route.action) != route.command)
+          {
+            return;
+          }
+        }
+        uint32_t cycles = (ESP.getCycleCount() - start) / iterations;
+        if (result.dispatch_routes == 0 || cycles < result.dispatch_min_cycles)
+        {
+          result.dispatch_min_cycles = cycles;
+        }
+        if (cycles > result.dispatch_max_cycles)
+        {
+          result.dispatch_max_cycles = cycles;
+        }
+        ++result.dispatch_routes;
+      }
+    }
+
+    // [sent, failed, hz, callAvgUs, callMaxUs, delayAvgUs, delayMaxUs]; see kMaxResultJsonBytes.
+    void append_channel_json(const ChannelStats &stats, uint32_t elapsed_us, JsonArray out)
+    {
+      out.add(stats.sent);
+      out.add(stats.failed);
+      double hz = elapsed_us ? (stats.sent * 1000000.0) / elapsed_us : 0.0;
+      out.add(round((hz < kMaxReportedHz ? hz : kMaxReportedHz) * 10.0) / 10.0);
+      uint32_t attempts = stats.sent + stats.failed;
+      out.add(attempts ? static_cast<uint32_t>(stats.call_us_total / attempts) : 0);
+      out.add(stats.call_us_max);
+      out.add(attempts ? static_cast<uint32_t>(stats.delay_us_total / attempts) : 0);
+      out.add(stats.delay_us_max);
+    }
+  } // namespace
+
+  const char *kind_to_string(ReportKind kind)
+  {
+    switch (kind)
+    {
+    case ReportKind::Keyboard:
+      return "keyboard";
+    case ReportKind::Consumer:
+      return "consumer";
+    case ReportKind::Mixed:
+      return "mixed";
+    case ReportKind::Mouse:
+    default:
+      return "mouse";
+    }
+  }
+
+  bool string_to_kind(const char *value, ReportKind &kind)
+  {
+    if (!value)
+    {
+      return false;
+    }
+    if (strcasecmp(value, "keyboard") == 0)
+    {
+      kind = ReportKind::Keyboard;
+      return true;
+    }
+    if (strcasecmp(value, "mouse") == 0)
+    {
+      kind = ReportKind::Mouse;
+      return true;
+    }
+    if (strcasecmp(value, "consumer") == 0 || strcasecmp(value, "media") == 0)
+    {
+      kind = ReportKind::Consumer;
+      return true;
+    }
+    if (strcasecmp(value, "mixed") == 0 || strcasecmp(value, "all") == 0)
+    {
+      kind = ReportKind::Mixed;
+      return true;
+    }
+    return false;
+  }
+
+  Config parse_config(JsonVariantConst command)
+  {
+    Config config;
+    ReportKind kind = config.kind;
+    if (string_to_kind(command["kind"] | "mouse", kind))
+    {
+      config.kind = kind;
+    }
+
+    JsonVariantConst rate = command["rateHz"];
+    if (rate.isNull())
+    {
+      rate = command["rate_hz"];
+    }
+    if (!rate.isNull())
+    {
+      config.rate_hz = static_cast<uint16_t>(clamp_u32(rate.as<int>(), kMinRateHz, kMaxRateHz));
+    }
+
+    JsonVariantConst duration = command["durationMs"];
+    if (duration.isNull())
+    {
+      duration = command["duration_ms"];
+    }
+    if (!duration.isNull())
+    {
+      config.duration_ms = clamp_u32(duration.as<long>(), kMinDurationMs, kMaxDurationMs);
+    }
+    return config;
+  }
+
+  bool run(const Config &config, Result &result)
+  {
+    result = Result();
+    result.config = config;
+
+    if (!Keyboard.isConnected())
+    {
+      return false;
+    }
+
+    // Mixed runs interleave the three report types so each one still reaches the requested rate.
+    uint32_t slots_per_period = (config.kind == ReportKind::Mixed) ? kChannelCount : 1;
+    int64_t period_us = 1000000LL / (static_cast<int64_t>(config.rate_hz) * slots_per_period);
+    if (period_us < 1)
+    {
+      period_us = 1;
+    }
+
+    const int64_t start_us = esp_timer_get_time();
+    const int64_t end_us = start_us + static_cast<int64_t>(config.duration_ms) * 1000LL;
+    int64_t next_us = start_us;
+    uint32_t slot = 0;
+
+    while (next_us < end_us)
+    {
+      wait_until(next_us);
+
+      int64_t issue_us = esp_timer_get_time();
+      ReportKind kind = kind_for_slot(config, slot);
+      ChannelStats &stats = result.channels[channel_index(kind)];
+      uint32_t delay_us = static_cast<uint32_t>(issue_us - next_us);
+
+      if (Keyboard.isConnected())
+      {
+        send_report(kind, slot);
+        ++stats.sent;
+      }
+      else
+      {
+        ++stats.failed;
+        result.aborted = true;
+      }
+
+      int64_t done_us = esp_timer_get_time();
+      uint32_t call_us = static_cast<uint32_t>(done_us - issue_us);
+      stats.call_us_total += call_us;
+      if (call_us > stats.call_us_max)
+      {
+        stats.call_us_max = call_us;
+      }
+      stats.delay_us_total += delay_us;
+      if (delay_us > stats.delay_us_max)
+      {
+        stats.delay_us_max = delay_us;
+      }
+
+      if (result.aborted)
+      {
+        break;
+      }
+
+      // Keep the schedule anchored to the start time; slots that have already passed are
+      // counted as missed rather than sent in a burst.
+      ++slot;
+      next_us += period_us;
+      if (done_us > next_us)
+      {
+        int64_t behind = (done_us - next_us) / period_us;
+        result.missed_slots += static_cast<uint32_t>(behind);
+        slot += static_cast<uint32_t>(behind);
+        next_us += behind * period_us;
+      }
+    }
+
+    result.elapsed_us = static_cast<uint32_t>(esp_timer_get_time() - start_us);
+    return true;
+  }
+
+  bool run_parse_bench(const ParseBenchHooks &hooks, uint32_t iterations, ParseResult &result)
+  {
+    result = ParseResult();
+    if (!hooks.process_command || !hooks.begin_isolation || !hooks.end_isolation)
+    {
+      return false;
+    }
+
+    if (iterations == 0)
+    {
+      iterations = kDefaultParseIterations;
+    }
+    if (iterations > kMaxParseIterations)
+    {
+      iterations = kMaxParseIterations;
+    }
+    result.iterations = iterations;
+    result.cpu_mhz = getCpuFrequencyMhz();
+
+    for (size_t idx = 0; idx < kParseCorpusSize; ++idx)
+    {
+      result.samples[idx].name = PARSE_CORPUS[idx].name;
+    }
+
+    hooks.begin_isolation();
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+      for (size_t idx = 0; idx < kParseCorpusSize; ++idx)
+      {
+        ParseSample &sample = result.samples[idx];
+        alloc_counter::track_task(self);
+        uint32_t start = ESP.getCycleCount();
+        hooks.process_command(PARSE_CORPUS[idx].payload);
+        uint32_t cycles = ESP.getCycleCount() - start;
+        sample.allocations_total += alloc_counter::allocations();
+        sample.cycles_total += cycles;
+      }
+    }
+    alloc_counter::track_task(nullptr);
+    hooks.end_isolation();
+    time_dispatch(iterations, result);
+    return true;
+  }
+
+  void append_parse_result_json(const ParseResult &result, JsonVariant doc)
+  {
+    doc["iterations"] = result.iterations;
+    doc["cpuMhz"] = result.cpu_mhz;
+    JsonObject samples = doc["results"].to<JsonObject>();
+    for (size_t idx = 0; idx < kParseCorpusSize; ++idx)
+    {
+      const ParseSample &sample = result.samples[idx];
+      if (!sample.name || result.iterations == 0)
+      {
+        continue;
+      }
+      JsonObject entry = samples[sample.name].to<JsonObject>();
+      entry["cycles"] = static_cast<uint32_t>(sample.cycles_total / result.iterations);
+      double allocations = static_cast<double>(sample.allocations_total) / result.iterations;
+      entry["allocs"] = round(allocations * 100.0) / 100.0;
+    }
+    JsonObject dispatch = doc["dispatch"].to<JsonObject>();
+    dispatch["routes"] = result.dispatch_routes;
+    dispatch["minCycles"] = result.dispatch_min_cycles;
+    dispatch["maxCycles"] = result.dispatch_max_cycles;
+  }
+
+  void append_result_json(const Result &result, JsonVariant doc)
+  {
+    doc["kind"] = kind_to_string(result.config.kind);
+    doc["rateHz"] = result.config.rate_hz;
+    doc["durationMs"] = result.config.duration_ms;
+    doc["elapsedMs"] = result.elapsed_us / 1000;
+    doc["missed"] = result.missed_slots;
+    if (result.aborted)
+    {
+      doc["aborted"] = true;
+    }
+
+    JsonObject reports = doc["reports"].to<JsonObject>();
+    for (size_t idx = 0; idx < kChannelCount; ++idx)
+    {
+      ReportKind kind = static_cast<ReportKind>(idx);
+      if (result.config.kind != ReportKind::Mixed && result.config.kind != kind)
+      {
+        continue;
+      }
+      append_channel_json(result.channels[idx], result.elapsed_us, reports[kind_to_string(kind)].to<JsonArray>());
+    }
+  }
+} // namespace hid_bench
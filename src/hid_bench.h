@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ArduinoJson.h>
+
+namespace hid_bench
+{
+  enum class ReportKind : uint8_t
+  {
+    Keyboard = 0,
+    Mouse = 1,
+    Consumer = 2,
+    Mixed = 3
+  };
+
+  constexpr uint16_t kMinRateHz = 1;
+  constexpr uint16_t kMaxRateHz = 1000;
+  constexpr uint16_t kDefaultRateHz = 125;
+  constexpr uint32_t kMinDurationMs = 100;
+  constexpr uint32_t kMaxDurationMs = 10000;
+  constexpr uint32_t kDefaultDurationMs = 2000;
+
+  struct Config
+  {
+    ReportKind kind = ReportKind::Mouse;
+    uint16_t rate_hz = kDefaultRateHz;
+    uint32_t duration_ms = kDefaultDurationMs;
+  };
+
+  struct ChannelStats
+  {
+    uint32_t sent = 0;
+    uint32_t failed = 0;
+    uint64_t call_us_total = 0;
+    uint32_t call_us_max = 0;
+    uint64_t delay_us_total = 0;
+    uint32_t delay_us_max = 0;
+  };
+
+  struct Result
+  {
+    Config config;
+    uint32_t elapsed_us = 0;
+    uint32_t missed_slots = 0;
+    bool aborted = false;
+    ChannelStats channels[3];
+  };
+
+  const char *kind_to_string(ReportKind kind);
+  bool string_to_kind(const char *value, ReportKind &kind);
+
+  // Parses rateHz/durationMs/kind from a system bench command, clamping to the supported range.
+  Config parse_config(JsonVariantConst command);
+
+  // Generates synthetic reports through the BLE Keyboard/Mouse objects. Blocks the caller for the
+  // configured duration; returns false when the HID link is not connected at start.
+  bool run(const Config &config, Result &result);
+
+  void append_result_json(const Result &result, JsonVariant doc);
+
+  // Upper bound of what append_result_json() adds to a reply, every counter at ten digits.
+  // Each report type is a seven-number array so a mixed run fits one transport message.
+  constexpr double kMaxReportedHz = 999999.9;
+  constexpr size_t kMaxCounterDigits = 10;
+  constexpr size_t kMaxChannelJsonBytes = sizeof("[,,,,,,]") - 1 + 7 * kMaxCounterDigits;
+  constexpr size_t kMaxResultJsonBytes =
+      sizeof(R"("kind":"consumer","rateHz":,"durationMs":,"elapsedMs":,"missed":,"aborted":true,)"
+             R"("reports":{"keyboard":,"mouse":,"consumer":})") -
+      1 + 4 * kMaxCounterDigits + 3 * kMaxChannelJsonBytes;
+
+  constexpr uint32_t kDefaultParseIterations = 200;
+  constexpr uint32_t kMaxParseIterations = 10000;
+
+  struct ParseBenchHooks
+  {
+    // Runs one payload through the same path as a transport message.
+    void (*process_command)(const char *payload) = nullptr;
+    // Swaps HID output for a null sink and discards responses on the calling task.
+    void (*begin_isolation)() = nullptr;
+    void (*end_isolation)() = nullptr;
+  };
+
+  struct ParseSample
+  {
+    const char *name = nullptr;
+    uint64_t cycles_total = 0;
+    uint32_t allocations_total = 0;
+  };
+
+  constexpr size_t kParseCorpusSize = 7;
+
+  struct ParseResult
+  {
+    uint32_t iterations = 0;
+    uint32_t cpu_mhz = 0;
+    ParseSample samples[kParseCorpusSize];
+    // Cycles per command_dispatch::find_command() for the cheapest and the dearest
+    // registered route; the two stay close however many routes there are.
+    uint32_t dispatch_routes = 0;
+    uint32_t dispatch_min_cycles = 0;
+    uint32_t dispatch_max_cycles = 0;
+  };
+
+  // Runs the built-in command corpus `iterations` times on the calling task and records
+  // CPU cycles and heap allocations per payload type, then times the action lookup alone.
+  bool run_parse_bench(const ParseBenchHooks &hooks, uint32_t iterations, ParseResult &result);
+
+  void append_parse_result_json(const ParseResult &result, JsonVariant doc);
+} // namespace hid_bench
@@ -0,0 +1,46 @@
+#include "hid_collections.h"
+
+#include <BleCombo.h>
+
+#include "consumer_control.h"
+#include "gamepad.h"
+
+namespace hid_collections
+{
+  bool begin()
+  {
+    static const uint8_t kGamepadReportIds[] = {gamepad::kReportId};
+    static const uint8_t kConsumerReportIds[] = {consumer_control::kConsumerReportId, consumer_control::kSystemReportId};
+    // Each collection is registered whole or not at all, so one that does not fit leaves
+    // the other working.
+    bool gamepad_added = Keyboard.addCollection(gamepad::kReportDescriptor, gamepad::kReportDescriptorSize,
+                                                kGamepadReportIds, sizeof(kGamepadReportIds));
+    bool consumer_added = Keyboard.addCollection(consumer_control::kReportDescriptor,
+                                                 consumer_control::kReportDescriptorSize, kConsumerReportIds,
+                                                 sizeof(kConsumerReportIds));
+    return gamepad_added && consumer_added;
+  }
+} // namespace hid_collections
+
+bool gamepad::hid_supported()
+{
+  return Keyboard.hasInputReport(gamepad::kReportId);
+}
+
+bool gamepad::hid_send_report(const uint8_t *report, size_t length)
+{
+  return length == gamepad::kReportBytes && Keyboard.sendInputReport(gamepad::kReportId, report, length);
+}
+
+// Both consumer_control report IDs are registered together.
+bool consumer_control::hid_supported()
+{
+  return Keyboard.hasInputReport(consumer_control::kConsumerReportId);
+}
+
+bool consumer_control::hid_send_report(uint8_t report_id, const uint8_t *report, size_t length)
+{
+  bool valid = (report_id == consumer_control::kConsumerReportId && length == consumer_control::kConsumerReportBytes) ||
+               (report_id == consumer_control::kSystemReportId && length == consumer_control::kSystemReportBytes);
+  return valid && Keyboard.sendInputReport(report_id, report, length);
+}
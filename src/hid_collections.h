@@ -0,0 +1,13 @@
+#pragma once
+
+// Report collections the firmware adds to the vendored BleCombo device
+// (lib/ESP32-BLE-Combo) beyond its keyboard, media-key and mouse reports. This file also
+// defines the HID hooks of the modules whose collections it registers, overriding their
+// weak "not supported" defaults.
+namespace hid_collections
+{
+  // Appends the collections to the combo device's report map. Must run before
+  // Keyboard.begin(); false when the device had no room, in which case the hooks keep
+  // reporting the collections as unsupported.
+  bool begin();
+} // namespace hid_collections
@@ -5,12 +5,23 @@
 #include <WiFi.h>
 #include <esp_http_server.h>
 #include <freertos/task.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 
+#include <atomic>
 #include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <strings.h>
+#include <unistd.h>
 
+#include "crash_snapshot.h"
+#include "memory_budget.h"
+#include "task_monitor.h"
+#include "text_stream.h"
+#include "trace.h"
 #include "wifi_manager.h"
 
 namespace http_server
@@ -19,6 +30,25 @@ namespace http_server
   {
     constexpr uint16_t HTTP_PORT = 80;
     constexpr const char *HTTP_STATUS_SERVICE_UNAVAILABLE = "503 Service Unavailable";
+    // POST /api/text reads the body this much at a time and gives up when typing has not
+    // freed any FIFO space, or the client has sent nothing, for TEXT_STALL_LIMIT_MS.
+    constexpr size_t TEXT_CHUNK_BYTES = 256;
+    constexpr uint32_t TEXT_WAIT_SLICE_MS = 100;
+    constexpr uint32_t TEXT_STALL_LIMIT_MS = 10000;
+    // POST /api/hid reads its body this much at a time and gives up when the client has sent
+    // nothing for HID_STALL_LIMIT_MS.
+    constexpr size_t HID_CHUNK_BYTES = 256;
+    constexpr uint32_t HID_STALL_LIMIT_MS = 10000;
+    // GET /api/events observers. They share max_open_sockets with every other client.
+    constexpr size_t MAX_EVENT_OBSERVERS = 3;
+    // A comment line keeps idle streams open through proxies and finds dead observers.
+    constexpr uint32_t EVENT_HEARTBEAT_MS = 15000;
+    // How long http_ws_task waits for a WebSocket event while observers are connected.
+    constexpr TickType_t EVENT_OBSERVER_POLL = pdMS_TO_TICKS(20);
+    // A /ws client silent for WS_PING_INTERVAL_MS is pinged and dropped when no pong follows
+    // within WS_PONG_TIMEOUT_MS, so a client that vanished is found within 8 s.
+    constexpr uint32_t WS_PING_INTERVAL_MS = 5000;
+    constexpr uint32_t WS_PONG_TIMEOUT_MS = 3000;
 
 #if defined(CONFIG_BT_NIMBLE_PINNED_TO_CORE)
     constexpr BaseType_t kHttpTaskCore = (CONFIG_BT_NIMBLE_PINNED_TO_CORE == 0) ? 1 : 0;
@@ -34,9 +64,44 @@ namespace http_server
     bool dependencies_initialized_ = false;
 
     TaskHandle_t http_server_task_handle = nullptr;
+    StackType_t http_server_task_stack[memory_budget::kHttpWsTaskStackBytes];
+    StaticTask_t http_server_task_buffer;
     httpd_handle_t http_server_handle = nullptr;
     volatile int ws_client_socket = -1;
 
+    // httpd reads no /ws frames while one of its handlers blocks (a scan, a long /api/text
+    // upload or /api/hid batch), so a client's pong waits in the socket meanwhile. The ping
+    // logic holds off while this is set and counts its deadline from httpd_free_since_ms.
+    std::atomic<bool> httpd_handler_busy{false};
+    std::atomic<uint32_t> httpd_free_since_ms{0};
+
+    struct HttpdBusyScope
+    {
+      HttpdBusyScope()
+      {
+        httpd_handler_busy.store(true);
+      }
+      ~HttpdBusyScope()
+      {
+        httpd_free_since_ms.store(millis());
+        httpd_handler_busy.store(false);
+      }
+    };
+
+    // Events on their way to GET /api/events observers, copied in by publish_event().
+    struct EventLine
+    {
+      uint16_t length;
+      char payload[memory_budget::kEventStreamLineBytes - sizeof(uint16_t)];
+    };
+    static_assert(sizeof(EventLine) == memory_budget::kEventStreamLineBytes,
+                  "EventLine must match kEventStreamLineBytes in memory_budget.h");
+    QueueHandle_t event_stream_queue = nullptr;
+    uint8_t event_stream_storage[memory_budget::kEventStreamQueueLength * sizeof(EventLine)];
+    StaticQueue_t event_stream_buffer;
+    // Sockets of connected observers, -1 for a free slot.
+    std::atomic<int> event_observer_sockets[MAX_EVENT_OBSERVERS];
+
     extern const uint8_t src_web_index_html_start[] asm("_binary_src_web_index_html_start");
     extern const uint8_t src_web_index_html_end[] asm("_binary_src_web_index_html_end");
 
@@ -126,13 +191,44 @@ namespace http_server
       return dependencies_.apply_transport_mode(mode);
     }
 
-    bool save_transport_config(TransportMode mode, uint32_t baud)
+    bool save_transport_config(TransportMode mode, uint32_t baud, NetworkProfile profile)
     {
       if (!dependencies_.save_transport_config)
       {
         return false;
       }
-      return dependencies_.save_transport_config(mode, baud);
+      return dependencies_.save_transport_config(mode, baud, profile);
+    }
+
+    NetworkProfile network_profile()
+    {
+      if (!dependencies_.get_network_profile)
+      {
+        return NetworkProfile::PowerSave;
+      }
+      return dependencies_.get_network_profile();
+    }
+
+    bool apply_network_profile(NetworkProfile profile)
+    {
+      if (!dependencies_.apply_network_profile)
+      {
+        return false;
+      }
+      return dependencies_.apply_network_profile(profile);
+    }
+
+    // Nagle holds a small frame back until the previous one is acknowledged, which costs up
+    // to a delayed-ACK period per event. lwIP sizes TCP send buffers globally
+    // (CONFIG_LWIP_TCP_SND_BUF_DEFAULT), so Nagle is the per-socket knob there is.
+    void applySocketProfile(int fd)
+    {
+      if (fd < 0)
+      {
+        return;
+      }
+      int noDelay = network_profile() == NetworkProfile::LowLatency ? 1 : 0;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
     }
 
     void send_status_error(const char *message)
@@ -229,6 +325,7 @@ namespace http_server
 
     esp_err_t handleScan(httpd_req_t *req)
     {
+      HttpdBusyScope busy;
       JsonDocument doc;
       auto obj = doc.to<JsonObject>();
       JsonArray networks = obj["networks"].to<JsonArray>();
@@ -355,6 +452,71 @@ namespace http_server
       return sendJsonResponse(req, 200, response);
     }
 
+    esp_err_t handleTraceGet(httpd_req_t *req)
+    {
+      setNoCacheHeaders(req);
+      httpd_resp_set_status(req, "200 OK");
+      httpd_resp_set_type(req, "application/octet-stream");
+      httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.bin\"");
+
+      size_t written = trace::write_dump(
+          [](void *context, const uint8_t *data, size_t length)
+          {
+            httpd_req_t *request = static_cast<httpd_req_t *>(context);
+            return httpd_resp_send_chunk(request, reinterpret_cast<const char *>(data), length) == ESP_OK;
+          },
+          req);
+      if (written == 0)
+      {
+        return ESP_FAIL;
+      }
+      return httpd_resp_send_chunk(req, nullptr, 0);
+    }
+
+    esp_err_t handleCoredumpGet(httpd_req_t *req)
+    {
+      if (!crash_snapshot::has_snapshot() && !crash_snapshot::has_coredump())
+      {
+        JsonDocument response;
+        auto obj = response.to<JsonObject>();
+        obj["status"] = "error";
+        obj["message"] = "No core dump stored";
+        return sendJsonResponse(req, 404, response);
+      }
+
+      setNoCacheHeaders(req);
+      httpd_resp_set_status(req, "200 OK");
+      httpd_resp_set_type(req, "application/octet-stream");
+      httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"coredump.bin\"");
+
+      size_t written = crash_snapshot::write_container(
+          [](void *context, const uint8_t *data, size_t length)
+          {
+            httpd_req_t *request = static_cast<httpd_req_t *>(context);
+            return httpd_resp_send_chunk(request, reinterpret_cast<const char *>(data), length) == ESP_OK;
+          },
+          req);
+      if (written == 0)
+      {
+        return ESP_FAIL;
+      }
+      return httpd_resp_send_chunk(req, nullptr, 0);
+    }
+
+    esp_err_t handleCoredumpDelete(httpd_req_t *req)
+    {
+      JsonDocument response;
+      auto obj = response.to<JsonObject>();
+      if (!crash_snapshot::erase())
+      {
+        obj["status"] = "error";
+        obj["message"] = "Failed to erase core dump";
+        return sendJsonResponse(req, 500, response);
+      }
+      obj["status"] = "ok";
+      return sendJsonResponse(req, 200, response);
+    }
+
     esp_err_t handleWifiStateGet(httpd_req_t *req)
     {
       JsonDocument doc;
@@ -371,6 +533,7 @@ namespace http_server
       obj["status"] = "ok";
       obj["mode"] = transport_mode_to_string(active_transport_mode());
       obj["baud"] = uart_baud_rate();
+      obj["profile"] = network_profile_to_string(network_profile());
       return sendJsonResponse(req, 200, doc);
     }
 
@@ -445,6 +608,29 @@ namespace http_server
         requestedBaud = static_cast<uint32_t>(baudCandidate);
       }
 
+      NetworkProfile requestedProfile = network_profile();
+      if (!payload["profile"].isNull() &&
+          !string_to_network_profile(payload["profile"].as<const char *>(), requestedProfile))
+      {
+        JsonDocument response;
+        auto obj = response.to<JsonObject>();
+        obj["status"] = "error";
+        obj["message"] = "Invalid network profile";
+        return sendJsonResponse(req, 400, response);
+      }
+
+      // The profile goes first so a refused one leaves the transport untouched, and is
+      // put back if the mode then fails.
+      const NetworkProfile previousProfile = network_profile();
+      if (requestedProfile != previousProfile && !apply_network_profile(requestedProfile))
+      {
+        JsonDocument response;
+        auto obj = response.to<JsonObject>();
+        obj["status"] = "error";
+        obj["message"] = "Failed to apply network profile";
+        return sendJsonResponse(req, 500, response);
+      }
+
       if (requestedMode == TransportMode::Uart)
       {
         apply_uart_baud_rate(requestedBaud);
@@ -452,6 +638,10 @@ namespace http_server
 
       if (!apply_transport_mode(requestedMode))
       {
+        if (requestedProfile != previousProfile)
+        {
+          apply_network_profile(previousProfile);
+        }
         JsonDocument response;
         auto obj = response.to<JsonObject>();
         obj["status"] = "error";
@@ -459,7 +649,7 @@ namespace http_server
         return sendJsonResponse(req, 500, response);
       }
 
-      if (!save_transport_config(active_transport_mode(), uart_baud_rate()))
+      if (!save_transport_config(active_transport_mode(), uart_baud_rate(), network_profile()))
       {
         JsonDocument response;
         auto obj = response.to<JsonObject>();
@@ -473,9 +663,600 @@ namespace http_server
       obj["status"] = "ok";
       obj["mode"] = transport_mode_to_string(active_transport_mode());
       obj["baud"] = uart_baud_rate();
+      obj["profile"] = network_profile_to_string(network_profile());
       return sendJsonResponse(req, 200, response);
     }
 
+    esp_err_t sendTextStreamStatus(httpd_req_t *req, int statusCode, const char *message, size_t accepted)
+    {
+      JsonDocument response;
+      auto obj = response.to<JsonObject>();
+      obj["status"] = statusCode == 200 ? "ok" : "error";
+      if (message)
+      {
+        obj["message"] = message;
+      }
+      obj["accepted"] = accepted;
+      text_stream::append_stats_json(obj);
+      return sendJsonResponse(req, statusCode, response);
+    }
+
+    // Streams the body (plain text, any length) into text_stream in TEXT_CHUNK_BYTES reads.
+    // While the FIFO is full the handler stops reading, so the client is held back by TCP
+    // rather than by a buffer sized for the whole upload. It replies once the last byte is
+    // buffered; a text_done event follows when the last byte has been typed.
+    esp_err_t handleTextPost(httpd_req_t *req)
+    {
+      if (req->content_len == 0)
+      {
+        return sendTextStreamStatus(req, 400, "Missing request body", 0);
+      }
+      if (!text_stream::begin())
+      {
+        return sendTextStreamStatus(req, 500, "Text stream unavailable", 0);
+      }
+      if (text_stream::upload_active())
+      {
+        return sendTextStreamStatus(req, 409, "Text upload already in progress", 0);
+      }
+
+      uint16_t charDelayMs = text_stream::kDefaultCharDelayMs;
+      char query[48];
+      char value[8];
+      if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+          httpd_query_key_value(query, "charDelayMs", value, sizeof(value)) == ESP_OK)
+      {
+        charDelayMs = static_cast<uint16_t>(strtoul(value, nullptr, 10));
+      }
+      text_stream::begin_upload(charDelayMs);
+
+      HttpdBusyScope busy;
+      char chunk[TEXT_CHUNK_BYTES];
+      size_t remaining = req->content_len;
+      size_t accepted = 0;
+      uint32_t lastReceivedMs = millis();
+      while (remaining > 0)
+      {
+        int ret = httpd_req_recv(req, chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+          if (millis() - lastReceivedMs < TEXT_STALL_LIMIT_MS)
+          {
+            continue;
+          }
+          // A client that stops mid-body would otherwise hold httpd, and every other request
+          // and /ws frame, for as long as it keeps the connection open. The rest of the body
+          // cannot be skipped, so the connection is closed after the reply.
+          text_stream::abort_upload();
+          sendTextStreamStatus(req, 408, "Upload stalled", accepted);
+          return ESP_FAIL;
+        }
+        if (ret <= 0)
+        {
+          // The client went away; what it sent is no longer wanted.
+          text_stream::abort_upload();
+          return sendTextStreamStatus(req, 400, "Failed to read body", accepted);
+        }
+        remaining -= static_cast<size_t>(ret);
+
+        size_t offset = 0;
+        uint32_t stalledMs = 0;
+        while (offset < static_cast<size_t>(ret))
+        {
+          size_t written = text_stream::write(chunk + offset, ret - offset, pdMS_TO_TICKS(TEXT_WAIT_SLICE_MS));
+          if (written > 0)
+          {
+            offset += written;
+            accepted += written;
+            stalledMs = 0;
+            continue;
+          }
+          stalledMs += TEXT_WAIT_SLICE_MS;
+          if (stalledMs >= TEXT_STALL_LIMIT_MS)
+          {
+            // Nothing is typing (BLE down or the FIFO was cleared under us).
+            text_stream::abort_upload();
+            return sendTextStreamStatus(req, 503, "Typing stalled", accepted);
+          }
+        }
+        lastReceivedMs = millis();
+      }
+      text_stream::end_upload();
+      return sendTextStreamStatus(req, 200, nullptr, accepted);
+    }
+
+    esp_err_t handleTextGet(httpd_req_t *req)
+    {
+      return sendTextStreamStatus(req, 200, nullptr, 0);
+    }
+
+    esp_err_t handleTextDelete(httpd_req_t *req)
+    {
+      text_stream::clear();
+      return sendTextStreamStatus(req, 200, nullptr, 0);
+    }
+
+    struct HidBatchStats
+    {
+      uint32_t commands = 0;
+      uint32_t errors = 0;
+    };
+
+    // Runs one body line and streams its replies. False when the response could not be sent
+    // or the pipeline stopped answering; the batch ends there.
+    bool runHidBatchLine(httpd_req_t *req, const std::string &line, bool overlong, HidBatchStats &stats)
+    {
+      if (line.empty() && !overlong)
+      {
+        return true;
+      }
+      ++stats.commands;
+      std::string reply;
+      bool answered = true;
+      if (overlong)
+      {
+        reply = "{\"status\":\"error\",\"message\":\"Input too long\"}\n";
+      }
+      else if (!dependencies_.execute_command(line.data(), line.size(), reply))
+      {
+        reply = "{\"status\":\"error\",\"message\":\"Command timed out\"}\n";
+        answered = false;
+      }
+      if (reply.find("\"status\":\"error\"") != std::string::npos)
+      {
+        ++stats.errors;
+      }
+      if (!reply.empty() && httpd_resp_send_chunk(req, reply.data(), reply.size()) != ESP_OK)
+      {
+        return false;
+      }
+      return answered;
+    }
+
+    // Newline-delimited commands in, NDJSON replies out. Each line goes to the command
+    // pipeline as soon as it is complete and its replies are sent as one chunk, so neither
+    // side is ever buffered whole and a single keep-alive request can carry any number of
+    // commands. The last line is a summary.
+    esp_err_t handleHidPost(httpd_req_t *req)
+    {
+      if (!dependencies_.execute_command)
+      {
+        JsonDocument response;
+        auto obj = response.to<JsonObject>();
+        obj["status"] = "error";
+        obj["message"] = "Command pipeline unavailable";
+        return sendJsonResponse(req, 503, response);
+      }
+
+      setNoCacheHeaders(req);
+      httpd_resp_set_type(req, "application/x-ndjson");
+
+      HttpdBusyScope busy;
+      const size_t limit = input_buffer_limit();
+      std::string line;
+      line.reserve(limit);
+      bool overlong = false;
+      HidBatchStats stats;
+      bool stopped = false;
+      bool stalled = false;
+      char chunk[HID_CHUNK_BYTES];
+      size_t remaining = req->content_len;
+      uint32_t lastReceivedMs = millis();
+      while (remaining > 0 && !stopped)
+      {
+        int ret = httpd_req_recv(req, chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+          if (millis() - lastReceivedMs < HID_STALL_LIMIT_MS)
+          {
+            continue;
+          }
+          // As in handleTextPost: a silent client must not hold httpd indefinitely.
+          stopped = true;
+          stalled = true;
+          break;
+        }
+        if (ret <= 0)
+        {
+          return ESP_FAIL;
+        }
+        remaining -= static_cast<size_t>(ret);
+        for (int index = 0; index < ret && !stopped; ++index)
+        {
+          char c = chunk[index];
+          if (c == '\r')
+          {
+            continue;
+          }
+          if (c != '\n')
+          {
+            if (line.size() + 1 >= limit)
+            {
+              overlong = true;
+            }
+            else
+            {
+              line.push_back(c);
+            }
+            continue;
+          }
+          stopped = !runHidBatchLine(req, line, overlong, stats);
+          line.clear();
+          overlong = false;
+        }
+        lastReceivedMs = millis();
+      }
+      if (!stopped)
+      {
+        // The last command need not end with a newline.
+        stopped = !runHidBatchLine(req, line, overlong, stats);
+      }
+
+      char summary[96];
+      snprintf(summary,
+               sizeof(summary),
+               "{\"status\":\"%s\",\"commands\":%lu,\"errors\":%lu}\n",
+               stalled ? "stalled" : stopped ? "aborted" : "done",
+               static_cast<unsigned long>(stats.commands),
+               static_cast<unsigned long>(stats.errors));
+      httpd_resp_send_chunk(req, summary, HTTPD_RESP_USE_STRLEN);
+      esp_err_t result = httpd_resp_send_chunk(req, nullptr, 0);
+      // The unread rest of a stalled body cannot be skipped; close the connection.
+      return stalled ? ESP_FAIL : result;
+    }
+
+    enum class WsCloseReason : uint8_t
+    {
+      Client,
+      SendFailed,
+      PongTimeout,
+      Replaced,
+      Local
+    };
+
+    // The active /ws session, written by httpd as frames arrive and by http_ws_task as it
+    // pings; times are millis().
+    struct WsSession
+    {
+      std::atomic<uint32_t> opened_ms{0};
+      std::atomic<uint32_t> last_seen_ms{0};
+      std::atomic<uint32_t> ping_sent_ms{0};
+      std::atomic<bool> ping_outstanding{false};
+    };
+
+    struct WsStats
+    {
+      std::atomic<uint32_t> opened{0};
+      std::atomic<uint32_t> closed_by_client{0};
+      std::atomic<uint32_t> send_failures{0};
+      std::atomic<uint32_t> pong_timeouts{0};
+      std::atomic<uint32_t> replaced{0};
+      std::atomic<uint32_t> closed_locally{0};
+      std::atomic<uint32_t> pings{0};
+      std::atomic<uint32_t> pongs{0};
+      std::atomic<uint32_t> last_rtt_ms{0};
+      std::atomic<uint32_t> last_lifetime_ms{0};
+      std::atomic<uint32_t> max_lifetime_ms{0};
+      // Time from the last frame a dead client sent to its teardown.
+      std::atomic<uint32_t> last_detection_ms{0};
+      std::atomic<uint32_t> max_detection_ms{0};
+    };
+
+    WsSession ws_session;
+    WsStats ws_stats;
+
+    void storeMax(std::atomic<uint32_t> &target, uint32_t value)
+    {
+      uint32_t current = target.load();
+      while (value > current && !target.compare_exchange_weak(current, value))
+      {
+      }
+    }
+
+    void beginWsSession(int fd)
+    {
+      uint32_t now = millis();
+      ws_session.opened_ms.store(now);
+      ws_session.last_seen_ms.store(now);
+      ws_session.ping_outstanding.store(false);
+      ws_client_socket = fd;
+      ws_stats.opened.fetch_add(1);
+      applySocketProfile(fd);
+    }
+
+    // Ends the active session if it is still `fd`, accounting it under `reason`. Sessions
+    // found dead are closed here rather than left for the LRU purge.
+    void endWsSession(int fd, WsCloseReason reason)
+    {
+      if (fd < 0 || ws_client_socket != fd)
+      {
+        return;
+      }
+      ws_client_socket = -1;
+      uint32_t now = millis();
+      uint32_t lifetime = now - ws_session.opened_ms.load();
+      ws_stats.last_lifetime_ms.store(lifetime);
+      storeMax(ws_stats.max_lifetime_ms, lifetime);
+
+      switch (reason)
+      {
+      case WsCloseReason::Client:
+        ws_stats.closed_by_client.fetch_add(1);
+        return;
+      case WsCloseReason::Replaced:
+        ws_stats.replaced.fetch_add(1);
+        return;
+      case WsCloseReason::Local:
+        ws_stats.closed_locally.fetch_add(1);
+        break;
+      case WsCloseReason::SendFailed:
+      case WsCloseReason::PongTimeout:
+      {
+        (reason == WsCloseReason::SendFailed ? ws_stats.send_failures : ws_stats.pong_timeouts).fetch_add(1);
+        uint32_t detection = now - ws_session.last_seen_ms.load();
+        ws_stats.last_detection_ms.store(detection);
+        storeMax(ws_stats.max_detection_ms, detection);
+        break;
+      }
+      }
+      if (http_server_handle)
+      {
+        httpd_sess_trigger_close(http_server_handle, fd);
+      }
+    }
+
+    // Any frame from the active client proves it is alive; a pong also ends the ping.
+    void noteWsFrame(int fd, httpd_ws_type_t type)
+    {
+      if (fd != ws_client_socket)
+      {
+        return;
+      }
+      uint32_t now = millis();
+      ws_session.last_seen_ms.store(now);
+      if (type == HTTPD_WS_TYPE_PONG && ws_session.ping_outstanding.exchange(false))
+      {
+        ws_stats.pongs.fetch_add(1);
+        ws_stats.last_rtt_ms.store(now - ws_session.ping_sent_ms.load());
+      }
+    }
+
+    // Pings the active client once it has been silent for WS_PING_INTERVAL_MS and tears the
+    // session down when the pong is WS_PONG_TIMEOUT_MS late. Time a blocking httpd handler
+    // kept frames unread does not count against the client. Runs on http_ws_task.
+    void serviceWsLiveness(httpd_handle_t server)
+    {
+      int fd = ws_client_socket;
+      if (!server || fd < 0 || httpd_handler_busy.load())
+      {
+        return;
+      }
+      uint32_t now = millis();
+      uint32_t sinceFree = now - httpd_free_since_ms.load();
+      if (ws_session.ping_outstanding.load())
+      {
+        uint32_t sincePing = now - ws_session.ping_sent_ms.load();
+        if (sincePing >= WS_PONG_TIMEOUT_MS && sinceFree >= WS_PONG_TIMEOUT_MS)
+        {
+          endWsSession(fd, WsCloseReason::PongTimeout);
+        }
+        return;
+      }
+      if (now - ws_session.last_seen_ms.load() < WS_PING_INTERVAL_MS)
+      {
+        return;
+      }
+      httpd_ws_frame_t frame = {};
+      frame.type = HTTPD_WS_TYPE_PING;
+      ws_session.ping_sent_ms.store(now);
+      ws_session.ping_outstanding.store(true);
+      if (httpd_ws_send_frame_async(server, fd, &frame) != ESP_OK)
+      {
+        endWsSession(fd, WsCloseReason::SendFailed);
+        return;
+      }
+      ws_stats.pings.fetch_add(1);
+    }
+
+    // Writes all of `data` to an event observer's socket; false once the socket has failed
+    // or stalled past send_wait_timeout, after which the observer is dropped.
+    bool sendToObserver(int fd, const char *data, size_t length)
+    {
+      httpd_handle_t server = http_server_handle;
+      while (length > 0)
+      {
+        int sent = server ? httpd_socket_send(server, fd, data, length, 0) : HTTPD_SOCK_ERR_INVALID;
+        if (sent <= 0)
+        {
+          return false;
+        }
+        data += sent;
+        length -= static_cast<size_t>(sent);
+      }
+      return true;
+    }
+
+    bool hasEventObservers()
+    {
+      for (const std::atomic<int> &socket : event_observer_sockets)
+      {
+        if (socket.load() >= 0)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void forgetEventObserver(int fd)
+    {
+      for (std::atomic<int> &socket : event_observer_sockets)
+      {
+        int expected = fd;
+        socket.compare_exchange_strong(expected, -1);
+      }
+    }
+
+    void broadcastToObservers(const char *data, size_t length)
+    {
+      for (std::atomic<int> &socket : event_observer_sockets)
+      {
+        int fd = socket.load();
+        if (fd >= 0 && !sendToObserver(fd, data, length))
+        {
+          forgetEventObserver(fd);
+          if (http_server_handle)
+          {
+            httpd_sess_trigger_close(http_server_handle, fd);
+          }
+        }
+      }
+    }
+
+    // One SSE message: "data: <json>\n\n". Returns its length, or 0 when it does not fit.
+    size_t formatEventMessage(char *out, size_t capacity, const char *json, size_t length)
+    {
+      static const char kPrefix[] = "data: ";
+      constexpr size_t prefixLength = sizeof(kPrefix) - 1;
+      if (prefixLength + length + 2 > capacity)
+      {
+        return 0;
+      }
+      memcpy(out, kPrefix, prefixLength);
+      memcpy(out + prefixLength, json, length);
+      out[prefixLength + length] = '\n';
+      out[prefixLength + length + 1] = '\n';
+      return prefixLength + length + 2;
+    }
+
+    bool sendEventDocument(int fd, const JsonDocument &doc)
+    {
+      char json[memory_budget::kEventStreamLineBytes];
+      size_t length = serializeJson(doc, json, sizeof(json));
+      char message[sizeof(json) + 8];
+      size_t messageLength = formatEventMessage(message, sizeof(message), json, length);
+      return messageLength == 0 || sendToObserver(fd, message, messageLength);
+    }
+
+    // What a new observer would otherwise wait for an event to learn.
+    bool sendEventSnapshot(int fd)
+    {
+      JsonDocument doc;
+      doc["event"] = "wifi_state";
+      wifi_manager::append_state_json(doc.as<JsonObject>());
+      if (!sendEventDocument(fd, doc))
+      {
+        return false;
+      }
+      doc.clear();
+      doc["event"] = "transport_mode";
+      doc["detail"] = transport_mode_to_string(active_transport_mode());
+      if (!sendEventDocument(fd, doc))
+      {
+        return false;
+      }
+      if (dependencies_.is_ble_connected)
+      {
+        doc.clear();
+        doc["event"] = dependencies_.is_ble_connected() ? "ble_connected" : "ble_disconnected";
+        return sendEventDocument(fd, doc);
+      }
+      return true;
+    }
+
+    // Server-Sent Events for read-only observers such as the portal, in either transport
+    // mode. The handler writes the response head and a state snapshot itself and returns
+    // with the socket left open; http_ws_task then writes every later event to it.
+    esp_err_t handleEventsGet(httpd_req_t *req)
+    {
+      std::atomic<int> *slot = nullptr;
+      for (std::atomic<int> &socket : event_observer_sockets)
+      {
+        if (socket.load() < 0)
+        {
+          slot = &socket;
+          break;
+        }
+      }
+      if (!slot || !event_stream_queue)
+      {
+        JsonDocument response;
+        auto obj = response.to<JsonObject>();
+        obj["status"] = "error";
+        obj["message"] = "Too many event observers";
+        return sendJsonResponse(req, 503, response);
+      }
+
+      static const char kHead[] = "HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: text/event-stream\r\n"
+                                  "Cache-Control: no-cache\r\n"
+                                  "Connection: keep-alive\r\n"
+                                  "\r\n"
+                                  "retry: 2000\n\n";
+      int fd = httpd_req_to_sockfd(req);
+      if (!sendToObserver(fd, kHead, sizeof(kHead) - 1))
+      {
+        return ESP_FAIL;
+      }
+      slot->store(fd);
+      applySocketProfile(fd);
+      if (!sendEventSnapshot(fd))
+      {
+        forgetEventObserver(fd);
+        return ESP_FAIL;
+      }
+      return ESP_OK;
+    }
+
+    // Registered as close_fn, so a descriptor is forgotten before it can be reused by
+    // another connection.
+    void onSocketClose(httpd_handle_t server, int fd)
+    {
+      (void)server;
+      forgetEventObserver(fd);
+      endWsSession(fd, WsCloseReason::Client);
+      close(fd);
+    }
+
+    // Fans queued events out to every observer, waiting up to `wait` for the first one,
+    // and sends the heartbeat that finds observers which went away without closing.
+    void serviceEventObservers(TickType_t wait)
+    {
+      if (!event_stream_queue)
+      {
+        if (wait > 0)
+        {
+          vTaskDelay(wait);
+        }
+        return;
+      }
+
+      EventLine line;
+      if (xQueueReceive(event_stream_queue, &line, wait) == pdPASS)
+      {
+        char message[sizeof(line.payload) + 8];
+        do
+        {
+          size_t length = formatEventMessage(message, sizeof(message), line.payload, line.length);
+          if (length > 0)
+          {
+            broadcastToObservers(message, length);
+          }
+        } while (xQueueReceive(event_stream_queue, &line, 0) == pdPASS);
+      }
+
+      static uint32_t lastHeartbeat = 0;
+      uint32_t now = millis();
+      if (now - lastHeartbeat >= EVENT_HEARTBEAT_MS)
+      {
+        lastHeartbeat = now;
+        static const char kHeartbeat[] = ": keep-alive\n\n";
+        broadcastToObservers(kHeartbeat, sizeof(kHeartbeat) - 1);
+      }
+    }
+
+    esp_err_t handleWebSocket(httpd_req_t *req);
+
     void registerHttpEndpoints(httpd_handle_t server)
     {
       if (!server)
@@ -546,6 +1327,78 @@ namespace http_server
           .handle_ws_control_frames = false,
           .supported_subprotocol = nullptr};
 
+      static const httpd_uri_t eventsUri = {
+          .uri = "/api/events",
+          .method = HTTP_GET,
+          .handler = handleEventsGet,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t hidPostUri = {
+          .uri = "/api/hid",
+          .method = HTTP_POST,
+          .handler = handleHidPost,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t textPostUri = {
+          .uri = "/api/text",
+          .method = HTTP_POST,
+          .handler = handleTextPost,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t textGetUri = {
+          .uri = "/api/text",
+          .method = HTTP_GET,
+          .handler = handleTextGet,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t textDeleteUri = {
+          .uri = "/api/text",
+          .method = HTTP_DELETE,
+          .handler = handleTextDelete,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t traceGetUri = {
+          .uri = "/api/trace",
+          .method = HTTP_GET,
+          .handler = handleTraceGet,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t coredumpGetUri = {
+          .uri = "/api/coredump",
+          .method = HTTP_GET,
+          .handler = handleCoredumpGet,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
+      static const httpd_uri_t coredumpDeleteUri = {
+          .uri = "/api/coredump",
+          .method = HTTP_DELETE,
+          .handler = handleCoredumpDelete,
+          .user_ctx = nullptr,
+          .is_websocket = false,
+          .handle_ws_control_frames = false,
+          .supported_subprotocol = nullptr};
+
       static const httpd_uri_t androidPortalUri = {
           .uri = "/generate_204",
           .method = HTTP_GET,
@@ -580,6 +1433,14 @@ namespace http_server
       httpd_register_uri_handler(server, &wifiStateGetUri);
       httpd_register_uri_handler(server, &transportGetUri);
       httpd_register_uri_handler(server, &transportPostUri);
+      httpd_register_uri_handler(server, &eventsUri);
+      httpd_register_uri_handler(server, &hidPostUri);
+      httpd_register_uri_handler(server, &textPostUri);
+      httpd_register_uri_handler(server, &textGetUri);
+      httpd_register_uri_handler(server, &textDeleteUri);
+      httpd_register_uri_handler(server, &traceGetUri);
+      httpd_register_uri_handler(server, &coredumpGetUri);
+      httpd_register_uri_handler(server, &coredumpDeleteUri);
       httpd_register_uri_handler(server, &androidPortalUri);
       httpd_register_uri_handler(server, &applePortalUri);
       httpd_register_uri_handler(server, &windowsPortalUri);
@@ -618,7 +1479,8 @@ namespace http_server
 
       if (req->method == HTTP_GET)
       {
-        ws_client_socket = httpd_req_to_sockfd(req);
+        endWsSession(ws_client_socket, WsCloseReason::Replaced);
+        beginWsSession(httpd_req_to_sockfd(req));
         wifi_manager::send_cached_state();
         return ESP_OK;
       }
@@ -638,6 +1500,8 @@ namespace http_server
         return ret;
       }
       payload[frame.len] = '\0';
+      trace::record(trace::EventType::WsFrameReceived, static_cast<uint16_t>(frame.type), frame.len);
+      noteWsFrame(httpd_req_to_sockfd(req), frame.type);
 
       if (active_transport_mode() != TransportMode::Websocket)
       {
@@ -666,8 +1530,16 @@ namespace http_server
         }
         enqueue_transport_message(queue, reinterpret_cast<const char *>(frame.payload), frame.len);
         break;
+      case HTTPD_WS_TYPE_BINARY:
+        // Pointer frames (pointer_protocol.h); the pump tells them apart by the start byte
+        // and the queue keeps them in order with the JSON commands.
+        if (frame.len > 0 && frame.len < input_buffer_limit())
+        {
+          enqueue_transport_message(queue, reinterpret_cast<const char *>(frame.payload), frame.len);
+        }
+        break;
       case HTTPD_WS_TYPE_CLOSE:
-        ws_client_socket = -1;
+        endWsSession(httpd_req_to_sockfd(req), WsCloseReason::Client);
         break;
       case HTTPD_WS_TYPE_PING:
         frame.type = HTTPD_WS_TYPE_PONG;
@@ -688,9 +1560,12 @@ namespace http_server
       config.server_port = HTTP_PORT;
       config.ctrl_port = HTTP_PORT + 1;
       config.task_priority = tskIDLE_PRIORITY + 4;
-      config.stack_size = 8192;
+      config.stack_size = memory_budget::kHttpdStackBytes;
       config.lru_purge_enable = true;
       config.uri_match_fn = httpd_uri_match_wildcard;
+      config.close_fn = onSocketClose;
+      // Room for every handler in registerHttpEndpoints(); the default of 8 silently drops the rest.
+      config.max_uri_handlers = 24;
 #if defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
       config.core_id = 0;
 #else
@@ -702,6 +1577,7 @@ namespace http_server
       {
         http_server_handle = server;
         registerHttpEndpoints(server);
+        task_monitor::watch("httpd", nullptr, memory_budget::kHttpdStackBytes);
       }
 
       constexpr TickType_t idleDelay = pdMS_TO_TICKS(100);
@@ -711,18 +1587,23 @@ namespace http_server
         if (active_transport_mode() == TransportMode::Websocket && events)
         {
           TransportMessage message = {};
-          if (xQueueReceive(events, &message, idleDelay) == pdPASS)
+          TickType_t wait = hasEventObservers() ? EVENT_OBSERVER_POLL : idleDelay;
+          if (xQueueReceive(events, &message, wait) == pdPASS)
           {
+            trace::record(trace::EventType::TaskWake, trace::TaskId::HttpWs);
+            trace::record(trace::EventType::QueueDequeue, trace::QueueId::Event, uxQueueMessagesWaiting(events));
             if (server && ws_client_socket >= 0)
             {
               httpd_ws_frame_t frame = {};
               frame.type = HTTPD_WS_TYPE_TEXT;
               frame.payload = reinterpret_cast<uint8_t *>(message.payload);
               frame.len = message.length;
-              esp_err_t err = httpd_ws_send_frame_async(server, ws_client_socket, &frame);
+              int fd = ws_client_socket;
+              esp_err_t err = httpd_ws_send_frame_async(server, fd, &frame);
+              trace::record(trace::EventType::WsFrameSent, err == ESP_OK ? 0 : 1, message.length);
               if (err != ESP_OK)
               {
-                ws_client_socket = -1;
+                endWsSession(fd, WsCloseReason::SendFailed);
                 xQueueSendToFront(events, &message, 0);
                 vTaskDelay(pdMS_TO_TICKS(50));
               }
@@ -733,19 +1614,49 @@ namespace http_server
               vTaskDelay(pdMS_TO_TICKS(50));
             }
           }
+          serviceWsLiveness(server);
+          serviceEventObservers(0);
         }
         else
         {
-          vTaskDelay(idleDelay);
+          serviceEventObservers(idleDelay);
         }
       }
     }
   } // namespace
 
+  const char *network_profile_to_string(NetworkProfile profile)
+  {
+    return profile == NetworkProfile::LowLatency ? "low_latency" : "power_save";
+  }
+
+  bool string_to_network_profile(const char *value, NetworkProfile &profile)
+  {
+    if (!value)
+    {
+      return false;
+    }
+    if (strcasecmp(value, "low_latency") == 0)
+    {
+      profile = NetworkProfile::LowLatency;
+      return true;
+    }
+    if (strcasecmp(value, "power_save") == 0)
+    {
+      profile = NetworkProfile::PowerSave;
+      return true;
+    }
+    return false;
+  }
+
   void init(const Dependencies &dependencies)
   {
     dependencies_ = dependencies;
     dependencies_initialized_ = true;
+    for (std::atomic<int> &socket : event_observer_sockets)
+    {
+      socket.store(-1);
+    }
   }
 
   void start()
@@ -755,19 +1666,36 @@ namespace http_server
       return;
     }
 
-    constexpr uint32_t stackSize = 8192;
+    if (!event_stream_queue)
+    {
+      event_stream_queue = xQueueCreateStatic(memory_budget::kEventStreamQueueLength,
+                                              sizeof(EventLine),
+                                              event_stream_storage,
+                                              &event_stream_buffer);
+    }
+
+    constexpr uint32_t stackSize = sizeof(http_server_task_stack);
     constexpr UBaseType_t priority = tskIDLE_PRIORITY + 3;
 #if defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
-    xTaskCreate(httpServerTask, "http_ws_task", stackSize, nullptr, priority, &http_server_task_handle);
+    http_server_task_handle = xTaskCreateStatic(httpServerTask,
+                                                "http_ws_task",
+                                                stackSize,
+                                                nullptr,
+                                                priority,
+                                                http_server_task_stack,
+                                                &http_server_task_buffer);
 #else
-    xTaskCreatePinnedToCore(httpServerTask,
-                            "http_ws_task",
-                            stackSize,
-                            nullptr,
-                            priority,
-                            &http_server_task_handle,
-                            kHttpTaskCore);
+    http_server_task_handle = xTaskCreateStaticPinnedToCore(httpServerTask,
+                                                            "http_ws_task",
+                                                            stackSize,
+                                                            nullptr,
+                                                            priority,
+                                                            http_server_task_stack,
+                                                            &http_server_task_buffer,
+                                                            kHttpTaskCore);
 #endif
+    crash_snapshot::watch_task(&http_server_task_handle);
+    task_monitor::watch("http_ws_task", &http_server_task_handle, stackSize);
   }
 
   void stop()
@@ -795,13 +1723,68 @@ namespace http_server
     }
   }
 
+  void publish_event(const char *payload)
+  {
+    if (!payload || !event_stream_queue || !hasEventObservers())
+    {
+      return;
+    }
+    EventLine line;
+    size_t length = strlen(payload);
+    if (length > sizeof(line.payload))
+    {
+      return;
+    }
+    line.length = static_cast<uint16_t>(length);
+    memcpy(line.payload, payload, length);
+    // Dropped when observers fall behind; the next wifi_state or ble event corrects them.
+    xQueueSend(event_stream_queue, &line, 0);
+  }
+
   void close_active_websocket()
   {
-    if (http_server_handle && ws_client_socket >= 0)
+    endWsSession(ws_client_socket, WsCloseReason::Local);
+  }
+
+  void apply_network_profile_to_sessions()
+  {
+    if (!dependencies_initialized_)
+    {
+      return;
+    }
+    applySocketProfile(ws_client_socket);
+    for (const std::atomic<int> &socket : event_observer_sockets)
+    {
+      applySocketProfile(socket.load());
+    }
+  }
+
+  void append_websocket_stats_json(JsonVariant doc)
+  {
+    int fd = ws_client_socket;
+    doc["connected"] = fd >= 0;
+    if (fd >= 0)
     {
-      httpd_sess_trigger_close(http_server_handle, ws_client_socket);
+      uint32_t now = millis();
+      doc["sessionAgeMs"] = now - ws_session.opened_ms.load();
+      doc["idleMs"] = now - ws_session.last_seen_ms.load();
     }
-    ws_client_socket = -1;
+    doc["pingIntervalMs"] = WS_PING_INTERVAL_MS;
+    doc["pongTimeoutMs"] = WS_PONG_TIMEOUT_MS;
+    doc["opened"] = ws_stats.opened.load();
+    JsonObject closed = doc["closed"].to<JsonObject>();
+    closed["client"] = ws_stats.closed_by_client.load();
+    closed["sendFailed"] = ws_stats.send_failures.load();
+    closed["pongTimeout"] = ws_stats.pong_timeouts.load();
+    closed["replaced"] = ws_stats.replaced.load();
+    closed["local"] = ws_stats.closed_locally.load();
+    doc["pings"] = ws_stats.pings.load();
+    doc["pongs"] = ws_stats.pongs.load();
+    doc["lastRttMs"] = ws_stats.last_rtt_ms.load();
+    doc["lastLifetimeMs"] = ws_stats.last_lifetime_ms.load();
+    doc["maxLifetimeMs"] = ws_stats.max_lifetime_ms.load();
+    doc["lastDetectionMs"] = ws_stats.last_detection_ms.load();
+    doc["maxDetectionMs"] = ws_stats.max_detection_ms.load();
   }
 } // namespace http_server
 
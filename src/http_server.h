@@ -2,7 +2,9 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
+#include <ArduinoJson.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 
@@ -12,6 +14,16 @@ enum class TransportMode : uint8_t
   Websocket = 1
 };
 
+// Latency against power on the Wi-Fi link; saved with the transport mode.
+enum class NetworkProfile : uint8_t
+{
+  // Modem sleep between DTIM beacons and Nagle on: the radio sleeps between packets.
+  PowerSave = 0,
+  // TCP_NODELAY on /ws and /api/events sockets. The radio stays awake only on builds
+  // without Bluetooth; with BLE up it keeps modem sleep.
+  LowLatency = 1
+};
+
 namespace http_server
 {
   constexpr size_t kMaxTransportPayload = 512;
@@ -19,6 +31,9 @@ namespace http_server
   struct TransportMessage
   {
     size_t length;
+    // Non-zero for commands from POST /api/hid: their replies go back to that request
+    // instead of the active transport.
+    uint32_t reply_sequence;
     char payload[kMaxTransportPayload];
   };
 
@@ -34,15 +49,34 @@ namespace http_server
     void (*apply_uart_baud_rate)(uint32_t baud) = nullptr;
     uint32_t (*get_uart_baud_rate)() = nullptr;
     bool (*apply_transport_mode)(TransportMode mode) = nullptr;
-    bool (*save_transport_config)(TransportMode mode, uint32_t baud) = nullptr;
+    bool (*save_transport_config)(TransportMode mode, uint32_t baud, NetworkProfile profile) = nullptr;
+    NetworkProfile (*get_network_profile)() = nullptr;
+    bool (*apply_network_profile)(NetworkProfile profile) = nullptr;
     void (*send_status_error)(const char *message) = nullptr;
     void (*send_event)(const char *name, const char *detail) = nullptr;
+    // Runs one command through the command pipeline and returns every line it replied
+    // with; false when the pipeline did not answer in time.
+    bool (*execute_command)(const char *payload, size_t length, std::string &reply) = nullptr;
+    // For the snapshot a new GET /api/events observer starts with.
+    bool (*is_ble_connected)() = nullptr;
     size_t input_buffer_limit = 0;
   };
 
+  const char *network_profile_to_string(NetworkProfile profile);
+  // False for anything but "power_save" or "low_latency".
+  bool string_to_network_profile(const char *value, NetworkProfile &profile);
+
   void init(const Dependencies &dependencies);
   void start();
   void stop();
+  // Queues a JSON event for GET /api/events observers; a no-op while none are connected.
+  // Never blocks, so it is safe from any task.
+  void publish_event(const char *payload);
   void close_active_websocket();
+  // Re-tunes the open /ws and /api/events sockets after the network profile changed.
+  void apply_network_profile_to_sessions();
+  // Session counts by close reason, lifetimes, ping round trips and how long dead clients
+  // took to detect, for {"device":"system","action":"websocket"}.
+  void append_websocket_stats_json(JsonVariant doc);
 } // namespace http_server
 
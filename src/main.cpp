@@ -3,6 +3,7 @@
 #include <ArduinoJson.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 #if __has_include("sdkconfig.h")
 #include <sdkconfig.h>
@@ -17,8 +18,21 @@
 #include <atomic>
 #include <vector>
 #include <cstdio>
-
+#include <base64.h>
+
+#include "alloc_counter.h"
+#include "command_dispatch.h"
+#include "consumer_control.h"
+#include "crash_snapshot.h"
+#include "gamepad.h"
+#include "hid_bench.h"
+#include "hid_collections.h"
 #include "http_server.h"
+#include "memory_budget.h"
+#include "pointer_protocol.h"
+#include "task_monitor.h"
+#include "text_stream.h"
+#include "trace.h"
 #include "wifi_manager.h"
 
 namespace
@@ -31,6 +45,7 @@ namespace
   constexpr const char *NVS_NAMESPACE_TRANSPORT = "transport";
   constexpr const char *NVS_KEY_TRANSPORT_MODE = "mode";
   constexpr const char *NVS_KEY_UART_BAUD = "baud";
+  constexpr const char *NVS_KEY_NETWORK_PROFILE = "net_profile";
   constexpr uint32_t DEFAULT_UART_BAUD = 115200;
   constexpr const char *NVS_NAMESPACE_WIFI = "wifi";
   constexpr const char *NVS_KEY_WIFI_SSID = "ssid";
@@ -47,10 +62,17 @@ namespace
 
   using http_server::TransportMessage;
 
-  constexpr UBaseType_t TRANSPORT_COMMAND_QUEUE_LENGTH = 8;
-  constexpr UBaseType_t TRANSPORT_EVENT_QUEUE_LENGTH = 8;
+#if defined(CONFIG_ARDUINO_LOOP_STACK_SIZE)
+  constexpr uint32_t ARDUINO_LOOP_STACK_BYTES = CONFIG_ARDUINO_LOOP_STACK_SIZE;
+#else
+  constexpr uint32_t ARDUINO_LOOP_STACK_BYTES = 8192;
+#endif
+
+  constexpr UBaseType_t TRANSPORT_COMMAND_QUEUE_LENGTH = memory_budget::kTransportCommandQueueLength;
+  constexpr UBaseType_t TRANSPORT_EVENT_QUEUE_LENGTH = memory_budget::kTransportEventQueueLength;
 
   std::atomic<TransportMode> activeTransportMode{TransportMode::Uart};
+  std::atomic<NetworkProfile> activeNetworkProfile{NetworkProfile::PowerSave};
   uint32_t uartBaudRate = DEFAULT_UART_BAUD;
   bool serialActive = false;
 
@@ -59,8 +81,8 @@ namespace
   bool ensureTransportQueues();
   void resetTransportQueues();
   bool applyTransportMode(TransportMode mode);
-  bool saveTransportConfig(TransportMode mode, uint32_t baud);
-  TransportMode loadTransportModeFromStorage(uint32_t &baudOut);
+  bool saveTransportConfig(TransportMode mode, uint32_t baud, NetworkProfile profile);
+  TransportMode loadTransportModeFromStorage(uint32_t &baudOut, NetworkProfile &profileOut);
   const char *transportModeToString(TransportMode mode);
   TransportMode stringToTransportMode(const char *value);
   void sendStatusOk();
@@ -71,11 +93,35 @@ namespace
   bool saveWifiCredentials(const String &ssid, const String &password);
   void flushInputBuffer();
   void processCommand(const String &payload);
+  void processPointerFrame(const uint8_t *frame, size_t length);
 
   QueueHandle_t transportCommandQueue = nullptr;
   QueueHandle_t transportEventQueue = nullptr;
   TaskHandle_t transportPumpTaskHandle = nullptr;
 
+  uint8_t transportCommandQueueStorage[TRANSPORT_COMMAND_QUEUE_LENGTH * sizeof(TransportMessage)];
+  uint8_t transportEventQueueStorage[TRANSPORT_EVENT_QUEUE_LENGTH * sizeof(TransportMessage)];
+  StaticQueue_t transportCommandQueueBuffer;
+  StaticQueue_t transportEventQueueBuffer;
+  StackType_t transportPumpStack[memory_budget::kTransportPumpStackBytes];
+  StaticTask_t transportPumpTaskBuffer;
+  TaskHandle_t arduinoLoopTaskHandle = nullptr;
+
+  // Responses produced on responseCaptureTask bypass the transport and are appended to
+  // responseCaptureTarget instead, one line each (or dropped when it is null).
+  TaskHandle_t responseCaptureTask = nullptr;
+  String *responseCaptureTarget = nullptr;
+
+  // POST /api/hid passes one command at a time to the pump through the command queue and
+  // waits on httpCommandDone for its replies. The sequence number keeps replies to a
+  // command that timed out from being taken for the next one.
+  constexpr uint32_t HTTP_COMMAND_TIMEOUT_MS = 15000;
+  SemaphoreHandle_t httpCommandDone = nullptr;
+  StaticSemaphore_t httpCommandDoneBuffer;
+  uint32_t httpCommandSequence = 0;
+  std::atomic<uint32_t> httpReplySequence{0};
+  String httpCommandReply;
+
   bool enqueueTransportMessage(QueueHandle_t queue, const char *data, size_t length)
   {
     if (!queue || !data)
@@ -95,7 +141,14 @@ namespace
       memcpy(message.payload, data, length);
     }
     message.payload[length] = '\0';
-    return xQueueSend(queue, &message, 0) == pdPASS;
+    trace::QueueId queueId = (queue == transportCommandQueue) ? trace::QueueId::Command : trace::QueueId::Event;
+    if (xQueueSend(queue, &message, 0) != pdPASS)
+    {
+      trace::record(trace::EventType::QueueDrop, queueId, static_cast<uint32_t>(length));
+      return false;
+    }
+    trace::record(trace::EventType::QueueEnqueue, queueId, uxQueueMessagesWaiting(queue));
+    return true;
   }
 
   void dispatchTransportJson(const char *payload)
@@ -105,6 +158,22 @@ namespace
       return;
     }
 
+    // Events also reach GET /api/events observers, whatever the transport.
+    if (strncmp(payload, "{\"event\":", 9) == 0)
+    {
+      http_server::publish_event(payload);
+    }
+
+    if (responseCaptureTask && responseCaptureTask == xTaskGetCurrentTaskHandle())
+    {
+      if (responseCaptureTarget)
+      {
+        *responseCaptureTarget += payload;
+        *responseCaptureTarget += '\n';
+      }
+      return;
+    }
+
     if (activeTransportMode.load() == TransportMode::Websocket)
     {
       if (!ensureTransportQueues())
@@ -129,19 +198,87 @@ namespace
     dispatchTransportJson(payload.c_str());
   }
 
+  // dispatchTransportJson() drops what does not fit the event queue. Bursts that must arrive
+  // whole (trace chunks) wait here first for the WebSocket sender to make room; false when
+  // it made none within timeoutMs, e.g. because no client is connected.
+  bool waitForEventQueueSpace(uint32_t timeoutMs)
+  {
+    if (activeTransportMode.load() != TransportMode::Websocket || !transportEventQueue ||
+        (responseCaptureTask && responseCaptureTask == xTaskGetCurrentTaskHandle()))
+    {
+      return true;
+    }
+    uint32_t start = millis();
+    while (uxQueueSpacesAvailable(transportEventQueue) == 0)
+    {
+      if (millis() - start >= timeoutMs)
+      {
+        return false;
+      }
+      vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
+  }
+
   bool ensureTransportQueues()
   {
     if (!transportCommandQueue)
     {
-      transportCommandQueue = xQueueCreate(TRANSPORT_COMMAND_QUEUE_LENGTH, sizeof(TransportMessage));
+      transportCommandQueue = xQueueCreateStatic(TRANSPORT_COMMAND_QUEUE_LENGTH,
+                                                 sizeof(TransportMessage),
+                                                 transportCommandQueueStorage,
+                                                 &transportCommandQueueBuffer);
     }
     if (!transportEventQueue)
     {
-      transportEventQueue = xQueueCreate(TRANSPORT_EVENT_QUEUE_LENGTH, sizeof(TransportMessage));
+      transportEventQueue = xQueueCreateStatic(TRANSPORT_EVENT_QUEUE_LENGTH,
+                                               sizeof(TransportMessage),
+                                               transportEventQueueStorage,
+                                               &transportEventQueueBuffer);
     }
     return transportCommandQueue != nullptr && transportEventQueue != nullptr;
   }
 
+  // Runs on the httpd task for POST /api/hid.
+  bool executeHttpCommand(const char *payload, size_t length, std::string &reply)
+  {
+    if (!httpCommandDone || !ensureTransportQueues() || length >= INPUT_BUFFER_LIMIT)
+    {
+      return false;
+    }
+
+    uint32_t sequence = ++httpCommandSequence;
+    if (sequence == 0)
+    {
+      sequence = ++httpCommandSequence;
+    }
+    TransportMessage message = {};
+    message.length = length;
+    message.reply_sequence = sequence;
+    memcpy(message.payload, payload, length);
+    message.payload[length] = '\0';
+    // Wait for room rather than drop: the HTTP client is paced by the pipeline.
+    if (xQueueSend(transportCommandQueue, &message, pdMS_TO_TICKS(HTTP_COMMAND_TIMEOUT_MS)) != pdPASS)
+    {
+      trace::record(trace::EventType::QueueDrop, trace::QueueId::Command, static_cast<uint32_t>(length));
+      return false;
+    }
+    trace::record(trace::EventType::QueueEnqueue, trace::QueueId::Command, uxQueueMessagesWaiting(transportCommandQueue));
+
+    for (;;)
+    {
+      if (xSemaphoreTake(httpCommandDone, pdMS_TO_TICKS(HTTP_COMMAND_TIMEOUT_MS)) != pdTRUE)
+      {
+        return false;
+      }
+      if (httpReplySequence.load(std::memory_order_acquire) == sequence)
+      {
+        reply.assign(httpCommandReply.c_str(), httpCommandReply.length());
+        return true;
+      }
+    }
+  }
+
   void resetTransportQueues()
   {
     if (transportCommandQueue)
@@ -229,7 +366,23 @@ namespace
     return true;
   }
 
-  bool saveTransportConfig(TransportMode mode, uint32_t baud)
+  NetworkProfile getNetworkProfile()
+  {
+    return activeNetworkProfile.load();
+  }
+
+  bool applyNetworkProfile(NetworkProfile profile)
+  {
+    if (!wifi_manager::set_power_save(profile == NetworkProfile::PowerSave))
+    {
+      return false;
+    }
+    activeNetworkProfile.store(profile);
+    http_server::apply_network_profile_to_sessions();
+    return true;
+  }
+
+  bool saveTransportConfig(TransportMode mode, uint32_t baud, NetworkProfile profile)
   {
     nvs_handle_t handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE_TRANSPORT, NVS_READWRITE, &handle);
@@ -244,6 +397,10 @@ namespace
       err = nvs_set_u32(handle, NVS_KEY_UART_BAUD, baud);
     }
     if (err == ESP_OK)
+    {
+      err = nvs_set_u8(handle, NVS_KEY_NETWORK_PROFILE, static_cast<uint8_t>(profile));
+    }
+    if (err == ESP_OK)
     {
       err = nvs_commit(handle);
     }
@@ -251,9 +408,10 @@ namespace
     return err == ESP_OK;
   }
 
-  TransportMode loadTransportModeFromStorage(uint32_t &baudOut)
+  TransportMode loadTransportModeFromStorage(uint32_t &baudOut, NetworkProfile &profileOut)
   {
     baudOut = DEFAULT_UART_BAUD;
+    profileOut = NetworkProfile::PowerSave;
     nvs_handle_t handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE_TRANSPORT, NVS_READONLY, &handle);
     if (err != ESP_OK)
@@ -281,6 +439,13 @@ namespace
       baudOut = baudValue;
     }
 
+    uint8_t profileValue = static_cast<uint8_t>(NetworkProfile::PowerSave);
+    if (nvs_get_u8(handle, NVS_KEY_NETWORK_PROFILE, &profileValue) == ESP_OK &&
+        profileValue <= static_cast<uint8_t>(NetworkProfile::LowLatency))
+    {
+      profileOut = static_cast<NetworkProfile>(profileValue);
+    }
+
     nvs_close(handle);
     return static_cast<TransportMode>(modeValue);
   }
@@ -301,6 +466,7 @@ namespace
     }
   }
   String inputBuffer;
+  pointer_protocol::FrameReader pointerFrameReader;
   bool lastBleConnectionState = false;
 
   struct NamedCode
@@ -403,50 +569,171 @@ namespace
 
   const size_t MOUSE_BUTTON_MAP_SIZE = sizeof(MOUSE_BUTTON_MAP) / sizeof(MOUSE_BUTTON_MAP[0]);
 
-  struct ConsumerEntry
+  struct GamepadButtonEntry
   {
     const char *name;
-    const MediaKeyReport *report;
+    uint8_t number;
   };
 
-  const ConsumerEntry CONSUMER_KEY_MAP[] = {
-      {"KEY_MEDIA_PLAY_PAUSE", &KEY_MEDIA_PLAY_PAUSE},
-      {"MEDIA_PLAY_PAUSE", &KEY_MEDIA_PLAY_PAUSE},
-      {"PLAY_PAUSE", &KEY_MEDIA_PLAY_PAUSE},
-      {"KEY_MEDIA_STOP", &KEY_MEDIA_STOP},
-      {"MEDIA_STOP", &KEY_MEDIA_STOP},
-      {"KEY_MEDIA_NEXT_TRACK", &KEY_MEDIA_NEXT_TRACK},
-      {"MEDIA_NEXT", &KEY_MEDIA_NEXT_TRACK},
-      {"NEXT_TRACK", &KEY_MEDIA_NEXT_TRACK},
-      {"KEY_MEDIA_PREVIOUS_TRACK", &KEY_MEDIA_PREVIOUS_TRACK},
-      {"MEDIA_PREVIOUS", &KEY_MEDIA_PREVIOUS_TRACK},
-      {"MEDIA_PREV", &KEY_MEDIA_PREVIOUS_TRACK},
-      {"PREVIOUS_TRACK", &KEY_MEDIA_PREVIOUS_TRACK},
-      {"KEY_MEDIA_VOLUME_UP", &KEY_MEDIA_VOLUME_UP},
-      {"VOLUME_UP", &KEY_MEDIA_VOLUME_UP},
-      {"KEY_MEDIA_VOLUME_DOWN", &KEY_MEDIA_VOLUME_DOWN},
-      {"VOLUME_DOWN", &KEY_MEDIA_VOLUME_DOWN},
-      {"KEY_MEDIA_MUTE", &KEY_MEDIA_MUTE},
-      {"MUTE", &KEY_MEDIA_MUTE},
-      {"KEY_MEDIA_WWW_HOME", &KEY_MEDIA_WWW_HOME},
-      {"WWW_HOME", &KEY_MEDIA_WWW_HOME},
-      {"KEY_MEDIA_EMAIL_READER", &KEY_MEDIA_EMAIL_READER},
-      {"EMAIL", &KEY_MEDIA_EMAIL_READER},
-      {"KEY_MEDIA_CALCULATOR", &KEY_MEDIA_CALCULATOR},
-      {"CALCULATOR", &KEY_MEDIA_CALCULATOR},
-      {"KEY_MEDIA_WWW_SEARCH", &KEY_MEDIA_WWW_SEARCH},
-      {"WWW_SEARCH", &KEY_MEDIA_WWW_SEARCH},
-      {"KEY_MEDIA_WWW_STOP", &KEY_MEDIA_WWW_STOP},
-      {"WWW_STOP", &KEY_MEDIA_WWW_STOP},
-      {"KEY_MEDIA_WWW_BACK", &KEY_MEDIA_WWW_BACK},
-      {"WWW_BACK", &KEY_MEDIA_WWW_BACK},
-      {"KEY_MEDIA_WWW_BOOKMARKS", &KEY_MEDIA_WWW_BOOKMARKS},
-      {"WWW_BOOKMARKS", &KEY_MEDIA_WWW_BOOKMARKS}};
-
-  const size_t CONSUMER_KEY_MAP_SIZE = sizeof(CONSUMER_KEY_MAP) / sizeof(CONSUMER_KEY_MAP[0]);
+  // Xbox-style names for the first eleven buttons; any button can also be given as 1..32.
+  const GamepadButtonEntry GAMEPAD_BUTTON_MAP[] = {
+      {"A", 1},
+      {"SOUTH", 1},
+      {"B", 2},
+      {"EAST", 2},
+      {"X", 3},
+      {"WEST", 3},
+      {"Y", 4},
+      {"NORTH", 4},
+      {"LB", 5},
+      {"L1", 5},
+      {"RB", 6},
+      {"R1", 6},
+      {"BACK", 7},
+      {"SELECT", 7},
+      {"START", 8},
+      {"HOME", 9},
+      {"GUIDE", 9},
+      {"LS", 10},
+      {"L3", 10},
+      {"RS", 11},
+      {"R3", 11}};
+
+  const size_t GAMEPAD_BUTTON_MAP_SIZE = sizeof(GAMEPAD_BUTTON_MAP) / sizeof(GAMEPAD_BUTTON_MAP[0]);
+
+  // Hat positions clockwise from up, matching the descriptor's 0..7 range.
+  const char *const GAMEPAD_HAT_NAMES[] = {"UP", "UP_RIGHT", "RIGHT", "DOWN_RIGHT", "DOWN", "DOWN_LEFT", "LEFT", "UP_LEFT"};
 
   constexpr size_t MAX_CONSUMER_KEYS = 8;
 
+  // Every HID report produced by the command handlers goes through hidOutput(), so the
+  // dispatcher can be benchmarked against a sink that never touches BLE.
+  struct HidOutput
+  {
+    bool (*is_connected)();
+    void (*keyboard_press)(uint8_t code);
+    void (*keyboard_release)(uint8_t code);
+    void (*keyboard_write)(uint8_t code);
+    void (*keyboard_release_all)();
+    void (*consumer_write)(consumer_control::Usage usage);
+    void (*mouse_move)(int dx, int dy, int wheel, int pan);
+    void (*mouse_click)(uint8_t mask);
+    void (*mouse_press)(uint8_t mask);
+    void (*mouse_release)(uint8_t mask);
+    bool (*gamepad_report)(const uint8_t *report, size_t length);
+  };
+
+  void traceHidReport(trace::HidReportKind kind, uint32_t detail = 0)
+  {
+    trace::record(trace::EventType::HidReport, kind, detail);
+  }
+
+  // Press and release of one usage. Without the extended collections only the usages in
+  // BleCombo's media-key bitmap exist; handleConsumer checks can_send() before getting here.
+  void writeConsumerUsage(consumer_control::Usage usage)
+  {
+    if (!consumer_control::hid_supported())
+    {
+      uint16_t mask = consumer_control::legacy_mask(usage.id);
+      MediaKeyReport report = {static_cast<uint8_t>(mask & 0xFF), static_cast<uint8_t>(mask >> 8)};
+      Keyboard.write(report);
+      return;
+    }
+    if (usage.page == consumer_control::Page::System)
+    {
+      uint8_t report[consumer_control::kSystemReportBytes];
+      consumer_control::encode_system(usage.id, report);
+      consumer_control::hid_send_report(consumer_control::kSystemReportId, report, sizeof(report));
+      consumer_control::encode_system(0, report);
+      consumer_control::hid_send_report(consumer_control::kSystemReportId, report, sizeof(report));
+      return;
+    }
+    uint8_t report[consumer_control::kConsumerReportBytes];
+    consumer_control::encode_consumer(usage.id, report);
+    consumer_control::hid_send_report(consumer_control::kConsumerReportId, report, sizeof(report));
+    consumer_control::encode_consumer(0, report);
+    consumer_control::hid_send_report(consumer_control::kConsumerReportId, report, sizeof(report));
+  }
+
+  const HidOutput BLE_HID_OUTPUT = {
+      []() { return Keyboard.isConnected(); },
+      [](uint8_t code)
+      {
+        Keyboard.press(code);
+        traceHidReport(trace::HidReportKind::KeyboardPress, code);
+      },
+      [](uint8_t code)
+      {
+        Keyboard.release(code);
+        traceHidReport(trace::HidReportKind::KeyboardRelease, code);
+      },
+      [](uint8_t code)
+      {
+        Keyboard.write(code);
+        traceHidReport(trace::HidReportKind::KeyboardWrite, code);
+      },
+      []()
+      {
+        Keyboard.releaseAll();
+        traceHidReport(trace::HidReportKind::KeyboardReleaseAll);
+      },
+      [](consumer_control::Usage usage)
+      {
+        writeConsumerUsage(usage);
+        traceHidReport(usage.page == consumer_control::Page::System ? trace::HidReportKind::SystemControl
+                                                                    : trace::HidReportKind::Consumer,
+                       usage.id);
+      },
+      [](int dx, int dy, int wheel, int pan)
+      {
+        Mouse.move(dx, dy, wheel, pan);
+        traceHidReport(trace::HidReportKind::MouseMove);
+      },
+      [](uint8_t mask)
+      {
+        Mouse.click(mask);
+        traceHidReport(trace::HidReportKind::MouseButtons, mask);
+      },
+      [](uint8_t mask)
+      {
+        Mouse.press(mask);
+        traceHidReport(trace::HidReportKind::MouseButtons, mask);
+      },
+      [](uint8_t mask)
+      {
+        Mouse.release(mask);
+        traceHidReport(trace::HidReportKind::MouseButtons, mask);
+      },
+      [](const uint8_t *report, size_t length)
+      {
+        bool sent = gamepad::hid_send_report(report, length);
+        traceHidReport(trace::HidReportKind::Gamepad, sent ? 0 : 1);
+        return sent;
+      }};
+
+  const HidOutput NULL_HID_OUTPUT = {
+      []() { return true; },
+      [](uint8_t) {},
+      [](uint8_t) {},
+      [](uint8_t) {},
+      []() {},
+      [](consumer_control::Usage) {},
+      [](int, int, int, int) {},
+      [](uint8_t) {},
+      [](uint8_t) {},
+      [](uint8_t) {},
+      [](const uint8_t *, size_t) { return true; }};
+
+  // The task running a benchmark or stress run (see beginHidIsolation). Only its reports go
+  // to the null sink; the gamepad task and the text pump keep reaching BLE meanwhile.
+  std::atomic<TaskHandle_t> hidIsolatedTask{nullptr};
+
+  const HidOutput *hidOutput()
+  {
+    TaskHandle_t isolated = hidIsolatedTask.load(std::memory_order_acquire);
+    return isolated && isolated == xTaskGetCurrentTaskHandle() ? &NULL_HID_OUTPUT : &BLE_HID_OUTPUT;
+  }
+
   bool initializeNvs()
   {
     esp_err_t err = nvs_flash_init();
@@ -461,6 +748,110 @@ namespace
     return err == ESP_OK;
   }
 
+  // Characters taken from text_stream per pass of the pump; at the default delay this
+  // holds up a waiting command for about 100 ms at most.
+  constexpr size_t TEXT_SLICE_CHARS = 8;
+  bool textStreamTyping = false;
+  uint32_t textStreamTypedInRun = 0;
+
+  // Types the next slice of uploaded text. True when anything was typed, so the pump polls
+  // again instead of sleeping.
+  bool typePendingText()
+  {
+    if (text_stream::buffered() == 0)
+    {
+      if (textStreamTyping && !text_stream::upload_active())
+      {
+        textStreamTyping = false;
+        sendEvent("text_done", String(textStreamTypedInRun).c_str());
+        textStreamTypedInRun = 0;
+      }
+      return false;
+    }
+    if (!hidOutput()->is_connected())
+    {
+      // Keep the text; the upload stalls and gives up if the link does not come back.
+      return false;
+    }
+
+    char slice[TEXT_SLICE_CHARS];
+    size_t count = text_stream::read(slice, sizeof(slice));
+    uint16_t charDelay = text_stream::char_delay_ms();
+    size_t skipped = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      uint8_t c = static_cast<uint8_t>(slice[i]);
+      // Bytes from 0x80 up are KEY_* codes (modifiers, arrows) to the keyboard, and UTF-8
+      // sequences have no key to type anyway.
+      if (c >= 0x80)
+      {
+        ++skipped;
+        continue;
+      }
+      hidOutput()->keyboard_write(c);
+      if (charDelay)
+      {
+        delay(charDelay);
+      }
+    }
+    text_stream::note_typed(count - skipped, skipped);
+    textStreamTyping = true;
+    textStreamTypedInRun += static_cast<uint32_t>(count - skipped);
+    return count > 0;
+  }
+
+  // Benchmarks and stress runs send the calling task's HID output to the null sink and drop
+  // its responses. The capture in force before (POST /api/hid) is restored afterwards.
+  TaskHandle_t isolationSavedCaptureTask = nullptr;
+  String *isolationSavedCaptureTarget = nullptr;
+
+  void beginHidIsolation()
+  {
+    isolationSavedCaptureTask = responseCaptureTask;
+    isolationSavedCaptureTarget = responseCaptureTarget;
+    hidIsolatedTask.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    responseCaptureTarget = nullptr;
+    responseCaptureTask = xTaskGetCurrentTaskHandle();
+  }
+
+  void endHidIsolation()
+  {
+    responseCaptureTask = isolationSavedCaptureTask;
+    responseCaptureTarget = isolationSavedCaptureTarget;
+    hidIsolatedTask.store(nullptr, std::memory_order_release);
+  }
+
+  void runQueuedMessage(const TransportMessage &message)
+  {
+    bool fromHttp = message.reply_sequence != 0;
+    TaskHandle_t previousCaptureTask = responseCaptureTask;
+    String *previousCaptureTarget = responseCaptureTarget;
+    if (fromHttp)
+    {
+      httpCommandReply = "";
+      responseCaptureTask = xTaskGetCurrentTaskHandle();
+      responseCaptureTarget = &httpCommandReply;
+    }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(message.payload);
+    if (message.length > 0 && bytes[0] == pointer_protocol::kFrameStart)
+    {
+      processPointerFrame(bytes, message.length);
+    }
+    else
+    {
+      processCommand(String(message.payload));
+    }
+
+    if (fromHttp)
+    {
+      responseCaptureTask = previousCaptureTask;
+      responseCaptureTarget = previousCaptureTarget;
+      httpReplySequence.store(message.reply_sequence, std::memory_order_release);
+      xSemaphoreGive(httpCommandDone);
+    }
+  }
+
   void transportPumpTask(void *param)
   {
     constexpr TickType_t idleDelay = pdMS_TO_TICKS(10);
@@ -474,11 +865,16 @@ namespace
         if (transportCommandQueue)
         {
           TransportMessage message = {};
-          if (xQueueReceive(transportCommandQueue, &message, pdMS_TO_TICKS(50)) == pdPASS)
+          bool typed = typePendingText();
+          if (xQueueReceive(transportCommandQueue, &message, typed ? 0 : pdMS_TO_TICKS(50)) == pdPASS)
           {
-            processCommand(String(message.payload));
+            trace::record(trace::EventType::TaskWake, trace::TaskId::TransportPump);
+            trace::record(trace::EventType::QueueDequeue,
+                          trace::QueueId::Command,
+                          uxQueueMessagesWaiting(transportCommandQueue));
+            runQueuedMessage(message);
           }
-          else
+          else if (!typed)
           {
             vTaskDelay(idleDelay);
           }
@@ -490,14 +886,35 @@ namespace
       }
       else
       {
-        bool processed = false;
+        bool processed = typePendingText();
         if (serialActive)
         {
           while (Serial.available())
           {
+            if (!processed)
+            {
+              trace::record(trace::EventType::TaskWake, trace::TaskId::TransportPump);
+            }
             processed = true;
             char c = static_cast<char>(Serial.read());
 
+            // Binary frames are length-delimited and may contain '\n', so collect them
+            // before looking for line endings.
+            if (pointerFrameReader.active())
+            {
+              if (pointerFrameReader.push(static_cast<uint8_t>(c)))
+              {
+                processPointerFrame(pointerFrameReader.frame(), pointerFrameReader.size());
+              }
+              continue;
+            }
+
+            if (inputBuffer.length() == 0 && static_cast<uint8_t>(c) == pointer_protocol::kFrameStart)
+            {
+              pointerFrameReader.begin();
+              continue;
+            }
+
             if (c == '\r')
             {
               continue;
@@ -520,7 +937,19 @@ namespace
           }
         }
 
-        if (!processed)
+        // Only POST /api/hid feeds the command queue in UART mode. Waiting on it doubles
+        // as the idle delay, so those commands do not sit out a full delay each.
+        TransportMessage message = {};
+        if (transportCommandQueue &&
+            xQueueReceive(transportCommandQueue, &message, processed ? 0 : idleDelay) == pdPASS)
+        {
+          trace::record(trace::EventType::TaskWake, trace::TaskId::TransportPump);
+          trace::record(trace::EventType::QueueDequeue,
+                        trace::QueueId::Command,
+                        uxQueueMessagesWaiting(transportCommandQueue));
+          runQueuedMessage(message);
+        }
+        else if (!processed && !transportCommandQueue)
         {
           vTaskDelay(idleDelay);
         }
@@ -535,18 +964,25 @@ namespace
       return;
     }
 
-    constexpr uint32_t stackSize = 4096;
+    constexpr uint32_t stackSize = sizeof(transportPumpStack);
     constexpr UBaseType_t priority = tskIDLE_PRIORITY + 2;
 #if defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
-    xTaskCreate(transportPumpTask, "transport_pump", stackSize, nullptr, priority, &transportPumpTaskHandle);
+    transportPumpTaskHandle = xTaskCreateStatic(transportPumpTask,
+                                                "transport_pump",
+                                                stackSize,
+                                                nullptr,
+                                                priority,
+                                                transportPumpStack,
+                                                &transportPumpTaskBuffer);
 #else
-    xTaskCreatePinnedToCore(transportPumpTask,
-                            "transport_pump",
-                            stackSize,
-                            nullptr,
-                            priority,
-                            &transportPumpTaskHandle,
-                            kHttpTaskCore);
+    transportPumpTaskHandle = xTaskCreateStaticPinnedToCore(transportPumpTask,
+                                                            "transport_pump",
+                                                            stackSize,
+                                                            nullptr,
+                                                            priority,
+                                                            transportPumpStack,
+                                                            &transportPumpTaskBuffer,
+                                                            kHttpTaskCore);
 #endif
   }
 
@@ -706,19 +1142,51 @@ namespace
     return false;
   }
 
-  bool lookupConsumerKey(const String &token, const MediaKeyReport *&report)
+  // A name from consumer_control::kUsageNames, or a consumer-page usage ID written as
+  // "0x6F"; `token` is already trimmed and upper case.
+  bool lookupConsumerKey(const String &token, consumer_control::Usage &usage)
   {
-    for (size_t i = 0; i < CONSUMER_KEY_MAP_SIZE; ++i)
+    const consumer_control::NamedUsage *named = consumer_control::find(token.c_str());
+    if (named)
+    {
+      usage = named->usage;
+      return true;
+    }
+    if (token.startsWith("0X") && token.length() > 2)
     {
-      if (token.equals(CONSUMER_KEY_MAP[i].name))
+      char *end = nullptr;
+      unsigned long id = strtoul(token.c_str() + 2, &end, 16);
+      if (*end == '\0' && id > 0 && id <= 0xFFFF)
       {
-        report = CONSUMER_KEY_MAP[i].report;
+        usage = {consumer_control::Page::Consumer, static_cast<uint16_t>(id)};
         return true;
       }
     }
     return false;
   }
 
+  bool lookupConsumerEntry(JsonVariantConst entry, consumer_control::Usage &usage)
+  {
+    if (entry.is<int>())
+    {
+      int id = entry.as<int>();
+      if (id <= 0 || id > 0xFFFF)
+      {
+        return false;
+      }
+      usage = {consumer_control::Page::Consumer, static_cast<uint16_t>(id)};
+      return true;
+    }
+    if (!entry.is<const char *>())
+    {
+      return false;
+    }
+    String token = entry.as<const char *>();
+    token.trim();
+    token.toUpperCase();
+    return lookupConsumerKey(token, usage);
+  }
+
   void reportInvalidKey(JsonVariantConst value)
   {
     if (value.is<const char *>())
@@ -1044,7 +1512,7 @@ namespace
     }
   }
 
-  bool collectConsumerReports(JsonVariantConst source, const MediaKeyReport **reports, size_t &count, size_t maxCount)
+  bool collectConsumerUsages(JsonVariantConst source, consumer_control::Usage *usages, size_t &count, size_t maxCount)
   {
     count = 0;
     if (source.is<JsonArrayConst>())
@@ -1052,20 +1520,12 @@ namespace
       JsonArrayConst arr = source.as<JsonArrayConst>();
       for (JsonVariantConst entry : arr)
       {
-        if (!entry.is<const char *>())
-        {
-          reportInvalidConsumerKey(entry);
-          return false;
-        }
         if (count >= maxCount)
         {
           sendStatusError("Too many consumer keys");
           return false;
         }
-        String token = entry.as<const char *>();
-        token.trim();
-        token.toUpperCase();
-        if (!lookupConsumerKey(token, reports[count]))
+        if (!lookupConsumerEntry(entry, usages[count]))
         {
           reportInvalidConsumerKey(entry);
           return false;
@@ -1075,348 +1535,324 @@ namespace
       return count > 0;
     }
 
-    if (source.is<const char *>())
+    if (lookupConsumerEntry(source, usages[0]))
     {
-      String token = source.as<const char *>();
-      token.trim();
-      token.toUpperCase();
-      if (lookupConsumerKey(token, reports[0]))
-      {
-        count = 1;
-        return true;
-      }
-      reportInvalidConsumerKey(source);
-      return false;
+      count = 1;
+      return true;
     }
-
     reportInvalidConsumerKey(source);
     return false;
   }
 
-  void handleKeyboard(JsonVariantConst command)
+  bool requireConnection(const char *message)
   {
-    if (!Keyboard.isConnected())
+    if (hidOutput()->is_connected())
     {
-      sendStatusError("BLE keyboard not connected");
-      return;
+      return true;
     }
+    sendStatusError(message);
+    return false;
+  }
 
-    const char *action = command["action"] | "press";
-    uint8_t codes[MAX_KEY_COMBO];
-    size_t keyCount = 0;
+  void writeKeyboardText(JsonVariantConst command, bool addNewLine)
+  {
+    const char *text = command["text"];
+    uint16_t repeat = clampRepeat(command["repeat"]);
+    addNewLine = addNewLine || command["newline"].as<bool>();
+    size_t textLength = text ? strlen(text) : 0;
 
-    if (strcmp(action, "write") == 0 || strcmp(action, "print") == 0 || strcmp(action, "println") == 0)
+    uint16_t charDelay = DEFAULT_CHAR_DELAY_MS;
+    bool charDelaySpecified = false;
+    auto updateCharDelay = [&](JsonVariantConst value)
     {
-      const char *text = command["text"];
-      uint16_t repeat = clampRepeat(command["repeat"]);
-      bool addNewLine = strcmp(action, "println") == 0 || command["newline"].as<bool>();
-      size_t textLength = text ? strlen(text) : 0;
-
-      uint16_t charDelay = DEFAULT_CHAR_DELAY_MS;
-      bool charDelaySpecified = false;
-      auto updateCharDelay = [&](JsonVariantConst value)
-      {
-        if (!value.isNull())
-        {
-          charDelay = clampDuration(value, charDelay, 0, 1000);
-          charDelaySpecified = true;
-        }
-      };
-      updateCharDelay(command["charDelayMs"]);
-      updateCharDelay(command["char_delay_ms"]);
-      updateCharDelay(command["interKeyDelayMs"]);
-      updateCharDelay(command["inter_key_delay_ms"]);
-      if (!charDelaySpecified)
-      {
-        updateCharDelay(command["delayMs"]);
-      }
-      if (!charDelaySpecified)
+      if (!value.isNull())
       {
-        updateCharDelay(command["delay_ms"]);
+        charDelay = clampDuration(value, charDelay, 0, 1000);
+        charDelaySpecified = true;
       }
+    };
+    updateCharDelay(command["charDelayMs"]);
+    updateCharDelay(command["char_delay_ms"]);
+    updateCharDelay(command["interKeyDelayMs"]);
+    updateCharDelay(command["inter_key_delay_ms"]);
+    if (!charDelaySpecified)
+    {
+      updateCharDelay(command["delayMs"]);
+    }
+    if (!charDelaySpecified)
+    {
+      updateCharDelay(command["delay_ms"]);
+    }
 
-      bool newlineCarriage = command["newlineCarriage"].isNull() ? true : command["newlineCarriage"].as<bool>();
+    bool newlineCarriage = command["newlineCarriage"].isNull() ? true : command["newlineCarriage"].as<bool>();
 
-      if (text)
+    if (text)
+    {
+      for (uint16_t i = 0; i < repeat; ++i)
       {
-        for (uint16_t i = 0; i < repeat; ++i)
+        for (size_t idx = 0; idx < textLength; ++idx)
         {
-          for (size_t idx = 0; idx < textLength; ++idx)
-          {
-            Keyboard.write(static_cast<uint8_t>(text[idx]));
-            if (charDelay)
-            {
-              delay(charDelay);
-            }
-          }
-          if (addNewLine)
+          hidOutput()->keyboard_write(static_cast<uint8_t>(text[idx]));
+          if (charDelay)
           {
-            if (newlineCarriage)
-            {
-              Keyboard.write('\r');
-              if (charDelay)
-              {
-                delay(charDelay);
-              }
-            }
-            Keyboard.write('\n');
-            if (charDelay)
-            {
-              delay(charDelay);
-            }
+            delay(charDelay);
           }
         }
-        sendStatusOk();
-        return;
-      }
-
-      if (addNewLine)
-      {
-        for (uint16_t i = 0; i < repeat; ++i)
+        if (addNewLine)
         {
           if (newlineCarriage)
           {
-            Keyboard.write('\r');
+            hidOutput()->keyboard_write('\r');
             if (charDelay)
             {
               delay(charDelay);
             }
           }
-          Keyboard.write('\n');
+          hidOutput()->keyboard_write('\n');
           if (charDelay)
           {
             delay(charDelay);
           }
         }
-        sendStatusOk();
-        return;
-      }
-
-      if (!extractKeyCodes(command, codes, keyCount))
-      {
-        return;
       }
+      sendStatusOk();
+      return;
+    }
 
+    if (addNewLine)
+    {
       for (uint16_t i = 0; i < repeat; ++i)
       {
-        for (size_t idx = 0; idx < keyCount; ++idx)
+        if (newlineCarriage)
         {
-          Keyboard.write(codes[idx]);
+          hidOutput()->keyboard_write('\r');
+          if (charDelay)
+          {
+            delay(charDelay);
+          }
         }
-        if (addNewLine)
+        hidOutput()->keyboard_write('\n');
+        if (charDelay)
         {
-          Keyboard.println();
+          delay(charDelay);
         }
       }
       sendStatusOk();
       return;
     }
 
-    if (strcmp(action, "releaseAll") == 0 || strcmp(action, "release_all") == 0)
-    {
-      Keyboard.releaseAll();
-      sendStatusOk();
-      return;
-    }
-
+    uint8_t codes[MAX_KEY_COMBO];
+    size_t keyCount = 0;
     if (!extractKeyCodes(command, codes, keyCount))
     {
       return;
     }
 
-    if (strcmp(action, "press") == 0)
+    for (uint16_t i = 0; i < repeat; ++i)
     {
       for (size_t idx = 0; idx < keyCount; ++idx)
       {
-        Keyboard.press(codes[idx]);
+        hidOutput()->keyboard_write(codes[idx]);
       }
-      sendStatusOk();
-      return;
-    }
-
-    if (strcmp(action, "release") == 0)
-    {
-      for (size_t idx = 0; idx < keyCount; ++idx)
+      if (addNewLine)
       {
-        Keyboard.release(codes[idx]);
+        hidOutput()->keyboard_write('\r');
+        hidOutput()->keyboard_write('\n');
       }
-      sendStatusOk();
-      return;
     }
+    sendStatusOk();
+  }
 
-    if (strcmp(action, "tap") == 0 || strcmp(action, "click") == 0)
+  void handleKeyboardWrite(JsonVariantConst command)
+  {
+    if (requireConnection("BLE keyboard not connected"))
     {
-      int holdValue = command["holdMs"] | 20;
-      if (!command["hold_ms"].isNull())
-      {
-        holdValue = command["hold_ms"].as<int>();
-      }
-      if (holdValue < 0)
-      {
-        holdValue = 0;
-      }
-      if (holdValue > 1000)
-      {
-        holdValue = 1000;
-      }
-      uint16_t holdMs = static_cast<uint16_t>(holdValue);
-      for (size_t idx = 0; idx < keyCount; ++idx)
-      {
-        Keyboard.press(codes[idx]);
-      }
-      delay(holdMs);
-      for (size_t idx = keyCount; idx > 0; --idx)
-      {
-        Keyboard.release(codes[idx - 1]);
-      }
-      sendStatusOk();
-      return;
+      writeKeyboardText(command, false);
     }
+  }
 
-    String message = F("Unknown keyboard action: ");
-    message += action;
-    sendStatusError(message.c_str());
+  void handleKeyboardPrintln(JsonVariantConst command)
+  {
+    if (requireConnection("BLE keyboard not connected"))
+    {
+      writeKeyboardText(command, true);
+    }
   }
 
-  void handleMouse(JsonVariantConst command)
+  void handleKeyboardReleaseAll(JsonVariantConst command)
   {
-    if (!Keyboard.isConnected())
+    (void)command;
+    if (!requireConnection("BLE keyboard not connected"))
     {
-      sendStatusError("BLE connection not established");
       return;
     }
+    hidOutput()->keyboard_release_all();
+    sendStatusOk();
+  }
 
-    const char *action = command["action"] | "move";
+  void handleKeyboardPress(JsonVariantConst command)
+  {
+    uint8_t codes[MAX_KEY_COMBO];
+    size_t keyCount = 0;
+    if (!requireConnection("BLE keyboard not connected") || !extractKeyCodes(command, codes, keyCount))
+    {
+      return;
+    }
+    for (size_t idx = 0; idx < keyCount; ++idx)
+    {
+      hidOutput()->keyboard_press(codes[idx]);
+    }
+    sendStatusOk();
+  }
 
-    if (strcmp(action, "move") == 0)
+  void handleKeyboardRelease(JsonVariantConst command)
+  {
+    uint8_t codes[MAX_KEY_COMBO];
+    size_t keyCount = 0;
+    if (!requireConnection("BLE keyboard not connected") || !extractKeyCodes(command, codes, keyCount))
     {
-      int dx = getOptionalInt(command, "x", "dx", 0);
-      int dy = getOptionalInt(command, "y", "dy", 0);
-      int wheel = getOptionalInt(command, "wheel", "scroll", 0);
-      int pan = getOptionalInt(command, "pan", nullptr, 0);
-      Mouse.move(dx, dy, wheel, pan);
-      sendStatusOk();
       return;
     }
+    for (size_t idx = 0; idx < keyCount; ++idx)
+    {
+      hidOutput()->keyboard_release(codes[idx]);
+    }
+    sendStatusOk();
+  }
 
-    if (strcmp(action, "releaseAll") == 0 || strcmp(action, "release_all") == 0)
+  void handleKeyboardTap(JsonVariantConst command)
+  {
+    uint8_t codes[MAX_KEY_COMBO];
+    size_t keyCount = 0;
+    if (!requireConnection("BLE keyboard not connected") || !extractKeyCodes(command, codes, keyCount))
     {
-      Mouse.release(MOUSE_ALL_BUTTONS);
-      sendStatusOk();
       return;
     }
+    int holdValue = command["holdMs"] | 20;
+    if (!command["hold_ms"].isNull())
+    {
+      holdValue = command["hold_ms"].as<int>();
+    }
+    if (holdValue < 0)
+    {
+      holdValue = 0;
+    }
+    if (holdValue > 1000)
+    {
+      holdValue = 1000;
+    }
+    uint16_t holdMs = static_cast<uint16_t>(holdValue);
+    for (size_t idx = 0; idx < keyCount; ++idx)
+    {
+      hidOutput()->keyboard_press(codes[idx]);
+    }
+    delay(holdMs);
+    for (size_t idx = keyCount; idx > 0; --idx)
+    {
+      hidOutput()->keyboard_release(codes[idx - 1]);
+    }
+    sendStatusOk();
+  }
 
-    uint8_t mask = 0;
-    bool hasButtons = false;
-    JsonVariantConst buttonsVariant = command["buttons"];
-    JsonVariantConst buttonVariant = command["button"];
+  void handleMouseMove(JsonVariantConst command)
+  {
+    if (!requireConnection("BLE connection not established"))
+    {
+      return;
+    }
+    int dx = getOptionalInt(command, "x", "dx", 0);
+    int dy = getOptionalInt(command, "y", "dy", 0);
+    int wheel = getOptionalInt(command, "wheel", "scroll", 0);
+    int pan = getOptionalInt(command, "pan", nullptr, 0);
+    hidOutput()->mouse_move(dx, dy, wheel, pan);
+    sendStatusOk();
+  }
 
-    if (!buttonsVariant.isNull())
+  void handleMouseReleaseAll(JsonVariantConst command)
+  {
+    (void)command;
+    if (!requireConnection("BLE connection not established"))
     {
-      hasButtons = parseButtonMask(buttonsVariant, mask);
-      if (!hasButtons)
-      {
-        return;
-      }
+      return;
     }
-    else if (!buttonVariant.isNull())
+    hidOutput()->mouse_release(MOUSE_ALL_BUTTONS);
+    sendStatusOk();
+  }
+
+  // "buttons" or "button", defaulting to the left button; false after reporting a bad value.
+  bool mouseButtons(JsonVariantConst command, uint8_t &mask)
+  {
+    if (!requireConnection("BLE connection not established"))
     {
-      hasButtons = parseButtonMask(buttonVariant, mask);
-      if (!hasButtons)
-      {
-        return;
-      }
+      return false;
     }
-    else
+    JsonVariantConst buttons = command["buttons"].isNull() ? command["button"] : command["buttons"];
+    if (buttons.isNull())
     {
-      if (strcmp(action, "click") == 0 || strcmp(action, "press") == 0 || strcmp(action, "release") == 0)
-      {
-        mask = MOUSE_LEFT;
-        hasButtons = true;
-      }
+      mask = MOUSE_LEFT;
+      return true;
     }
+    return parseButtonMask(buttons, mask);
+  }
 
-    if (strcmp(action, "click") == 0)
+  void handleMouseClick(JsonVariantConst command)
+  {
+    uint8_t mask = 0;
+    if (mouseButtons(command, mask))
     {
-      Mouse.click(mask);
+      hidOutput()->mouse_click(mask);
       sendStatusOk();
-      return;
     }
+  }
 
-    if (strcmp(action, "press") == 0)
+  void handleMousePress(JsonVariantConst command)
+  {
+    uint8_t mask = 0;
+    if (mouseButtons(command, mask))
     {
-      if (!hasButtons)
-      {
-        sendStatusError("mouse press requires button(s)");
-        return;
-      }
-      Mouse.press(mask);
+      hidOutput()->mouse_press(mask);
       sendStatusOk();
-      return;
     }
+  }
 
-    if (strcmp(action, "release") == 0)
+  void handleMouseRelease(JsonVariantConst command)
+  {
+    uint8_t mask = 0;
+    if (mouseButtons(command, mask))
     {
-      if (!hasButtons)
-      {
-        sendStatusError("mouse release requires button(s)");
-        return;
-      }
-      Mouse.release(mask);
+      hidOutput()->mouse_release(mask);
       sendStatusOk();
-      return;
     }
-
-    String message = F("Unknown mouse action: ");
-    message += action;
-    sendStatusError(message.c_str());
   }
 
   void handleConsumer(JsonVariantConst command)
   {
-    if (!Keyboard.isConnected())
+    if (!requireConnection("BLE keyboard not connected"))
     {
-      sendStatusError("BLE keyboard not connected");
       return;
     }
 
-    const MediaKeyReport *reports[MAX_CONSUMER_KEYS];
+    consumer_control::Usage usages[MAX_CONSUMER_KEYS];
     size_t count = 0;
 
-    JsonVariantConst keysVariant = command["keys"];
-    if (!keysVariant.isNull())
+    static const char *const KEY_FIELDS[] = {"keys", "key", "code", "usages", "usage"};
+    JsonVariantConst keysVariant;
+    for (const char *field : KEY_FIELDS)
     {
-      if (!collectConsumerReports(keysVariant, reports, count, MAX_CONSUMER_KEYS))
+      keysVariant = command[field];
+      if (!keysVariant.isNull())
       {
-        return;
+        break;
       }
     }
-    else
+    if (keysVariant.isNull())
     {
-      JsonVariantConst keyVariant = command["key"];
-      if (!keyVariant.isNull())
-      {
-        if (!collectConsumerReports(keyVariant, reports, count, MAX_CONSUMER_KEYS))
-        {
-          return;
-        }
-      }
-      else
-      {
-        JsonVariantConst codeVariant = command["code"];
-        if (!codeVariant.isNull())
-        {
-          if (!collectConsumerReports(codeVariant, reports, count, MAX_CONSUMER_KEYS))
-          {
-            return;
-          }
-        }
-        else
-        {
-          sendStatusError("consumer action requires key");
-          return;
-        }
-      }
+      sendStatusError("consumer action requires key");
+      return;
+    }
+    if (!collectConsumerUsages(keysVariant, usages, count, MAX_CONSUMER_KEYS))
+    {
+      return;
     }
 
     if (count == 0)
@@ -1425,6 +1861,18 @@ namespace
       return;
     }
 
+    for (size_t idx = 0; idx < count; ++idx)
+    {
+      if (!consumer_control::can_send(usages[idx]))
+      {
+        char message[64];
+        snprintf(message, sizeof(message), "%s usage 0x%04X not supported by this build",
+                 usages[idx].page == consumer_control::Page::System ? "System control" : "Consumer", usages[idx].id);
+        sendStatusError(message);
+        return;
+      }
+    }
+
     uint16_t repeat = clampRepeat(command["repeat"]);
     int gapValue = command["gapMs"] | 5;
     if (!command["gap_ms"].isNull())
@@ -1445,7 +1893,7 @@ namespace
     {
       for (size_t idx = 0; idx < count; ++idx)
       {
-        Keyboard.write(*reports[idx]);
+        hidOutput()->consumer_write(usages[idx]);
         if (gapMs > 0)
         {
           delay(gapMs);
@@ -1456,6 +1904,684 @@ namespace
     sendStatusOk();
   }
 
+  // Desired gamepad state; every command edits it and submits the result to the streaming
+  // task, which decides whether a report actually goes out.
+  gamepad::State gamepadState;
+
+  void reportInvalidGamepadButton(JsonVariantConst value)
+  {
+    if (value.is<const char *>())
+    {
+      String message = F("Unknown gamepad button: ");
+      message += value.as<const char *>();
+      sendStatusError(message.c_str());
+    }
+    else
+    {
+      sendStatusError("Invalid gamepad button entry");
+    }
+  }
+
+  bool addGamepadButton(JsonVariantConst value, uint32_t &mask)
+  {
+    if (value.is<int>())
+    {
+      int number = value.as<int>();
+      if (number < 1 || number > static_cast<int>(gamepad::kButtonCount))
+      {
+        return false;
+      }
+      mask |= 1UL << (number - 1);
+      return true;
+    }
+    if (!value.is<const char *>())
+    {
+      return false;
+    }
+    String token = value.as<const char *>();
+    token.trim();
+    token.toUpperCase();
+    for (size_t i = 0; i < GAMEPAD_BUTTON_MAP_SIZE; ++i)
+    {
+      if (token.equals(GAMEPAD_BUTTON_MAP[i].name))
+      {
+        mask |= 1UL << (GAMEPAD_BUTTON_MAP[i].number - 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool parseGamepadButtons(JsonVariantConst value, uint32_t &mask)
+  {
+    mask = 0;
+    if (value.is<JsonArrayConst>())
+    {
+      for (JsonVariantConst button : value.as<JsonArrayConst>())
+      {
+        if (!addGamepadButton(button, mask))
+        {
+          reportInvalidGamepadButton(button);
+          return false;
+        }
+      }
+      if (mask == 0)
+      {
+        sendStatusError("gamepad action requires button");
+        return false;
+      }
+      return true;
+    }
+    if (!addGamepadButton(value, mask))
+    {
+      reportInvalidGamepadButton(value);
+      return false;
+    }
+    return true;
+  }
+
+  int16_t clampGamepadAxis(int value)
+  {
+    if (value < -gamepad::kAxisMax)
+    {
+      return -gamepad::kAxisMax;
+    }
+    if (value > gamepad::kAxisMax)
+    {
+      return gamepad::kAxisMax;
+    }
+    return static_cast<int16_t>(value);
+  }
+
+  uint8_t clampGamepadTrigger(int value)
+  {
+    if (value < 0)
+    {
+      return 0;
+    }
+    if (value > gamepad::kTriggerMax)
+    {
+      return gamepad::kTriggerMax;
+    }
+    return static_cast<uint8_t>(value);
+  }
+
+  // Accepts a direction name, "center", or a number (0..7, anything else centres).
+  bool parseGamepadHat(JsonVariantConst value, uint8_t &hat)
+  {
+    if (value.is<int>())
+    {
+      int raw = value.as<int>();
+      hat = (raw >= 0 && raw <= 7) ? static_cast<uint8_t>(raw) : gamepad::kHatCentered;
+      return true;
+    }
+    if (!value.is<const char *>())
+    {
+      sendStatusError("Invalid gamepad hat value");
+      return false;
+    }
+    String token = value.as<const char *>();
+    token.trim();
+    token.toUpperCase();
+    token.replace('-', '_');
+    if (token.equals("CENTER") || token.equals("CENTRE") || token.equals("NONE"))
+    {
+      hat = gamepad::kHatCentered;
+      return true;
+    }
+    for (uint8_t i = 0; i < 8; ++i)
+    {
+      if (token.equals(GAMEPAD_HAT_NAMES[i]))
+      {
+        hat = i;
+        return true;
+      }
+    }
+    String message = F("Unknown gamepad hat direction: ");
+    message += value.as<const char *>();
+    sendStatusError(message.c_str());
+    return false;
+  }
+
+  // Sets one stick axis or trigger by name: lx, ly, rx, ry, lt, rt.
+  bool setGamepadControl(gamepad::State &state, const char *name, int value)
+  {
+    if (strcasecmp(name, "lx") == 0)
+      state.axes[gamepad::LeftX] = clampGamepadAxis(value);
+    else if (strcasecmp(name, "ly") == 0)
+      state.axes[gamepad::LeftY] = clampGamepadAxis(value);
+    else if (strcasecmp(name, "rx") == 0)
+      state.axes[gamepad::RightX] = clampGamepadAxis(value);
+    else if (strcasecmp(name, "ry") == 0)
+      state.axes[gamepad::RightY] = clampGamepadAxis(value);
+    else if (strcasecmp(name, "lt") == 0)
+      state.triggers[gamepad::LeftTrigger] = clampGamepadTrigger(value);
+    else if (strcasecmp(name, "rt") == 0)
+      state.triggers[gamepad::RightTrigger] = clampGamepadTrigger(value);
+    else
+      return false;
+    return true;
+  }
+
+  // The compact form carries the whole report in one array,
+  //   [buttons, lx, ly, rx, ry, lt, rt, hat]
+  // with buttons as a bit mask (bit 0 is button 1). An object with any of "buttons", the
+  // control names and "hat" updates only the fields it names.
+  bool parseGamepadState(JsonVariantConst value, gamepad::State &state)
+  {
+    static const char *const CONTROLS[] = {"lx", "ly", "rx", "ry", "lt", "rt"};
+    if (value.is<JsonArrayConst>())
+    {
+      JsonArrayConst fields = value.as<JsonArrayConst>();
+      if (fields.size() != 8)
+      {
+        sendStatusError("gamepad state must be [buttons, lx, ly, rx, ry, lt, rt, hat]");
+        return false;
+      }
+      state.buttons = fields[0].as<uint32_t>();
+      for (size_t i = 0; i < 6; ++i)
+      {
+        setGamepadControl(state, CONTROLS[i], fields[i + 1].as<int>());
+      }
+      return parseGamepadHat(fields[7], state.hat);
+    }
+    if (value.is<JsonObjectConst>())
+    {
+      JsonObjectConst fields = value.as<JsonObjectConst>();
+      if (!fields["buttons"].isNull())
+      {
+        JsonVariantConst buttons = fields["buttons"];
+        if (buttons.is<uint32_t>())
+        {
+          state.buttons = buttons.as<uint32_t>();
+        }
+        else if (!parseGamepadButtons(buttons, state.buttons))
+        {
+          return false;
+        }
+      }
+      for (const char *control : CONTROLS)
+      {
+        if (!fields[control].isNull())
+        {
+          setGamepadControl(state, control, fields[control].as<int>());
+        }
+      }
+      return fields["hat"].isNull() || parseGamepadHat(fields["hat"], state.hat);
+    }
+    sendStatusError("Invalid gamepad state");
+    return false;
+  }
+
+  void sendGamepadStats(const char *action)
+  {
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = action;
+    gamepad::append_stats_json(obj);
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  void handleGamepadStats(JsonVariantConst command)
+  {
+    (void)command;
+    sendGamepadStats("stats");
+  }
+
+  void handleGamepadConfig(JsonVariantConst command)
+  {
+    if (!command["intervalMs"].isNull())
+    {
+      gamepad::set_interval_ms(clampDuration(command["intervalMs"], gamepad::interval_ms(), gamepad::kMinIntervalMs,
+                                             gamepad::kMaxIntervalMs));
+    }
+    sendGamepadStats("config");
+  }
+
+  // Checks shared by the actions that change the gamepad state.
+  bool gamepadReady()
+  {
+    if (!requireConnection("BLE keyboard not connected"))
+    {
+      return false;
+    }
+    if (!gamepad::hid_supported())
+    {
+      sendStatusError("Gamepad not supported by this build");
+      return false;
+    }
+    return true;
+  }
+
+  void submitGamepadState(const gamepad::State &next)
+  {
+    gamepadState = next;
+    if (!gamepad::submit(gamepadState))
+    {
+      sendStatusError("Gamepad task not running");
+      return;
+    }
+    sendStatusOk();
+  }
+
+  void handleGamepadState(JsonVariantConst command)
+  {
+    gamepad::State next = gamepadState;
+    if (gamepadReady() && parseGamepadState(command["state"], next))
+    {
+      submitGamepadState(next);
+    }
+  }
+
+  void updateGamepadButtons(JsonVariantConst command, bool press)
+  {
+    if (!gamepadReady())
+    {
+      return;
+    }
+    JsonVariantConst buttons = command["buttons"].isNull() ? command["button"] : command["buttons"];
+    uint32_t mask = 0;
+    if (buttons.isNull())
+    {
+      sendStatusError("gamepad action requires button");
+      return;
+    }
+    if (!parseGamepadButtons(buttons, mask))
+    {
+      return;
+    }
+    gamepad::State next = gamepadState;
+    if (press)
+    {
+      next.buttons |= mask;
+    }
+    else
+    {
+      next.buttons &= ~mask;
+    }
+    submitGamepadState(next);
+  }
+
+  void handleGamepadPress(JsonVariantConst command)
+  {
+    updateGamepadButtons(command, true);
+  }
+
+  void handleGamepadRelease(JsonVariantConst command)
+  {
+    updateGamepadButtons(command, false);
+  }
+
+  void handleGamepadAxis(JsonVariantConst command)
+  {
+    if (!gamepadReady())
+    {
+      return;
+    }
+    gamepad::State next = gamepadState;
+    const char *axis = command["axis"] | "";
+    if (!setGamepadControl(next, axis, command["value"] | 0))
+    {
+      String message = F("Unknown gamepad axis: ");
+      message += axis;
+      sendStatusError(message.c_str());
+      return;
+    }
+    submitGamepadState(next);
+  }
+
+  void handleGamepadHat(JsonVariantConst command)
+  {
+    gamepad::State next = gamepadState;
+    if (gamepadReady() &&
+        parseGamepadHat(command["direction"].isNull() ? command["value"] : command["direction"], next.hat))
+    {
+      submitGamepadState(next);
+    }
+  }
+
+  void handleGamepadReset(JsonVariantConst command)
+  {
+    (void)command;
+    if (gamepadReady())
+    {
+      submitGamepadState(gamepad::State());
+    }
+  }
+
+  static_assert(sizeof(R"({"status":"ok","action":"stack_stress","ranOn":"","scanned":false,"reconnecting":false,})") -
+                        1 + task_monitor::kMaxTaskNameChars + task_monitor::kMaxReportJsonBytes <
+                    INPUT_BUFFER_LIMIT,
+                "a stack_stress reply with kMaxTasks tasks no longer fits one transport message");
+
+  // Drives the command task through its deepest paths (longest text write, widest key
+  // combos, deepest JSON nesting, oversized and invalid payloads) with HID output swapped
+  // for the null sink, then floods the event path with maximum-size messages so the
+  // WebSocket sender sees its worst case too. "scan" adds a Wi-Fi scan on this task and
+  // "reconnect" reconnects with the saved credentials to exercise wifi_connect.
+  void runStackStress(JsonVariantConst command)
+  {
+    String payloads[5];
+    payloads[0] = F("{\"device\":\"keyboard\",\"action\":\"write\",\"charDelayMs\":0,\"text\":\"");
+    while (payloads[0].length() + 3 < INPUT_BUFFER_LIMIT - 1)
+    {
+      payloads[0] += static_cast<char>('a' + (payloads[0].length() % 26));
+    }
+    payloads[0] += F("\"}");
+    payloads[1] = F("{\"device\":\"keyboard\",\"action\":\"tap\",\"holdMs\":0,"
+                    "\"keys\":[\"CTRL\",\"ALT\",\"SHIFT\",\"GUI\",\"KEY_F12\",\"KEY_F11\",\"KEY_F10\",\"KEY_F9\"]}");
+    payloads[2] = F("{\"device\":\"consumer\",\"gapMs\":0,\"keys\":[\"VOLUME_UP\",\"VOLUME_DOWN\",\"MUTE\","
+                    "\"PLAY_PAUSE\",\"NEXT_TRACK\",\"PREVIOUS_TRACK\",\"STOP\",\"NOT_A_KEY\"]}");
+    payloads[3] = F("{\"device\":\"mouse\",\"action\":\"move\",\"dx\":1,\"dy\":1,\"x\":[[[[[[[[[[[[[[[[0]]]]]]]]]]]]]]]]}");
+    payloads[4] = F("{\"device\":\"keyboard\",\"action\":\"write\",\"text\":\"");
+    while (payloads[4].length() < JSON_DOC_CAPACITY + 16)
+    {
+      payloads[4] += 'x';
+    }
+    payloads[4] += F("\"}");
+
+    beginHidIsolation();
+    for (const String &payload : payloads)
+    {
+      processCommand(payload);
+    }
+    endHidIsolation();
+
+    String filler = F("{\"event\":\"stack_stress\",\"data\":\"");
+    while (filler.length() + 2 < INPUT_BUFFER_LIMIT - 1)
+    {
+      filler += '.';
+    }
+    filler += F("\"}");
+    for (UBaseType_t idx = 0; idx < TRANSPORT_EVENT_QUEUE_LENGTH * 2; ++idx)
+    {
+      dispatchTransportJson(filler);
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    bool scanned = false;
+    if (command["scan"].as<bool>())
+    {
+      JsonDocument scanDoc;
+      JsonArray networks = scanDoc.to<JsonArray>();
+      String errorMessage;
+      int errorCode = 0;
+      scanned = wifi_manager::scan_networks(networks, errorMessage, errorCode);
+    }
+
+    bool reconnecting = command["reconnect"].as<bool>() && wifi_manager::connect_saved_credentials();
+
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = "stack_stress";
+    obj["ranOn"] = pcTaskGetName(nullptr);
+    obj["scanned"] = scanned;
+    obj["reconnecting"] = reconnecting;
+    task_monitor::append_report_json(obj);
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  static_assert(sizeof(R"({"status":"error","action":"bench","message":"BLE connection lost during bench",})") - 1 +
+                        hid_bench::kMaxResultJsonBytes <
+                    INPUT_BUFFER_LIMIT,
+                "the worst-case bench reply no longer fits one transport message");
+
+  void handleSystemBench(JsonVariantConst command)
+  {
+    if (!Keyboard.isConnected())
+    {
+      sendStatusError("BLE connection not established");
+      return;
+    }
+
+    hid_bench::Result result;
+    if (!hid_bench::run(hid_bench::parse_config(command), result))
+    {
+      sendStatusError("BLE connection not established");
+      return;
+    }
+
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = result.aborted ? "error" : "ok";
+    obj["action"] = "bench";
+    if (result.aborted)
+    {
+      obj["message"] = "BLE connection lost during bench";
+    }
+    hid_bench::append_result_json(result, obj);
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  void handleSystemParseBench(JsonVariantConst command)
+  {
+    hid_bench::ParseBenchHooks hooks;
+    hooks.process_command = [](const char *payload)
+    { processCommand(String(payload)); };
+    hooks.begin_isolation = beginHidIsolation;
+    hooks.end_isolation = endHidIsolation;
+
+    uint32_t iterations = command["iterations"] | hid_bench::kDefaultParseIterations;
+    hid_bench::ParseResult result;
+    if (!hid_bench::run_parse_bench(hooks, iterations, result))
+    {
+      sendStatusError("Parse bench unavailable");
+      return;
+    }
+
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = "parse_bench";
+    hid_bench::append_parse_result_json(result, obj);
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  constexpr uint32_t TRACE_CHUNK_WAIT_MS = 500;
+
+  void handleSystemTrace(JsonVariantConst command)
+  {
+    // Base64 chunks keep the binary dump inside the line-oriented JSON protocol; decode with
+    // tools/trace_to_chrome.py. 192 input bytes encode to 256 characters per line.
+    struct ChunkWriter
+    {
+      uint8_t buffer[192];
+      size_t used;
+      uint32_t chunks;
+      // Cleared once the queue stops draining, so a dump with no reader does not wait per chunk.
+      bool paced;
+
+      void flush()
+      {
+        if (used == 0)
+        {
+          return;
+        }
+        paced = paced && waitForEventQueueSpace(TRACE_CHUNK_WAIT_MS);
+        String payload = F("{\"event\":\"trace\",\"seq\":");
+        payload += chunks;
+        payload += F(",\"data\":\"");
+        payload += base64::encode(buffer, used);
+        payload += F("\"}");
+        dispatchTransportJson(payload);
+        ++chunks;
+        used = 0;
+      }
+    };
+
+    ChunkWriter writer = {};
+    writer.paced = true;
+    size_t bytes = trace::write_dump(
+        [](void *context, const uint8_t *data, size_t length)
+        {
+          ChunkWriter &chunkWriter = *static_cast<ChunkWriter *>(context);
+          while (length > 0)
+          {
+            size_t take = sizeof(chunkWriter.buffer) - chunkWriter.used;
+            if (take > length)
+            {
+              take = length;
+            }
+            memcpy(chunkWriter.buffer + chunkWriter.used, data, take);
+            chunkWriter.used += take;
+            data += take;
+            length -= take;
+            if (chunkWriter.used == sizeof(chunkWriter.buffer))
+            {
+              chunkWriter.flush();
+            }
+          }
+          return true;
+        },
+        &writer);
+    writer.flush();
+
+    if (command["clear"].as<bool>())
+    {
+      trace::clear();
+    }
+
+    if (writer.paced)
+    {
+      waitForEventQueueSpace(TRACE_CHUNK_WAIT_MS);
+    }
+    String payload = F("{\"status\":\"ok\",\"action\":\"trace\",\"bytes\":");
+    payload += static_cast<uint32_t>(bytes);
+    payload += F(",\"chunks\":");
+    payload += writer.chunks;
+    payload += F("}");
+    dispatchTransportJson(payload);
+  }
+
+  static_assert(sizeof(R"({"status":"ok","action":"stack_report",})") - 1 + task_monitor::kMaxReportJsonBytes <
+                    INPUT_BUFFER_LIMIT,
+                "a stack_report reply with kMaxTasks tasks no longer fits one transport message");
+
+  void handleSystemStackReport(JsonVariantConst command)
+  {
+    (void)command;
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = "stack_report";
+    task_monitor::append_report_json(obj);
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  void handleSystemEcho(JsonVariantConst command)
+  {
+    // Round trip through the transport and the parser with no HID work: what is left is
+    // link and firmware overhead, reported against the active network profile.
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = "echo";
+    obj["profile"] = http_server::network_profile_to_string(activeNetworkProfile.load());
+    if (!command["data"].isNull())
+    {
+      obj["data"] = command["data"];
+    }
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  void handleSystemWebsocket(JsonVariantConst command)
+  {
+    (void)command;
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = "websocket";
+    http_server::append_websocket_stats_json(obj);
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  void handleSystemMemory(JsonVariantConst command)
+  {
+    (void)command;
+    JsonDocument response;
+    JsonObject obj = response.to<JsonObject>();
+    obj["status"] = "ok";
+    obj["action"] = "memory";
+    JsonObject budget = obj["static"].to<JsonObject>();
+    for (size_t idx = 0; idx < memory_budget::kEntryCount; ++idx)
+    {
+      budget[memory_budget::kTable[idx].subsystem] = static_cast<uint32_t>(memory_budget::kTable[idx].bytes);
+    }
+    obj["staticTotal"] = static_cast<uint32_t>(memory_budget::total_bytes());
+    obj["staticLimit"] = static_cast<uint32_t>(memory_budget::kStaticRamLimit);
+    obj["freeHeap"] = ESP.getFreeHeap();
+    obj["minFreeHeap"] = ESP.getMinFreeHeap();
+    obj["largestFreeBlock"] = ESP.getMaxAllocHeap();
+    String payload;
+    serializeJson(response, payload);
+    dispatchTransportJson(payload);
+  }
+
+  using command_dispatch::Command;
+
+  struct CommandBinding
+  {
+    Command command;
+    void (*handler)(JsonVariantConst command);
+  };
+
+  // One handler per command_dispatch::Command, in its order; kRoutes maps the action names.
+  constexpr CommandBinding COMMAND_HANDLERS[] = {
+      {Command::KeyboardWrite, handleKeyboardWrite},
+      {Command::KeyboardPrintln, handleKeyboardPrintln},
+      {Command::KeyboardReleaseAll, handleKeyboardReleaseAll},
+      {Command::KeyboardPress, handleKeyboardPress},
+      {Command::KeyboardRelease, handleKeyboardRelease},
+      {Command::KeyboardTap, handleKeyboardTap},
+      {Command::MouseMove, handleMouseMove},
+      {Command::MouseReleaseAll, handleMouseReleaseAll},
+      {Command::MouseClick, handleMouseClick},
+      {Command::MousePress, handleMousePress},
+      {Command::MouseRelease, handleMouseRelease},
+      {Command::ConsumerSend, handleConsumer},
+      {Command::GamepadStats, handleGamepadStats},
+      {Command::GamepadConfig, handleGamepadConfig},
+      {Command::GamepadState, handleGamepadState},
+      {Command::GamepadPress, handleGamepadPress},
+      {Command::GamepadRelease, handleGamepadRelease},
+      {Command::GamepadAxis, handleGamepadAxis},
+      {Command::GamepadHat, handleGamepadHat},
+      {Command::GamepadReset, handleGamepadReset},
+      {Command::SystemBench, handleSystemBench},
+      {Command::SystemParseBench, handleSystemParseBench},
+      {Command::SystemTrace, handleSystemTrace},
+      {Command::SystemStackReport, handleSystemStackReport},
+      {Command::SystemStackStress, runStackStress},
+      {Command::SystemEcho, handleSystemEcho},
+      {Command::SystemWebsocket, handleSystemWebsocket},
+      {Command::SystemMemory, handleSystemMemory}};
+
+  constexpr bool handlersInOrderFrom(size_t index)
+  {
+    return index >= command_dispatch::kCommandCount ||
+           (static_cast<size_t>(COMMAND_HANDLERS[index].command) == index && handlersInOrderFrom(index + 1));
+  }
+
+  static_assert(sizeof(COMMAND_HANDLERS) / sizeof(COMMAND_HANDLERS[0]) == command_dispatch::kCommandCount,
+                "COMMAND_HANDLERS needs one entry per command_dispatch::Command");
+  static_assert(handlersInOrderFrom(0), "COMMAND_HANDLERS must follow command_dispatch::Command order");
+
   void processCommand(const String &payload)
   {
     if (payload.length() == 0)
@@ -1463,14 +2589,18 @@ namespace
       return;
     }
 
+    trace::record(trace::EventType::ParseStart, 0, payload.length());
+
     if (payload.length() > JSON_DOC_CAPACITY)
     {
+      trace::record(trace::EventType::ParseEnd, 1);
       sendStatusError("JSON payload too large");
       return;
     }
 
     JsonDocument doc;
     DeserializationError error = deserializeJson(doc, payload);
+    trace::record(trace::EventType::ParseEnd, error ? 1 : 0);
     if (error)
     {
       String message = F("JSON parse error: ");
@@ -1491,24 +2621,83 @@ namespace
       return;
     }
 
-    if (strcasecmp(device, "keyboard") == 0)
+    const command_dispatch::DeviceName *target = command_dispatch::find_device(device);
+    if (!target)
     {
-      handleKeyboard(doc.as<JsonVariantConst>());
+      String message = F("Unknown device type: ");
+      message += device;
+      sendStatusError(message.c_str());
+      trace::record(trace::EventType::CommandEnd, static_cast<uint16_t>(command_dispatch::Device::Unknown));
+      return;
     }
-    else if (strcasecmp(device, "mouse") == 0)
+
+    const char *action = doc["action"] | target->default_action;
+    Command command = command_dispatch::find_command(*target, action);
+    if (command == Command::None)
     {
-      handleMouse(doc.as<JsonVariantConst>());
+      String message = F("Unknown ");
+      message += target->name;
+      message += F(" action: ");
+      message += action;
+      sendStatusError(message.c_str());
     }
-    else if (strcasecmp(device, "consumer") == 0 || strcasecmp(device, "media") == 0)
+    else
     {
-      handleConsumer(doc.as<JsonVariantConst>());
+      COMMAND_HANDLERS[static_cast<size_t>(command)].handler(doc.as<JsonVariantConst>());
     }
-    else
+    trace::record(trace::EventType::CommandEnd, static_cast<uint16_t>(target->device));
+  }
+
+  const pointer_protocol::Sink POINTER_SINK = {
+      [](int dx, int dy, int wheel, int pan) { hidOutput()->mouse_move(dx, dy, wheel, pan); },
+      [](uint8_t mask) { hidOutput()->mouse_press(mask); },
+      [](uint8_t mask) { hidOutput()->mouse_release(mask); },
+      [](uint8_t code) { hidOutput()->keyboard_press(code); },
+      [](uint8_t code) { hidOutput()->keyboard_release(code); },
+      []()
+      {
+        hidOutput()->keyboard_release_all();
+        hidOutput()->mouse_release(MOUSE_ALL_BUTTONS);
+      }};
+
+  constexpr uint32_t POINTER_DROP_EVENT_INTERVAL_MS = 1000;
+  uint32_t lastPointerDropEventMs = 0;
+  bool pointerDropEventSent = false;
+
+  // A stream of frames may fail the same way many times a second; report it at most once
+  // per interval.
+  void reportPointerDrop(const char *reason)
+  {
+    uint32_t now = millis();
+    if (pointerDropEventSent && now - lastPointerDropEventMs < POINTER_DROP_EVENT_INTERVAL_MS)
     {
-      String message = F("Unknown device type: ");
-      message += device;
-      sendStatusError(message.c_str());
+      return;
     }
+    pointerDropEventSent = true;
+    lastPointerDropEventMs = now;
+    sendEvent("pointer_frame_dropped", reason);
+  }
+
+  // Binary frames get no status reply: they are sent every animation frame and a reply
+  // would cost as much as the frame saves. Failures are reported as events instead, which
+  // keeps replies to JSON commands in order for hosts that match them first in, first out.
+  void processPointerFrame(const uint8_t *frame, size_t length)
+  {
+    trace::record(trace::EventType::ParseStart, 0, length);
+    pointer_protocol::Status status = pointer_protocol::validate(frame, length);
+    trace::record(trace::EventType::ParseEnd, status == pointer_protocol::Status::Ok ? 0 : 1);
+    if (status != pointer_protocol::Status::Ok)
+    {
+      reportPointerDrop(pointer_protocol::status_to_string(status));
+      return;
+    }
+    if (!hidOutput()->is_connected())
+    {
+      reportPointerDrop("BLE connection not established");
+      return;
+    }
+    pointer_protocol::decode(frame, length, POINTER_SINK);
+    trace::record(trace::EventType::CommandEnd, static_cast<uint16_t>(command_dispatch::Device::Pointer));
   }
 
   void flushInputBuffer()
@@ -1523,7 +2712,19 @@ namespace
 
 void setup()
 {
+  crash_snapshot::begin();
+  arduinoLoopTaskHandle = xTaskGetCurrentTaskHandle();
+  crash_snapshot::watch_task(&arduinoLoopTaskHandle);
+  crash_snapshot::watch_task(&transportPumpTaskHandle);
+  crash_snapshot::watch_queue("command", &transportCommandQueue, TRANSPORT_COMMAND_QUEUE_LENGTH);
+  crash_snapshot::watch_queue("event", &transportEventQueue, TRANSPORT_EVENT_QUEUE_LENGTH);
+  task_monitor::watch("loopTask", &arduinoLoopTaskHandle, ARDUINO_LOOP_STACK_BYTES);
+  task_monitor::watch("transport_pump", &transportPumpTaskHandle, sizeof(transportPumpStack));
+
   inputBuffer.reserve(INPUT_BUFFER_LIMIT);
+  // The report map is fixed once the combo device starts. A failure is reported once the
+  // transport is up; nothing sent before that reaches a host.
+  const bool hidCollectionsRegistered = hid_collections::begin();
   Keyboard.begin();
   Mouse.begin();
 
@@ -1533,13 +2734,23 @@ void setup()
   }
 
   uint32_t storedBaud = DEFAULT_UART_BAUD;
-  TransportMode storedMode = loadTransportModeFromStorage(storedBaud);
+  NetworkProfile storedProfile = NetworkProfile::PowerSave;
+  TransportMode storedMode = loadTransportModeFromStorage(storedBaud, storedProfile);
   applyUartBaudRate(storedBaud);
+  const bool networkProfileApplied = applyNetworkProfile(storedProfile);
   if (!applyTransportMode(storedMode))
   {
     applyTransportMode(TransportMode::Uart);
     sendStatusError("Falling back to UART transport");
   }
+  if (!networkProfileApplied)
+  {
+    sendStatusError("Failed to apply network profile");
+  }
+  if (!hidCollectionsRegistered)
+  {
+    sendStatusError("HID report map full; extra collections disabled");
+  }
 
   wifi_manager::Callbacks callbacks;
   callbacks.dispatch_transport_json = dispatchTransportJson;
@@ -1572,14 +2783,38 @@ void setup()
   httpDependencies.get_uart_baud_rate = getCurrentUartBaudRate;
   httpDependencies.apply_transport_mode = applyTransportMode;
   httpDependencies.save_transport_config = saveTransportConfig;
+  httpDependencies.get_network_profile = getNetworkProfile;
+  httpDependencies.apply_network_profile = applyNetworkProfile;
   httpDependencies.send_status_error = sendStatusError;
   httpDependencies.send_event = sendEvent;
+  httpDependencies.execute_command = executeHttpCommand;
+  httpDependencies.is_ble_connected = []() { return Keyboard.isConnected(); };
   httpDependencies.input_buffer_limit = INPUT_BUFFER_LIMIT;
   http_server::init(httpDependencies);
+
+  task_monitor::Callbacks monitorCallbacks;
+  monitorCallbacks.send_event = sendEvent;
+  task_monitor::init(monitorCallbacks);
+
+  gamepad::Callbacks gamepadCallbacks;
+  gamepadCallbacks.is_connected = []() { return hidOutput()->is_connected(); };
+  gamepadCallbacks.send_report = [](const uint8_t *report, size_t length)
+  { return hidOutput()->gamepad_report(report, length); };
+  if (!gamepad::begin(gamepadCallbacks))
+  {
+    sendStatusError("Failed to start gamepad task");
+  }
+  text_stream::begin();
+  httpCommandDone = xSemaphoreCreateBinaryStatic(&httpCommandDoneBuffer);
+
   http_server::start();
   startTransportPumpTask();
 
   sendEvent("ready");
+  if (crash_snapshot::has_snapshot() || crash_snapshot::has_coredump())
+  {
+    sendEvent("coredump_available", "/api/coredump");
+  }
 }
 
 void loop()
@@ -1593,6 +2828,7 @@ void loop()
 
   wifi_manager::process_dns();
   wifi_manager::process();
+  task_monitor::poll();
   delay(2);
 }
 
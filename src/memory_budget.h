@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/stream_buffer.h>
+#include <freertos/task.h>
+
+#include "http_server.h"
+
+// Statically allocated RAM for every FreeRTOS object the firmware owns. Task stacks, queue
+// storage and control blocks are sized here and reserved in .bss by the owning module, so
+// nothing is created from the heap at runtime and creation cannot fail under
+// fragmentation. Each module static_asserts its storage against its entry below.
+namespace memory_budget
+{
+  // ESP-IDF counts stack depth in bytes (StackType_t is uint8_t).
+  constexpr uint32_t kTransportPumpStackBytes = 4096;
+  constexpr uint32_t kHttpWsTaskStackBytes = 8192;
+  constexpr uint32_t kWifiConnectStackBytes = 4096;
+  // Encodes and notifies gamepad reports; no JSON on this task.
+  constexpr uint32_t kGamepadStackBytes = 3072;
+  // Allocated from the heap by esp_http_server itself, so it is not part of kTable.
+  constexpr uint32_t kHttpdStackBytes = 8192;
+
+  constexpr UBaseType_t kTransportCommandQueueLength = 8;
+  constexpr UBaseType_t kTransportEventQueueLength = 8;
+  constexpr UBaseType_t kWifiConnectQueueLength = 1;
+  // Upper bound for wifi_manager's WifiConnectRequest (flag + SSID + password).
+  constexpr size_t kWifiConnectRequestBytes = 1 + (32 + 1) + (64 + 1);
+  // One-slot mailbox holding the newest gamepad::State.
+  constexpr UBaseType_t kGamepadQueueLength = 1;
+  constexpr size_t kGamepadStateBytes = 16;
+  // Text uploaded through POST /api/text waiting to be typed; the upload blocks while it
+  // is full, so this bounds memory, not the size of an upload.
+  constexpr size_t kTextStreamBytes = 2048;
+  // Events waiting for GET /api/events observers, each with a 2-byte length; longer events
+  // are not streamed. http_ws_task drains the queue within 20 ms, so three slots absorb the
+  // bursts Wi-Fi reconnects produce.
+  constexpr UBaseType_t kEventStreamQueueLength = 3;
+  constexpr size_t kEventStreamLineBytes = 200;
+
+  constexpr size_t task_bytes(uint32_t stack_bytes)
+  {
+    return stack_bytes + sizeof(StaticTask_t);
+  }
+
+  constexpr size_t queue_bytes(UBaseType_t length, size_t item_size)
+  {
+    return length * item_size + sizeof(StaticQueue_t);
+  }
+
+  struct Entry
+  {
+    const char *subsystem;
+    size_t bytes;
+  };
+
+  // FreeRTOS stream buffers need one byte more than their capacity.
+  constexpr size_t stream_buffer_bytes(size_t capacity)
+  {
+    return capacity + 1 + sizeof(StaticStreamBuffer_t);
+  }
+
+  constexpr Entry kTable[] = {
+      {"transport_pump task", task_bytes(kTransportPumpStackBytes)},
+      {"http_ws_task task", task_bytes(kHttpWsTaskStackBytes)},
+      {"wifi_connect task", task_bytes(kWifiConnectStackBytes)},
+      {"gamepad task", task_bytes(kGamepadStackBytes)},
+      {"transport command queue",
+       queue_bytes(kTransportCommandQueueLength, sizeof(http_server::TransportMessage))},
+      {"transport event queue", queue_bytes(kTransportEventQueueLength, sizeof(http_server::TransportMessage))},
+      {"wifi_connect queue", queue_bytes(kWifiConnectQueueLength, kWifiConnectRequestBytes)},
+      {"gamepad mailbox", queue_bytes(kGamepadQueueLength, kGamepadStateBytes)},
+      {"text stream buffer", stream_buffer_bytes(kTextStreamBytes)},
+      {"event stream queue", queue_bytes(kEventStreamQueueLength, kEventStreamLineBytes)},
+      {"wifi state mutex", sizeof(StaticSemaphore_t)},
+      {"http command semaphore", sizeof(StaticSemaphore_t)},
+  };
+  constexpr size_t kEntryCount = sizeof(kTable) / sizeof(kTable[0]);
+
+  constexpr size_t total_bytes(size_t index = 0)
+  {
+    return index >= kEntryCount ? 0 : kTable[index].bytes + total_bytes(index + 1);
+  }
+
+  // Ceiling for the table as a whole; raising a stack or queue past it is a deliberate
+  // decision, not an accident.
+  constexpr size_t kStaticRamLimit = 32 * 1024;
+  static_assert(total_bytes() <= kStaticRamLimit, "static FreeRTOS objects exceed the RAM budget");
+  static_assert(kTransportPumpStackBytes >= 3072, "transport_pump runs ArduinoJson parsing and needs >= 3 KB");
+  static_assert(kHttpWsTaskStackBytes >= 4096, "http_ws_task needs >= 4 KB for WebSocket sends");
+} // namespace memory_budget
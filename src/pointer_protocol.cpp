@@ -0,0 +1,240 @@
+#include "pointer_protocol.h"
+
+namespace pointer_protocol
+{
+  namespace
+  {
+    // Payload bytes following the record type, or -1 for an unknown type.
+    int record_arguments(uint8_t type)
+    {
+      switch (static_cast<RecordType>(type))
+      {
+      case RecordType::Move:
+      case RecordType::Scroll:
+        return 2;
+      case RecordType::ButtonsPress:
+      case RecordType::ButtonsRelease:
+      case RecordType::KeyPress:
+      case RecordType::KeyRelease:
+        return 1;
+      case RecordType::ReleaseAll:
+        return 0;
+      }
+      return -1;
+    }
+
+    Status check_records(const uint8_t *records, size_t length)
+    {
+      size_t offset = 0;
+      while (offset < length)
+      {
+        int arguments = record_arguments(records[offset]);
+        if (arguments < 0)
+        {
+          return Status::UnknownRecord;
+        }
+        offset += 1 + static_cast<size_t>(arguments);
+        if (offset > length)
+        {
+          return Status::TruncatedRecord;
+        }
+      }
+      return Status::Ok;
+    }
+  } // namespace
+
+  const char *status_to_string(Status status)
+  {
+    switch (status)
+    {
+    case Status::Ok:
+      return "ok";
+    case Status::BadStart:
+      return "bad start byte";
+    case Status::BadLength:
+      return "bad length";
+    case Status::BadChecksum:
+      return "bad checksum";
+    case Status::UnknownRecord:
+      return "unknown record";
+    case Status::TruncatedRecord:
+      return "truncated record";
+    }
+    return "unknown";
+  }
+
+  size_t frame_size(const uint8_t *data, size_t available)
+  {
+    if (available < 2)
+    {
+      return 0;
+    }
+    return static_cast<size_t>(data[1]) + kFrameOverhead;
+  }
+
+  uint8_t checksum(const uint8_t *records, size_t length)
+  {
+    uint32_t sum = static_cast<uint32_t>(length);
+    for (size_t index = 0; index < length; ++index)
+    {
+      sum += records[index];
+    }
+    return static_cast<uint8_t>(sum & 0xFF);
+  }
+
+  Status validate(const uint8_t *frame, size_t length)
+  {
+    if (length == 0 || frame[0] != kFrameStart)
+    {
+      return Status::BadStart;
+    }
+    size_t records = length > 1 ? frame[1] : 0;
+    if (length < kFrameOverhead || length != records + kFrameOverhead)
+    {
+      return Status::BadLength;
+    }
+    if (checksum(frame + 2, records) != frame[length - 1])
+    {
+      return Status::BadChecksum;
+    }
+    return check_records(frame + 2, records);
+  }
+
+  Status decode(const uint8_t *frame, size_t length, const Sink &sink, size_t *records_out)
+  {
+    if (records_out)
+    {
+      *records_out = 0;
+    }
+    Status status = validate(frame, length);
+    if (status != Status::Ok)
+    {
+      return status;
+    }
+
+    const uint8_t *record = frame + 2;
+    const uint8_t *end = frame + length - 1;
+    size_t applied = 0;
+    while (record < end)
+    {
+      RecordType type = static_cast<RecordType>(record[0]);
+      switch (type)
+      {
+      case RecordType::Move:
+        if (sink.move)
+          sink.move(static_cast<int8_t>(record[1]), static_cast<int8_t>(record[2]), 0, 0);
+        break;
+      case RecordType::Scroll:
+        if (sink.move)
+          sink.move(0, 0, static_cast<int8_t>(record[1]), static_cast<int8_t>(record[2]));
+        break;
+      case RecordType::ButtonsPress:
+        if (sink.buttons_press)
+          sink.buttons_press(record[1]);
+        break;
+      case RecordType::ButtonsRelease:
+        if (sink.buttons_release)
+          sink.buttons_release(record[1]);
+        break;
+      case RecordType::KeyPress:
+        if (sink.key_press)
+          sink.key_press(record[1]);
+        break;
+      case RecordType::KeyRelease:
+        if (sink.key_release)
+          sink.key_release(record[1]);
+        break;
+      case RecordType::ReleaseAll:
+        if (sink.release_all)
+          sink.release_all();
+        break;
+      }
+      record += 1 + record_arguments(static_cast<uint8_t>(type));
+      ++applied;
+    }
+    if (records_out)
+    {
+      *records_out = applied;
+    }
+    return Status::Ok;
+  }
+
+  void FrameReader::begin()
+  {
+    buffer_[0] = kFrameStart;
+    size_ = 1;
+    active_ = true;
+  }
+
+  bool FrameReader::push(uint8_t byte)
+  {
+    if (!active_)
+    {
+      return false;
+    }
+    buffer_[size_++] = byte;
+    size_t expected = frame_size(buffer_, size_);
+    if (expected == 0 || size_ < expected)
+    {
+      return false;
+    }
+    active_ = false;
+    return true;
+  }
+
+  FrameWriter::FrameWriter(uint8_t *buffer, size_t capacity) : buffer_(buffer), capacity_(capacity)
+  {
+  }
+
+  bool FrameWriter::put(const uint8_t *bytes, size_t count)
+  {
+    if (length_ + count > kMaxRecordBytes || 2 + length_ + count + 1 > capacity_)
+    {
+      return false;
+    }
+    for (size_t index = 0; index < count; ++index)
+    {
+      buffer_[2 + length_ + index] = bytes[index];
+    }
+    length_ += count;
+    return true;
+  }
+
+  bool FrameWriter::move(int8_t dx, int8_t dy)
+  {
+    const uint8_t bytes[] = {static_cast<uint8_t>(RecordType::Move), static_cast<uint8_t>(dx),
+                             static_cast<uint8_t>(dy)};
+    return put(bytes, sizeof(bytes));
+  }
+
+  bool FrameWriter::scroll(int8_t wheel, int8_t pan)
+  {
+    const uint8_t bytes[] = {static_cast<uint8_t>(RecordType::Scroll), static_cast<uint8_t>(wheel),
+                             static_cast<uint8_t>(pan)};
+    return put(bytes, sizeof(bytes));
+  }
+
+  bool FrameWriter::record(RecordType type, uint8_t value)
+  {
+    const uint8_t bytes[] = {static_cast<uint8_t>(type), value};
+    return put(bytes, sizeof(bytes));
+  }
+
+  bool FrameWriter::release_all()
+  {
+    const uint8_t type = static_cast<uint8_t>(RecordType::ReleaseAll);
+    return put(&type, 1);
+  }
+
+  size_t FrameWriter::finish()
+  {
+    if (capacity_ < kFrameOverhead)
+    {
+      return 0;
+    }
+    buffer_[0] = kFrameStart;
+    buffer_[1] = static_cast<uint8_t>(length_);
+    buffer_[2 + length_] = checksum(buffer_ + 2, length_);
+    return length_ + kFrameOverhead;
+  }
+} // namespace pointer_protocol
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Compact binary alternative to the JSON mouse and keyboard commands, used by the browser
+// overlay to send one frame per animation frame instead of one JSON message per event.
+// Kept free of Arduino and ESP-IDF so the host tools can share it.
+//
+//   0xA5 | length | records (length bytes) | checksum
+//
+// The checksum is the low byte of the sum of the length byte and every record byte. A JSON
+// line never starts with 0xA5 (it is a UTF-8 continuation byte), so the UART can carry both
+// formats: a frame may only begin where a line would. Records:
+//
+//   0x01 dx dy          relative move, signed bytes
+//   0x02 wheel pan      scroll, signed bytes
+//   0x03 mask           press mouse buttons (MOUSE_LEFT, MOUSE_RIGHT, ... bits)
+//   0x04 mask           release mouse buttons
+//   0x05 code           press a key (the firmware's key code: ASCII or KEY_* value)
+//   0x06 code           release a key
+//   0x07                release every key and button
+namespace pointer_protocol
+{
+  constexpr uint8_t kFrameStart = 0xA5;
+  constexpr size_t kMaxRecordBytes = 255;
+  // Start byte, length byte and checksum.
+  constexpr size_t kFrameOverhead = 3;
+  constexpr size_t kMaxFrameBytes = kMaxRecordBytes + kFrameOverhead;
+
+  enum class RecordType : uint8_t
+  {
+    Move = 0x01,
+    Scroll = 0x02,
+    ButtonsPress = 0x03,
+    ButtonsRelease = 0x04,
+    KeyPress = 0x05,
+    KeyRelease = 0x06,
+    ReleaseAll = 0x07
+  };
+
+  enum class Status : uint8_t
+  {
+    Ok = 0,
+    BadStart,
+    BadLength,
+    BadChecksum,
+    UnknownRecord,
+    TruncatedRecord
+  };
+
+  const char *status_to_string(Status status);
+
+  // Size of the whole frame starting at data[0], or 0 while fewer than two bytes are
+  // available. Only meaningful when data[0] is kFrameStart.
+  size_t frame_size(const uint8_t *data, size_t available);
+
+  uint8_t checksum(const uint8_t *records, size_t length);
+
+  // Checks framing, checksum and every record without applying anything.
+  Status validate(const uint8_t *frame, size_t length);
+
+  struct Sink
+  {
+    void (*move)(int dx, int dy, int wheel, int pan) = nullptr;
+    void (*buttons_press)(uint8_t mask) = nullptr;
+    void (*buttons_release)(uint8_t mask) = nullptr;
+    void (*key_press)(uint8_t code) = nullptr;
+    void (*key_release)(uint8_t code) = nullptr;
+    void (*release_all)() = nullptr;
+  };
+
+  // Validates the frame, then applies its records in order. A frame that fails validation
+  // applies nothing. `records_out`, when given, receives the number of records applied.
+  Status decode(const uint8_t *frame, size_t length, const Sink &sink, size_t *records_out = nullptr);
+
+  // Collects one frame from a byte stream, starting with the byte after kFrameStart.
+  class FrameReader
+  {
+  public:
+    // Starts a frame; the start byte has already been consumed by the caller.
+    void begin();
+    bool active() const
+    {
+      return active_;
+    }
+    // Adds the next byte; true once the frame is complete, after which frame() and size()
+    // describe it and the reader is inactive again.
+    bool push(uint8_t byte);
+    const uint8_t *frame() const
+    {
+      return buffer_;
+    }
+    size_t size() const
+    {
+      return size_;
+    }
+
+  private:
+    uint8_t buffer_[kMaxFrameBytes] = {};
+    size_t size_ = 0;
+    bool active_ = false;
+  };
+
+  // Appends records to a caller-owned buffer and closes the frame; used by host tools and
+  // checks. Returns false when a record does not fit.
+  class FrameWriter
+  {
+  public:
+    FrameWriter(uint8_t *buffer, size_t capacity);
+    bool move(int8_t dx, int8_t dy);
+    bool scroll(int8_t wheel, int8_t pan);
+    bool record(RecordType type, uint8_t value);
+    bool release_all();
+    // Writes the header and checksum; returns the frame size.
+    size_t finish();
+
+  private:
+    bool put(const uint8_t *bytes, size_t count);
+
+    uint8_t *buffer_;
+    size_t capacity_;
+    size_t length_ = 0;
+  };
+} // namespace pointer_protocol
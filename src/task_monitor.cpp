@@ -0,0 +1,161 @@
+#include "task_monitor.h"
+
+#include <Arduino.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace task_monitor
+{
+  namespace
+  {
+    struct WatchedTask
+    {
+      const char *name;
+      const TaskHandle_t *handle;
+      TaskHandle_t resolved;
+      uint32_t stack_bytes;
+      bool warned;
+    };
+
+    Callbacks callbacks_;
+    WatchedTask tasks_[kMaxTasks] = {};
+    size_t task_count_ = 0;
+    unsigned long last_poll_ms_ = 0;
+
+    TaskHandle_t resolve(WatchedTask &task)
+    {
+      if (task.handle)
+      {
+        return *task.handle;
+      }
+      if (!task.resolved)
+      {
+        task.resolved = xTaskGetHandle(task.name);
+      }
+      return task.resolved;
+    }
+
+    uint32_t guard_bytes(uint32_t stack_bytes)
+    {
+      uint32_t eighth = stack_bytes / 8;
+      return eighth > kMinGuardBytes ? eighth : kMinGuardBytes;
+    }
+
+    bool sample(WatchedTask &task, TaskReport &report)
+    {
+      report = TaskReport();
+      report.name = task.name;
+      report.stack_bytes = task.stack_bytes;
+      TaskHandle_t handle = resolve(task);
+      if (!handle)
+      {
+        return false;
+      }
+      report.found = true;
+      // ESP-IDF reports the high-water mark in bytes.
+      report.free_bytes = uxTaskGetStackHighWaterMark(handle);
+      report.peak_used_bytes = task.stack_bytes > report.free_bytes ? task.stack_bytes - report.free_bytes : 0;
+      report.recommended_bytes = recommended_stack(report.peak_used_bytes);
+      return true;
+    }
+  } // namespace
+
+  void init(const Callbacks &callbacks)
+  {
+    callbacks_ = callbacks;
+  }
+
+  void watch(const char *name, const TaskHandle_t *handle, uint32_t stack_bytes)
+  {
+    if (!name || task_count_ >= kMaxTasks || strlen(name) > kMaxTaskNameChars || stack_bytes > kMaxStackBytes)
+    {
+      return;
+    }
+    for (size_t idx = 0; idx < task_count_; ++idx)
+    {
+      if (strcmp(tasks_[idx].name, name) == 0)
+      {
+        return;
+      }
+    }
+    tasks_[task_count_++] = {name, handle, nullptr, stack_bytes, false};
+  }
+
+  uint32_t recommended_stack(uint32_t peak_used_bytes)
+  {
+    uint32_t margin = peak_used_bytes / 4;
+    if (margin < 1024)
+    {
+      margin = 1024;
+    }
+    uint32_t size = peak_used_bytes + margin;
+    return (size + 511) & ~static_cast<uint32_t>(511);
+  }
+
+  size_t collect(TaskReport *out, size_t capacity)
+  {
+    size_t count = 0;
+    for (size_t idx = 0; idx < task_count_ && count < capacity; ++idx)
+    {
+      sample(tasks_[idx], out[count]);
+      ++count;
+    }
+    return count;
+  }
+
+  void append_report_json(JsonVariant doc)
+  {
+    TaskReport reports[kMaxTasks];
+    size_t count = collect(reports, kMaxTasks);
+    JsonObject tasks = doc["tasks"].to<JsonObject>();
+    int32_t reclaimable = 0;
+    for (size_t idx = 0; idx < count; ++idx)
+    {
+      const TaskReport &report = reports[idx];
+      JsonArray entry = tasks[report.name].to<JsonArray>();
+      entry.add(report.stack_bytes);
+      if (!report.found)
+      {
+        continue;
+      }
+      entry.add(report.free_bytes);
+      entry.add(report.recommended_bytes);
+      reclaimable += static_cast<int32_t>(report.stack_bytes) - static_cast<int32_t>(report.recommended_bytes);
+    }
+    // Negative when at least one task is already running short.
+    doc["reclaimableBytes"] = reclaimable;
+  }
+
+  void poll()
+  {
+    unsigned long now = millis();
+    if (now - last_poll_ms_ < kPollIntervalMs)
+    {
+      return;
+    }
+    last_poll_ms_ = now;
+
+    for (size_t idx = 0; idx < task_count_; ++idx)
+    {
+      WatchedTask &task = tasks_[idx];
+      TaskReport report;
+      if (task.warned || !sample(task, report))
+      {
+        continue;
+      }
+      if (report.free_bytes >= guard_bytes(task.stack_bytes))
+      {
+        continue;
+      }
+      // The high-water mark never recovers, so one event per task per boot is enough.
+      task.warned = true;
+      if (callbacks_.send_event)
+      {
+        char detail[48];
+        snprintf(detail, sizeof(detail), "%s:%u", task.name, static_cast<unsigned>(report.free_bytes));
+        callbacks_.send_event("stack_low", detail);
+      }
+    }
+  }
+} // namespace task_monitor
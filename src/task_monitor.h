@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Stack high-water tracking for the firmware's tasks. The report turns each task's peak
+// stack use into a recommended size, and poll() raises a "stack_low" event the first time
+// a task's remaining headroom drops below the guard threshold.
+namespace task_monitor
+{
+  constexpr size_t kMaxTasks = 8;
+  constexpr uint32_t kPollIntervalMs = 1000;
+  constexpr uint32_t kMinGuardBytes = 512;
+  // watch() ignores longer names and larger stacks, which keeps every size to six digits.
+  constexpr size_t kMaxTaskNameChars = 15;
+  constexpr uint32_t kMaxStackBytes = 512 * 1024;
+  constexpr size_t kMaxSizeDigits = 6;
+
+  // Upper bound of what append_report_json() adds to a reply: kMaxTasks entries with the
+  // longest name, three sizes each, and a reclaimable total of up to eight characters.
+  constexpr size_t kMaxReportJsonBytes = sizeof(R"("tasks":{},"reclaimableBytes":)") - 1 + 8 +
+                                         kMaxTasks * (sizeof(R"("":[,,],)") - 1 + kMaxTaskNameChars + 3 * kMaxSizeDigits);
+
+  struct Callbacks
+  {
+    void (*send_event)(const char *name, const char *detail) = nullptr;
+  };
+
+  struct TaskReport
+  {
+    const char *name = nullptr;
+    bool found = false;
+    uint32_t stack_bytes = 0;
+    uint32_t free_bytes = 0;
+    uint32_t peak_used_bytes = 0;
+    uint32_t recommended_bytes = 0;
+  };
+
+  void init(const Callbacks &callbacks);
+
+  // Registers a task by the address of its handle, or by FreeRTOS task name when `handle`
+  // is null (for tasks created inside ESP-IDF components, such as "httpd").
+  void watch(const char *name, const TaskHandle_t *handle, uint32_t stack_bytes);
+
+  // Peak use plus 25% (at least 1 KB) of margin, rounded up to 512 bytes.
+  uint32_t recommended_stack(uint32_t peak_used_bytes);
+
+  size_t collect(TaskReport *out, size_t capacity);
+  // "tasks" maps each name to [stackBytes, freeBytes, recommendedBytes], or to [stackBytes]
+  // for a task that is not running; compact so the reply fits one transport message.
+  void append_report_json(JsonVariant doc);
+
+  // Rate-limited to kPollIntervalMs; call from loop().
+  void poll();
+} // namespace task_monitor
@@ -0,0 +1,116 @@
+#include "text_stream.h"
+
+#include <freertos/stream_buffer.h>
+
+#include <atomic>
+
+#include "memory_budget.h"
+
+namespace text_stream
+{
+  namespace
+  {
+    StreamBufferHandle_t stream_ = nullptr;
+    uint8_t stream_storage_[memory_budget::kTextStreamBytes + 1];
+    StaticStreamBuffer_t stream_buffer_;
+
+    std::atomic<bool> uploading_{false};
+    std::atomic<uint16_t> char_delay_ms_{kDefaultCharDelayMs};
+    std::atomic<uint32_t> uploads_{0};
+    std::atomic<uint32_t> aborted_{0};
+    std::atomic<uint32_t> received_{0};
+    std::atomic<uint32_t> typed_{0};
+    std::atomic<uint32_t> skipped_{0};
+  } // namespace
+
+  bool begin()
+  {
+    if (!stream_)
+    {
+      stream_ = xStreamBufferCreateStatic(memory_budget::kTextStreamBytes, 1, stream_storage_, &stream_buffer_);
+    }
+    return stream_ != nullptr;
+  }
+
+  void begin_upload(uint16_t char_delay_ms)
+  {
+    char_delay_ms_.store(char_delay_ms > kMaxCharDelayMs ? kMaxCharDelayMs : char_delay_ms,
+                         std::memory_order_relaxed);
+    uploads_.fetch_add(1, std::memory_order_relaxed);
+    uploading_.store(true, std::memory_order_release);
+  }
+
+  size_t write(const char *data, size_t length, TickType_t timeout)
+  {
+    if (!stream_ || length == 0)
+    {
+      return 0;
+    }
+    size_t written = xStreamBufferSend(stream_, data, length, timeout);
+    received_.fetch_add(static_cast<uint32_t>(written), std::memory_order_relaxed);
+    return written;
+  }
+
+  void end_upload()
+  {
+    uploading_.store(false, std::memory_order_release);
+  }
+
+  void abort_upload()
+  {
+    aborted_.fetch_add(1, std::memory_order_relaxed);
+    clear();
+    end_upload();
+  }
+
+  bool upload_active()
+  {
+    return uploading_.load(std::memory_order_acquire);
+  }
+
+  size_t read(char *out, size_t capacity)
+  {
+    if (!stream_)
+    {
+      return 0;
+    }
+    return xStreamBufferReceive(stream_, out, capacity, 0);
+  }
+
+  size_t buffered()
+  {
+    return stream_ ? xStreamBufferBytesAvailable(stream_) : 0;
+  }
+
+  uint16_t char_delay_ms()
+  {
+    return char_delay_ms_.load(std::memory_order_relaxed);
+  }
+
+  void note_typed(size_t count, size_t skipped)
+  {
+    typed_.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+    skipped_.fetch_add(static_cast<uint32_t>(skipped), std::memory_order_relaxed);
+  }
+
+  void clear()
+  {
+    if (stream_)
+    {
+      xStreamBufferReset(stream_);
+    }
+  }
+
+  void append_stats_json(JsonVariant doc)
+  {
+    doc["uploading"] = upload_active();
+    doc["buffered"] = buffered();
+    doc["capacity"] = memory_budget::kTextStreamBytes;
+    doc["charDelayMs"] = char_delay_ms();
+    doc["uploads"] = uploads_.load(std::memory_order_relaxed);
+    doc["aborted"] = aborted_.load(std::memory_order_relaxed);
+    doc["received"] = received_.load(std::memory_order_relaxed);
+    doc["typed"] = typed_.load(std::memory_order_relaxed);
+    doc["skipped"] = skipped_.load(std::memory_order_relaxed);
+  }
+} // namespace text_stream
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+// Bounded FIFO between POST /api/text and the typing loop on the transport pump. The
+// HTTP handler writes the request body into it as it arrives and blocks while it is full,
+// so TCP flow control slows the client to typing speed and an upload of any size needs
+// only kTextStreamBytes of RAM. The pump types a few characters per pass, so commands keep
+// being served while a long text is typed.
+namespace text_stream
+{
+  constexpr uint16_t kDefaultCharDelayMs = 6;
+  constexpr uint16_t kMaxCharDelayMs = 1000;
+
+  // Creates the stream buffer; safe to call more than once.
+  bool begin();
+
+  // Producer side, httpd task only. An upload sets the typing delay for its text.
+  void begin_upload(uint16_t char_delay_ms);
+  // Waits up to `timeout` for room for all of `length`, then takes what fits; returns the
+  // bytes taken.
+  size_t write(const char *data, size_t length, TickType_t timeout);
+  void end_upload();
+  // Ends an upload that failed and drops everything not typed yet.
+  void abort_upload();
+  bool upload_active();
+
+  // Consumer side, transport pump only.
+  size_t read(char *out, size_t capacity);
+  size_t buffered();
+  uint16_t char_delay_ms();
+  void note_typed(size_t count, size_t skipped);
+
+  // Drops text not typed yet (DELETE /api/text).
+  void clear();
+
+  void append_stats_json(JsonVariant doc);
+} // namespace text_stream
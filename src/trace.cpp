@@ -0,0 +1,170 @@
+#include "trace.h"
+
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstring>
+
+namespace trace
+{
+  namespace
+  {
+    constexpr uint32_t kRingMask = kEventsPerCore - 1;
+    constexpr size_t kDumpChunkEvents = 16;
+
+    // seq holds the 1-based write index of the event in the slot, or 0 while the slot is
+    // being written, so readers can discard torn or overwritten entries.
+    struct Slot
+    {
+      std::atomic<uint32_t> seq;
+      Event event;
+    };
+
+    struct CoreRing
+    {
+      std::atomic<uint32_t> head;
+      Slot slots[kEventsPerCore];
+    };
+
+    CoreRing rings_[portNUM_PROCESSORS];
+
+    inline bool IRAM_ATTR read_slot(const CoreRing &ring, uint32_t index, Event &out)
+    {
+      const Slot &slot = ring.slots[index & kRingMask];
+      uint32_t before = slot.seq.load(std::memory_order_acquire);
+      out = slot.event;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint32_t after = slot.seq.load(std::memory_order_relaxed);
+      return before == after && before == index + 1;
+    }
+
+    inline uint32_t IRAM_ATTR first_available(uint32_t head)
+    {
+      return head > kEventsPerCore ? head - kEventsPerCore : 0;
+    }
+  } // namespace
+
+  void IRAM_ATTR record(EventType type, uint16_t arg16, uint32_t arg32)
+  {
+    uint8_t core = static_cast<uint8_t>(xPortGetCoreID());
+    CoreRing &ring = rings_[core];
+    // Only tasks on this core write this ring; fetch_add keeps preempting writers on the
+    // same core from claiming the same slot.
+    uint32_t index = ring.head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = ring.slots[index & kRingMask];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event.timestamp_us = static_cast<uint32_t>(esp_timer_get_time());
+    slot.event.type = static_cast<uint8_t>(type);
+    slot.event.core = core;
+    slot.event.arg16 = arg16;
+    slot.event.arg32 = arg32;
+    slot.seq.store(index + 1, std::memory_order_release);
+  }
+
+  size_t IRAM_ATTR copy_recent(uint8_t core, Event *out, size_t capacity)
+  {
+    if (!out || capacity == 0 || core >= portNUM_PROCESSORS)
+    {
+      return 0;
+    }
+
+    const CoreRing &ring = rings_[core];
+    uint32_t head = ring.head.load(std::memory_order_acquire);
+    uint32_t start = first_available(head);
+    if (head - start > capacity)
+    {
+      start = head - static_cast<uint32_t>(capacity);
+    }
+
+    size_t count = 0;
+    for (uint32_t index = start; index < head; ++index)
+    {
+      if (read_slot(ring, index, out[count]))
+      {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  void clear()
+  {
+    for (size_t core = 0; core < portNUM_PROCESSORS; ++core)
+    {
+      // Back to an empty ring: a dump right after lists only what was recorded since.
+      rings_[core].head.store(0, std::memory_order_relaxed);
+      for (size_t idx = 0; idx < kEventsPerCore; ++idx)
+      {
+        rings_[core].slots[idx].seq.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t write_dump(bool (*write)(void *context, const uint8_t *data, size_t length), void *context)
+  {
+    if (!write)
+    {
+      return 0;
+    }
+
+    DumpHeader header = {};
+    header.magic = kDumpMagic;
+    header.version = kDumpVersion;
+    header.event_size = sizeof(Event);
+    header.core_count = portNUM_PROCESSORS;
+    header.events_per_core = kEventsPerCore;
+    header.now_us = static_cast<uint32_t>(esp_timer_get_time());
+    for (size_t core = 0; core < portNUM_PROCESSORS; ++core)
+    {
+      header.recorded_total += rings_[core].head.load(std::memory_order_relaxed);
+    }
+
+    size_t written = 0;
+    if (!write(context, reinterpret_cast<const uint8_t *>(&header), sizeof(header)))
+    {
+      return 0;
+    }
+    written += sizeof(header);
+
+    Event chunk[kDumpChunkEvents];
+    for (size_t core = 0; core < portNUM_PROCESSORS; ++core)
+    {
+      const CoreRing &ring = rings_[core];
+      uint32_t head = ring.head.load(std::memory_order_acquire);
+      uint32_t start = first_available(head);
+
+      CoreHeader core_header = {};
+      core_header.core = static_cast<uint8_t>(core);
+      core_header.event_count = head - start;
+      if (!write(context, reinterpret_cast<const uint8_t *>(&core_header), sizeof(core_header)))
+      {
+        return 0;
+      }
+      written += sizeof(core_header);
+
+      uint32_t index = start;
+      while (index < head)
+      {
+        size_t batch = 0;
+        for (; batch < kDumpChunkEvents && index < head; ++batch, ++index)
+        {
+          if (!read_slot(ring, index, chunk[batch]))
+          {
+            memset(&chunk[batch], 0, sizeof(Event));
+          }
+        }
+        size_t bytes = batch * sizeof(Event);
+        if (!write(context, reinterpret_cast<const uint8_t *>(chunk), bytes))
+        {
+          return 0;
+        }
+        written += bytes;
+      }
+    }
+    return written;
+  }
+} // namespace trace
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Lightweight binary event trace. Each core owns a fixed ring of compact events that is
+// written without locks, so recording is cheap enough to leave enabled in production.
+// The rings are dumped through /api/trace (raw binary) or the UART "trace" system
+// command (base64 chunks); tools/trace_to_chrome.py converts either form into Chrome
+// about:tracing / Perfetto JSON.
+namespace trace
+{
+  enum class EventType : uint8_t
+  {
+    None = 0,
+    WsFrameReceived = 1, // arg16: frame type, arg32: payload length
+    WsFrameSent = 2,     // arg16: 0 ok / 1 failed, arg32: payload length
+    QueueEnqueue = 3,    // arg16: QueueId, arg32: messages waiting after enqueue
+    QueueDequeue = 4,    // arg16: QueueId, arg32: messages waiting after dequeue
+    QueueDrop = 5,       // arg16: QueueId, arg32: payload length
+    ParseStart = 6,      // arg32: payload length
+    ParseEnd = 7,        // arg16: 0 ok / 1 error
+    CommandEnd = 8,      // arg16: device id
+    HidReport = 9,       // arg16: HidReportKind, arg32: report argument
+    WifiEvent = 10,      // arg16: Arduino WiFi event id, arg32: reason code
+    TaskWake = 11,       // arg16: TaskId
+    TaskIdle = 12,       // arg16: TaskId
+  };
+
+  enum class QueueId : uint16_t
+  {
+    Command = 0,
+    Event = 1,
+  };
+
+  enum class TaskId : uint16_t
+  {
+    TransportPump = 1,
+    HttpWs = 2,
+    WifiConnect = 3,
+    Gamepad = 4,
+  };
+
+  enum class HidReportKind : uint16_t
+  {
+    KeyboardPress = 0,
+    KeyboardRelease = 1,
+    KeyboardWrite = 2,
+    KeyboardReleaseAll = 3,
+    Consumer = 4,
+    MouseMove = 5,
+    MouseButtons = 6,
+    Gamepad = 7,
+    SystemControl = 8,
+  };
+
+  struct Event
+  {
+    uint32_t timestamp_us;
+    uint8_t type;
+    uint8_t core;
+    uint16_t arg16;
+    uint32_t arg32;
+  };
+  static_assert(sizeof(Event) == 12, "trace::Event is part of the dump format");
+
+  constexpr size_t kEventsPerCore = 128;
+  static_assert((kEventsPerCore & (kEventsPerCore - 1)) == 0, "ring size must be a power of two");
+
+  // Dump layout (little endian): DumpHeader, then core_count blocks of CoreHeader followed
+  // by event_count Events in chronological order. Slots overwritten while the dump was in
+  // progress are emitted with type None.
+  constexpr uint32_t kDumpMagic = 0x43525448; // "HTRC"
+  constexpr uint16_t kDumpVersion = 1;
+
+  struct DumpHeader
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t event_size;
+    uint16_t core_count;
+    uint16_t events_per_core;
+    uint32_t recorded_total;
+    uint32_t now_us;
+  };
+  static_assert(sizeof(DumpHeader) == 20, "trace::DumpHeader is part of the dump format");
+
+  struct CoreHeader
+  {
+    uint8_t core;
+    uint8_t reserved[3];
+    uint32_t event_count;
+  };
+  static_assert(sizeof(CoreHeader) == 8, "trace::CoreHeader is part of the dump format");
+
+  void record(EventType type, uint16_t arg16 = 0, uint32_t arg32 = 0);
+
+  inline void record(EventType type, QueueId queue, uint32_t arg32)
+  {
+    record(type, static_cast<uint16_t>(queue), arg32);
+  }
+
+  inline void record(EventType type, TaskId task)
+  {
+    record(type, static_cast<uint16_t>(task), 0);
+  }
+
+  inline void record(EventType type, HidReportKind kind, uint32_t arg32 = 0)
+  {
+    record(type, static_cast<uint16_t>(kind), arg32);
+  }
+
+  // Copies up to `capacity` of the most recent events recorded on `core`, oldest first.
+  // Safe to call from any context, including the panic handler (lives in IRAM).
+  size_t copy_recent(uint8_t core, Event *out, size_t capacity);
+
+  void clear();
+
+  // Streams a dump through `write`, which returns false to abort. Returns the number of
+  // bytes written, or 0 on failure.
+  size_t write_dump(bool (*write)(void *context, const uint8_t *data, size_t length), void *context);
+} // namespace trace
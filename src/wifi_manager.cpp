@@ -11,8 +11,16 @@
 #include <nvs_flash.h>
 
 #include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <memory>
 
+#include "crash_snapshot.h"
+#include "memory_budget.h"
+#include "task_monitor.h"
+#include "trace.h"
+#include "wifi_state_machine.h"
+
 namespace wifi_manager
 {
   namespace
@@ -20,13 +28,15 @@ namespace wifi_manager
     constexpr const char *NVS_NAMESPACE_WIFI = "wifi";
     constexpr const char *NVS_KEY_SSID = "ssid";
     constexpr const char *NVS_KEY_PASS = "password";
-    constexpr unsigned long WIFI_CONNECT_TIMEOUT_MS = 20000;
-    constexpr unsigned long WIFI_RETRY_DELAY_MS = 500;
-    constexpr unsigned long WIFI_AP_SHUTDOWN_DELAY_MS = 3000;
+    constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 20000;
+    constexpr uint32_t WIFI_RETRY_DELAY_MS = 500;
+    constexpr uint32_t WIFI_AP_SHUTDOWN_DELAY_MS = 3000;
     constexpr const char *CONFIG_AP_SSID = "uhid-setup";
     constexpr const char *CONFIG_AP_PASSWORD = "uhid1234";
     constexpr size_t WIFI_MAX_SSID_LENGTH = 32;
     constexpr size_t WIFI_MAX_PASSWORD_LENGTH = 64;
+    constexpr size_t WIFI_STATE_MESSAGE_CAPACITY = 48;
+    constexpr size_t WIFI_STATE_PAYLOAD_CAPACITY = 384;
     constexpr uint16_t DNS_PORT = 53;
 
     #if defined(CONFIG_BT_NIMBLE_PINNED_TO_CORE)
@@ -39,20 +49,22 @@ namespace wifi_manager
     constexpr BaseType_t kWifiTaskCore = 0;
     #endif
 
+    enum class WifiState : uint8_t
+    {
+      None = 0,
+      Idle,
+      Ap,
+      Connecting,
+      Connected,
+      Failed
+    };
+
+    // Fixed-capacity fields so state churn under a flapping link never touches the heap.
     struct WifiManagerState
     {
-      String last_state;
-      String last_ssid;
-      String last_message;
-      bool configuration_mode = false;
-      bool dns_active = false;
-      bool sta_connect_in_progress = false;
-      bool temporary_apsta_mode = false;
-      bool ap_shutdown_pending = false;
-      unsigned long ap_shutdown_deadline = 0;
-      wifi_mode_t current_mode = WIFI_MODE_NULL;
-      wifi_mode_t target_mode = WIFI_MODE_AP;
-      wifi_mode_t mode_before_temporary = WIFI_MODE_NULL;
+      WifiState last_state = WifiState::None;
+      char last_ssid[WIFI_MAX_SSID_LENGTH + 1] = {};
+      char last_message[WIFI_STATE_MESSAGE_CAPACITY] = {};
     };
 
     class WifiStateLock
@@ -78,9 +90,16 @@ namespace wifi_manager
       SemaphoreHandle_t mutex_;
     };
 
+    using wifi_state_machine::ApStartResult;
+    using wifi_state_machine::ConnectProgress;
+    using wifi_state_machine::Mode;
+    using wifi_state_machine::StationStatus;
+
     Callbacks callbacks_;
     WifiManagerState state_;
+    wifi_state_machine::StateMachine machine_;
     SemaphoreHandle_t state_mutex_ = nullptr;
+    StaticSemaphore_t state_mutex_buffer_;
     bool wifi_events_registered_ = false;
 
     struct WifiConnectRequest
@@ -90,8 +109,15 @@ namespace wifi_manager
       char password[WIFI_MAX_PASSWORD_LENGTH + 1];
     };
 
+    static_assert(sizeof(WifiConnectRequest) <= memory_budget::kWifiConnectRequestBytes,
+                  "WifiConnectRequest outgrew its entry in memory_budget.h");
+
     QueueHandle_t wifi_connect_request_queue_ = nullptr;
+    uint8_t wifi_connect_queue_storage_[memory_budget::kWifiConnectQueueLength * sizeof(WifiConnectRequest)];
+    StaticQueue_t wifi_connect_queue_buffer_;
     TaskHandle_t wifi_connect_task_handle_ = nullptr;
+    StackType_t wifi_connect_task_stack_[memory_budget::kWifiConnectStackBytes];
+    StaticTask_t wifi_connect_task_buffer_;
     std::atomic<bool> wifi_connect_busy_{false};
 
     DNSServer dns_server_;
@@ -100,7 +126,7 @@ namespace wifi_manager
     {
       if (!state_mutex_)
       {
-        state_mutex_ = xSemaphoreCreateMutex();
+        state_mutex_ = xSemaphoreCreateMutexStatic(&state_mutex_buffer_);
       }
       return state_mutex_ != nullptr;
     }
@@ -184,149 +210,221 @@ namespace wifi_manager
       return save_credentials_internal(ssid, password);
     }
 
-    void start_captive_portal()
+    const char *wifi_state_to_string(WifiState state)
     {
-      if (state_.dns_active)
-      {
-        dns_server_.stop();
+      switch (state)
+      {
+      case WifiState::Idle:
+        return "idle";
+      case WifiState::Ap:
+        return "ap";
+      case WifiState::Connecting:
+        return "connecting";
+      case WifiState::Connected:
+        return "connected";
+      case WifiState::Failed:
+        return "failed";
+      case WifiState::None:
+      default:
+        return "";
       }
+    }
 
-      dns_server_.setErrorReplyCode(DNSReplyCode::NoError);
-      IPAddress ap_ip = WiFi.softAPIP();
-      dns_server_.start(DNS_PORT, "*", ap_ip);
-      state_.dns_active = true;
+    // Copies at most capacity - 1 bytes and always terminates.
+    void copy_bounded(char *dest, size_t capacity, const char *src, size_t src_length)
+    {
+      size_t length = src_length < capacity - 1 ? src_length : capacity - 1;
+      memcpy(dest, src, length);
+      dest[length] = '\0';
     }
 
-    void stop_captive_portal()
+    void copy_bounded(char *dest, size_t capacity, const char *src)
     {
-      if (state_.dns_active)
-      {
-        dns_server_.stop();
-        state_.dns_active = false;
-      }
+      copy_bounded(dest, capacity, src, strnlen(src, capacity - 1));
     }
 
-    void append_json_escaped(String &dest, const String &value)
+    // Bounded JSON builder over caller-owned storage; output is truncated rather than grown.
+    struct FixedJsonWriter
     {
-      for (size_t i = 0; i < value.length(); ++i)
+      char *data;
+      size_t capacity;
+      size_t length;
+
+      void append(const char *text)
       {
-        char c = value[i];
-        switch (c)
+        while (*text && length + 1 < capacity)
         {
-        case '\\':
-        case '"':
-          dest += '\\';
-          dest += c;
-          break;
-        case '\b':
-          dest += F("\\b");
-          break;
-        case '\f':
-          dest += F("\\f");
-          break;
-        case '\n':
-          dest += F("\\n");
-          break;
-        case '\r':
-          dest += F("\\r");
-          break;
-        case '\t':
-          dest += F("\\t");
-          break;
-        default:
-          if (static_cast<uint8_t>(c) < 0x20)
+          data[length++] = *text++;
+        }
+        data[length] = '\0';
+      }
+
+      void append_escaped(const char *value)
+      {
+        for (; *value; ++value)
+        {
+          char c = *value;
+          char escaped[7] = {'\\', c, '\0'};
+          switch (c)
           {
-            char buffer[7];
-            snprintf(buffer, sizeof(buffer), "\\\\u%04x", static_cast<unsigned>(static_cast<uint8_t>(c)));
-            dest += buffer;
+          case '\\':
+          case '"':
+            break;
+          case '\b':
+            escaped[1] = 'b';
+            break;
+          case '\f':
+            escaped[1] = 'f';
+            break;
+          case '\n':
+            escaped[1] = 'n';
+            break;
+          case '\r':
+            escaped[1] = 'r';
+            break;
+          case '\t':
+            escaped[1] = 't';
+            break;
+          default:
+            if (static_cast<uint8_t>(c) < 0x20)
+            {
+              snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(static_cast<uint8_t>(c)));
+            }
+            else
+            {
+              escaped[0] = c;
+              escaped[1] = '\0';
+            }
+            break;
           }
-          else
+          size_t needed = strlen(escaped);
+          if (length + needed + 1 > capacity)
           {
-            dest += c;
+            return;
           }
-          break;
+          memcpy(data + length, escaped, needed + 1);
+          length += needed;
         }
       }
-    }
+    };
 
-    void dispatch_wifi_state(const String &state_value, const String &ssid, const String &message)
+    void dispatch_wifi_state(WifiState state_value, const char *ssid, const char *message)
     {
       if (!callbacks_.dispatch_transport_json)
       {
         return;
       }
 
-      String payload = F("{\"event\":\"wifi_state\",\"state\":\"");
-      append_json_escaped(payload, state_value);
-      payload += F("\"");
+      char payload[WIFI_STATE_PAYLOAD_CAPACITY];
+      FixedJsonWriter writer = {payload, sizeof(payload), 0};
+      writer.append("{\"event\":\"wifi_state\",\"state\":\"");
+      writer.append(wifi_state_to_string(state_value));
+      writer.append("\"");
 
-      if (!ssid.isEmpty())
+      if (ssid[0] != '\0')
       {
-        payload += F(",\"ssid\":\"");
-        append_json_escaped(payload, ssid);
-        payload += F("\"");
+        writer.append(",\"ssid\":\"");
+        writer.append_escaped(ssid);
+        writer.append("\"");
       }
 
-      if (!message.isEmpty())
+      if (message[0] != '\0')
       {
-        payload += F(",\"message\":\"");
-        append_json_escaped(payload, message);
-        payload += F("\"");
+        writer.append(",\"message\":\"");
+        writer.append_escaped(message);
+        writer.append("\"");
       }
 
-      payload += F("}");
-      callbacks_.dispatch_transport_json(payload.c_str());
+      writer.append("}");
+      callbacks_.dispatch_transport_json(payload);
     }
 
-    void publish_wifi_state_locked(const char *state_value, const char *ssid, const char *message)
+    // SSID of the current station config, read without going through Arduino's String API.
+    void current_sta_ssid(char *out, size_t capacity)
     {
-      String next_state = state_value ? String(state_value) : String();
-      if (next_state.isEmpty())
+      out[0] = '\0';
+      wifi_config_t config = {};
+      if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK)
+      {
+        return;
+      }
+      const char *ssid = reinterpret_cast<const char *>(config.sta.ssid);
+      copy_bounded(out, capacity, ssid, strnlen(ssid, sizeof(config.sta.ssid)));
+    }
+
+    void publish_wifi_state_locked(WifiState state_value, const char *ssid, const char *message)
+    {
+      if (state_value == WifiState::None)
       {
         if (ssid)
         {
-          state_.last_ssid = String(ssid);
+          copy_bounded(state_.last_ssid, sizeof(state_.last_ssid), ssid);
         }
         if (message)
         {
-          state_.last_message = String(message);
+          copy_bounded(state_.last_message, sizeof(state_.last_message), message);
         }
-        state_.last_state = "";
+        state_.last_state = WifiState::None;
         return;
       }
 
-      String next_ssid = ssid ? String(ssid) : state_.last_ssid;
-      if (!ssid && next_state == "connected")
+      char next_ssid[sizeof(state_.last_ssid)];
+      if (ssid)
       {
-        String current_ssid = WiFi.SSID();
-        if (current_ssid.length())
+        copy_bounded(next_ssid, sizeof(next_ssid), ssid);
+      }
+      else
+      {
+        memcpy(next_ssid, state_.last_ssid, sizeof(next_ssid));
+        if (state_value == WifiState::Connected)
         {
-          next_ssid = current_ssid;
+          char current_ssid[sizeof(next_ssid)];
+          current_sta_ssid(current_ssid, sizeof(current_ssid));
+          if (current_ssid[0] != '\0')
+          {
+            memcpy(next_ssid, current_ssid, sizeof(next_ssid));
+          }
         }
       }
 
-      String next_message = message ? String(message) : state_.last_message;
+      char next_message[sizeof(state_.last_message)];
+      if (message)
+      {
+        copy_bounded(next_message, sizeof(next_message), message);
+      }
+      else
+      {
+        memcpy(next_message, state_.last_message, sizeof(next_message));
+      }
 
-      if (next_state == state_.last_state && next_ssid == state_.last_ssid && next_message == state_.last_message)
+      if (state_value == state_.last_state && strcmp(next_ssid, state_.last_ssid) == 0 &&
+          strcmp(next_message, state_.last_message) == 0)
       {
         return;
       }
 
-      state_.last_state = next_state;
-      state_.last_ssid = next_ssid;
-      state_.last_message = next_message;
+      state_.last_state = state_value;
+      memcpy(state_.last_ssid, next_ssid, sizeof(next_ssid));
+      memcpy(state_.last_message, next_message, sizeof(next_message));
       dispatch_wifi_state(state_.last_state, state_.last_ssid, state_.last_message);
     }
 
-    void publish_wifi_state(const char *state_value, const char *ssid = nullptr, const char *message = nullptr)
+    void publish_wifi_state(WifiState state_value, const char *ssid = nullptr, const char *message = nullptr)
     {
       WifiStateLock lock = lock_state();
       publish_wifi_state_locked(state_value, ssid, message);
     }
 
+    void publish_disconnect_locked(uint8_t reason)
+    {
+      char message[sizeof(state_.last_message)];
+      snprintf(message, sizeof(message), "Disconnect reason %u", static_cast<unsigned>(reason));
+      publish_wifi_state_locked(WifiState::Failed, nullptr, message);
+    }
+
     void send_cached_wifi_state_locked()
     {
-      if (state_.last_state.isEmpty())
+      if (state_.last_state == WifiState::None)
       {
         return;
       }
@@ -340,19 +438,19 @@ namespace wifi_manager
         return;
       }
 
-      doc["state"] = state_.last_state.isEmpty() ? "" : state_.last_state;
-      if (!state_.last_ssid.isEmpty())
+      doc["state"] = wifi_state_to_string(state_.last_state);
+      if (state_.last_ssid[0] != '\0')
       {
-        doc["ssid"] = state_.last_ssid;
+        doc["ssid"] = static_cast<const char *>(state_.last_ssid);
       }
       else
       {
         doc.remove("ssid");
       }
 
-      if (!state_.last_message.isEmpty())
+      if (state_.last_message[0] != '\0')
       {
-        doc["message"] = state_.last_message;
+        doc["message"] = static_cast<const char *>(state_.last_message);
       }
       else
       {
@@ -360,19 +458,69 @@ namespace wifi_manager
       }
     }
 
-    bool ensure_wifi_started()
+    wifi_mode_t to_wifi_mode(Mode mode)
+    {
+      switch (mode)
+      {
+      case Mode::Sta:
+        return WIFI_MODE_STA;
+      case Mode::Ap:
+        return WIFI_MODE_AP;
+      case Mode::ApSta:
+        return WIFI_MODE_APSTA;
+      case Mode::Off:
+      default:
+        return WIFI_MODE_NULL;
+      }
+    }
+
+    Mode from_wifi_mode(wifi_mode_t mode)
     {
-      wifi_mode_t current_mode = WIFI_MODE_NULL;
-      if (esp_wifi_get_mode(&current_mode) == ESP_OK)
+      switch (mode)
       {
-        state_.current_mode = current_mode;
+      case WIFI_MODE_STA:
+        return Mode::Sta;
+      case WIFI_MODE_AP:
+        return Mode::Ap;
+      case WIFI_MODE_APSTA:
+        return Mode::ApSta;
+      default:
+        return Mode::Off;
       }
+    }
 
-      if (state_.current_mode == WIFI_MODE_NULL)
+    // Radio backend for the state machine: the real driver through Arduino WiFi and esp_wifi.
+    uint32_t radio_now_ms()
+    {
+      return millis();
+    }
+
+    bool radio_read_mode(Mode &mode)
+    {
+      wifi_mode_t current = WIFI_MODE_NULL;
+      if (esp_wifi_get_mode(&current) != ESP_OK)
       {
         return false;
       }
+      mode = from_wifi_mode(current);
+      return true;
+    }
 
+    bool radio_apply_mode(Mode current, Mode next)
+    {
+      if (current == Mode::Off)
+      {
+        return WiFi.mode(to_wifi_mode(next));
+      }
+      if (esp_wifi_set_mode(to_wifi_mode(next)) == ESP_OK)
+      {
+        return true;
+      }
+      return WiFi.mode(to_wifi_mode(next));
+    }
+
+    bool radio_start(Mode mode)
+    {
       esp_err_t err = esp_wifi_start();
       if (err == ESP_OK || err == ESP_ERR_WIFI_STATE)
       {
@@ -381,9 +529,8 @@ namespace wifi_manager
 
       if (err == ESP_ERR_WIFI_NOT_INIT)
       {
-        if (!WiFi.mode(state_.current_mode))
+        if (!WiFi.mode(to_wifi_mode(mode)))
         {
-          state_.current_mode = WIFI_MODE_NULL;
           return false;
         }
         err = esp_wifi_start();
@@ -393,139 +540,129 @@ namespace wifi_manager
       return false;
     }
 
-    void set_wifi_mode(wifi_mode_t mode)
+    ApStartResult radio_start_access_point()
     {
-      if (state_.current_mode == mode)
-      {
-        return;
-      }
-
-      bool success = false;
-      if (state_.current_mode == WIFI_MODE_NULL)
-      {
-        success = WiFi.mode(mode);
-      }
-      else
-      {
-        esp_err_t err = esp_wifi_set_mode(mode);
-        if (err == ESP_OK)
-        {
-          success = true;
-        }
-        else
-        {
-          success = WiFi.mode(mode);
-        }
-      }
-
-      if (!success)
-      {
-        wifi_mode_t actual = WIFI_MODE_NULL;
-        if (esp_wifi_get_mode(&actual) == ESP_OK)
-        {
-          state_.current_mode = actual;
-        }
-        else
-        {
-          state_.current_mode = WIFI_MODE_NULL;
-        }
-        return;
-      }
+      IPAddress local_ip(192, 168, 4, 1);
+      IPAddress gateway(192, 168, 4, 1);
+      IPAddress subnet(255, 255, 255, 0);
 
-      wifi_mode_t actual = WIFI_MODE_NULL;
-      if (esp_wifi_get_mode(&actual) == ESP_OK)
+      if (!WiFi.softAPConfig(local_ip, gateway, subnet))
       {
-        state_.current_mode = actual;
+        return ApStartResult::ConfigFailed;
       }
-      else
+      if (!WiFi.softAP(CONFIG_AP_SSID, CONFIG_AP_PASSWORD))
       {
-        state_.current_mode = mode;
+        return ApStartResult::AccessPointFailed;
       }
+      return ApStartResult::Ok;
     }
 
-    bool is_ap_mode(wifi_mode_t mode)
+    void radio_stop_access_point()
     {
-      return mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA;
+      WiFi.softAPdisconnect(true);
     }
 
-    void ensure_ap_only_mode()
+    void radio_start_portal()
     {
-      state_.temporary_apsta_mode = false;
-      state_.target_mode = WIFI_MODE_AP;
-      set_wifi_mode(WIFI_MODE_AP);
+      dns_server_.setErrorReplyCode(DNSReplyCode::NoError);
+      IPAddress ap_ip = WiFi.softAPIP();
+      dns_server_.start(DNS_PORT, "*", ap_ip);
     }
 
-    void ensure_sta_only_mode()
+    void radio_stop_portal()
     {
-      state_.temporary_apsta_mode = false;
-      state_.target_mode = WIFI_MODE_STA;
-      set_wifi_mode(WIFI_MODE_STA);
+      dns_server_.stop();
     }
 
-    void shutdown_access_point()
+    void radio_begin_station(const char *ssid, const char *password)
     {
-      stop_captive_portal();
-      WiFi.softAPdisconnect(true);
-      ensure_sta_only_mode();
-      state_.configuration_mode = false;
+      WiFi.persistent(false);
+      WiFi.setAutoReconnect(true);
+      WiFi.begin(ssid, password);
     }
 
-    void request_ap_sta_mode(bool temporary)
+    StationStatus radio_station_status()
     {
-      if (temporary)
-      {
-        state_.mode_before_temporary = state_.current_mode;
-        if (state_.mode_before_temporary == WIFI_MODE_STA)
-        {
-          state_.target_mode = WIFI_MODE_STA;
-        }
-        else
-        {
-          state_.target_mode = WIFI_MODE_AP;
-        }
+      switch (WiFi.status())
+      {
+      case WL_CONNECTED:
+        return StationStatus::Connected;
+      case WL_CONNECT_FAILED:
+        return StationStatus::Failed;
+      case WL_CONNECTION_LOST:
+        return StationStatus::Lost;
+      case WL_DISCONNECTED:
+        return StationStatus::Disconnected;
+      case WL_NO_SSID_AVAIL:
+        return StationStatus::NoSsid;
+      default:
+        return StationStatus::Idle;
       }
-
-      state_.temporary_apsta_mode = temporary;
-      set_wifi_mode(WIFI_MODE_APSTA);
     }
 
-    void restore_ap_mode_after_temporary_sta()
+    void radio_reconnect_station()
     {
-      if (!state_.temporary_apsta_mode)
-      {
-        return;
-      }
+      WiFi.reconnect();
+    }
 
-      state_.temporary_apsta_mode = false;
-      if (state_.mode_before_temporary == WIFI_MODE_STA)
+    void radio_disconnect_station(bool keep_ap_active)
+    {
+      if (keep_ap_active)
       {
-        ensure_sta_only_mode();
+        esp_wifi_disconnect();
       }
       else
       {
-        ensure_ap_only_mode();
+        WiFi.disconnect();
       }
     }
 
-    void schedule_sta_only_transition()
+    wifi_state_machine::Radio make_radio()
     {
-      if (state_.current_mode != WIFI_MODE_APSTA || state_.temporary_apsta_mode)
+      wifi_state_machine::Radio radio;
+      radio.now_ms = radio_now_ms;
+      radio.read_mode = radio_read_mode;
+      radio.apply_mode = radio_apply_mode;
+      radio.start = radio_start;
+      radio.start_access_point = radio_start_access_point;
+      radio.stop_access_point = radio_stop_access_point;
+      radio.start_portal = radio_start_portal;
+      radio.stop_portal = radio_stop_portal;
+      radio.begin_station = radio_begin_station;
+      radio.station_status = radio_station_status;
+      radio.reconnect_station = radio_reconnect_station;
+      radio.disconnect_station = radio_disconnect_station;
+      return radio;
+    }
+
+    const char *ap_start_failure_message(ApStartResult result)
+    {
+      switch (result)
       {
-        return;
+      case ApStartResult::ConfigFailed:
+        return "Failed to configure access point network";
+      case ApStartResult::AccessPointFailed:
+        return "Failed to start access point";
+      case ApStartResult::StartFailed:
+      default:
+        return "Failed to start WiFi for access point";
       }
-      state_.ap_shutdown_pending = true;
-      state_.ap_shutdown_deadline = millis() + WIFI_AP_SHUTDOWN_DELAY_MS;
-      state_.target_mode = WIFI_MODE_STA;
     }
 
-    void finalize_sta_only_transition()
+    void start_ap_locked()
     {
-      if (!state_.ap_shutdown_pending)
+      ApStartResult result = machine_.start_ap();
+      if (result != ApStartResult::Ok)
       {
+        const char *message = ap_start_failure_message(result);
+        publish_wifi_state_locked(WifiState::Failed, nullptr, message);
+        if (callbacks_.send_status_error)
+        {
+          callbacks_.send_status_error(message);
+        }
         return;
       }
-      state_.ap_shutdown_pending = false;
-      shutdown_access_point();
+      publish_wifi_state_locked(WifiState::Ap, CONFIG_AP_SSID, nullptr);
     }
 
     bool connect_to_station_internal(const String &ssid, const String &password, bool keep_ap_active)
@@ -535,80 +672,40 @@ namespace wifi_manager
         return false;
       }
 
-      publish_wifi_state("connecting", ssid.c_str());
+      publish_wifi_state(WifiState::Connecting, ssid.c_str());
 
       {
         WifiStateLock lock = lock_state();
-        state_.ap_shutdown_pending = false;
-        if (keep_ap_active)
+        if (!machine_.begin_connect(ssid.c_str(), password.c_str(), keep_ap_active))
         {
-          request_ap_sta_mode(false);
-        }
-        else
-        {
-          shutdown_access_point();
-        }
-        WiFi.persistent(false);
-        WiFi.setAutoReconnect(true);
-
-        if (!ensure_wifi_started())
-        {
-          if (keep_ap_active)
-          {
-            // Restore AP state when we fail to start the STA interface.
-            start_ap();
-          }
-          else
-          {
-            WiFi.disconnect();
-          }
-          publish_wifi_state("failed", ssid.c_str(), "Failed to start WiFi");
+          publish_wifi_state_locked(WifiState::Failed, ssid.c_str(), "Failed to start WiFi");
           return false;
         }
-
-        state_.sta_connect_in_progress = true;
       }
 
-      WiFi.begin(ssid.c_str(), password.c_str());
-
-      unsigned long start_attempt = millis();
-      bool connected = false;
-      while ((millis() - start_attempt) < WIFI_CONNECT_TIMEOUT_MS)
+      ConnectProgress progress = ConnectProgress::Pending;
+      for (;;)
       {
-        wl_status_t status = WiFi.status();
-        if (status == WL_CONNECTED)
         {
-          connected = true;
-          break;
+          WifiStateLock lock = lock_state();
+          progress = machine_.poll_connect();
         }
-        if (status == WL_CONNECT_FAILED || status == WL_CONNECTION_LOST || status == WL_DISCONNECTED)
+        if (progress != ConnectProgress::Pending)
         {
-          WiFi.reconnect();
+          break;
         }
         vTaskDelay(pdMS_TO_TICKS(WIFI_RETRY_DELAY_MS));
       }
 
+      bool connected = progress == ConnectProgress::Connected;
       {
         WifiStateLock lock = lock_state();
-        state_.sta_connect_in_progress = false;
-        if (connected && !keep_ap_active)
-        {
-          state_.configuration_mode = false;
-        }
+        machine_.finish_connect(connected, keep_ap_active);
       }
 
       if (!connected)
       {
-        if (keep_ap_active)
-        {
-          esp_wifi_disconnect();
-          start_ap();
-        }
-        else
-        {
-          WiFi.disconnect();
-        }
-        publish_wifi_state("failed", ssid.c_str(), "Connection timed out");
+        publish_wifi_state(WifiState::Failed, ssid.c_str(), "Connection timed out");
         return false;
       }
 
@@ -618,13 +715,14 @@ namespace wifi_manager
         {
           callbacks_.send_status_error("Failed to save WiFi credentials");
         }
-        publish_wifi_state("failed", ssid.c_str(), "Failed to save WiFi credentials");
+        publish_wifi_state(WifiState::Failed, ssid.c_str(), "Failed to save WiFi credentials");
         if (keep_ap_active)
         {
           WifiStateLock lock = lock_state();
-          state_.ap_shutdown_pending = false;
-          state_.target_mode = WIFI_MODE_APSTA;
-          state_.current_mode = WIFI_MODE_APSTA;
+          wifi_state_machine::State &machine_state = machine_.state();
+          machine_state.ap_shutdown_pending = false;
+          machine_state.target_mode = Mode::ApSta;
+          machine_state.current_mode = Mode::ApSta;
         }
         return false;
       }
@@ -632,18 +730,18 @@ namespace wifi_manager
       if (!keep_ap_active)
       {
         WifiStateLock lock = lock_state();
-        stop_captive_portal();
+        machine_.stop_captive_portal();
       }
 
       if (callbacks_.send_event)
       {
         callbacks_.send_event("wifi_sta_connected", ssid.c_str());
       }
-      publish_wifi_state("connected", ssid.c_str());
+      publish_wifi_state(WifiState::Connected, ssid.c_str());
       if (!keep_ap_active)
       {
         WifiStateLock lock = lock_state();
-        schedule_sta_only_transition();
+        machine_.schedule_sta_only_transition();
       }
       return true;
     }
@@ -658,6 +756,7 @@ namespace wifi_manager
         if (wifi_connect_request_queue_ &&
             xQueueReceive(wifi_connect_request_queue_, &request, portMAX_DELAY) == pdPASS)
         {
+          trace::record(trace::EventType::TaskWake, trace::TaskId::WifiConnect);
           String ssid = String(request.ssid);
           String password = String(request.password);
           bool keep_ap_active = request.keep_ap_active;
@@ -682,7 +781,11 @@ namespace wifi_manager
     {
       if (!wifi_connect_request_queue_)
       {
-        wifi_connect_request_queue_ = xQueueCreate(1, sizeof(WifiConnectRequest));
+        wifi_connect_request_queue_ = xQueueCreateStatic(memory_budget::kWifiConnectQueueLength,
+                                                         sizeof(WifiConnectRequest),
+                                                         wifi_connect_queue_storage_,
+                                                         &wifi_connect_queue_buffer_);
+        crash_snapshot::watch_queue("wifi_connect", &wifi_connect_request_queue_, memory_budget::kWifiConnectQueueLength);
       }
 
       if (!wifi_connect_request_queue_)
@@ -692,23 +795,32 @@ namespace wifi_manager
 
       if (!wifi_connect_task_handle_)
       {
-        constexpr uint32_t stack_size = 4096;
+        constexpr uint32_t stack_size = sizeof(wifi_connect_task_stack_);
         constexpr UBaseType_t priority = tskIDLE_PRIORITY + 1;
 #if defined(CONFIG_FREERTOS_UNICORE) && CONFIG_FREERTOS_UNICORE
-        if (xTaskCreate(wifi_connect_task, "wifi_connect", stack_size, nullptr, priority, &wifi_connect_task_handle_) != pdPASS)
+        wifi_connect_task_handle_ = xTaskCreateStatic(wifi_connect_task,
+                                                      "wifi_connect",
+                                                      stack_size,
+                                                      nullptr,
+                                                      priority,
+                                                      wifi_connect_task_stack_,
+                                                      &wifi_connect_task_buffer_);
 #else
-        if (xTaskCreatePinnedToCore(wifi_connect_task,
-                                    "wifi_connect",
-                                    stack_size,
-                                    nullptr,
-                                    priority,
-                                    &wifi_connect_task_handle_,
-                                    kWifiTaskCore) != pdPASS)
+        wifi_connect_task_handle_ = xTaskCreateStaticPinnedToCore(wifi_connect_task,
+                                                                  "wifi_connect",
+                                                                  stack_size,
+                                                                  nullptr,
+                                                                  priority,
+                                                                  wifi_connect_task_stack_,
+                                                                  &wifi_connect_task_buffer_,
+                                                                  kWifiTaskCore);
 #endif
+        if (!wifi_connect_task_handle_)
         {
-          wifi_connect_task_handle_ = nullptr;
           return false;
         }
+        crash_snapshot::watch_task(&wifi_connect_task_handle_);
+        task_monitor::watch("wifi_connect", &wifi_connect_task_handle_, stack_size);
       }
 
       return true;
@@ -738,19 +850,8 @@ namespace wifi_manager
 
       WifiConnectRequest request = {};
       request.keep_ap_active = keep_ap_active;
-      String limited_ssid = ssid;
-      if (limited_ssid.length() > WIFI_MAX_SSID_LENGTH)
-      {
-        limited_ssid = limited_ssid.substring(0, static_cast<int>(WIFI_MAX_SSID_LENGTH));
-      }
-      limited_ssid.toCharArray(request.ssid, sizeof(request.ssid));
-
-      String limited_password = password;
-      if (limited_password.length() > WIFI_MAX_PASSWORD_LENGTH)
-      {
-        limited_password = limited_password.substring(0, static_cast<int>(WIFI_MAX_PASSWORD_LENGTH));
-      }
-      limited_password.toCharArray(request.password, sizeof(request.password));
+      copy_bounded(request.ssid, sizeof(request.ssid), ssid.c_str());
+      copy_bounded(request.password, sizeof(request.password), password.c_str());
 
       return xQueueSend(wifi_connect_request_queue_, &request, 0) == pdPASS;
     }
@@ -785,11 +886,8 @@ namespace wifi_manager
     bool scan_networks_internal(JsonArray results, String &error_message, int &error_code)
     {
       WifiStateLock lock = lock_state();
-      request_ap_sta_mode(true);
-
-      if (!ensure_wifi_started())
+      if (!machine_.begin_scan())
       {
-        restore_ap_mode_after_temporary_sta();
         error_message = "WiFi interface not ready";
         error_code = 0;
         return false;
@@ -798,7 +896,7 @@ namespace wifi_manager
       int16_t count = WiFi.scanNetworks(false, false, false);
       if (count < 0)
       {
-        restore_ap_mode_after_temporary_sta();
+        machine_.end_scan();
         error_message = "Scan failed";
         error_code = count;
         return false;
@@ -815,7 +913,7 @@ namespace wifi_manager
       }
 
       WiFi.scanDelete();
-      restore_ap_mode_after_temporary_sta();
+      machine_.end_scan();
       return true;
     }
   } // namespace
@@ -835,6 +933,7 @@ namespace wifi_manager
     ensure_state_mutex();
     WifiStateLock lock = lock_state();
     state_ = WifiManagerState();
+    machine_.init(make_radio(), WIFI_CONNECT_TIMEOUT_MS, WIFI_AP_SHUTDOWN_DELAY_MS);
   }
 
   bool schedule_connect(const String &ssid, const String &password, bool keep_ap_active)
@@ -860,59 +959,33 @@ namespace wifi_manager
   void start_ap()
   {
     WifiStateLock lock = lock_state();
-    state_.ap_shutdown_pending = false;
-    ensure_ap_only_mode();
-
-    auto report_failure = [](const char *message) {
-      stop_captive_portal();
-      WiFi.softAPdisconnect(true);
-      state_.configuration_mode = false;
-      publish_wifi_state_locked("failed", nullptr, message);
-      if (callbacks_.send_status_error)
-      {
-        callbacks_.send_status_error(message);
-      }
-    };
-
-    if (!ensure_wifi_started())
-    {
-      report_failure("Failed to start WiFi for access point");
-      return;
-    }
-
-    IPAddress local_ip(192, 168, 4, 1);
-    IPAddress gateway(192, 168, 4, 1);
-    IPAddress subnet(255, 255, 255, 0);
-
-    if (!WiFi.softAPConfig(local_ip, gateway, subnet))
-    {
-      report_failure("Failed to configure access point network");
-      return;
-    }
-
-    if (!WiFi.softAP(CONFIG_AP_SSID, CONFIG_AP_PASSWORD))
-    {
-      report_failure("Failed to start access point");
-      return;
-    }
-
-    start_captive_portal();
-    state_.configuration_mode = true;
-    publish_wifi_state_locked("ap", CONFIG_AP_SSID, nullptr);
+    start_ap_locked();
   }
 
   void stop_ap()
   {
     WifiStateLock lock = lock_state();
-    state_.ap_shutdown_pending = false;
-    shutdown_access_point();
-    publish_wifi_state_locked("idle", nullptr, nullptr);
+    machine_.stop_ap();
+    publish_wifi_state_locked(WifiState::Idle, nullptr, nullptr);
+  }
+
+  bool set_power_save(bool enabled)
+  {
+#if defined(CONFIG_BT_ENABLED)
+    // Coexistence needs modem sleep: esp_wifi_set_ps(WIFI_PS_NONE) fails while BLE is up.
+    (void)enabled;
+    const wifi_ps_type_t mode = WIFI_PS_MIN_MODEM;
+#else
+    const wifi_ps_type_t mode = enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE;
+#endif
+    // WiFi.setSleep() also returns false when the mode is already set.
+    return WiFi.getSleep() == mode || WiFi.setSleep(mode);
   }
 
   bool is_configuration_mode()
   {
     WifiStateLock lock = lock_state();
-    return state_.configuration_mode;
+    return machine_.state().configuration_mode;
   }
 
   void append_state_json(JsonVariant doc)
@@ -930,16 +1003,13 @@ namespace wifi_manager
   void process()
   {
     WifiStateLock lock = lock_state();
-    if (state_.ap_shutdown_pending && millis() >= state_.ap_shutdown_deadline)
-    {
-      finalize_sta_only_transition();
-    }
+    machine_.process();
   }
 
   void process_dns()
   {
     WifiStateLock lock = lock_state();
-    if (state_.dns_active)
+    if (machine_.state().portal_active)
     {
       dns_server_.processNextRequest();
     }
@@ -952,40 +1022,40 @@ namespace wifi_manager
     switch (event)
     {
     case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-      state_.sta_connect_in_progress = false;
-      publish_wifi_state("connected", WiFi.SSID().c_str());
-      schedule_sta_only_transition();
+      trace::record(trace::EventType::WifiEvent, static_cast<uint16_t>(event));
+      publish_wifi_state_locked(WifiState::Connected, nullptr, nullptr);
+      machine_.on_got_ip();
       break;
     case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
     {
-      state_.sta_connect_in_progress = false;
+      machine_.on_disconnected();
       uint8_t reason = info.wifi_sta_disconnected.reason;
-      String message = F("Disconnect reason ");
-      message += String(reason);
-      publish_wifi_state("failed", nullptr, message.c_str());
+      trace::record(trace::EventType::WifiEvent, static_cast<uint16_t>(event), reason);
+      publish_disconnect_locked(reason);
       break;
     }
     default:
+      trace::record(trace::EventType::WifiEvent, static_cast<uint16_t>(event));
       break;
     }
 #else
     switch (event)
     {
     case SYSTEM_EVENT_STA_GOT_IP:
-      state_.sta_connect_in_progress = false;
-      publish_wifi_state("connected", WiFi.SSID().c_str());
-      schedule_sta_only_transition();
+      trace::record(trace::EventType::WifiEvent, static_cast<uint16_t>(event));
+      publish_wifi_state_locked(WifiState::Connected, nullptr, nullptr);
+      machine_.on_got_ip();
       break;
     case SYSTEM_EVENT_STA_DISCONNECTED:
     {
-      state_.sta_connect_in_progress = false;
+      machine_.on_disconnected();
       uint8_t reason = info.disconnected.reason;
-      String message = F("Disconnect reason ");
-      message += String(reason);
-      publish_wifi_state("failed", nullptr, message.c_str());
+      trace::record(trace::EventType::WifiEvent, static_cast<uint16_t>(event), reason);
+      publish_disconnect_locked(reason);
       break;
     }
     default:
+      trace::record(trace::EventType::WifiEvent, static_cast<uint16_t>(event));
       break;
     }
 #endif
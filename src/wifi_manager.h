@@ -23,6 +23,11 @@ namespace wifi_manager
   void stop_ap();
 
   bool is_configuration_mode();
+  // Modem sleep in station mode; off keeps the radio listening at the cost of power. Safe
+  // before the station starts, which applies it then. With Bluetooth enabled the driver
+  // rejects turning sleep off, so the station stays in modem sleep. False when the Wi-Fi
+  // driver refuses the setting.
+  bool set_power_save(bool enabled);
   void append_state_json(JsonVariant doc);
   void send_cached_state();
 
@@ -0,0 +1,358 @@
+#include "wifi_state_machine.h"
+
+namespace wifi_state_machine
+{
+  const char *mode_to_string(Mode mode)
+  {
+    switch (mode)
+    {
+    case Mode::Sta:
+      return "sta";
+    case Mode::Ap:
+      return "ap";
+    case Mode::ApSta:
+      return "apsta";
+    case Mode::Off:
+    default:
+      return "off";
+    }
+  }
+
+  void StateMachine::init(const Radio &radio, uint32_t connect_timeout_ms, uint32_t ap_shutdown_delay_ms)
+  {
+    radio_ = radio;
+    connect_timeout_ms_ = connect_timeout_ms;
+    ap_shutdown_delay_ms_ = ap_shutdown_delay_ms;
+    reset();
+  }
+
+  void StateMachine::reset()
+  {
+    state_ = State();
+  }
+
+  State &StateMachine::state()
+  {
+    return state_;
+  }
+
+  const State &StateMachine::state() const
+  {
+    return state_;
+  }
+
+  uint32_t StateMachine::now_ms() const
+  {
+    return radio_.now_ms ? radio_.now_ms() : 0;
+  }
+
+  bool StateMachine::ensure_started()
+  {
+    Mode current_mode = Mode::Off;
+    if (radio_.read_mode && radio_.read_mode(current_mode))
+    {
+      state_.current_mode = current_mode;
+    }
+
+    if (state_.current_mode == Mode::Off)
+    {
+      return false;
+    }
+
+    if (radio_.start && radio_.start(state_.current_mode))
+    {
+      return true;
+    }
+
+    Mode actual = Mode::Off;
+    if (!radio_.read_mode || !radio_.read_mode(actual))
+    {
+      state_.current_mode = Mode::Off;
+    }
+    return false;
+  }
+
+  void StateMachine::set_mode(Mode mode)
+  {
+    if (state_.current_mode == mode)
+    {
+      return;
+    }
+
+    bool success = radio_.apply_mode && radio_.apply_mode(state_.current_mode, mode);
+
+    Mode actual = Mode::Off;
+    if (radio_.read_mode && radio_.read_mode(actual))
+    {
+      state_.current_mode = actual;
+    }
+    else
+    {
+      state_.current_mode = success ? mode : Mode::Off;
+    }
+  }
+
+  void StateMachine::ensure_ap_only_mode()
+  {
+    state_.temporary_apsta_mode = false;
+    state_.target_mode = Mode::Ap;
+    set_mode(Mode::Ap);
+  }
+
+  void StateMachine::ensure_sta_only_mode()
+  {
+    state_.temporary_apsta_mode = false;
+    state_.target_mode = Mode::Sta;
+    set_mode(Mode::Sta);
+  }
+
+  void StateMachine::start_captive_portal()
+  {
+    if (state_.portal_active && radio_.stop_portal)
+    {
+      radio_.stop_portal();
+    }
+    if (radio_.start_portal)
+    {
+      radio_.start_portal();
+    }
+    state_.portal_active = true;
+  }
+
+  void StateMachine::stop_captive_portal()
+  {
+    if (!state_.portal_active)
+    {
+      return;
+    }
+    if (radio_.stop_portal)
+    {
+      radio_.stop_portal();
+    }
+    state_.portal_active = false;
+  }
+
+  void StateMachine::shutdown_access_point()
+  {
+    stop_captive_portal();
+    if (radio_.stop_access_point)
+    {
+      radio_.stop_access_point();
+    }
+    ensure_sta_only_mode();
+    state_.configuration_mode = false;
+  }
+
+  void StateMachine::request_ap_sta_mode(bool temporary)
+  {
+    if (temporary && state_.current_mode == Mode::ApSta && !state_.temporary_apsta_mode)
+    {
+      // Already in AP+STA for a connect that keeps the portal; restoring afterwards would
+      // drop the STA side under it.
+      return;
+    }
+    if (temporary)
+    {
+      state_.mode_before_temporary = state_.current_mode;
+      state_.target_mode = (state_.mode_before_temporary == Mode::Sta) ? Mode::Sta : Mode::Ap;
+    }
+
+    state_.temporary_apsta_mode = temporary;
+    set_mode(Mode::ApSta);
+  }
+
+  void StateMachine::restore_ap_mode_after_temporary_sta()
+  {
+    if (!state_.temporary_apsta_mode)
+    {
+      return;
+    }
+
+    state_.temporary_apsta_mode = false;
+    if (state_.mode_before_temporary == Mode::Sta)
+    {
+      ensure_sta_only_mode();
+    }
+    else
+    {
+      ensure_ap_only_mode();
+    }
+  }
+
+  void StateMachine::schedule_sta_only_transition()
+  {
+    if (state_.current_mode != Mode::ApSta || state_.temporary_apsta_mode)
+    {
+      return;
+    }
+    state_.ap_shutdown_pending = true;
+    state_.ap_shutdown_deadline_ms = now_ms() + ap_shutdown_delay_ms_;
+    state_.target_mode = Mode::Sta;
+  }
+
+  void StateMachine::finalize_sta_only_transition()
+  {
+    if (!state_.ap_shutdown_pending)
+    {
+      return;
+    }
+    state_.ap_shutdown_pending = false;
+    shutdown_access_point();
+  }
+
+  ApStartResult StateMachine::start_ap()
+  {
+    state_.ap_shutdown_pending = false;
+    ensure_ap_only_mode();
+
+    ApStartResult result = ApStartResult::StartFailed;
+    if (ensure_started())
+    {
+      result = radio_.start_access_point ? radio_.start_access_point() : ApStartResult::AccessPointFailed;
+    }
+
+    if (result != ApStartResult::Ok)
+    {
+      stop_captive_portal();
+      if (radio_.stop_access_point)
+      {
+        radio_.stop_access_point();
+      }
+      state_.configuration_mode = false;
+      return result;
+    }
+
+    start_captive_portal();
+    state_.configuration_mode = true;
+    return ApStartResult::Ok;
+  }
+
+  void StateMachine::stop_ap()
+  {
+    state_.ap_shutdown_pending = false;
+    shutdown_access_point();
+  }
+
+  bool StateMachine::begin_connect(const char *ssid, const char *password, bool keep_ap_active)
+  {
+    state_.ap_shutdown_pending = false;
+    if (keep_ap_active)
+    {
+      request_ap_sta_mode(false);
+    }
+    else
+    {
+      shutdown_access_point();
+    }
+
+    if (!ensure_started())
+    {
+      if (keep_ap_active)
+      {
+        start_ap();
+      }
+      else if (radio_.disconnect_station)
+      {
+        radio_.disconnect_station(false);
+      }
+      return false;
+    }
+
+    state_.sta_connect_in_progress = true;
+    state_.connect_started_ms = now_ms();
+    state_.last_station_attempt_ms = state_.connect_started_ms;
+    if (radio_.begin_station)
+    {
+      radio_.begin_station(ssid, password);
+    }
+    return true;
+  }
+
+  ConnectProgress StateMachine::poll_connect()
+  {
+    StationStatus status = radio_.station_status ? radio_.station_status() : StationStatus::Idle;
+    if (status == StationStatus::Connected)
+    {
+      return ConnectProgress::Connected;
+    }
+    if (now_ms() - state_.connect_started_ms >= connect_timeout_ms_)
+    {
+      return ConnectProgress::TimedOut;
+    }
+    // The driver reports Disconnected until it has an IP, so an attempt still associating
+    // looks the same as a failed one. Restarting it on every poll would abort it before it
+    // can finish; give each attempt kStationRetryIntervalMs first.
+    bool retry_due = now_ms() - state_.last_station_attempt_ms >= kStationRetryIntervalMs;
+    if ((status == StationStatus::Failed || status == StationStatus::Lost || status == StationStatus::Disconnected) &&
+        retry_due && radio_.reconnect_station)
+    {
+      radio_.reconnect_station();
+      state_.last_station_attempt_ms = now_ms();
+    }
+    return ConnectProgress::Pending;
+  }
+
+  void StateMachine::finish_connect(bool connected, bool keep_ap_active)
+  {
+    state_.sta_connect_in_progress = false;
+    if (connected)
+    {
+      if (!keep_ap_active)
+      {
+        state_.configuration_mode = false;
+      }
+      return;
+    }
+
+    if (radio_.disconnect_station)
+    {
+      radio_.disconnect_station(keep_ap_active);
+    }
+    if (keep_ap_active)
+    {
+      start_ap();
+    }
+  }
+
+  bool StateMachine::begin_scan()
+  {
+    request_ap_sta_mode(true);
+    if (!ensure_started())
+    {
+      restore_ap_mode_after_temporary_sta();
+      return false;
+    }
+    return true;
+  }
+
+  void StateMachine::end_scan()
+  {
+    restore_ap_mode_after_temporary_sta();
+  }
+
+  void StateMachine::on_got_ip()
+  {
+    state_.sta_connect_in_progress = false;
+    schedule_sta_only_transition();
+  }
+
+  void StateMachine::on_disconnected()
+  {
+    state_.sta_connect_in_progress = false;
+  }
+
+  bool StateMachine::process()
+  {
+    if (!state_.ap_shutdown_pending)
+    {
+      return false;
+    }
+    // Signed difference keeps the deadline correct across millis() wrap-around.
+    if (static_cast<int32_t>(now_ms() - state_.ap_shutdown_deadline_ms) < 0)
+    {
+      return false;
+    }
+    finalize_sta_only_transition();
+    return true;
+  }
+} // namespace wifi_state_machine
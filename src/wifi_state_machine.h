@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// AP/STA mode handling behind wifi_manager, kept free of Arduino, ESP-IDF and FreeRTOS so
+// the same code runs in tools/wifi_sim. Every driver call goes through Radio. The machine
+// does no locking of its own: wifi_manager calls it with its state lock held.
+namespace wifi_state_machine
+{
+  enum class Mode : uint8_t
+  {
+    Off = 0,
+    Sta,
+    Ap,
+    ApSta
+  };
+
+  enum class StationStatus : uint8_t
+  {
+    Idle = 0,
+    Connected,
+    Failed,
+    Lost,
+    Disconnected,
+    NoSsid
+  };
+
+  enum class ApStartResult : uint8_t
+  {
+    Ok = 0,
+    StartFailed,
+    ConfigFailed,
+    AccessPointFailed
+  };
+
+  enum class ConnectProgress : uint8_t
+  {
+    Pending = 0,
+    Connected,
+    TimedOut
+  };
+
+  constexpr uint32_t kDefaultConnectTimeoutMs = 20000;
+  constexpr uint32_t kDefaultApShutdownDelayMs = 3000;
+  // Minimum time between station reconnect attempts while a connect is polled.
+  constexpr uint32_t kStationRetryIntervalMs = 5000;
+
+  struct Radio
+  {
+    uint32_t (*now_ms)() = nullptr;
+    // Reads the driver's mode; false when the driver is not initialised.
+    bool (*read_mode)(Mode &mode) = nullptr;
+    // Switches the driver from `current` to `next`; false if it was rejected.
+    bool (*apply_mode)(Mode current, Mode next) = nullptr;
+    // Starts the driver in `mode`, initialising it first when needed.
+    bool (*start)(Mode mode) = nullptr;
+    ApStartResult (*start_access_point)() = nullptr;
+    void (*stop_access_point)() = nullptr;
+    void (*start_portal)() = nullptr;
+    void (*stop_portal)() = nullptr;
+    void (*begin_station)(const char *ssid, const char *password) = nullptr;
+    StationStatus (*station_status)() = nullptr;
+    void (*reconnect_station)() = nullptr;
+    // With keep_ap_active only the STA link is dropped and the soft AP stays up.
+    void (*disconnect_station)(bool keep_ap_active) = nullptr;
+  };
+
+  struct State
+  {
+    bool configuration_mode = false;
+    bool portal_active = false;
+    bool sta_connect_in_progress = false;
+    bool temporary_apsta_mode = false;
+    bool ap_shutdown_pending = false;
+    uint32_t ap_shutdown_deadline_ms = 0;
+    uint32_t connect_started_ms = 0;
+    uint32_t last_station_attempt_ms = 0;
+    Mode current_mode = Mode::Off;
+    Mode target_mode = Mode::Ap;
+    Mode mode_before_temporary = Mode::Off;
+  };
+
+  const char *mode_to_string(Mode mode);
+
+  class StateMachine
+  {
+  public:
+    void init(const Radio &radio,
+              uint32_t connect_timeout_ms = kDefaultConnectTimeoutMs,
+              uint32_t ap_shutdown_delay_ms = kDefaultApShutdownDelayMs);
+    void reset();
+
+    State &state();
+    const State &state() const;
+
+    bool ensure_started();
+    void set_mode(Mode mode);
+    void ensure_ap_only_mode();
+    void ensure_sta_only_mode();
+    void start_captive_portal();
+    void stop_captive_portal();
+    void shutdown_access_point();
+    void request_ap_sta_mode(bool temporary);
+    void restore_ap_mode_after_temporary_sta();
+    void schedule_sta_only_transition();
+    void finalize_sta_only_transition();
+
+    // Brings up the soft AP and portal. On failure the AP is torn down again and
+    // configuration mode is cleared.
+    ApStartResult start_ap();
+    void stop_ap();
+
+    // Connect sequence, split so the caller can drop its lock between polls. begin_connect
+    // returns false when the driver would not start; the AP is restored when it was kept.
+    bool begin_connect(const char *ssid, const char *password, bool keep_ap_active);
+    ConnectProgress poll_connect();
+    void finish_connect(bool connected, bool keep_ap_active);
+
+    // Scans need the STA interface, so they run inside a temporary AP+STA bracket.
+    bool begin_scan();
+    void end_scan();
+
+    void on_got_ip();
+    void on_disconnected();
+
+    // Runs a deferred AP shutdown once its deadline passes; true when it ran.
+    bool process();
+
+  private:
+    uint32_t now_ms() const;
+
+    Radio radio_;
+    State state_;
+    uint32_t connect_timeout_ms_ = kDefaultConnectTimeoutMs;
+    uint32_t ap_shutdown_delay_ms_ = kDefaultApShutdownDelayMs;
+  };
+} // namespace wifi_state_machine
@@ -14,6 +14,9 @@ Move the mouse and right-click:
     python3 ble_hid_uart_client.py mouse --action move --dx 50 --dy -10
     python3 ble_hid_uart_client.py mouse --action click --buttons right
 
+Measure how many mouse reports per second the BLE link sustains:
+    python3 ble_hid_uart_client.py bench --kind mouse --rate 125 --duration-ms 2000
+
 By default the tool listens for ~1.5 seconds after each command to print
 `status`/`event` messages. Use `--listen-for -1` to keep running until Ctrl+C.
 """
@@ -125,6 +128,16 @@ def _build_consumer_command(args: argparse.Namespace) -> dict:
     return command
 
 
+def _build_bench_command(args: argparse.Namespace) -> dict:
+    return {
+        "device": "system",
+        "action": "bench",
+        "kind": args.kind,
+        "rateHz": args.rate,
+        "durationMs": args.duration_ms,
+    }
+
+
 def _build_raw_command(args: argparse.Namespace) -> dict:
     try:
         payload = json.loads(args.json)
@@ -166,6 +179,11 @@ def build_parser() -> argparse.ArgumentParser:
     cs.add_argument("--repeat", type=_positive_int, help="repeat count")
     cs.add_argument("--gap-ms", type=_non_negative_int, dest="gap_ms", help="delay between keys in milliseconds")
 
+    bench = subparsers.add_parser("bench", help="run the on-device HID throughput benchmark")
+    bench.add_argument("--kind", default="mouse", choices=["keyboard", "mouse", "consumer", "mixed"])
+    bench.add_argument("--rate", type=_positive_int, default=125, help="reports per second per report type")
+    bench.add_argument("--duration-ms", type=_positive_int, default=2000, dest="duration_ms", help="benchmark duration in milliseconds")
+
     raw = subparsers.add_parser("raw", help="send raw JSON string")
     raw.add_argument("json", help="JSON payload to send (must already include device/type)")
 
@@ -179,6 +197,8 @@ def _build_payload(args: argparse.Namespace) -> dict:
         return _build_mouse_command(args)
     if args.command == "consumer":
         return _build_consumer_command(args)
+    if args.command == "bench":
+        return _build_bench_command(args)
     if args.command == "raw":
         return _build_raw_command(args)
     raise SystemExit(f"unsupported command {args.command}")
@@ -222,6 +242,9 @@ def main(argv: Optional[Iterable[str]] = None) -> int:
     print(f"[client] sent: {serialized}")
 
     listen_for = args.listen_for
+    if args.command == "bench" and 0 <= listen_for < args.duration_ms / 1000.0 + 1.0:
+        # The report only arrives once the benchmark finishes.
+        listen_for = args.duration_ms / 1000.0 + 1.0
     try:
         if listen_for != 0:
             if listen_for < 0:
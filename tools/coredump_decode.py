@@ -0,0 +1,220 @@
+#!/usr/bin/env python3
+"""
+Decode the crash download served by the firmware at /api/coredump.
+
+The download holds a small perf snapshot captured in the panic handler (queue depths,
+heap statistics, watched task stacks, the last trace events per core) followed by the
+raw ESP-IDF core dump image from the coredump partition (see src/crash_snapshot.h):
+
+    curl -o coredump.bin http://<device>/api/coredump
+    python3 tools/coredump_decode.py coredump.bin --core-out core.raw
+    espcoredump.py info_corefile --core-format raw -c core.raw .pio/build/nodemcu-32s/firmware.elf
+
+Clear the stored crash afterwards with `curl -X DELETE http://<device>/api/coredump`.
+"""
+
+from __future__ import annotations
+
+import argparse
+import json
+import os
+import struct
+import sys
+from typing import Iterable, List, Optional
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from trace_to_chrome import EVENT, EVENT_NAMES, Event, event_args  # noqa: E402
+
+CONTAINER_MAGIC = 0x43444348
+SNAPSHOT_MAGIC = 0x50534E43
+CONTAINER_HEADER = struct.Struct("<IHHIII")
+SNAPSHOT_HEADER = struct.Struct("<IHHIIIIBBBB")
+NAME_LENGTH = 16
+CORE_SLOTS = 2
+MAX_QUEUES = 4
+MAX_TASKS = 8
+TRACE_EVENTS_PER_CORE = 32
+QUEUE_SAMPLE = struct.Struct(f"<{NAME_LENGTH}sII")
+TASK_SAMPLE = struct.Struct(f"<{NAME_LENGTH}sIB3x")
+SNAPSHOT_SIZE = 1124
+NOT_RUNNING = 0xFF
+
+# esp_reset_reason_t
+RESET_REASONS = {
+    0: "unknown",
+    1: "power_on",
+    2: "external",
+    3: "software",
+    4: "panic",
+    5: "interrupt_watchdog",
+    6: "task_watchdog",
+    7: "other_watchdog",
+    8: "deep_sleep",
+    9: "brownout",
+    10: "sdio",
+}
+
+
+def _name(raw: bytes) -> str:
+    return raw.split(b"\0", 1)[0].decode("utf-8", errors="replace")
+
+
+def _fnv1a(data: bytes) -> int:
+    value = 2166136261
+    for byte in data:
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def decode_snapshot(raw: bytes) -> dict:
+    if len(raw) != SNAPSHOT_SIZE:
+        raise SystemExit(f"unexpected snapshot size {len(raw)} (expected {SNAPSHOT_SIZE})")
+    (
+        magic,
+        version,
+        size,
+        uptime_ms,
+        free_heap,
+        min_free_heap,
+        task_total,
+        panic_core,
+        queue_count,
+        task_count,
+        _reserved,
+    ) = SNAPSHOT_HEADER.unpack_from(raw)
+    if magic != SNAPSHOT_MAGIC or version != 1 or size != SNAPSHOT_SIZE:
+        raise SystemExit("snapshot header is not recognised")
+    (checksum,) = struct.unpack_from("<I", raw, SNAPSHOT_SIZE - 4)
+    offset = SNAPSHOT_HEADER.size
+
+    current = []
+    for _ in range(CORE_SLOTS):
+        current.append(_name(raw[offset : offset + NAME_LENGTH]))
+        offset += NAME_LENGTH
+
+    queues = []
+    for index in range(MAX_QUEUES):
+        name, waiting, capacity = QUEUE_SAMPLE.unpack_from(raw, offset)
+        offset += QUEUE_SAMPLE.size
+        if index < queue_count:
+            queues.append({"name": _name(name), "waiting": waiting, "capacity": capacity})
+
+    tasks = []
+    for index in range(MAX_TASKS):
+        name, stack_free, running = TASK_SAMPLE.unpack_from(raw, offset)
+        offset += TASK_SAMPLE.size
+        if index < task_count:
+            tasks.append(
+                {
+                    "name": _name(name),
+                    "stackFreeBytes": stack_free,
+                    "runningOnCore": None if running == NOT_RUNNING else running,
+                }
+            )
+
+    trace_counts = struct.unpack_from(f"<{CORE_SLOTS}H", raw, offset)
+    offset += 2 * CORE_SLOTS
+    trace = []
+    for core in range(CORE_SLOTS):
+        for index in range(TRACE_EVENTS_PER_CORE):
+            timestamp, event_type, event_core, arg16, arg32 = EVENT.unpack_from(raw, offset)
+            offset += EVENT.size
+            if index >= trace_counts[core] or event_type == 0:
+                continue
+            event = Event(timestamp, event_type, event_core, arg16, arg32)
+            trace.append(
+                {
+                    "core": core,
+                    "timestampUs": timestamp,
+                    "event": EVENT_NAMES.get(event_type, f"type_{event_type}"),
+                    "args": event_args(event),
+                }
+            )
+
+    return {
+        "checksumOk": checksum == _fnv1a(raw[:-4]),
+        "uptimeMs": uptime_ms,
+        "freeHeap": free_heap,
+        "minFreeHeap": min_free_heap,
+        "taskTotal": task_total,
+        "panicCore": panic_core,
+        "currentTask": current,
+        "queues": queues,
+        "tasks": tasks,
+        "trace": trace,
+    }
+
+
+def decode_container(raw: bytes) -> tuple[dict, Optional[dict], bytes]:
+    if len(raw) < CONTAINER_HEADER.size:
+        raise SystemExit("download is truncated")
+    magic, version, header_size, reset_reason, snapshot_size, coredump_size = CONTAINER_HEADER.unpack_from(raw)
+    if magic != CONTAINER_MAGIC or version != 1:
+        raise SystemExit("not a /api/coredump download (bad magic)")
+    if len(raw) < header_size + snapshot_size + coredump_size:
+        raise SystemExit("download is truncated")
+    offset = header_size
+    snapshot = decode_snapshot(raw[offset : offset + snapshot_size]) if snapshot_size else None
+    offset += snapshot_size
+    core = raw[offset : offset + coredump_size]
+    header = {
+        "resetReason": RESET_REASONS.get(reset_reason, reset_reason),
+        "snapshotBytes": snapshot_size,
+        "coredumpBytes": coredump_size,
+    }
+    return header, snapshot, core
+
+
+def print_report(header: dict, snapshot: Optional[dict]) -> None:
+    print(f"reset reason: {header['resetReason']}")
+    print(f"core dump: {header['coredumpBytes']} bytes")
+    if snapshot is None:
+        print("perf snapshot: none")
+        return
+    if not snapshot["checksumOk"]:
+        print("perf snapshot: CHECKSUM MISMATCH, values below may be corrupt")
+    print(f"uptime at panic: {snapshot['uptimeMs'] / 1000.0:.3f} s (panic on core {snapshot['panicCore']})")
+    print(f"heap: {snapshot['freeHeap']} bytes free, {snapshot['minFreeHeap']} minimum since boot")
+    print(f"tasks: {snapshot['taskTotal']} total; running: " + ", ".join(
+        f"core {core}={name or '-'}" for core, name in enumerate(snapshot["currentTask"])
+    ))
+    for queue in snapshot["queues"]:
+        print(f"  queue {queue['name']:<14} {queue['waiting']}/{queue['capacity']}")
+    for task in snapshot["tasks"]:
+        running = "" if task["runningOnCore"] is None else f"  (running on core {task['runningOnCore']})"
+        print(f"  task  {task['name']:<14} {task['stackFreeBytes']} bytes stack free{running}")
+    if snapshot["trace"]:
+        print("last trace events:")
+        for entry in sorted(snapshot["trace"], key=lambda item: (item["timestampUs"], item["core"])):
+            args = " ".join(f"{key}={value}" for key, value in entry["args"].items())
+            print(f"  {entry['timestampUs']:>12} us  core {entry['core']}  {entry['event']:<18} {args}")
+
+
+def build_parser() -> argparse.ArgumentParser:
+    parser = argparse.ArgumentParser(description="Decode a /api/coredump download.")
+    parser.add_argument("input", help="file saved from /api/coredump")
+    parser.add_argument("--core-out", help="write the raw core dump image here for espcoredump.py")
+    parser.add_argument("--json", action="store_true", help="print the decoded snapshot as JSON")
+    return parser
+
+
+def main(argv: Optional[Iterable[str]] = None) -> int:
+    args = build_parser().parse_args(list(argv) if argv is not None else None)
+    with open(args.input, "rb") as handle:
+        header, snapshot, core = decode_container(handle.read())
+    if args.json:
+        print(json.dumps({**header, "snapshot": snapshot}, indent=2))
+    else:
+        print_report(header, snapshot)
+    if args.core_out:
+        if not core:
+            print("[coredump] no core dump image in download", file=sys.stderr)
+            return 1
+        with open(args.core_out, "wb") as handle:
+            handle.write(core)
+        print(f"[coredump] wrote {len(core)} bytes to {args.core_out}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":  # pragma: no cover
+    sys.exit(main())
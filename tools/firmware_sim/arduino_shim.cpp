@@ -0,0 +1,965 @@
+#include <Arduino.h>
+#include <base64.h>
+#include <esp_timer.h>
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "sim_options.h"
+
+namespace
+{
+  int64_t monotonic_ns()
+  {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+  }
+
+  const int64_t start_ns_ = monotonic_ns();
+
+  // ---- Serial backend ------------------------------------------------------------------
+
+  std::mutex serial_mutex_;
+  std::deque<uint8_t> serial_input_;
+  int serial_in_fd_ = -1;
+  int serial_out_fd_ = -1;
+
+  void serial_reader(int fd)
+  {
+    uint8_t buffer[256];
+    for (;;)
+    {
+      ssize_t got = ::read(fd, buffer, sizeof(buffer));
+      if (got > 0)
+      {
+        std::lock_guard<std::mutex> lock(serial_mutex_);
+        serial_input_.insert(serial_input_.end(), buffer, buffer + got);
+        continue;
+      }
+      if (got < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (fd == STDIN_FILENO)
+      {
+        // stdin closed: keep running so HTTP clients can still use the simulator.
+        return;
+      }
+      // A pty master reads EIO while no client has the slave open; wait for one.
+      pollfd waiter = {fd, POLLIN, 0};
+      poll(&waiter, 1, 200);
+    }
+  }
+
+  void serial_write(const void *data, size_t length)
+  {
+    if (serial_out_fd_ < 0)
+    {
+      return;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (length > 0)
+    {
+      ssize_t sent = ::write(serial_out_fd_, bytes, length);
+      if (sent < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        return;
+      }
+      bytes += sent;
+      length -= static_cast<size_t>(sent);
+    }
+  }
+
+  // ---- Heap model ----------------------------------------------------------------------
+
+  // Heap figures are reported against the ESP32's usable DRAM heap so the numbers read
+  // like the device's, with the host allocator's live bytes as "used".
+  constexpr uint32_t kSimHeapBytes = 300 * 1024;
+  std::atomic<uint32_t> min_free_heap_{kSimHeapBytes};
+
+  uint32_t sim_free_heap()
+  {
+    struct mallinfo2 info = mallinfo2();
+    size_t used = std::min<size_t>(info.uordblks, kSimHeapBytes);
+    uint32_t free_bytes = kSimHeapBytes - static_cast<uint32_t>(used);
+    uint32_t previous = min_free_heap_.load();
+    while (free_bytes < previous && !min_free_heap_.compare_exchange_weak(previous, free_bytes))
+    {
+    }
+    return free_bytes;
+  }
+} // namespace
+
+namespace firmware_sim
+{
+  bool start_serial()
+  {
+    switch (options().serial)
+    {
+    case SerialBackend::None:
+      return true;
+    case SerialBackend::Stdio:
+      serial_in_fd_ = STDIN_FILENO;
+      serial_out_fd_ = STDOUT_FILENO;
+      break;
+    case SerialBackend::Pty:
+    {
+      int master = posix_openpt(O_RDWR | O_NOCTTY);
+      if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+      {
+        perror("firmware_sim: posix_openpt");
+        return false;
+      }
+      termios settings;
+      if (tcgetattr(master, &settings) == 0)
+      {
+        cfmakeraw(&settings);
+        tcsetattr(master, TCSANOW, &settings);
+      }
+      fprintf(stderr, "firmware_sim: serial on %s\n", ptsname(master));
+      serial_in_fd_ = master;
+      serial_out_fd_ = master;
+      break;
+    }
+    }
+    std::thread(serial_reader, serial_in_fd_).detach();
+    return true;
+  }
+} // namespace firmware_sim
+
+// ---- Timing ----------------------------------------------------------------------------
+
+unsigned long millis()
+{
+  return static_cast<unsigned long>((monotonic_ns() - start_ns_) / 1000000);
+}
+
+unsigned long micros()
+{
+  return static_cast<unsigned long>((monotonic_ns() - start_ns_) / 1000);
+}
+
+void delay(uint32_t ms)
+{
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+  timespec duration = {static_cast<time_t>(us / 1000000), static_cast<long>((us % 1000000) * 1000)};
+  nanosleep(&duration, nullptr);
+}
+
+void yield()
+{
+  sched_yield();
+}
+
+int64_t esp_timer_get_time()
+{
+  return (monotonic_ns() - start_ns_) / 1000;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+  switch (code)
+  {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  case ESP_ERR_NVS_NOT_FOUND:
+    return "ESP_ERR_NVS_NOT_FOUND";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+// ---- Serial ----------------------------------------------------------------------------
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  baud_ = baud;
+  started_ = true;
+}
+
+void HardwareSerial::end()
+{
+  started_ = false;
+}
+
+void HardwareSerial::setTimeout(unsigned long)
+{
+}
+
+int HardwareSerial::available()
+{
+  std::lock_guard<std::mutex> lock(serial_mutex_);
+  return started_ ? static_cast<int>(serial_input_.size()) : 0;
+}
+
+int HardwareSerial::read()
+{
+  std::lock_guard<std::mutex> lock(serial_mutex_);
+  if (!started_ || serial_input_.empty())
+  {
+    return -1;
+  }
+  uint8_t value = serial_input_.front();
+  serial_input_.pop_front();
+  return value;
+}
+
+int HardwareSerial::peek()
+{
+  std::lock_guard<std::mutex> lock(serial_mutex_);
+  return (!started_ || serial_input_.empty()) ? -1 : serial_input_.front();
+}
+
+void HardwareSerial::flush()
+{
+}
+
+size_t HardwareSerial::write(uint8_t value)
+{
+  return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length)
+{
+  if (started_ && data)
+  {
+    serial_write(data, length);
+  }
+  return length;
+}
+
+size_t HardwareSerial::write(const char *data, size_t length)
+{
+  return write(reinterpret_cast<const uint8_t *>(data), length);
+}
+
+size_t HardwareSerial::print(const char *value)
+{
+  return value ? write(value, strlen(value)) : 0;
+}
+
+size_t HardwareSerial::print(const String &value)
+{
+  return write(value.c_str(), value.length());
+}
+
+size_t HardwareSerial::print(char value)
+{
+  return write(static_cast<uint8_t>(value));
+}
+
+size_t HardwareSerial::print(int value)
+{
+  return printf("%d", value);
+}
+
+size_t HardwareSerial::print(unsigned int value)
+{
+  return printf("%u", value);
+}
+
+size_t HardwareSerial::print(long value)
+{
+  return printf("%ld", value);
+}
+
+size_t HardwareSerial::print(unsigned long value)
+{
+  return printf("%lu", value);
+}
+
+size_t HardwareSerial::println()
+{
+  return write("\r\n", 2);
+}
+
+size_t HardwareSerial::println(const char *value)
+{
+  return print(value) + println();
+}
+
+size_t HardwareSerial::println(const String &value)
+{
+  return print(value) + println();
+}
+
+size_t HardwareSerial::println(int value)
+{
+  return print(value) + println();
+}
+
+size_t HardwareSerial::println(unsigned long value)
+{
+  return print(value) + println();
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length <= 0)
+  {
+    return 0;
+  }
+  return write(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+}
+
+// ---- ESP -------------------------------------------------------------------------------
+
+EspClass ESP;
+
+uint32_t EspClass::getHeapSize()
+{
+  return kSimHeapBytes;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return sim_free_heap();
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+  sim_free_heap();
+  return min_free_heap_.load();
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+  return sim_free_heap();
+}
+
+uint32_t EspClass::getCpuFreqMHz()
+{
+  return 240;
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+  return 240;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  return static_cast<uint32_t>((monotonic_ns() - start_ns_) * 240 / 1000);
+}
+
+const char *EspClass::getSdkVersion()
+{
+  return "firmware_sim";
+}
+
+void EspClass::restart()
+{
+  fprintf(stderr, "firmware_sim: ESP.restart() requested, exiting\n");
+  exit(0);
+}
+
+// ---- String ----------------------------------------------------------------------------
+
+String::String(const char *value)
+{
+  if (value)
+  {
+    assign(value, strlen(value));
+  }
+}
+
+String::String(const char *value, size_t length)
+{
+  if (value)
+  {
+    assign(value, length);
+  }
+}
+
+String::String(const String &other)
+{
+  if (other.buffer_)
+  {
+    assign(other.buffer_, other.length_);
+  }
+}
+
+String::String(String &&other) noexcept : buffer_(other.buffer_), capacity_(other.capacity_), length_(other.length_)
+{
+  other.buffer_ = nullptr;
+  other.capacity_ = 0;
+  other.length_ = 0;
+}
+
+String::String(char value)
+{
+  assign(&value, 1);
+}
+
+namespace
+{
+  String format_integer(unsigned long long magnitude, bool negative, unsigned char base)
+  {
+    char digits[72];
+    size_t position = sizeof(digits);
+    digits[--position] = '\0';
+    if (base < 2 || base > 36)
+    {
+      base = 10;
+    }
+    do
+    {
+      unsigned digit = static_cast<unsigned>(magnitude % base);
+      digits[--position] = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+      magnitude /= base;
+    } while (magnitude > 0);
+    if (negative)
+    {
+      digits[--position] = '-';
+    }
+    return String(digits + position);
+  }
+
+  unsigned long long magnitude_of(long long value)
+  {
+    return value < 0 ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+  }
+} // namespace
+
+String::String(int value, unsigned char base) : String(static_cast<long long>(value), base)
+{
+}
+
+String::String(unsigned int value, unsigned char base) : String(static_cast<unsigned long long>(value), base)
+{
+}
+
+String::String(long value, unsigned char base) : String(static_cast<long long>(value), base)
+{
+}
+
+String::String(unsigned long value, unsigned char base) : String(static_cast<unsigned long long>(value), base)
+{
+}
+
+String::String(long long value, unsigned char base)
+{
+  *this = format_integer(magnitude_of(value), value < 0 && base == 10, base);
+}
+
+String::String(unsigned long long value, unsigned char base)
+{
+  *this = format_integer(value, false, base);
+}
+
+String::String(double value, unsigned int decimals)
+{
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", static_cast<int>(decimals), value);
+  assign(buffer, strlen(buffer));
+}
+
+String::~String()
+{
+  release();
+}
+
+String &String::operator=(const String &other)
+{
+  if (this == &other)
+  {
+    return *this;
+  }
+  if (other.buffer_)
+  {
+    assign(other.buffer_, other.length_);
+  }
+  else
+  {
+    release();
+  }
+  return *this;
+}
+
+String &String::operator=(String &&other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    buffer_ = other.buffer_;
+    capacity_ = other.capacity_;
+    length_ = other.length_;
+    other.buffer_ = nullptr;
+    other.capacity_ = 0;
+    other.length_ = 0;
+  }
+  return *this;
+}
+
+String &String::operator=(const char *value)
+{
+  // Assigning null invalidates the string, which ArduinoJson relies on to clear it.
+  if (value)
+  {
+    assign(value, strlen(value));
+  }
+  else
+  {
+    release();
+  }
+  return *this;
+}
+
+bool String::ensure_capacity(size_t capacity)
+{
+  if (buffer_ && capacity_ >= capacity)
+  {
+    return true;
+  }
+  char *grown = static_cast<char *>(realloc(buffer_, capacity + 1));
+  if (!grown)
+  {
+    return false;
+  }
+  if (!buffer_)
+  {
+    grown[0] = '\0';
+  }
+  buffer_ = grown;
+  capacity_ = capacity;
+  return true;
+}
+
+void String::assign(const char *value, size_t length)
+{
+  if (!ensure_capacity(length))
+  {
+    release();
+    return;
+  }
+  memmove(buffer_, value, length);
+  buffer_[length] = '\0';
+  length_ = length;
+}
+
+void String::release()
+{
+  free(buffer_);
+  buffer_ = nullptr;
+  capacity_ = 0;
+  length_ = 0;
+}
+
+bool String::reserve(size_t capacity)
+{
+  return ensure_capacity(std::max(capacity, length_));
+}
+
+bool String::concat(const char *value, size_t length)
+{
+  if (!value)
+  {
+    return false;
+  }
+  if (length == 0)
+  {
+    return ensure_capacity(length_);
+  }
+  size_t needed = length_ + length;
+  if (!buffer_ || capacity_ < needed)
+  {
+    // Grow geometrically so repeated += stays linear, like the ESP32 core.
+    size_t target = std::max(needed, capacity_ + capacity_ / 2);
+    if (!ensure_capacity(target))
+    {
+      return false;
+    }
+  }
+  memcpy(buffer_ + length_, value, length);
+  length_ = needed;
+  buffer_[length_] = '\0';
+  return true;
+}
+
+bool String::concat(const String &value)
+{
+  if (&value == this)
+  {
+    String copy(value);
+    return concat(copy.c_str(), copy.length());
+  }
+  return concat(value.c_str(), value.length());
+}
+
+bool String::concat(const char *value)
+{
+  return value ? concat(value, strlen(value)) : false;
+}
+
+bool String::concat(char value)
+{
+  return concat(&value, 1);
+}
+
+bool String::concat(unsigned char value)
+{
+  return concat(String(static_cast<unsigned int>(value)));
+}
+
+bool String::concat(int value)
+{
+  return concat(String(value));
+}
+
+bool String::concat(unsigned int value)
+{
+  return concat(String(value));
+}
+
+bool String::concat(long value)
+{
+  return concat(String(value));
+}
+
+bool String::concat(unsigned long value)
+{
+  return concat(String(value));
+}
+
+bool String::equals(const String &other) const
+{
+  return length_ == other.length_ && memcmp(c_str(), other.c_str(), length_) == 0;
+}
+
+bool String::equals(const char *other) const
+{
+  if (!other)
+  {
+    return length_ == 0;
+  }
+  return strcmp(c_str(), other) == 0;
+}
+
+bool String::equalsIgnoreCase(const String &other) const
+{
+  return length_ == other.length_ && strncasecmp(c_str(), other.c_str(), length_) == 0;
+}
+
+bool String::operator<(const String &other) const
+{
+  return strcmp(c_str(), other.c_str()) < 0;
+}
+
+bool String::startsWith(const String &prefix) const
+{
+  return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const
+{
+  if (offset > length_ || prefix.length_ > length_ - offset)
+  {
+    return false;
+  }
+  return strncmp(c_str() + offset, prefix.c_str(), prefix.length_) == 0;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+  if (suffix.length_ > length_)
+  {
+    return false;
+  }
+  return strcmp(c_str() + length_ - suffix.length_, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const
+{
+  return (*this)[index];
+}
+
+void String::setCharAt(unsigned int index, char value)
+{
+  if (index < length_)
+  {
+    buffer_[index] = value;
+  }
+}
+
+char String::operator[](unsigned int index) const
+{
+  return index < length_ ? buffer_[index] : '\0';
+}
+
+char &String::operator[](unsigned int index)
+{
+  static char dummy;
+  if (index >= length_)
+  {
+    dummy = '\0';
+    return dummy;
+  }
+  return buffer_[index];
+}
+
+int String::indexOf(char value, unsigned int from) const
+{
+  if (from >= length_)
+  {
+    return -1;
+  }
+  const char *found = strchr(c_str() + from, value);
+  return found ? static_cast<int>(found - c_str()) : -1;
+}
+
+int String::indexOf(const String &value, unsigned int from) const
+{
+  if (from >= length_)
+  {
+    return -1;
+  }
+  const char *found = strstr(c_str() + from, value.c_str());
+  return found ? static_cast<int>(found - c_str()) : -1;
+}
+
+int String::lastIndexOf(char value) const
+{
+  const char *found = strrchr(c_str(), value);
+  return found ? static_cast<int>(found - c_str()) : -1;
+}
+
+int String::lastIndexOf(const String &value) const
+{
+  if (value.length_ == 0 || value.length_ > length_)
+  {
+    return -1;
+  }
+  for (size_t index = length_ - value.length_ + 1; index-- > 0;)
+  {
+    if (strncmp(c_str() + index, value.c_str(), value.length_) == 0)
+    {
+      return static_cast<int>(index);
+    }
+  }
+  return -1;
+}
+
+String String::substring(unsigned int begin) const
+{
+  return substring(begin, static_cast<unsigned int>(length_));
+}
+
+String String::substring(unsigned int begin, unsigned int end) const
+{
+  if (begin > end)
+  {
+    std::swap(begin, end);
+  }
+  if (begin >= length_)
+  {
+    return String();
+  }
+  end = std::min<unsigned int>(end, static_cast<unsigned int>(length_));
+  return String(c_str() + begin, end - begin);
+}
+
+void String::replace(char find, char replacement)
+{
+  for (size_t index = 0; index < length_; ++index)
+  {
+    if (buffer_[index] == find)
+    {
+      buffer_[index] = replacement;
+    }
+  }
+}
+
+void String::replace(const String &find, const String &replacement)
+{
+  if (find.length_ == 0 || length_ == 0)
+  {
+    return;
+  }
+  String result;
+  size_t index = 0;
+  while (index < length_)
+  {
+    const char *found = strstr(c_str() + index, find.c_str());
+    if (!found)
+    {
+      break;
+    }
+    size_t position = static_cast<size_t>(found - c_str());
+    result.concat(c_str() + index, position - index);
+    result.concat(replacement);
+    index = position + find.length_;
+  }
+  result.concat(c_str() + index, length_ - index);
+  *this = std::move(result);
+}
+
+void String::remove(unsigned int index)
+{
+  remove(index, static_cast<unsigned int>(length_));
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index >= length_)
+  {
+    return;
+  }
+  count = std::min<unsigned int>(count, static_cast<unsigned int>(length_ - index));
+  memmove(buffer_ + index, buffer_ + index + count, length_ - index - count + 1);
+  length_ -= count;
+}
+
+void String::toLowerCase()
+{
+  for (size_t index = 0; index < length_; ++index)
+  {
+    buffer_[index] = static_cast<char>(tolower(static_cast<unsigned char>(buffer_[index])));
+  }
+}
+
+void String::toUpperCase()
+{
+  for (size_t index = 0; index < length_; ++index)
+  {
+    buffer_[index] = static_cast<char>(toupper(static_cast<unsigned char>(buffer_[index])));
+  }
+}
+
+void String::trim()
+{
+  if (length_ == 0)
+  {
+    return;
+  }
+  size_t begin = 0;
+  while (begin < length_ && isspace(static_cast<unsigned char>(buffer_[begin])))
+  {
+    ++begin;
+  }
+  size_t end = length_;
+  while (end > begin && isspace(static_cast<unsigned char>(buffer_[end - 1])))
+  {
+    --end;
+  }
+  length_ = end - begin;
+  memmove(buffer_, buffer_ + begin, length_);
+  buffer_[length_] = '\0';
+}
+
+long String::toInt() const
+{
+  return atol(c_str());
+}
+
+float String::toFloat() const
+{
+  return static_cast<float>(atof(c_str()));
+}
+
+double String::toDouble() const
+{
+  return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, const char *rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const char *lhs, const String &rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+String operator+(const String &lhs, char rhs)
+{
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+
+// ---- base64 ----------------------------------------------------------------------------
+
+String base64::encode(const uint8_t *data, size_t length)
+{
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  String encoded;
+  encoded.reserve((length + 2) / 3 * 4);
+  for (size_t index = 0; index < length; index += 3)
+  {
+    uint32_t chunk = static_cast<uint32_t>(data[index]) << 16;
+    if (index + 1 < length)
+    {
+      chunk |= static_cast<uint32_t>(data[index + 1]) << 8;
+    }
+    if (index + 2 < length)
+    {
+      chunk |= data[index + 2];
+    }
+    char quad[4] = {kAlphabet[(chunk >> 18) & 0x3F],
+                    kAlphabet[(chunk >> 12) & 0x3F],
+                    index + 1 < length ? kAlphabet[(chunk >> 6) & 0x3F] : '=',
+                    index + 2 < length ? kAlphabet[chunk & 0x3F] : '='};
+    encoded.concat(quad, 4);
+  }
+  return encoded;
+}
+
+String base64::encode(const String &text)
+{
+  return encode(reinterpret_cast<const uint8_t *>(text.c_str()), text.length());
+}
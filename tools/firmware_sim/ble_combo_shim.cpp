@@ -0,0 +1,209 @@
+#include <BleCombo.h>
+
+#include <atomic>
+#include <cstdio>
+#include <time.h>
+
+#include "consumer_control.h"
+#include "gamepad.h"
+#include "sim_options.h"
+
+// Reports are counted and, with --ble-report-us, each one blocks for that long, roughly
+// what a notification costs when the BLE stack is keeping up with the connection interval.
+namespace
+{
+  std::atomic<uint64_t> keyboard_reports_{0};
+  std::atomic<uint64_t> consumer_reports_{0};
+  std::atomic<uint64_t> mouse_reports_{0};
+  std::atomic<uint64_t> gamepad_reports_{0};
+
+  void send_report(std::atomic<uint64_t> &counter, const char *kind, unsigned a, unsigned b)
+  {
+    counter.fetch_add(1, std::memory_order_relaxed);
+    const firmware_sim::Options &options = firmware_sim::options();
+    if (options.ble_log)
+    {
+      fprintf(stderr, "hid %s %u %u\n", kind, a, b);
+    }
+    if (options.ble_report_us > 0)
+    {
+      timespec duration = {static_cast<time_t>(options.ble_report_us / 1000000),
+                           static_cast<long>((options.ble_report_us % 1000000) * 1000)};
+      nanosleep(&duration, nullptr);
+    }
+  }
+} // namespace
+
+namespace firmware_sim
+{
+  HidCounters hid_counters()
+  {
+    return HidCounters{keyboard_reports_.load(), consumer_reports_.load(), mouse_reports_.load(),
+                       gamepad_reports_.load()};
+  }
+} // namespace firmware_sim
+
+BleComboKeyboard Keyboard;
+BleComboMouse Mouse;
+
+void BleComboKeyboard::begin()
+{
+}
+
+void BleComboKeyboard::end()
+{
+}
+
+bool BleComboKeyboard::isConnected()
+{
+  return firmware_sim::options().ble_connected;
+}
+
+size_t BleComboKeyboard::press(uint8_t key)
+{
+  send_report(keyboard_reports_, "press", key, 0);
+  return 1;
+}
+
+size_t BleComboKeyboard::press(const MediaKeyReport key)
+{
+  send_report(consumer_reports_, "consumer_press", key[0], key[1]);
+  return 1;
+}
+
+size_t BleComboKeyboard::release(uint8_t key)
+{
+  send_report(keyboard_reports_, "release", key, 0);
+  return 1;
+}
+
+size_t BleComboKeyboard::release(const MediaKeyReport key)
+{
+  send_report(consumer_reports_, "consumer_release", key[0], key[1]);
+  return 1;
+}
+
+size_t BleComboKeyboard::write(uint8_t key)
+{
+  return press(key) + release(key) - 1;
+}
+
+size_t BleComboKeyboard::write(const MediaKeyReport key)
+{
+  return press(key) + release(key) - 1;
+}
+
+size_t BleComboKeyboard::write(const uint8_t *buffer, size_t size)
+{
+  size_t written = 0;
+  for (size_t index = 0; index < size; ++index)
+  {
+    written += write(buffer[index]);
+  }
+  return written;
+}
+
+size_t BleComboKeyboard::print(const char *text)
+{
+  size_t written = 0;
+  for (; text && *text; ++text)
+  {
+    written += write(static_cast<uint8_t>(*text));
+  }
+  return written;
+}
+
+void BleComboKeyboard::releaseAll()
+{
+  send_report(keyboard_reports_, "release_all", 0, 0);
+}
+
+bool BleComboKeyboard::addCollection(const uint8_t *, size_t, const uint8_t *reportIds, size_t reportIdCount)
+{
+  if (extra_report_count_ + reportIdCount > kMaxExtraInputReports)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < reportIdCount; ++i)
+  {
+    extra_report_ids_[extra_report_count_++] = reportIds[i];
+  }
+  return true;
+}
+
+bool BleComboKeyboard::hasInputReport(uint8_t reportId) const
+{
+  for (size_t i = 0; i < extra_report_count_; ++i)
+  {
+    if (extra_report_ids_[i] == reportId)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BleComboKeyboard::sendInputReport(uint8_t reportId, const uint8_t *report, size_t length)
+{
+  if (!isConnected() || !hasInputReport(reportId))
+  {
+    return false;
+  }
+  if (reportId == gamepad::kReportId && length == gamepad::kReportBytes)
+  {
+    // Buttons and the left stick are enough to follow a trace in the log.
+    send_report(gamepad_reports_, "gamepad", report[0] | (report[1] << 8) | (report[2] << 16) | (report[3] << 24),
+                static_cast<unsigned>(report[4] | (report[5] << 8)));
+    return true;
+  }
+  if (reportId == consumer_control::kConsumerReportId && length == consumer_control::kConsumerReportBytes)
+  {
+    send_report(consumer_reports_, "consumer_usage", report[0] | (report[1] << 8), 0);
+    return true;
+  }
+  if (reportId == consumer_control::kSystemReportId && length == consumer_control::kSystemReportBytes)
+  {
+    send_report(consumer_reports_, "system_control", report[0], 0);
+    return true;
+  }
+  return false;
+}
+
+void BleComboMouse::begin()
+{
+}
+
+void BleComboMouse::end()
+{
+}
+
+bool BleComboMouse::isConnected()
+{
+  return firmware_sim::options().ble_connected;
+}
+
+void BleComboMouse::click(uint8_t buttons)
+{
+  press(buttons);
+  release(buttons);
+}
+
+void BleComboMouse::move(signed char x, signed char y, signed char, signed char)
+{
+  send_report(mouse_reports_, "move", static_cast<unsigned>(x & 0xFF), static_cast<unsigned>(y & 0xFF));
+}
+
+void BleComboMouse::press(uint8_t buttons)
+{
+  send_report(mouse_reports_, "mouse_press", buttons, 0);
+}
+
+void BleComboMouse::release(uint8_t buttons)
+{
+  send_report(mouse_reports_, "mouse_release", buttons, 0);
+}
+
+bool BleComboMouse::isPressed(uint8_t)
+{
+  return false;
+}
@@ -0,0 +1,44 @@
+#include "crash_snapshot.h"
+
+// Host stand-in for src/crash_snapshot.cpp: a simulated process has no RTC memory or
+// coredump partition, so there is never anything to report and /api/coredump returns 404.
+namespace crash_snapshot
+{
+  void begin()
+  {
+  }
+
+  void watch_queue(const char *name, const QueueHandle_t *queue, uint32_t capacity)
+  {
+    (void)name;
+    (void)queue;
+    (void)capacity;
+  }
+
+  void watch_task(const TaskHandle_t *task)
+  {
+    (void)task;
+  }
+
+  bool has_snapshot()
+  {
+    return false;
+  }
+
+  bool has_coredump()
+  {
+    return false;
+  }
+
+  size_t write_container(bool (*write)(void *context, const uint8_t *data, size_t length), void *context)
+  {
+    (void)write;
+    (void)context;
+    return 0;
+  }
+
+  bool erase()
+  {
+    return true;
+  }
+} // namespace crash_snapshot
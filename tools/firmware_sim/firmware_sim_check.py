@@ -0,0 +1,337 @@
+"""End-to-end checks against the firmware simulator over its real HTTP and WebSocket API.
+Each scenario starts a fresh firmware_sim (path in argv[1]) in WebSocket transport mode.
+The WebSocket client here is a minimal one on a plain socket, so the check needs nothing
+beyond the Python standard library."""
+
+import base64
+import http.client
+import json
+import os
+import queue
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+failures = 0
+
+
+def expect(condition, what):
+    global failures
+    if not condition:
+        print(f"FAIL {what}", file=sys.stderr)
+        failures += 1
+
+
+def free_port():
+    with socket.socket() as probe:
+        probe.bind(("127.0.0.1", 0))
+        return probe.getsockname()[1]
+
+
+class Simulator:
+    def __init__(self, binary):
+        self.port = free_port()
+        self.nvs = tempfile.NamedTemporaryFile(suffix=".nvs", delete=False)
+        self.nvs.close()
+        self.process = subprocess.Popen(
+            [binary, "--serial", "none", "--port", str(self.port), "--nvs", self.nvs.name],
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+        deadline = time.monotonic() + 10
+        while time.monotonic() < deadline:
+            try:
+                self.request("GET", "/api/transport")
+                break
+            except OSError:
+                time.sleep(0.1)
+        status, _ = self.request("POST", "/api/transport", json.dumps({"mode": "websocket"}))
+        expect(status == 200, "switch to WebSocket transport")
+
+    def request(self, method, path, body=None, timeout=30):
+        connection = http.client.HTTPConnection("127.0.0.1", self.port, timeout=timeout)
+        try:
+            connection.request(method, path, body=body)
+            response = connection.getresponse()
+            return response.status, response.read().decode()
+        finally:
+            connection.close()
+
+    def close(self):
+        self.process.terminate()
+        self.process.wait(timeout=10)
+        os.unlink(self.nvs.name)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class WebSocket:
+    """Text frames in and out; pings are answered from the reader thread, as any client
+    library does."""
+
+    def __init__(self, port, path="/ws"):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=5)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(
+            (
+                f"GET {path} HTTP/1.1\r\nHost: 127.0.0.1:{port}\r\nUpgrade: websocket\r\n"
+                f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n"
+            ).encode()
+        )
+        head = b""
+        while b"\r\n\r\n" not in head:
+            chunk = self.sock.recv(1)
+            if not chunk:
+                raise OSError("handshake closed")
+            head += chunk
+        if b" 101 " not in head.split(b"\r\n", 1)[0]:
+            raise OSError("handshake refused")
+        self.sock.settimeout(None)
+        self.messages = queue.Queue()
+        self.closed = threading.Event()
+        self.send_lock = threading.Lock()
+        threading.Thread(target=self._read, daemon=True).start()
+
+    def _exact(self, count):
+        data = b""
+        while len(data) < count:
+            chunk = self.sock.recv(count - len(data))
+            if not chunk:
+                raise OSError("closed")
+            data += chunk
+        return data
+
+    def _send_frame(self, opcode, payload):
+        mask = os.urandom(4)
+        header = bytes([0x80 | opcode])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        else:
+            header += bytes([0x80 | 126]) + struct.pack(">H", len(payload))
+        masked = bytes(byte ^ mask[index % 4] for index, byte in enumerate(payload))
+        with self.send_lock:
+            self.sock.sendall(header + mask + masked)
+
+    def _read(self):
+        try:
+            while True:
+                first, second = self._exact(2)
+                length = second & 0x7F
+                if length == 126:
+                    length = struct.unpack(">H", self._exact(2))[0]
+                elif length == 127:
+                    length = struct.unpack(">Q", self._exact(8))[0]
+                payload = self._exact(length)
+                opcode = first & 0x0F
+                if opcode == 0x9:
+                    self._send_frame(0xA, payload)
+                elif opcode == 0x8:
+                    break
+                elif opcode == 0x1:
+                    self.messages.put(payload.decode())
+        except OSError:
+            pass
+        self.closed.set()
+
+    def send(self, text):
+        self._send_frame(0x1, text.encode())
+
+    def receive(self, timeout=5):
+        try:
+            return self.messages.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def close(self):
+        self.sock.close()
+
+
+def request_trace(client, clear=False):
+    """Sequence numbers of the chunk events and the final reply of one trace dump."""
+    client.send(json.dumps({"device": "system", "action": "trace", "clear": clear}))
+    chunks = []
+    while True:
+        line = client.receive()
+        if line is None:
+            return chunks, None
+        message = json.loads(line)
+        if message.get("event") == "trace":
+            chunks.append(message["seq"])
+        elif message.get("action") == "trace":
+            return chunks, message
+
+
+def check_trace_dump(binary):
+    # The dump is a burst of chunk events; every one must reach the client.
+    with Simulator(binary) as sim:
+        batch = "".join(json.dumps({"device": "system", "action": "echo"}) + "\n" for _ in range(100))
+        sim.request("POST", "/api/hid", batch)
+        client = WebSocket(sim.port)
+        chunks, reply = request_trace(client, clear=True)
+        expect(reply is not None, "trace reply arrives")
+        expect(reply is not None and reply["chunks"] > 8, "the dump outnumbers the event queue")
+        expect(reply is not None and chunks == list(range(reply["chunks"])), "every trace chunk arrives in order")
+        # Only the few events since the clear are left, not the old ring positions. Chunk
+        # sends still queued at the clear add a chunk or two, depending on timing.
+        full = reply["chunks"] if reply is not None else 0
+        chunks, reply = request_trace(client)
+        expect(reply is not None and reply["chunks"] < full // 2, "a dump after clear holds only new events")
+        client.close()
+
+
+def reply_to(client, action=None):
+    """The next reply for `action` (any reply when None), skipping events and other
+    replies; None on timeout."""
+    while True:
+        line = client.receive()
+        if line is None:
+            return None
+        message = json.loads(line)
+        if "event" not in message and (action is None or message.get("action") == action):
+            return message
+
+
+def check_gamepad_reports(binary):
+    # Gamepad reports go through the firmware's hooks in src/hid_collections.cpp and the
+    # collection they register on the combo device, not through a simulator stand-in.
+    with Simulator(binary) as sim:
+        client = WebSocket(sim.port)
+        client.send(json.dumps({"device": "gamepad", "action": "stats"}))
+        stats = reply_to(client, "stats")
+        expect(stats is not None and stats["supported"], "the combo device carries the gamepad collection")
+        client.send(json.dumps({"device": "gamepad", "action": "press", "button": 1}))
+        reply = reply_to(client)
+        expect(reply is not None and reply.get("status") == "ok", "gamepad press is accepted")
+        deadline = time.monotonic() + 5
+        sent = 0
+        while time.monotonic() < deadline and sent == 0:
+            client.send(json.dumps({"device": "gamepad", "action": "stats"}))
+            stats = reply_to(client, "stats")
+            sent = stats["sent"] if stats else 0
+            time.sleep(0.05)
+        expect(sent > 0, "the gamepad report reaches the combo device")
+        client.close()
+
+
+def check_consumer_reports(binary):
+    # Usages outside BleCombo's media-key bitmap need the consumer and system-control
+    # collections that src/hid_collections.cpp registers; a stock combo device rejects them.
+    with Simulator(binary) as sim:
+        client = WebSocket(sim.port)
+        for key in ("BRIGHTNESS_UP", "SLEEP", "VOLUME_UP"):
+            client.send(json.dumps({"device": "consumer", "key": key}))
+            reply = reply_to(client) or {}
+            expect(reply.get("status") == "ok", f"consumer {key} is sent ({reply.get('message', 'no reply')})")
+        client.close()
+
+
+def stalled_post(port, path, body, length):
+    """Everything the server sends to a POST that stops after `body` out of `length` bytes,
+    up to the server closing the connection; None when it has not closed it within 30 s."""
+    with socket.create_connection(("127.0.0.1", port), timeout=30) as sock:
+        sock.sendall(
+            (f"POST {path} HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: {length}\r\n\r\n").encode() + body
+        )
+        response = b""
+        try:
+            while True:
+                chunk = sock.recv(4096)
+                if not chunk:
+                    return response.decode()
+                response += chunk
+        except socket.timeout:
+            return None
+
+
+def check_stalled_text_upload(binary):
+    # A client that stops mid-body is cut off and the server goes back to serving others.
+    with Simulator(binary) as sim:
+        started = time.monotonic()
+        response = stalled_post(sim.port, "/api/text?charDelayMs=0", b"abc", 1000)
+        expect(response is not None and response.startswith("HTTP/1.1 408 "), "a stalled text upload gets 408 and is closed")
+        expect(time.monotonic() - started < 20, "the stall limit cuts the upload off")
+        code, _ = sim.request("GET", "/api/text", timeout=5)
+        expect(code == 200, "httpd serves other requests after the stall")
+
+
+def check_stalled_batch(binary):
+    # Same for a command batch: the commands that arrived run, then the batch is cut off.
+    with Simulator(binary) as sim:
+        line = json.dumps({"device": "system", "action": "echo"}).encode() + b"\n"
+        response = stalled_post(sim.port, "/api/hid", line, 1000)
+        expect(response is not None and '"action":"echo"' in response, "a stalled batch runs the lines it got")
+        expect(response is not None and '"status":"stalled","commands":1' in response, "a stalled batch ends and is closed")
+        code, _ = sim.request("GET", "/api/text", timeout=5)
+        expect(code == 200, "httpd serves other requests after the stalled batch")
+
+
+def check_ws_survives_text_upload(binary):
+    # The upload blocks httpd past the ping interval plus the pong timeout. The client's pong
+    # waits unread in its socket meanwhile, which must not count as a dead client.
+    with Simulator(binary) as sim:
+        client = WebSocket(sim.port)
+        started = time.monotonic()
+        status, _ = sim.request("POST", "/api/text?charDelayMs=20", "x" * 2600, timeout=60)
+        expect(status == 200, "the long text upload completes")
+        expect(time.monotonic() - started > 9, "the upload held httpd past the pong deadline")
+        alive = not client.closed.wait(0.5)
+        expect(alive, "the /ws client outlives the upload")
+        if alive:
+            client.send(json.dumps({"device": "system", "action": "websocket"}))
+            stats = reply_to(client, "websocket")
+            expect(stats is not None and stats["closed"]["pongTimeout"] == 0, "no pong timeout during the upload")
+        client.close()
+
+
+def check_network_profile(binary):
+    # Both profiles can be selected and back, though the radio keeps modem sleep under both.
+    with Simulator(binary) as sim:
+        for profile in ("low_latency", "power_save"):
+            status, body = sim.request("POST", "/api/transport", json.dumps({"mode": "websocket", "profile": profile}))
+            expect(status == 200, f"{profile} is applied")
+            status, body = sim.request("GET", "/api/transport")
+            expect(status == 200 and json.loads(body).get("profile") == profile, f"{profile} is reported")
+            expect(json.loads(body).get("mode") == "websocket", f"switching to {profile} keeps the transport")
+
+
+def check_stack_report(binary):
+    # Both stack replies must reach a /ws client; one that outgrows a transport message is dropped.
+    with Simulator(binary) as sim:
+        client = WebSocket(sim.port)
+        for action in ("stack_report", "stack_stress"):
+            client.send(json.dumps({"device": "system", "action": action}))
+            reply = reply_to(client, action)
+            expect(reply is not None and reply.get("status") == "ok", f"{action} reply arrives")
+            expect(reply is not None and len(reply.get("tasks", {})) > 0, f"{action} lists the watched tasks")
+        client.close()
+
+
+def main():
+    binary = sys.argv[1]
+    checks = (
+        check_trace_dump,
+        check_stack_report,
+        check_gamepad_reports,
+        check_consumer_reports,
+        check_stalled_text_upload,
+        check_stalled_batch,
+        check_ws_survives_text_upload,
+        check_network_profile,
+    )
+    for check in checks:
+        check(binary)
+    if failures == 0:
+        print("firmware_sim: all checks passed")
+    return 0 if failures == 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
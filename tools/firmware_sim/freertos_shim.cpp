@@ -0,0 +1,577 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/stream_buffer.h>
+#include <freertos/task.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimTask
+{
+  std::string name;
+  TaskFunction_t code = nullptr;
+  void *parameters = nullptr;
+  uint32_t stack_depth = 0;
+  BaseType_t core_id = 0;
+  pthread_t thread = {};
+  uint8_t *host_stack = nullptr;
+  size_t host_stack_bytes = 0;
+  bool adopted = false;
+};
+
+struct SimQueue
+{
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length = 0;
+  size_t item_size = 0;
+  // Mutex semantics for xSemaphoreCreateMutex: a one-slot queue that starts full.
+  bool is_semaphore = false;
+};
+
+struct SimStreamBuffer
+{
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<uint8_t> bytes;
+  size_t size = 0;
+  size_t trigger_level = 1;
+};
+
+namespace
+{
+  // Host frames are larger than Xtensa ones; give each task this many times its
+  // configured stack (and at least kMinHostStack) so it does not overflow on the host.
+  constexpr size_t kHostStackScale = 4;
+  constexpr size_t kMinHostStack = 256 * 1024;
+  constexpr uint8_t kStackPaint = 0xA5;
+
+  std::mutex registry_mutex_;
+  std::vector<SimTask *> tasks_;
+  thread_local SimTask *current_task_ = nullptr;
+
+  void register_task(SimTask *task)
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    tasks_.push_back(task);
+  }
+
+  void *task_entry(void *arg)
+  {
+    SimTask *task = static_cast<SimTask *>(arg);
+    current_task_ = task;
+    pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+    task->code(task->parameters);
+    // FreeRTOS tasks must not return; treat it like vTaskDelete(nullptr).
+    return nullptr;
+  }
+
+  TaskHandle_t create_task(TaskFunction_t code,
+                           const char *name,
+                           uint32_t stack_depth,
+                           void *parameters,
+                           BaseType_t core_id)
+  {
+    SimTask *task = new SimTask();
+    task->name = name ? name : "";
+    task->code = code;
+    task->parameters = parameters;
+    task->stack_depth = stack_depth;
+    task->core_id = (core_id == tskNO_AFFINITY) ? 0 : core_id;
+    task->host_stack_bytes = std::max(kMinHostStack, static_cast<size_t>(stack_depth) * kHostStackScale);
+    long page = sysconf(_SC_PAGESIZE);
+    task->host_stack_bytes = (task->host_stack_bytes + page - 1) / page * page;
+    void *stack = mmap(nullptr, task->host_stack_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED)
+    {
+      delete task;
+      return nullptr;
+    }
+    task->host_stack = static_cast<uint8_t *>(stack);
+    memset(task->host_stack, kStackPaint, task->host_stack_bytes);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->host_stack, task->host_stack_bytes);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    register_task(task);
+    if (pthread_create(&task->thread, &attr, task_entry, task) != 0)
+    {
+      pthread_attr_destroy(&attr);
+      fprintf(stderr, "firmware_sim: failed to start task %s\n", task->name.c_str());
+      return nullptr;
+    }
+    pthread_attr_destroy(&attr);
+    return task;
+  }
+
+  // Threads the shim did not create (main, httpd's accept thread) get a handle the first
+  // time they ask for one, without stack accounting.
+  SimTask *adopt_current_thread()
+  {
+    SimTask *task = new SimTask();
+    char name[16] = {};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    task->name = name;
+    task->thread = pthread_self();
+    task->adopted = true;
+    register_task(task);
+    current_task_ = task;
+    return task;
+  }
+
+  bool wait_until(std::unique_lock<std::mutex> &lock,
+                  std::condition_variable &condition,
+                  TickType_t ticks,
+                  const std::function<bool()> &ready)
+  {
+    if (ticks == portMAX_DELAY)
+    {
+      condition.wait(lock, ready);
+      return true;
+    }
+    return condition.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+  }
+
+  BaseType_t queue_send(QueueHandle_t queue, const void *item, TickType_t ticks, bool to_front)
+  {
+    if (!queue)
+    {
+      return pdFAIL;
+    }
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait_until(lock, queue->not_full, ticks, [queue]() { return queue->items.size() < queue->length; }))
+    {
+      return pdFAIL;
+    }
+    std::vector<uint8_t> copy(queue->item_size);
+    if (queue->item_size > 0 && item)
+    {
+      memcpy(copy.data(), item, queue->item_size);
+    }
+    if (to_front)
+    {
+      queue->items.push_front(std::move(copy));
+    }
+    else
+    {
+      queue->items.push_back(std::move(copy));
+    }
+    lock.unlock();
+    queue->not_empty.notify_one();
+    return pdPASS;
+  }
+
+  QueueHandle_t create_queue(UBaseType_t length, UBaseType_t item_size, StaticQueue_t *buffer)
+  {
+    SimQueue *queue = new SimQueue();
+    queue->length = length;
+    queue->item_size = item_size;
+    if (buffer)
+    {
+      buffer->host = queue;
+    }
+    return queue;
+  }
+} // namespace
+
+BaseType_t xPortGetCoreID()
+{
+  SimTask *task = xTaskGetCurrentTaskHandle();
+  return task ? task->core_id : 0;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t code,
+                               const char *name,
+                               uint32_t stack_depth,
+                               void *parameters,
+                               UBaseType_t,
+                               StackType_t *,
+                               StaticTask_t *task_buffer)
+{
+  TaskHandle_t task = create_task(code, name, stack_depth, parameters, tskNO_AFFINITY);
+  if (task && task_buffer)
+  {
+    task_buffer->host = task;
+  }
+  return task;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t code,
+                                           const char *name,
+                                           uint32_t stack_depth,
+                                           void *parameters,
+                                           UBaseType_t,
+                                           StackType_t *,
+                                           StaticTask_t *task_buffer,
+                                           BaseType_t core_id)
+{
+  TaskHandle_t task = create_task(code, name, stack_depth, parameters, core_id);
+  if (task && task_buffer)
+  {
+    task_buffer->host = task;
+  }
+  return task;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code,
+                                   const char *name,
+                                   uint32_t stack_depth,
+                                   void *parameters,
+                                   UBaseType_t,
+                                   TaskHandle_t *created_task,
+                                   BaseType_t core_id)
+{
+  TaskHandle_t task = create_task(code, name, stack_depth, parameters, core_id);
+  if (created_task)
+  {
+    *created_task = task;
+  }
+  return task ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code,
+                       const char *name,
+                       uint32_t stack_depth,
+                       void *parameters,
+                       UBaseType_t priority,
+                       TaskHandle_t *created_task)
+{
+  return xTaskCreatePinnedToCore(code, name, stack_depth, parameters, priority, created_task, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  if (!task || task == current_task_)
+  {
+    pthread_exit(nullptr);
+  }
+  // Killing another thread is not portable; the firmware only does this on shutdown paths.
+  fprintf(stderr, "firmware_sim: vTaskDelete(%s) from another task is not supported\n", task->name.c_str());
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  if (ticks == 0)
+  {
+    sched_yield();
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount()
+{
+  static const auto start = std::chrono::steady_clock::now();
+  return static_cast<TickType_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  return current_task_ ? current_task_ : adopt_current_thread();
+}
+
+TaskHandle_t xTaskGetHandle(const char *name)
+{
+  if (!name)
+  {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  for (SimTask *task : tasks_)
+  {
+    if (task->name == name)
+    {
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+const char *pcTaskGetName(TaskHandle_t task)
+{
+  if (!task)
+  {
+    task = xTaskGetCurrentTaskHandle();
+  }
+  return task->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+  if (!task)
+  {
+    task = xTaskGetCurrentTaskHandle();
+  }
+  if (!task->host_stack)
+  {
+    return task->stack_depth;
+  }
+  // Stacks grow down, so untouched paint is at the low end.
+  size_t untouched = 0;
+  while (untouched < task->host_stack_bytes && task->host_stack[untouched] == kStackPaint)
+  {
+    ++untouched;
+  }
+  // Host use (including glibc's thread descriptor at the top) scaled back to a rough
+  // target figure, so task_monitor's low-stack warning only fires on real outliers.
+  size_t used = (task->host_stack_bytes - untouched) / kHostStackScale;
+  return used >= task->stack_depth ? 0 : static_cast<UBaseType_t>(task->stack_depth - used);
+}
+
+UBaseType_t uxTaskGetNumberOfTasks()
+{
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  return static_cast<UBaseType_t>(tasks_.size());
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+  return create_queue(length, item_size, nullptr);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *, StaticQueue_t *queue_buffer)
+{
+  return create_queue(length, item_size, queue_buffer);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+  delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+  return queue_send(queue, item, ticks_to_wait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+  return queue_send(queue, item, ticks_to_wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait)
+{
+  return queue_send(queue, item, ticks_to_wait, true);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item)
+{
+  if (!queue)
+  {
+    return pdFAIL;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->items.clear();
+    std::vector<uint8_t> copy(queue->item_size);
+    if (queue->item_size > 0 && item)
+    {
+      memcpy(copy.data(), item, queue->item_size);
+    }
+    queue->items.push_back(std::move(copy));
+  }
+  queue->not_empty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait)
+{
+  if (!queue)
+  {
+    return pdFAIL;
+  }
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (!wait_until(lock, queue->not_empty, ticks_to_wait, [queue]() { return !queue->items.empty(); }))
+  {
+    return pdFAIL;
+  }
+  if (item && queue->item_size > 0)
+  {
+    memcpy(item, queue->items.front().data(), queue->item_size);
+  }
+  queue->items.pop_front();
+  lock.unlock();
+  queue->not_full.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+  if (!queue)
+  {
+    return pdFAIL;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->items.clear();
+  }
+  queue->not_full.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+  if (!queue)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return static_cast<UBaseType_t>(queue->items.size());
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+  if (!queue)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return static_cast<UBaseType_t>(queue->length - queue->items.size());
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  return xSemaphoreCreateMutexStatic(nullptr);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+  SemaphoreHandle_t semaphore = create_queue(1, 0, buffer);
+  semaphore->is_semaphore = true;
+  semaphore->items.emplace_back();
+  return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+  return xSemaphoreCreateBinaryStatic(nullptr);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+  SemaphoreHandle_t semaphore = create_queue(1, 0, buffer);
+  semaphore->is_semaphore = true;
+  return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+  return xQueueReceive(semaphore, nullptr, ticks_to_wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  return xQueueSend(semaphore, nullptr, 0);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+  vQueueDelete(semaphore);
+}
+
+StreamBufferHandle_t xStreamBufferCreateStatic(size_t size, size_t trigger_level, uint8_t *, StaticStreamBuffer_t *buffer)
+{
+  SimStreamBuffer *stream = new SimStreamBuffer();
+  stream->size = size;
+  stream->trigger_level = trigger_level == 0 ? 1 : trigger_level;
+  if (buffer)
+  {
+    buffer->host = stream;
+  }
+  return stream;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void *data, size_t length, TickType_t ticks_to_wait)
+{
+  if (!buffer || !data || length == 0)
+  {
+    return 0;
+  }
+  std::unique_lock<std::mutex> lock(buffer->mutex);
+  size_t wanted = std::min(length, buffer->size);
+  wait_until(lock, buffer->not_full, ticks_to_wait,
+             [buffer, wanted]() { return buffer->size - buffer->bytes.size() >= wanted; });
+  size_t count = std::min(length, buffer->size - buffer->bytes.size());
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  buffer->bytes.insert(buffer->bytes.end(), bytes, bytes + count);
+  lock.unlock();
+  if (count > 0)
+  {
+    buffer->not_empty.notify_one();
+  }
+  return count;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void *data, size_t length, TickType_t ticks_to_wait)
+{
+  if (!buffer || !data || length == 0)
+  {
+    return 0;
+  }
+  std::unique_lock<std::mutex> lock(buffer->mutex);
+  wait_until(lock, buffer->not_empty, ticks_to_wait,
+             [buffer]() { return buffer->bytes.size() >= buffer->trigger_level; });
+  size_t count = std::min(length, buffer->bytes.size());
+  std::copy(buffer->bytes.begin(), buffer->bytes.begin() + count, static_cast<uint8_t *>(data));
+  buffer->bytes.erase(buffer->bytes.begin(), buffer->bytes.begin() + count);
+  lock.unlock();
+  if (count > 0)
+  {
+    buffer->not_full.notify_one();
+  }
+  return count;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t buffer)
+{
+  if (!buffer)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  return buffer->bytes.size();
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t buffer)
+{
+  if (!buffer)
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(buffer->mutex);
+  return buffer->size - buffer->bytes.size();
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t buffer)
+{
+  if (!buffer)
+  {
+    return pdFAIL;
+  }
+  {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->bytes.clear();
+  }
+  buffer->not_full.notify_all();
+  return pdPASS;
+}
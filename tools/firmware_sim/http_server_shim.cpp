@@ -0,0 +1,1458 @@
+#include <esp_http_server.h>
+#include <freertos/task.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <strings.h>
+#include <utility>
+#include <vector>
+
+#include "sim_options.h"
+
+namespace
+{
+  constexpr size_t kMaxRequestHeaderBytes = 1024;
+  constexpr size_t kMaxWsPayloadBytes = 64 * 1024;
+  constexpr int kServerTaskPriority = 5;
+
+  struct Session
+  {
+    int fd = -1;
+    bool websocket = false;
+    httpd_uri_t ws_uri = {};
+    uint64_t last_used = 0;
+    bool close_requested = false;
+    std::string rx;
+    std::mutex send_mutex;
+  };
+
+  struct Work
+  {
+    httpd_work_fn_t fn;
+    void *arg;
+  };
+
+  struct Server
+  {
+    httpd_config_t config = {};
+    int listen_fd = -1;
+    int wake_pipe[2] = {-1, -1};
+    std::vector<httpd_uri_t> handlers;
+    std::vector<std::string> handler_uris;
+    httpd_err_handler_func_t err_handlers[HTTPD_ERR_CODE_MAX] = {};
+
+    std::mutex mutex;
+    std::map<int, std::shared_ptr<Session>> sessions;
+    std::deque<Work> work;
+    uint64_t use_counter = 0;
+
+    TaskHandle_t task = nullptr;
+    std::atomic<bool> stopping{false};
+    std::mutex stop_mutex;
+    std::condition_variable stopped_condition;
+    bool stopped = false;
+  };
+
+  struct WsPending
+  {
+    bool header_read = false;
+    bool payload_read = false;
+    bool final = false;
+    httpd_ws_type_t type = HTTPD_WS_TYPE_TEXT;
+    uint64_t length = 0;
+    bool masked = false;
+    uint8_t mask[4] = {};
+  };
+
+  // Lives in httpd_req_t::aux for the duration of one handler call.
+  struct RequestAux
+  {
+    Server *server = nullptr;
+    std::shared_ptr<Session> session;
+    std::string path;
+    std::string query;
+    std::vector<std::pair<std::string, std::string>> headers;
+    size_t body_remaining = 0;
+    bool keep_alive = true;
+
+    std::string status = "200 OK";
+    std::string content_type = "text/html";
+    std::vector<std::pair<std::string, std::string>> response_headers;
+    bool headers_sent = false;
+    bool chunked = false;
+    bool send_failed = false;
+    size_t bytes_sent = 0;
+
+    WsPending ws;
+  };
+
+  RequestAux *aux_of(httpd_req_t *req)
+  {
+    return req ? static_cast<RequestAux *>(req->aux) : nullptr;
+  }
+
+  void wake(Server *server)
+  {
+    char byte = 1;
+    ssize_t ignored = write(server->wake_pipe[1], &byte, 1);
+    (void)ignored;
+  }
+
+  bool send_all(Session &session, const void *data, size_t length)
+  {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (length > 0)
+    {
+      ssize_t sent = send(session.fd, bytes, length, MSG_NOSIGNAL);
+      if (sent < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        return false;
+      }
+      bytes += sent;
+      length -= static_cast<size_t>(sent);
+    }
+    return true;
+  }
+
+  // Reads from the session's buffer first, then the socket; 0 on close, < 0 on error.
+  ssize_t read_some(Session &session, void *out, size_t length)
+  {
+    if (!session.rx.empty())
+    {
+      size_t take = std::min(length, session.rx.size());
+      memcpy(out, session.rx.data(), take);
+      session.rx.erase(0, take);
+      return static_cast<ssize_t>(take);
+    }
+    for (;;)
+    {
+      ssize_t got = recv(session.fd, out, length, 0);
+      if (got < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      return got;
+    }
+  }
+
+  bool read_exact(Session &session, void *out, size_t length)
+  {
+    uint8_t *bytes = static_cast<uint8_t *>(out);
+    while (length > 0)
+    {
+      ssize_t got = read_some(session, bytes, length);
+      if (got <= 0)
+      {
+        return false;
+      }
+      bytes += got;
+      length -= static_cast<size_t>(got);
+    }
+    return true;
+  }
+
+  bool discard(Session &session, uint64_t length)
+  {
+    char sink[512];
+    while (length > 0)
+    {
+      size_t take = static_cast<size_t>(std::min<uint64_t>(length, sizeof(sink)));
+      if (!read_exact(session, sink, take))
+      {
+        return false;
+      }
+      length -= take;
+    }
+    return true;
+  }
+
+  const char *find_header(const std::vector<std::pair<std::string, std::string>> &headers, const char *field)
+  {
+    for (const auto &header : headers)
+    {
+      if (strcasecmp(header.first.c_str(), field) == 0)
+      {
+        return header.second.c_str();
+      }
+    }
+    return nullptr;
+  }
+
+  // ---- SHA-1 for the WebSocket handshake ------------------------------------------------
+
+  std::string sha1(const std::string &input)
+  {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string message = input;
+    uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56)
+    {
+      message.push_back('\0');
+    }
+    for (int shift = 56; shift >= 0; shift -= 8)
+    {
+      message.push_back(static_cast<char>((bit_length >> shift) & 0xFF));
+    }
+
+    auto rotl = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+    for (size_t block = 0; block < message.size(); block += 64)
+    {
+      uint32_t w[80];
+      for (int i = 0; i < 16; ++i)
+      {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(message.data() + block + i * 4);
+        w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+      }
+      for (int i = 16; i < 80; ++i)
+      {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+      }
+      uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+      for (int i = 0; i < 80; ++i)
+      {
+        uint32_t f;
+        uint32_t k;
+        if (i < 20)
+        {
+          f = (b & c) | (~b & d);
+          k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+          f = b ^ c ^ d;
+          k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+          f = (b & c) | (b & d) | (c & d);
+          k = 0x8F1BBCDC;
+        }
+        else
+        {
+          f = b ^ c ^ d;
+          k = 0xCA62C1D6;
+        }
+        uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = temp;
+      }
+      h[0] += a;
+      h[1] += b;
+      h[2] += c;
+      h[3] += d;
+      h[4] += e;
+    }
+
+    std::string digest;
+    for (uint32_t word : h)
+    {
+      for (int shift = 24; shift >= 0; shift -= 8)
+      {
+        digest.push_back(static_cast<char>((word >> shift) & 0xFF));
+      }
+    }
+    return digest;
+  }
+
+  std::string base64_encode(const std::string &input)
+  {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < input.size(); i += 3)
+    {
+      uint32_t chunk = uint32_t(uint8_t(input[i])) << 16;
+      if (i + 1 < input.size())
+        chunk |= uint32_t(uint8_t(input[i + 1])) << 8;
+      if (i + 2 < input.size())
+        chunk |= uint8_t(input[i + 2]);
+      out.push_back(kAlphabet[(chunk >> 18) & 0x3F]);
+      out.push_back(kAlphabet[(chunk >> 12) & 0x3F]);
+      out.push_back(i + 1 < input.size() ? kAlphabet[(chunk >> 6) & 0x3F] : '=');
+      out.push_back(i + 2 < input.size() ? kAlphabet[chunk & 0x3F] : '=');
+    }
+    return out;
+  }
+
+  // ---- Responses -------------------------------------------------------------------------
+
+  bool send_response_headers(RequestAux &aux, const char *length_header)
+  {
+    std::string head = "HTTP/1.1 " + aux.status + "\r\nContent-Type: " + aux.content_type + "\r\n" + length_header;
+    for (const auto &header : aux.response_headers)
+    {
+      head += header.first + ": " + header.second + "\r\n";
+    }
+    head += "\r\n";
+    aux.headers_sent = true;
+    std::lock_guard<std::mutex> lock(aux.session->send_mutex);
+    return send_all(*aux.session, head.data(), head.size());
+  }
+
+  const char *error_status(httpd_err_code_t error)
+  {
+    switch (error)
+    {
+    case HTTPD_501_METHOD_NOT_IMPLEMENTED:
+      return "501 Method Not Implemented";
+    case HTTPD_505_VERSION_NOT_SUPPORTED:
+      return "505 Version Not Supported";
+    case HTTPD_400_BAD_REQUEST:
+      return "400 Bad Request";
+    case HTTPD_401_UNAUTHORIZED:
+      return "401 Unauthorized";
+    case HTTPD_403_FORBIDDEN:
+      return "403 Forbidden";
+    case HTTPD_404_NOT_FOUND:
+      return "404 Not Found";
+    case HTTPD_405_METHOD_NOT_ALLOWED:
+      return "405 Method Not Allowed";
+    case HTTPD_408_REQ_TIMEOUT:
+      return "408 Request Timeout";
+    case HTTPD_411_LENGTH_REQUIRED:
+      return "411 Length Required";
+    case HTTPD_414_URI_TOO_LONG:
+      return "414 URI Too Long";
+    case HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE:
+      return "431 Request Header Fields Too Large";
+    case HTTPD_500_INTERNAL_SERVER_ERROR:
+    default:
+      return "500 Internal Server Error";
+    }
+  }
+
+  const char *error_message(httpd_err_code_t error)
+  {
+    switch (error)
+    {
+    case HTTPD_404_NOT_FOUND:
+      return "Nothing matches the given URI";
+    case HTTPD_405_METHOD_NOT_ALLOWED:
+      return "Request method for this URI is not handled by server";
+    case HTTPD_400_BAD_REQUEST:
+      return "Bad request syntax";
+    case HTTPD_414_URI_TOO_LONG:
+      return "URI is too long";
+    case HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE:
+      return "Header fields are too long";
+    case HTTPD_501_METHOD_NOT_IMPLEMENTED:
+      return "Request method is not supported by server";
+    default:
+      return "Server has encountered an unexpected error";
+    }
+  }
+
+  // ---- WebSocket framing -----------------------------------------------------------------
+
+  bool send_ws_frame(Session &session, const httpd_ws_frame_t &frame)
+  {
+    uint8_t head[10];
+    size_t head_length = 0;
+    head[head_length++] = static_cast<uint8_t>((frame.final || !frame.fragmented ? 0x80 : 0x00) | (frame.type & 0x0F));
+    if (frame.len < 126)
+    {
+      head[head_length++] = static_cast<uint8_t>(frame.len);
+    }
+    else if (frame.len <= 0xFFFF)
+    {
+      head[head_length++] = 126;
+      head[head_length++] = static_cast<uint8_t>(frame.len >> 8);
+      head[head_length++] = static_cast<uint8_t>(frame.len);
+    }
+    else
+    {
+      head[head_length++] = 127;
+      for (int shift = 56; shift >= 0; shift -= 8)
+      {
+        head[head_length++] = static_cast<uint8_t>(static_cast<uint64_t>(frame.len) >> shift);
+      }
+    }
+    std::lock_guard<std::mutex> lock(session.send_mutex);
+    if (!send_all(session, head, head_length))
+    {
+      return false;
+    }
+    return frame.len == 0 || !frame.payload || send_all(session, frame.payload, frame.len);
+  }
+
+  bool read_ws_header(Session &session, WsPending &pending)
+  {
+    uint8_t head[2];
+    if (!read_exact(session, head, sizeof(head)))
+    {
+      return false;
+    }
+    pending.header_read = true;
+    pending.payload_read = false;
+    pending.final = (head[0] & 0x80) != 0;
+    pending.type = static_cast<httpd_ws_type_t>(head[0] & 0x0F);
+    pending.masked = (head[1] & 0x80) != 0;
+    pending.length = head[1] & 0x7F;
+    if (pending.length == 126)
+    {
+      uint8_t extended[2];
+      if (!read_exact(session, extended, sizeof(extended)))
+      {
+        return false;
+      }
+      pending.length = (uint64_t(extended[0]) << 8) | extended[1];
+    }
+    else if (pending.length == 127)
+    {
+      uint8_t extended[8];
+      if (!read_exact(session, extended, sizeof(extended)))
+      {
+        return false;
+      }
+      pending.length = 0;
+      for (uint8_t byte : extended)
+      {
+        pending.length = (pending.length << 8) | byte;
+      }
+    }
+    if (pending.masked && !read_exact(session, pending.mask, sizeof(pending.mask)))
+    {
+      return false;
+    }
+    return pending.length <= kMaxWsPayloadBytes;
+  }
+
+  // ---- Request dispatch ------------------------------------------------------------------
+
+  int method_from_string(const std::string &method)
+  {
+    static const std::pair<const char *, int> kMethods[] = {
+        {"DELETE", HTTP_DELETE}, {"GET", HTTP_GET}, {"HEAD", HTTP_HEAD}, {"POST", HTTP_POST},
+        {"PUT", HTTP_PUT}, {"OPTIONS", HTTP_OPTIONS}, {"PATCH", HTTP_PATCH}};
+    for (const auto &entry : kMethods)
+    {
+      if (method == entry.first)
+      {
+        return entry.second;
+      }
+    }
+    return -2;
+  }
+
+  void init_request(httpd_req_t &req, RequestAux &aux, Server *server, const std::string &uri, int method)
+  {
+    req = httpd_req_t();
+    req.handle = server;
+    req.method = method;
+    size_t length = std::min(uri.size(), static_cast<size_t>(HTTPD_MAX_URI_LEN));
+    memcpy(req.uri, uri.data(), length);
+    req.content_len = aux.body_remaining;
+    req.aux = &aux;
+  }
+
+  // Runs the registered (or default) error handler; false means close the session.
+  bool dispatch_error(httpd_req_t &req, httpd_err_code_t error)
+  {
+    Server *server = static_cast<Server *>(req.handle);
+    if (server->err_handlers[error])
+    {
+      return server->err_handlers[error](&req, error) == ESP_OK;
+    }
+    httpd_resp_send_err(&req, error, nullptr);
+    return false;
+  }
+
+  void log_request(const char *method, const RequestAux &aux, int64_t started_us)
+  {
+    if (!firmware_sim::options().http_log)
+    {
+      return;
+    }
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count() -
+                      started_us;
+    fprintf(stderr, "http %s %s %s %zu bytes %lld us\n", method, aux.path.c_str(), aux.status.c_str(), aux.bytes_sent,
+            static_cast<long long>(elapsed));
+  }
+
+  int64_t now_us()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  bool handle_ws_frame(Server *server, const std::shared_ptr<Session> &session)
+  {
+    RequestAux aux;
+    aux.server = server;
+    aux.session = session;
+    aux.path = session->ws_uri.uri;
+    if (!read_ws_header(*session, aux.ws))
+    {
+      return false;
+    }
+
+    httpd_req_t req;
+    init_request(req, aux, server, aux.path, 0);
+    req.user_ctx = session->ws_uri.user_ctx;
+
+    bool control = aux.ws.type == HTTPD_WS_TYPE_PING || aux.ws.type == HTTPD_WS_TYPE_PONG ||
+                   aux.ws.type == HTTPD_WS_TYPE_CLOSE;
+    if (control && !session->ws_uri.handle_ws_control_frames)
+    {
+      std::vector<uint8_t> payload(aux.ws.length);
+      httpd_ws_frame_t frame = {};
+      frame.payload = payload.data();
+      if (httpd_ws_recv_frame(&req, &frame, payload.size()) != ESP_OK)
+      {
+        return false;
+      }
+      if (frame.type == HTTPD_WS_TYPE_PING)
+      {
+        frame.type = HTTPD_WS_TYPE_PONG;
+        return send_ws_frame(*session, frame);
+      }
+      if (frame.type == HTTPD_WS_TYPE_CLOSE)
+      {
+        httpd_ws_frame_t reply = {};
+        reply.type = HTTPD_WS_TYPE_CLOSE;
+        send_ws_frame(*session, reply);
+        return false;
+      }
+      return true;
+    }
+
+    esp_err_t result = session->ws_uri.handler(&req);
+    if (aux.ws.type == HTTPD_WS_TYPE_CLOSE)
+    {
+      return false;
+    }
+    if (!aux.ws.payload_read && !discard(*session, aux.ws.length))
+    {
+      return false;
+    }
+    return result == ESP_OK;
+  }
+
+  bool upgrade_websocket(RequestAux &aux, const httpd_uri_t &handler)
+  {
+    const char *key = find_header(aux.headers, "Sec-WebSocket-Key");
+    const char *upgrade = find_header(aux.headers, "Upgrade");
+    if (!key || !upgrade || strcasecmp(upgrade, "websocket") != 0)
+    {
+      return false;
+    }
+    std::string accept = base64_encode(sha1(std::string(key) + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+    std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Accept: " +
+                           accept + "\r\n\r\n";
+    {
+      std::lock_guard<std::mutex> lock(aux.session->send_mutex);
+      if (!send_all(*aux.session, response.data(), response.size()))
+      {
+        return false;
+      }
+    }
+    aux.status = "101 Switching Protocols";
+    aux.session->websocket = true;
+    aux.session->ws_uri = handler;
+    return true;
+  }
+
+  bool handle_http_request(Server *server, const std::shared_ptr<Session> &session)
+  {
+    Session &s = *session;
+    std::string head;
+    size_t end = std::string::npos;
+    while ((end = s.rx.find("\r\n\r\n")) == std::string::npos)
+    {
+      if (s.rx.size() > kMaxRequestHeaderBytes)
+      {
+        break;
+      }
+      char buffer[512];
+      ssize_t got = recv(s.fd, buffer, sizeof(buffer), 0);
+      if (got <= 0)
+      {
+        if (got < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        return false;
+      }
+      s.rx.append(buffer, static_cast<size_t>(got));
+    }
+    int64_t started = now_us();
+
+    RequestAux aux;
+    aux.server = server;
+    aux.session = session;
+    httpd_req_t req;
+
+    if (end == std::string::npos)
+    {
+      s.rx.clear();
+      init_request(req, aux, server, "", HTTP_GET);
+      dispatch_error(req, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE);
+      return false;
+    }
+    head = s.rx.substr(0, end);
+    s.rx.erase(0, end + 4);
+
+    size_t line_end = head.find("\r\n");
+    std::string request_line = head.substr(0, line_end);
+    char method_text[16] = {};
+    char target_text[2048] = {};
+    char version_text[16] = {};
+    if (sscanf(request_line.c_str(), "%15s %2047s %15s", method_text, target_text, version_text) != 3)
+    {
+      init_request(req, aux, server, "", HTTP_GET);
+      dispatch_error(req, HTTPD_400_BAD_REQUEST);
+      return false;
+    }
+    std::string target = target_text;
+    aux.keep_alive = strcmp(version_text, "HTTP/1.0") != 0;
+
+    size_t position = (line_end == std::string::npos) ? head.size() : line_end + 2;
+    while (position < head.size())
+    {
+      size_t next = head.find("\r\n", position);
+      if (next == std::string::npos)
+      {
+        next = head.size();
+      }
+      std::string line = head.substr(position, next - position);
+      size_t colon = line.find(':');
+      if (colon != std::string::npos)
+      {
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        aux.headers.emplace_back(line.substr(0, colon), value);
+      }
+      position = next + 2;
+    }
+    if (const char *length = find_header(aux.headers, "Content-Length"))
+    {
+      aux.body_remaining = static_cast<size_t>(strtoul(length, nullptr, 10));
+    }
+    if (const char *connection = find_header(aux.headers, "Connection"))
+    {
+      if (strcasecmp(connection, "close") == 0)
+      {
+        aux.keep_alive = false;
+      }
+      else if (strcasecmp(connection, "keep-alive") == 0)
+      {
+        aux.keep_alive = true;
+      }
+    }
+
+    size_t query_start = target.find('?');
+    aux.path = target.substr(0, query_start);
+    if (query_start != std::string::npos)
+    {
+      aux.query = target.substr(query_start + 1);
+    }
+
+    int method = method_from_string(method_text);
+    init_request(req, aux, server, target, method == -2 ? HTTP_GET : method);
+    if (target.size() > HTTPD_MAX_URI_LEN)
+    {
+      dispatch_error(req, HTTPD_414_URI_TOO_LONG);
+      return false;
+    }
+    if (method == -2)
+    {
+      dispatch_error(req, HTTPD_501_METHOD_NOT_IMPLEMENTED);
+      return false;
+    }
+
+    const httpd_uri_t *handler = nullptr;
+    bool uri_matched = false;
+    for (const httpd_uri_t &candidate : server->handlers)
+    {
+      bool matches = server->config.uri_match_fn
+                         ? server->config.uri_match_fn(candidate.uri, aux.path.c_str(), aux.path.size())
+                         : aux.path == candidate.uri;
+      if (!matches)
+      {
+        continue;
+      }
+      uri_matched = true;
+      if (candidate.method == method || candidate.method == HTTP_ANY)
+      {
+        handler = &candidate;
+        break;
+      }
+    }
+
+    bool keep = true;
+    if (!handler)
+    {
+      keep = dispatch_error(req, uri_matched ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND);
+    }
+    else if (handler->is_websocket)
+    {
+      req.user_ctx = handler->user_ctx;
+      if (!upgrade_websocket(aux, *handler))
+      {
+        keep = dispatch_error(req, HTTPD_400_BAD_REQUEST);
+      }
+      else
+      {
+        keep = handler->handler(&req) == ESP_OK;
+      }
+    }
+    else
+    {
+      req.user_ctx = handler->user_ctx;
+      keep = handler->handler(&req) == ESP_OK;
+    }
+
+    log_request(method_text, aux, started);
+    if (!keep || aux.send_failed)
+    {
+      return false;
+    }
+    if (!s.websocket && aux.body_remaining > 0 && !discard(s, aux.body_remaining))
+    {
+      return false;
+    }
+    return s.websocket || aux.keep_alive;
+  }
+
+  // ---- Server task -----------------------------------------------------------------------
+
+  void close_session(Server *server, int fd)
+  {
+    std::shared_ptr<Session> session;
+    {
+      std::lock_guard<std::mutex> lock(server->mutex);
+      auto found = server->sessions.find(fd);
+      if (found == server->sessions.end())
+      {
+        return;
+      }
+      session = found->second;
+      server->sessions.erase(found);
+    }
+    // As in esp_http_server, a close_fn takes over closing the socket.
+    std::lock_guard<std::mutex> lock(session->send_mutex);
+    if (server->config.close_fn)
+    {
+      server->config.close_fn(server, fd);
+    }
+    else
+    {
+      close(fd);
+    }
+    session->fd = -1;
+  }
+
+  void accept_session(Server *server)
+  {
+    int fd = accept(server->listen_fd, nullptr, nullptr);
+    if (fd < 0)
+    {
+      return;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    timeval receive_timeout = {server->config.recv_wait_timeout, 0};
+    timeval send_timeout = {server->config.send_wait_timeout, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout, sizeof(receive_timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    int lru_fd = -1;
+    {
+      std::lock_guard<std::mutex> lock(server->mutex);
+      if (server->sessions.size() >= server->config.max_open_sockets)
+      {
+        if (!server->config.lru_purge_enable)
+        {
+          close(fd);
+          return;
+        }
+        uint64_t oldest = UINT64_MAX;
+        for (const auto &entry : server->sessions)
+        {
+          if (entry.second->last_used < oldest)
+          {
+            oldest = entry.second->last_used;
+            lru_fd = entry.first;
+          }
+        }
+      }
+    }
+    if (lru_fd >= 0)
+    {
+      close_session(server, lru_fd);
+    }
+
+    if (server->config.open_fn && server->config.open_fn(server, fd) != ESP_OK)
+    {
+      close(fd);
+      return;
+    }
+    auto session = std::make_shared<Session>();
+    session->fd = fd;
+    std::lock_guard<std::mutex> lock(server->mutex);
+    session->last_used = ++server->use_counter;
+    server->sessions[fd] = session;
+  }
+
+  void server_task(void *param)
+  {
+    Server *server = static_cast<Server *>(param);
+    std::vector<pollfd> fds;
+    while (!server->stopping.load())
+    {
+      fds.clear();
+      fds.push_back({server->listen_fd, POLLIN, 0});
+      fds.push_back({server->wake_pipe[0], POLLIN, 0});
+      std::vector<int> pending_close;
+      std::deque<Work> work;
+      {
+        std::lock_guard<std::mutex> lock(server->mutex);
+        for (const auto &entry : server->sessions)
+        {
+          if (entry.second->close_requested)
+          {
+            pending_close.push_back(entry.first);
+          }
+          else
+          {
+            fds.push_back({entry.first, POLLIN, 0});
+          }
+        }
+        work.swap(server->work);
+      }
+      for (int fd : pending_close)
+      {
+        close_session(server, fd);
+      }
+      for (const Work &item : work)
+      {
+        item.fn(item.arg);
+      }
+      if (!pending_close.empty() || !work.empty())
+      {
+        continue;
+      }
+
+      if (poll(fds.data(), fds.size(), -1) < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        break;
+      }
+      if (fds[1].revents & POLLIN)
+      {
+        char drain[64];
+        while (read(server->wake_pipe[0], drain, sizeof(drain)) == static_cast<ssize_t>(sizeof(drain)))
+        {
+        }
+      }
+      if (fds[0].revents & POLLIN)
+      {
+        accept_session(server);
+      }
+      for (size_t index = 2; index < fds.size(); ++index)
+      {
+        if (!(fds[index].revents & (POLLIN | POLLHUP | POLLERR)))
+        {
+          continue;
+        }
+        std::shared_ptr<Session> session;
+        {
+          std::lock_guard<std::mutex> lock(server->mutex);
+          auto found = server->sessions.find(fds[index].fd);
+          if (found == server->sessions.end())
+          {
+            continue;
+          }
+          session = found->second;
+          session->last_used = ++server->use_counter;
+        }
+        bool keep = session->websocket ? handle_ws_frame(server, session) : handle_http_request(server, session);
+        if (!keep)
+        {
+          close_session(server, fds[index].fd);
+        }
+      }
+    }
+
+    std::vector<int> open_fds;
+    {
+      std::lock_guard<std::mutex> lock(server->mutex);
+      for (const auto &entry : server->sessions)
+      {
+        open_fds.push_back(entry.first);
+      }
+    }
+    for (int fd : open_fds)
+    {
+      close_session(server, fd);
+    }
+    close(server->listen_fd);
+    {
+      std::lock_guard<std::mutex> lock(server->stop_mutex);
+      server->stopped = true;
+    }
+    server->stopped_condition.notify_all();
+    vTaskDelete(nullptr);
+  }
+
+  std::shared_ptr<Session> find_session(Server *server, int fd)
+  {
+    std::lock_guard<std::mutex> lock(server->mutex);
+    auto found = server->sessions.find(fd);
+    return found == server->sessions.end() ? nullptr : found->second;
+  }
+} // namespace
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+  if (!handle || !config)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  Server *server = new Server();
+  server->config = *config;
+  const firmware_sim::Options &options = firmware_sim::options();
+  // The firmware asks for port 80; the simulator listens where --http-port says.
+  if (options.http_port != 0)
+  {
+    server->config.server_port = options.http_port;
+  }
+
+  server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(server->config.server_port);
+  if (inet_pton(AF_INET, options.http_host.c_str(), &address.sin_addr) != 1 ||
+      bind(server->listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(server->listen_fd, std::max<int>(server->config.backlog_conn, 16)) != 0)
+  {
+    fprintf(stderr, "firmware_sim: cannot listen on %s:%u: %s\n", options.http_host.c_str(),
+            server->config.server_port, strerror(errno));
+    close(server->listen_fd);
+    delete server;
+    return ESP_FAIL;
+  }
+  if (pipe(server->wake_pipe) != 0)
+  {
+    close(server->listen_fd);
+    delete server;
+    return ESP_FAIL;
+  }
+  fcntl(server->wake_pipe[0], F_SETFL, O_NONBLOCK);
+
+  if (xTaskCreatePinnedToCore(server_task,
+                              "httpd",
+                              static_cast<uint32_t>(server->config.stack_size),
+                              server,
+                              kServerTaskPriority,
+                              &server->task,
+                              server->config.core_id) != pdPASS)
+  {
+    close(server->listen_fd);
+    delete server;
+    return ESP_ERR_HTTPD_TASK;
+  }
+  fprintf(stderr, "firmware_sim: http on %s:%u\n", options.http_host.c_str(), server->config.server_port);
+  *handle = server;
+  return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  server->stopping.store(true);
+  wake(server);
+  std::unique_lock<std::mutex> lock(server->stop_mutex);
+  server->stopped_condition.wait(lock, [server]() { return server->stopped; });
+  return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server || !uri_handler || !uri_handler->uri || !uri_handler->handler)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (const httpd_uri_t &existing : server->handlers)
+  {
+    if (strcmp(existing.uri, uri_handler->uri) == 0 && existing.method == uri_handler->method)
+    {
+      return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+  }
+  // Same limit as ESP-IDF, so handlers beyond max_uri_handlers fail here as well.
+  if (server->handlers.size() >= server->config.max_uri_handlers)
+  {
+    fprintf(stderr, "firmware_sim: no slot left for handler %s (max_uri_handlers=%u)\n", uri_handler->uri,
+            server->config.max_uri_handlers);
+    return ESP_ERR_HTTPD_HANDLERS_FULL;
+  }
+  server->handler_uris.reserve(server->config.max_uri_handlers);
+  server->handler_uris.emplace_back(uri_handler->uri);
+  httpd_uri_t copy = *uri_handler;
+  copy.uri = server->handler_uris.back().c_str();
+  server->handlers.push_back(copy);
+  return ESP_OK;
+}
+
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char *uri, httpd_method_t method)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server || !uri)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (auto it = server->handlers.begin(); it != server->handlers.end(); ++it)
+  {
+    if (strcmp(it->uri, uri) == 0 && it->method == method)
+    {
+      server->handlers.erase(it);
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_register_err_handler(httpd_handle_t handle, httpd_err_code_t error, httpd_err_handler_func_t handler)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server || error >= HTTPD_ERR_CODE_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  server->err_handlers[error] = handler;
+  return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char *reference_uri, const char *uri_to_match, size_t match_upto)
+{
+  size_t template_length = strlen(reference_uri);
+  char last = template_length > 0 ? reference_uri[template_length - 1] : '\0';
+  char before_last = template_length > 1 ? reference_uri[template_length - 2] : '\0';
+  bool asterisk = last == '*' || (before_last == '*' && last == '?');
+  bool question = last == '?' || (before_last == '?' && last == '*');
+  size_t exact = template_length - (asterisk ? 1 : 0) - (question ? 1 : 0);
+
+  // With '?', the character before it is optional; with '*', anything may follow.
+  if (question && match_upto + 1 == exact && strncmp(reference_uri, uri_to_match, match_upto) == 0)
+  {
+    return true;
+  }
+  if (asterisk)
+  {
+    return match_upto >= exact && strncmp(reference_uri, uri_to_match, exact) == 0;
+  }
+  return match_upto == exact && strncmp(reference_uri, uri_to_match, exact) == 0;
+}
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || !buf)
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+  size_t want = std::min(buf_len, aux->body_remaining);
+  if (want == 0)
+  {
+    return 0;
+  }
+  ssize_t got = read_some(*aux->session, buf, want);
+  if (got < 0)
+  {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+  }
+  aux->body_remaining -= static_cast<size_t>(got);
+  return static_cast<int>(got);
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field)
+{
+  RequestAux *aux = aux_of(req);
+  const char *value = aux ? find_header(aux->headers, field) : nullptr;
+  return value ? strlen(value) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size)
+{
+  RequestAux *aux = aux_of(req);
+  const char *value = aux ? find_header(aux->headers, field) : nullptr;
+  if (!value)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (!val || val_size == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  snprintf(val, val_size, "%s", value);
+  return strlen(value) < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *req)
+{
+  RequestAux *aux = aux_of(req);
+  return aux ? aux->query.size() : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || aux->query.empty())
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (!buf || buf_len == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  snprintf(buf, buf_len, "%s", aux->query.c_str());
+  return aux->query.size() < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *query, const char *key, char *val, size_t val_size)
+{
+  if (!query || !key || !val || val_size == 0)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  size_t key_length = strlen(key);
+  const char *cursor = query;
+  while (*cursor)
+  {
+    const char *end = strchr(cursor, '&');
+    size_t length = end ? static_cast<size_t>(end - cursor) : strlen(cursor);
+    if (length > key_length && strncmp(cursor, key, key_length) == 0 && cursor[key_length] == '=')
+    {
+      size_t value_length = length - key_length - 1;
+      size_t copy = std::min(value_length, val_size - 1);
+      memcpy(val, cursor + key_length + 1, copy);
+      val[copy] = '\0';
+      return value_length < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    if (!end)
+    {
+      break;
+    }
+    cursor = end + 1;
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *req)
+{
+  RequestAux *aux = aux_of(req);
+  return aux ? aux->session->fd : -1;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || !status)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  aux->status = status;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || !type)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  aux->content_type = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || !field || !value)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (aux->response_headers.size() >= aux->server->config.max_resp_headers)
+  {
+    return ESP_ERR_HTTPD_RESP_HDR;
+  }
+  aux->response_headers.emplace_back(field, value);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux)
+  {
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+  size_t length = (buf_len == HTTPD_RESP_USE_STRLEN) ? (buf ? strlen(buf) : 0) : static_cast<size_t>(buf_len);
+  char length_header[48];
+  snprintf(length_header, sizeof(length_header), "Content-Length: %zu\r\n", length);
+  if (!send_response_headers(*aux, length_header))
+  {
+    aux->send_failed = true;
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  std::lock_guard<std::mutex> lock(aux->session->send_mutex);
+  if (length > 0 && !send_all(*aux->session, buf, length))
+  {
+    aux->send_failed = true;
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  aux->bytes_sent += length;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux)
+  {
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+  if (!aux->headers_sent)
+  {
+    aux->chunked = true;
+    if (!send_response_headers(*aux, "Transfer-Encoding: chunked\r\n"))
+    {
+      aux->send_failed = true;
+      return ESP_ERR_HTTPD_RESP_SEND;
+    }
+  }
+  size_t length = (buf_len == HTTPD_RESP_USE_STRLEN) ? (buf ? strlen(buf) : 0) : static_cast<size_t>(buf_len);
+  if (!buf)
+  {
+    length = 0;
+  }
+  char size_line[24];
+  snprintf(size_line, sizeof(size_line), "%zx\r\n", length);
+  std::lock_guard<std::mutex> lock(aux->session->send_mutex);
+  bool ok = send_all(*aux->session, size_line, strlen(size_line)) && (length == 0 || send_all(*aux->session, buf, length)) &&
+            send_all(*aux->session, "\r\n", 2);
+  if (!ok)
+  {
+    aux->send_failed = true;
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  aux->bytes_sent += length;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_sendstr(httpd_req_t *req, const char *str)
+{
+  return httpd_resp_send(req, str, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *req, const char *str)
+{
+  return httpd_resp_send_chunk(req, str, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *message)
+{
+  if (!aux_of(req))
+  {
+    return ESP_ERR_HTTPD_INVALID_REQ;
+  }
+  httpd_resp_set_status(req, error_status(error));
+  httpd_resp_set_type(req, "text/html");
+  return httpd_resp_send(req, message ? message : error_message(error), HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  {
+    std::lock_guard<std::mutex> lock(server->mutex);
+    auto found = server->sessions.find(sockfd);
+    if (found == server->sessions.end())
+    {
+      return ESP_ERR_NOT_FOUND;
+    }
+    found->second->close_requested = true;
+  }
+  wake(server);
+  return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server || !work)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  {
+    std::lock_guard<std::mutex> lock(server->mutex);
+    server->work.push_back(Work{work, arg});
+  }
+  wake(server);
+  return ESP_OK;
+}
+
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+  (void)flags;
+  Server *server = static_cast<Server *>(handle);
+  if (!server || !buf)
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+  std::shared_ptr<Session> session = find_session(server, sockfd);
+  if (!session)
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+  std::lock_guard<std::mutex> lock(session->send_mutex);
+  if (session->fd < 0)
+  {
+    return HTTPD_SOCK_ERR_INVALID;
+  }
+  ssize_t sent = send(session->fd, buf, buf_len, MSG_NOSIGNAL);
+  if (sent < 0)
+  {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+  }
+  return static_cast<int>(sent);
+}
+
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t *fds, int *client_fds)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server || !fds || !client_fds)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(server->mutex);
+  size_t count = 0;
+  for (const auto &entry : server->sessions)
+  {
+    if (count >= *fds)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    client_fds[count++] = entry.first;
+  }
+  *fds = count;
+  return ESP_OK;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || !frame || !aux->ws.header_read)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  frame->type = aux->ws.type;
+  frame->final = aux->ws.final;
+  frame->fragmented = !aux->ws.final;
+  frame->len = static_cast<size_t>(aux->ws.length);
+  if (max_len == 0)
+  {
+    return ESP_OK;
+  }
+  if (aux->ws.payload_read || !frame->payload)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (max_len < frame->len)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if (!read_exact(*aux->session, frame->payload, frame->len))
+  {
+    return ESP_FAIL;
+  }
+  aux->ws.payload_read = true;
+  if (aux->ws.masked)
+  {
+    for (size_t index = 0; index < frame->len; ++index)
+    {
+      frame->payload[index] ^= aux->ws.mask[index % 4];
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
+{
+  RequestAux *aux = aux_of(req);
+  if (!aux || !frame)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return send_ws_frame(*aux->session, *frame) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t handle, int fd, httpd_ws_frame_t *frame)
+{
+  Server *server = static_cast<Server *>(handle);
+  if (!server || !frame)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::shared_ptr<Session> session = find_session(server, fd);
+  if (!session || !session->websocket)
+  {
+    return ESP_FAIL;
+  }
+  return send_ws_frame(*session, *frame) ? ESP_OK : ESP_FAIL;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t handle, int fd)
+{
+  Server *server = static_cast<Server *>(handle);
+  std::shared_ptr<Session> session = server ? find_session(server, fd) : nullptr;
+  if (!session)
+  {
+    return HTTPD_WS_CLIENT_INVALID;
+  }
+  return session->websocket ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+}
@@ -0,0 +1,325 @@
+#include <nvs.h>
+#include <nvs_flash.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "sim_options.h"
+
+// Values are kept per namespace as typed byte strings. With --nvs the store is loaded at
+// nvs_flash_init() and rewritten on every commit, one "namespace key type hex" line each.
+namespace
+{
+  enum class ValueType : char
+  {
+    U8 = 'b',
+    U16 = 'h',
+    U32 = 'w',
+    Str = 's',
+    Blob = 'x'
+  };
+
+  struct Value
+  {
+    ValueType type;
+    std::vector<uint8_t> bytes;
+  };
+
+  struct Handle
+  {
+    std::string name_space;
+    bool writable;
+  };
+
+  std::mutex mutex_;
+  bool initialised_ = false;
+  std::map<std::string, std::map<std::string, Value>> store_;
+  std::map<nvs_handle_t, Handle> handles_;
+  nvs_handle_t next_handle_ = 1;
+
+  std::string to_hex(const std::vector<uint8_t> &bytes)
+  {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t byte : bytes)
+    {
+      hex.push_back(kDigits[byte >> 4]);
+      hex.push_back(kDigits[byte & 0xF]);
+    }
+    return hex.empty() ? "-" : hex;
+  }
+
+  std::vector<uint8_t> from_hex(const std::string &hex)
+  {
+    std::vector<uint8_t> bytes;
+    for (size_t index = 0; index + 1 < hex.size(); index += 2)
+    {
+      bytes.push_back(static_cast<uint8_t>(std::stoul(hex.substr(index, 2), nullptr, 16)));
+    }
+    return bytes;
+  }
+
+  void load_file()
+  {
+    const std::string &path = firmware_sim::options().nvs_path;
+    if (path.empty())
+    {
+      return;
+    }
+    std::ifstream input(path);
+    std::string line;
+    while (std::getline(input, line))
+    {
+      std::istringstream fields(line);
+      std::string name_space;
+      std::string key;
+      char type = 0;
+      std::string hex;
+      if (fields >> name_space >> key >> type >> hex)
+      {
+        store_[name_space][key] = Value{static_cast<ValueType>(type), hex == "-" ? std::vector<uint8_t>() : from_hex(hex)};
+      }
+    }
+  }
+
+  void save_file()
+  {
+    const std::string &path = firmware_sim::options().nvs_path;
+    if (path.empty())
+    {
+      return;
+    }
+    std::ofstream output(path, std::ios::trunc);
+    for (const auto &name_space : store_)
+    {
+      for (const auto &entry : name_space.second)
+      {
+        output << name_space.first << ' ' << entry.first << ' ' << static_cast<char>(entry.second.type) << ' '
+               << to_hex(entry.second.bytes) << '\n';
+      }
+    }
+  }
+
+  esp_err_t set_value(nvs_handle_t handle, const char *key, ValueType type, const void *data, size_t length)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = handles_.find(handle);
+    if (found == handles_.end() || !key)
+    {
+      return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!found->second.writable)
+    {
+      return ESP_ERR_INVALID_STATE;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    store_[found->second.name_space][key] = Value{type, std::vector<uint8_t>(bytes, bytes + length)};
+    return ESP_OK;
+  }
+
+  esp_err_t get_value(nvs_handle_t handle, const char *key, ValueType type, std::vector<uint8_t> &out)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = handles_.find(handle);
+    if (found == handles_.end() || !key)
+    {
+      return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    auto name_space = store_.find(found->second.name_space);
+    if (name_space == store_.end())
+    {
+      return ESP_ERR_NVS_NOT_FOUND;
+    }
+    auto entry = name_space->second.find(key);
+    if (entry == name_space->second.end() || entry->second.type != type)
+    {
+      return ESP_ERR_NVS_NOT_FOUND;
+    }
+    out = entry->second.bytes;
+    return ESP_OK;
+  }
+
+  template <typename T>
+  esp_err_t get_integer(nvs_handle_t handle, const char *key, ValueType type, T *out_value)
+  {
+    std::vector<uint8_t> bytes;
+    esp_err_t err = get_value(handle, key, type, bytes);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+    if (bytes.size() != sizeof(T) || !out_value)
+    {
+      return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, bytes.data(), sizeof(T));
+    return ESP_OK;
+  }
+
+  esp_err_t get_bytes(nvs_handle_t handle, const char *key, ValueType type, void *out_value, size_t *length)
+  {
+    std::vector<uint8_t> bytes;
+    esp_err_t err = get_value(handle, key, type, bytes);
+    if (err != ESP_OK)
+    {
+      return err;
+    }
+    if (!length)
+    {
+      return ESP_ERR_INVALID_ARG;
+    }
+    if (!out_value)
+    {
+      *length = bytes.size();
+      return ESP_OK;
+    }
+    if (*length < bytes.size())
+    {
+      return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, bytes.data(), bytes.size());
+    *length = bytes.size();
+    return ESP_OK;
+  }
+} // namespace
+
+esp_err_t nvs_flash_init()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!initialised_)
+  {
+    load_file();
+    initialised_ = true;
+  }
+  return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  store_.clear();
+  save_file();
+  return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name_space, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!initialised_)
+  {
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+  }
+  if (!name_space || !out_handle)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (open_mode == NVS_READONLY && store_.find(name_space) == store_.end())
+  {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  nvs_handle_t handle = next_handle_++;
+  handles_[handle] = Handle{name_space, open_mode == NVS_READWRITE};
+  *out_handle = handle;
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  handles_.erase(handle);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (handles_.find(handle) == handles_.end())
+  {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  save_file();
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = handles_.find(handle);
+  if (found == handles_.end() || !key)
+  {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  return store_[found->second.name_space].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = handles_.find(handle);
+  if (found == handles_.end())
+  {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  store_[found->second.name_space].clear();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+  return set_value(handle, key, ValueType::U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value)
+{
+  return set_value(handle, key, ValueType::U16, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+  return set_value(handle, key, ValueType::U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+  if (!value)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // Stored with the terminator, so nvs_get_str reports the same lengths as on the device.
+  return set_value(handle, key, ValueType::Str, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+  return set_value(handle, key, ValueType::Blob, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *out_value)
+{
+  return get_integer(handle, key, ValueType::U8, out_value);
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value)
+{
+  return get_integer(handle, key, ValueType::U16, out_value);
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+  return get_integer(handle, key, ValueType::U32, out_value);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+  return get_bytes(handle, key, ValueType::Str, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+  return get_bytes(handle, key, ValueType::Blob, out_value, length);
+}
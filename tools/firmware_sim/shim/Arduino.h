@@ -0,0 +1,82 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 core: timing, Serial, the ESP object and String.
+// Serial is backed by stdin/stdout or a pseudo-terminal (see firmware_sim --serial).
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <esp_attr.h>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <pgmspace.h>
+
+#include "WString.h"
+
+#define F(string_literal) (string_literal)
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+uint32_t getCpuFrequencyMhz();
+
+class HardwareSerial
+{
+public:
+  void begin(unsigned long baud);
+  void end();
+  void setTimeout(unsigned long timeout_ms);
+  int available();
+  int read();
+  int peek();
+  void flush();
+
+  size_t write(uint8_t value);
+  size_t write(const uint8_t *data, size_t length);
+  size_t write(const char *data, size_t length);
+
+  size_t print(const char *value);
+  size_t print(const String &value);
+  size_t print(char value);
+  size_t print(int value);
+  size_t print(unsigned int value);
+  size_t print(long value);
+  size_t print(unsigned long value);
+  size_t println();
+  size_t println(const char *value);
+  size_t println(const String &value);
+  size_t println(int value);
+  size_t println(unsigned long value);
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+  explicit operator bool() const { return true; }
+
+private:
+  unsigned long baud_ = 0;
+  bool started_ = false;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getCpuFreqMHz();
+  // Derived from CLOCK_MONOTONIC at getCpuFreqMHz(), so cycle deltas convert to time the
+  // same way they do on the device.
+  uint32_t getCycleCount();
+  const char *getSdkVersion();
+  void restart();
+};
+
+extern EspClass ESP;
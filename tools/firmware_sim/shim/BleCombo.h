@@ -0,0 +1,117 @@
+#pragma once
+
+// Host stand-in for the BleCombo library. Reports are counted (and optionally logged or
+// delayed to mimic the BLE connection interval) instead of being sent; see
+// firmware_sim --ble-*.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "WString.h"
+
+typedef uint8_t MediaKeyReport[2];
+
+constexpr uint8_t KEY_LEFT_CTRL = 0x80;
+constexpr uint8_t KEY_LEFT_SHIFT = 0x81;
+constexpr uint8_t KEY_LEFT_ALT = 0x82;
+constexpr uint8_t KEY_LEFT_GUI = 0x83;
+constexpr uint8_t KEY_RIGHT_CTRL = 0x84;
+constexpr uint8_t KEY_RIGHT_SHIFT = 0x85;
+constexpr uint8_t KEY_RIGHT_ALT = 0x86;
+constexpr uint8_t KEY_RIGHT_GUI = 0x87;
+
+constexpr uint8_t KEY_UP_ARROW = 0xDA;
+constexpr uint8_t KEY_DOWN_ARROW = 0xD9;
+constexpr uint8_t KEY_LEFT_ARROW = 0xD8;
+constexpr uint8_t KEY_RIGHT_ARROW = 0xD7;
+constexpr uint8_t KEY_BACKSPACE = 0xB2;
+constexpr uint8_t KEY_TAB = 0xB3;
+constexpr uint8_t KEY_RETURN = 0xB0;
+constexpr uint8_t KEY_ESC = 0xB1;
+constexpr uint8_t KEY_INSERT = 0xD1;
+constexpr uint8_t KEY_DELETE = 0xD4;
+constexpr uint8_t KEY_PAGE_UP = 0xD3;
+constexpr uint8_t KEY_PAGE_DOWN = 0xD6;
+constexpr uint8_t KEY_HOME = 0xD2;
+constexpr uint8_t KEY_END = 0xD5;
+constexpr uint8_t KEY_CAPS_LOCK = 0xC1;
+constexpr uint8_t KEY_F1 = 0xC2;
+constexpr uint8_t KEY_F2 = 0xC3;
+constexpr uint8_t KEY_F3 = 0xC4;
+constexpr uint8_t KEY_F4 = 0xC5;
+constexpr uint8_t KEY_F5 = 0xC6;
+constexpr uint8_t KEY_F6 = 0xC7;
+constexpr uint8_t KEY_F7 = 0xC8;
+constexpr uint8_t KEY_F8 = 0xC9;
+constexpr uint8_t KEY_F9 = 0xCA;
+constexpr uint8_t KEY_F10 = 0xCB;
+constexpr uint8_t KEY_F11 = 0xCC;
+constexpr uint8_t KEY_F12 = 0xCD;
+
+const MediaKeyReport KEY_MEDIA_NEXT_TRACK = {1, 0};
+const MediaKeyReport KEY_MEDIA_PREVIOUS_TRACK = {2, 0};
+const MediaKeyReport KEY_MEDIA_STOP = {4, 0};
+const MediaKeyReport KEY_MEDIA_PLAY_PAUSE = {8, 0};
+const MediaKeyReport KEY_MEDIA_MUTE = {16, 0};
+const MediaKeyReport KEY_MEDIA_VOLUME_UP = {32, 0};
+const MediaKeyReport KEY_MEDIA_VOLUME_DOWN = {64, 0};
+const MediaKeyReport KEY_MEDIA_WWW_HOME = {128, 0};
+const MediaKeyReport KEY_MEDIA_LOCAL_MACHINE_BROWSER = {0, 1};
+const MediaKeyReport KEY_MEDIA_CALCULATOR = {0, 2};
+const MediaKeyReport KEY_MEDIA_WWW_BOOKMARKS = {0, 4};
+const MediaKeyReport KEY_MEDIA_WWW_SEARCH = {0, 8};
+const MediaKeyReport KEY_MEDIA_WWW_STOP = {0, 16};
+const MediaKeyReport KEY_MEDIA_WWW_BACK = {0, 32};
+const MediaKeyReport KEY_MEDIA_CONSUMER_CONTROL_CONFIGURATION = {0, 64};
+const MediaKeyReport KEY_MEDIA_EMAIL_READER = {0, 128};
+
+constexpr uint8_t MOUSE_LEFT = 1;
+constexpr uint8_t MOUSE_RIGHT = 2;
+constexpr uint8_t MOUSE_MIDDLE = 4;
+constexpr uint8_t MOUSE_BACK = 8;
+constexpr uint8_t MOUSE_FORWARD = 16;
+
+class BleComboKeyboard
+{
+public:
+  void begin();
+  void end();
+  bool isConnected();
+
+  size_t press(uint8_t key);
+  size_t press(const MediaKeyReport key);
+  size_t release(uint8_t key);
+  size_t release(const MediaKeyReport key);
+  size_t write(uint8_t key);
+  size_t write(const MediaKeyReport key);
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *text);
+  void releaseAll();
+
+  // The fork's extra collections (lib/ESP32-BLE-Combo).
+  static const size_t kMaxExtraInputReports = 4;
+  bool addCollection(const uint8_t *fragment, size_t size, const uint8_t *reportIds, size_t reportIdCount);
+  bool hasInputReport(uint8_t reportId) const;
+  bool sendInputReport(uint8_t reportId, const uint8_t *report, size_t length);
+
+private:
+  uint8_t extra_report_ids_[kMaxExtraInputReports] = {};
+  size_t extra_report_count_ = 0;
+};
+
+class BleComboMouse
+{
+public:
+  void begin();
+  void end();
+  bool isConnected();
+
+  void click(uint8_t buttons = MOUSE_LEFT);
+  void move(signed char x, signed char y, signed char wheel = 0, signed char h_wheel = 0);
+  void press(uint8_t buttons = MOUSE_LEFT);
+  void release(uint8_t buttons = MOUSE_LEFT);
+  bool isPressed(uint8_t buttons = MOUSE_LEFT);
+};
+
+extern BleComboKeyboard Keyboard;
+extern BleComboMouse Mouse;
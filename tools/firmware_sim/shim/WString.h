@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Arduino String subset used by the firmware and by ArduinoJson's String adapter. Storage
+// comes from malloc/realloc, as in the Arduino core, so alloc_counter sees the same
+// allocations it would on the device.
+class String
+{
+public:
+  String(const char *value = "");
+  String(const char *value, size_t length);
+  String(const String &other);
+  String(String &&other) noexcept;
+  explicit String(char value);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(double value, unsigned int decimals = 2);
+  ~String();
+
+  String &operator=(const String &other);
+  String &operator=(String &&other) noexcept;
+  String &operator=(const char *value);
+
+  bool reserve(size_t capacity);
+  size_t length() const { return length_; }
+  bool isEmpty() const { return length_ == 0; }
+  const char *c_str() const { return buffer_ ? buffer_ : ""; }
+  explicit operator bool() const { return buffer_ != nullptr; }
+
+  bool concat(const String &value);
+  bool concat(const char *value);
+  bool concat(const char *value, size_t length);
+  bool concat(char value);
+  bool concat(unsigned char value);
+  bool concat(int value);
+  bool concat(unsigned int value);
+  bool concat(long value);
+  bool concat(unsigned long value);
+
+  template <typename T>
+  String &operator+=(const T &value)
+  {
+    concat(value);
+    return *this;
+  }
+
+  bool equals(const String &other) const;
+  bool equals(const char *other) const;
+  bool equalsIgnoreCase(const String &other) const;
+  bool operator==(const String &other) const { return equals(other); }
+  bool operator==(const char *other) const { return equals(other); }
+  bool operator!=(const String &other) const { return !equals(other); }
+  bool operator!=(const char *other) const { return !equals(other); }
+  bool operator<(const String &other) const;
+
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char value);
+  char operator[](unsigned int index) const;
+  char &operator[](unsigned int index);
+
+  int indexOf(char value, unsigned int from = 0) const;
+  int indexOf(const String &value, unsigned int from = 0) const;
+  int lastIndexOf(char value) const;
+  int lastIndexOf(const String &value) const;
+  String substring(unsigned int begin) const;
+  String substring(unsigned int begin, unsigned int end) const;
+
+  void replace(char find, char replacement);
+  void replace(const String &find, const String &replacement);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  bool ensure_capacity(size_t capacity);
+  void assign(const char *value, size_t length);
+  void release();
+
+  char *buffer_ = nullptr;
+  size_t capacity_ = 0;
+  size_t length_ = 0;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
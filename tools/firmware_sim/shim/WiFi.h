@@ -0,0 +1,15 @@
+#pragma once
+
+// Only the types wifi_manager.h puts in its interface; firmware_sim replaces wifi_manager
+// itself with wifi_manager_sim.cpp, so no radio is modelled here.
+
+#include <cstdint>
+
+#include <Arduino.h>
+
+typedef int WiFiEvent_t;
+
+typedef union
+{
+  uint8_t reserved[64];
+} WiFiEventInfo_t;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "WString.h"
+
+class base64
+{
+public:
+  static String encode(const uint8_t *data, size_t length);
+  static String encode(const String &text);
+};
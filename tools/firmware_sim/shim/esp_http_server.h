@@ -0,0 +1,214 @@
+#pragma once
+
+// esp_http_server API over Linux sockets (http_server_shim.cpp). Like the ESP-IDF server,
+// one "httpd" task multiplexes every session with select() and runs handlers inline, so a
+// slow handler stalls every other client exactly as it does on the device.
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+
+#define ESP_ERR_HTTPD_BASE 0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_RESP_SEND (ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_ALLOC_MEM (ESP_ERR_HTTPD_BASE + 7)
+#define ESP_ERR_HTTPD_TASK (ESP_ERR_HTTPD_BASE + 8)
+
+#define HTTPD_RESP_USE_STRLEN -1
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+#define HTTPD_MAX_URI_LEN 512
+
+// Same numbering as http_parser, which ESP-IDF uses; ws frames arrive with method 0.
+enum httpd_method_t
+{
+  HTTP_DELETE = 0,
+  HTTP_GET = 1,
+  HTTP_HEAD = 2,
+  HTTP_POST = 3,
+  HTTP_PUT = 4,
+  HTTP_OPTIONS = 6,
+  HTTP_PATCH = 28,
+  HTTP_ANY = -1
+};
+
+typedef void *httpd_handle_t;
+
+struct httpd_req_t
+{
+  httpd_handle_t handle;
+  int method;
+  // const in ESP-IDF; left writable here so the shim can fill it in place.
+  char uri[HTTPD_MAX_URI_LEN + 1];
+  size_t content_len;
+  void *aux;
+  void *user_ctx;
+  void *sess_ctx;
+  void (*free_ctx)(void *ctx);
+  bool ignore_sess_ctx_changes;
+};
+
+typedef esp_err_t (*httpd_handler_t)(httpd_req_t *req);
+
+struct httpd_uri_t
+{
+  const char *uri;
+  httpd_method_t method;
+  httpd_handler_t handler;
+  void *user_ctx;
+  bool is_websocket;
+  bool handle_ws_control_frames;
+  const char *supported_subprotocol;
+};
+
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+typedef esp_err_t (*httpd_open_func_t)(httpd_handle_t handle, int sockfd);
+typedef void (*httpd_close_func_t)(httpd_handle_t handle, int sockfd);
+
+struct httpd_config_t
+{
+  unsigned task_priority;
+  size_t stack_size;
+  BaseType_t core_id;
+  uint16_t server_port;
+  uint16_t ctrl_port;
+  uint16_t max_open_sockets;
+  uint16_t max_uri_handlers;
+  uint16_t max_resp_headers;
+  uint16_t backlog_conn;
+  bool lru_purge_enable;
+  uint16_t recv_wait_timeout;
+  uint16_t send_wait_timeout;
+  void *global_user_ctx;
+  void (*global_user_ctx_free_fn)(void *ctx);
+  void *global_transport_ctx;
+  void (*global_transport_ctx_free_fn)(void *ctx);
+  bool enable_so_linger;
+  int linger_timeout;
+  bool keep_alive_enable;
+  int keep_alive_idle;
+  int keep_alive_interval;
+  int keep_alive_count;
+  httpd_open_func_t open_fn;
+  httpd_close_func_t close_fn;
+  httpd_uri_match_func_t uri_match_fn;
+};
+
+#define HTTPD_DEFAULT_CONFIG()                 \
+  {                                            \
+    .task_priority = tskIDLE_PRIORITY + 5,     \
+    .stack_size = 4096,                        \
+    .core_id = tskNO_AFFINITY,                 \
+    .server_port = 80,                         \
+    .ctrl_port = 32768,                        \
+    .max_open_sockets = 7,                     \
+    .max_uri_handlers = 8,                     \
+    .max_resp_headers = 8,                     \
+    .backlog_conn = 5,                         \
+    .lru_purge_enable = false,                 \
+    .recv_wait_timeout = 5,                    \
+    .send_wait_timeout = 5,                    \
+    .global_user_ctx = nullptr,                \
+    .global_user_ctx_free_fn = nullptr,        \
+    .global_transport_ctx = nullptr,           \
+    .global_transport_ctx_free_fn = nullptr,   \
+    .enable_so_linger = false,                 \
+    .linger_timeout = 0,                       \
+    .keep_alive_enable = false,                \
+    .keep_alive_idle = 0,                      \
+    .keep_alive_interval = 0,                  \
+    .keep_alive_count = 0,                     \
+    .open_fn = nullptr,                        \
+    .close_fn = nullptr,                       \
+    .uri_match_fn = nullptr                    \
+  }
+
+enum httpd_err_code_t
+{
+  HTTPD_500_INTERNAL_SERVER_ERROR = 0,
+  HTTPD_501_METHOD_NOT_IMPLEMENTED,
+  HTTPD_505_VERSION_NOT_SUPPORTED,
+  HTTPD_400_BAD_REQUEST,
+  HTTPD_401_UNAUTHORIZED,
+  HTTPD_403_FORBIDDEN,
+  HTTPD_404_NOT_FOUND,
+  HTTPD_405_METHOD_NOT_ALLOWED,
+  HTTPD_408_REQ_TIMEOUT,
+  HTTPD_411_LENGTH_REQUIRED,
+  HTTPD_414_URI_TOO_LONG,
+  HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE,
+  HTTPD_ERR_CODE_MAX
+};
+
+typedef esp_err_t (*httpd_err_handler_func_t)(httpd_req_t *req, httpd_err_code_t error);
+
+enum httpd_ws_type_t
+{
+  HTTPD_WS_TYPE_CONTINUE = 0x0,
+  HTTPD_WS_TYPE_TEXT = 0x1,
+  HTTPD_WS_TYPE_BINARY = 0x2,
+  HTTPD_WS_TYPE_CLOSE = 0x8,
+  HTTPD_WS_TYPE_PING = 0x9,
+  HTTPD_WS_TYPE_PONG = 0xA
+};
+
+enum httpd_ws_client_info_t
+{
+  HTTPD_WS_CLIENT_INVALID = 0x0,
+  HTTPD_WS_CLIENT_HTTP = 0x1,
+  HTTPD_WS_CLIENT_WEBSOCKET = 0x2
+};
+
+struct httpd_ws_frame_t
+{
+  bool final;
+  bool fragmented;
+  httpd_ws_type_t type;
+  uint8_t *payload;
+  size_t len;
+};
+
+typedef void (*httpd_work_fn_t)(void *arg);
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char *uri, httpd_method_t method);
+esp_err_t httpd_register_err_handler(httpd_handle_t handle, httpd_err_code_t error, httpd_err_handler_func_t handler);
+bool httpd_uri_match_wildcard(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len);
+size_t httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size);
+size_t httpd_req_get_url_query_len(httpd_req_t *req);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char *query, const char *key, char *val, size_t val_size);
+int httpd_req_to_sockfd(httpd_req_t *req);
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_sendstr(httpd_req_t *req, const char *str);
+esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *req, const char *str);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *message);
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
+int httpd_socket_send(httpd_handle_t handle, int sockfd, const char *buf, size_t buf_len, int flags);
+esp_err_t httpd_get_client_list(httpd_handle_t handle, size_t *fds, int *client_fds);
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len);
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame);
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t handle, int fd, httpd_ws_frame_t *frame);
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t handle, int fd);
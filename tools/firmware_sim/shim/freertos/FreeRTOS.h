@@ -0,0 +1,45 @@
+#pragma once
+
+// FreeRTOS API subset used by the firmware, implemented over POSIX threads in
+// freertos_shim.cpp. One tick is one millisecond, as in the Arduino-ESP32 build.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sdkconfig.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+// ESP-IDF counts stack depth in bytes.
+typedef uint8_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFu
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define portNUM_PROCESSORS 2
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Control blocks only have to hold a pointer to the host object; the sizes keep
+// memory_budget's arithmetic in the same range as the ESP32 build.
+struct StaticTask_t
+{
+  void *host;
+  uint8_t reserved[344];
+};
+
+struct StaticQueue_t
+{
+  void *host;
+  uint8_t reserved[76];
+};
+
+typedef StaticQueue_t StaticSemaphore_t;
+
+BaseType_t xPortGetCoreID();
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct SimStreamBuffer *StreamBufferHandle_t;
+
+struct StaticStreamBuffer_t
+{
+  void *host;
+  uint8_t reserved[28];
+};
+
+// `storage` must hold size + 1 bytes, as in FreeRTOS; the shim keeps its own copy.
+StreamBufferHandle_t xStreamBufferCreateStatic(size_t size,
+                                               size_t trigger_level,
+                                               uint8_t *storage,
+                                               StaticStreamBuffer_t *buffer);
+// Waits up to ticks_to_wait for room for all of `length`, then writes what fits.
+size_t xStreamBufferSend(StreamBufferHandle_t buffer, const void *data, size_t length, TickType_t ticks_to_wait);
+// Waits up to ticks_to_wait for the trigger level, then reads what is there.
+size_t xStreamBufferReceive(StreamBufferHandle_t buffer, void *data, size_t length, TickType_t ticks_to_wait);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t buffer);
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t buffer);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t buffer);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct SimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t code,
+                               const char *name,
+                               uint32_t stack_depth,
+                               void *parameters,
+                               UBaseType_t priority,
+                               StackType_t *stack,
+                               StaticTask_t *task_buffer);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t code,
+                                           const char *name,
+                                           uint32_t stack_depth,
+                                           void *parameters,
+                                           UBaseType_t priority,
+                                           StackType_t *stack,
+                                           StaticTask_t *task_buffer,
+                                           BaseType_t core_id);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code,
+                                   const char *name,
+                                   uint32_t stack_depth,
+                                   void *parameters,
+                                   UBaseType_t priority,
+                                   TaskHandle_t *created_task,
+                                   BaseType_t core_id);
+BaseType_t xTaskCreate(TaskFunction_t code,
+                       const char *name,
+                       uint32_t stack_depth,
+                       void *parameters,
+                       UBaseType_t priority,
+                       TaskHandle_t *created_task);
+
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TaskHandle_t xTaskGetHandle(const char *name);
+const char *pcTaskGetName(TaskHandle_t task);
+// Host stacks are painted at creation; this reports the configured size minus the deepest
+// use seen so far. x86-64 frames run larger than Xtensa ones, so treat it as an upper bound.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+UBaseType_t uxTaskGetNumberOfTasks();
@@ -0,0 +1,5 @@
+#pragma once
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
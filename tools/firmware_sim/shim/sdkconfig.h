@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for the generated ESP-IDF sdkconfig: the values the firmware sources test
+// for, matching the nodemcu-32s Arduino build.
+#define CONFIG_FREERTOS_UNICORE 0
+#define CONFIG_ARDUINO_RUNNING_CORE 1
+#define CONFIG_ARDUINO_LOOP_STACK_SIZE 8192
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_BT_ENABLED 1
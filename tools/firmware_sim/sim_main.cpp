@@ -0,0 +1,202 @@
+// Runs the firmware's setup() and loop() as a Linux process. The HTTP/WebSocket API is
+// served by a host esp_http_server (http_server_shim.cpp), Serial is stdio or a pty, NVS
+// is an optional file and the BLE HID objects count reports instead of sending them.
+
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "sim_options.h"
+
+void setup();
+void loop();
+
+namespace firmware_sim
+{
+  Options &options()
+  {
+    static Options instance;
+    return instance;
+  }
+} // namespace firmware_sim
+
+namespace
+{
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --host ADDR            HTTP listen address (default 127.0.0.1)\n"
+            "  --port N               HTTP port instead of the firmware's 80 (default 8080)\n"
+            "  --http-log             log every request with its status and handler time\n"
+            "  --serial stdio|pty|none\n"
+            "                         where Serial reads and writes (default stdio)\n"
+            "  --nvs FILE             persist NVS in FILE (default: in memory only)\n"
+            "  --ble-disconnected     report the BLE host as not connected\n"
+            "  --ble-report-us N      time each HID report takes to send (default 0)\n"
+            "  --ble-log              print every HID report to stderr\n"
+            "  --wifi-connect-ms N    time a station connect takes (default 1500)\n"
+            "  --wifi-unreachable     station connects always time out\n"
+            "  --wifi-scan-ms N       time a network scan takes (default 1200)\n",
+            program);
+  }
+
+  bool parse_number(const char *text, uint32_t &value)
+  {
+    char *end = nullptr;
+    unsigned long parsed = strtoul(text, &end, 10);
+    if (!text[0] || *end != '\0')
+    {
+      return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+  }
+
+  bool parse_options(int argc, char **argv, firmware_sim::Options &options)
+  {
+    for (int index = 1; index < argc; ++index)
+    {
+      std::string flag = argv[index];
+      const char *value = (index + 1 < argc) ? argv[index + 1] : nullptr;
+      uint32_t number = 0;
+      if (flag == "--http-log")
+      {
+        options.http_log = true;
+      }
+      else if (flag == "--ble-disconnected")
+      {
+        options.ble_connected = false;
+      }
+      else if (flag == "--ble-log")
+      {
+        options.ble_log = true;
+      }
+      else if (flag == "--wifi-unreachable")
+      {
+        options.wifi_reachable = false;
+      }
+      else if (!value)
+      {
+        fprintf(stderr, "unknown option or missing value: %s\n", flag.c_str());
+        return false;
+      }
+      else
+      {
+        ++index;
+        if (flag == "--host")
+        {
+          options.http_host = value;
+        }
+        else if (flag == "--port" && parse_number(value, number) && number <= 65535)
+        {
+          options.http_port = static_cast<uint16_t>(number);
+        }
+        else if (flag == "--serial" && strcmp(value, "stdio") == 0)
+        {
+          options.serial = firmware_sim::SerialBackend::Stdio;
+        }
+        else if (flag == "--serial" && strcmp(value, "pty") == 0)
+        {
+          options.serial = firmware_sim::SerialBackend::Pty;
+        }
+        else if (flag == "--serial" && strcmp(value, "none") == 0)
+        {
+          options.serial = firmware_sim::SerialBackend::None;
+        }
+        else if (flag == "--nvs")
+        {
+          options.nvs_path = value;
+        }
+        else if (flag == "--ble-report-us" && parse_number(value, number))
+        {
+          options.ble_report_us = number;
+        }
+        else if (flag == "--wifi-connect-ms" && parse_number(value, number))
+        {
+          options.wifi_connect_ms = number;
+        }
+        else if (flag == "--wifi-scan-ms" && parse_number(value, number))
+        {
+          options.wifi_scan_ms = number;
+        }
+        else
+        {
+          fprintf(stderr, "bad option: %s %s\n", flag.c_str(), value);
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Same shape as the Arduino core's loopTask so task_monitor and crash_snapshot find it.
+  void loop_task(void *param)
+  {
+    (void)param;
+    setup();
+    for (;;)
+    {
+      loop();
+    }
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  firmware_sim::Options &options = firmware_sim::options();
+  if (!parse_options(argc, argv, options))
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  // Block the shutdown signals before any task exists so only sigwait() below sees them.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (!firmware_sim::start_serial())
+  {
+    return 1;
+  }
+
+  TaskHandle_t loop_handle = nullptr;
+  if (xTaskCreatePinnedToCore(loop_task,
+                              "loopTask",
+                              CONFIG_ARDUINO_LOOP_STACK_SIZE,
+                              nullptr,
+                              1,
+                              &loop_handle,
+                              CONFIG_ARDUINO_RUNNING_CORE) != pdPASS)
+  {
+    fprintf(stderr, "firmware_sim: cannot start loopTask\n");
+    return 1;
+  }
+
+  int received = 0;
+  sigwait(&signals, &received);
+
+  firmware_sim::HidCounters counters = firmware_sim::hid_counters();
+  fprintf(stderr,
+          "\nfirmware_sim: %s, HID reports keyboard=%llu consumer=%llu mouse=%llu gamepad=%llu\n",
+          received == SIGINT ? "interrupted" : "terminated",
+          static_cast<unsigned long long>(counters.keyboard_reports),
+          static_cast<unsigned long long>(counters.consumer_reports),
+          static_cast<unsigned long long>(counters.mouse_reports),
+          static_cast<unsigned long long>(counters.gamepad_reports));
+  fflush(stdout);
+  fflush(stderr);
+  // Firmware tasks never return; skip static destructors they may still be using.
+  _exit(0);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Command-line settings shared by the host stand-ins (see sim_main.cpp for the flags).
+namespace firmware_sim
+{
+  enum class SerialBackend : uint8_t
+  {
+    Stdio = 0,
+    Pty,
+    None
+  };
+
+  struct Options
+  {
+    std::string http_host = "127.0.0.1";
+    uint16_t http_port = 8080;
+    bool http_log = false;
+    SerialBackend serial = SerialBackend::Stdio;
+    std::string nvs_path;
+    bool ble_connected = true;
+    uint32_t ble_report_us = 0;
+    bool ble_log = false;
+    uint32_t wifi_connect_ms = 1500;
+    bool wifi_reachable = true;
+    uint32_t wifi_scan_ms = 1200;
+  };
+
+  Options &options();
+
+  // Opens the Serial backend chosen in options(); false if a pty could not be created.
+  bool start_serial();
+
+  struct HidCounters
+  {
+    uint64_t keyboard_reports;
+    uint64_t consumer_reports;
+    uint64_t mouse_reports;
+    uint64_t gamepad_reports;
+  };
+
+  HidCounters hid_counters();
+} // namespace firmware_sim
@@ -0,0 +1,326 @@
+#include "wifi_manager.h"
+
+#include <sdkconfig.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "sim_options.h"
+
+// Host stand-in for src/wifi_manager.cpp. There is no radio: a connect succeeds after
+// --wifi-connect-ms unless --wifi-unreachable is given, and scans return a fixed list
+// after --wifi-scan-ms. The published wifi_state payloads, the connect task and the
+// state lock match the firmware so the HTTP and transport paths see the same behaviour.
+// The AP/STA mode logic itself is exercised by tools/wifi_sim.
+namespace wifi_manager
+{
+  namespace
+  {
+    constexpr const char *CONFIG_AP_SSID = "uhid-setup";
+    constexpr size_t WIFI_MAX_SSID_LENGTH = 32;
+    constexpr size_t WIFI_MAX_PASSWORD_LENGTH = 64;
+    constexpr size_t WIFI_STATE_MESSAGE_CAPACITY = 48;
+    constexpr size_t WIFI_STATE_PAYLOAD_CAPACITY = 384;
+    constexpr uint32_t WIFI_CONNECT_STACK_BYTES = 4096;
+
+    struct SimNetwork
+    {
+      const char *ssid;
+      int rssi;
+      int channel;
+      const char *auth;
+    };
+
+    constexpr SimNetwork SIM_NETWORKS[] = {
+        {"sim-home", -48, 6, "wpa2_psk"},
+        {"sim-office", -63, 11, "wpa2_wpa3_psk"},
+        {"sim-guest", -71, 1, "open"},
+    };
+
+    struct WifiConnectRequest
+    {
+      bool keep_ap_active;
+      char ssid[WIFI_MAX_SSID_LENGTH + 1];
+      char password[WIFI_MAX_PASSWORD_LENGTH + 1];
+    };
+
+    Callbacks callbacks_;
+    SemaphoreHandle_t state_mutex_ = nullptr;
+    QueueHandle_t wifi_connect_request_queue_ = nullptr;
+    TaskHandle_t wifi_connect_task_handle_ = nullptr;
+    volatile bool wifi_connect_busy_ = false;
+    bool configuration_mode_ = false;
+    const char *last_state_ = nullptr;
+    char last_ssid_[WIFI_MAX_SSID_LENGTH + 1] = {};
+    char last_message_[WIFI_STATE_MESSAGE_CAPACITY] = {};
+
+    // Stands in for the Wi-Fi driver's power-save mode. Like WiFi.setSleep(), setting the
+    // mode already in effect fails, and the driver starts in modem sleep.
+    enum class SleepMode
+    {
+      None,
+      MinModem
+    };
+    SleepMode sleep_mode_ = SleepMode::MinModem;
+
+    bool set_sleep(SleepMode mode)
+    {
+      if (mode == sleep_mode_)
+      {
+        return false;
+      }
+      sleep_mode_ = mode;
+      return true;
+    }
+
+    class WifiStateLock
+    {
+    public:
+      WifiStateLock()
+      {
+        if (!state_mutex_)
+        {
+          state_mutex_ = xSemaphoreCreateMutex();
+        }
+        xSemaphoreTake(state_mutex_, portMAX_DELAY);
+      }
+
+      ~WifiStateLock()
+      {
+        xSemaphoreGive(state_mutex_);
+      }
+    };
+
+    void copy_bounded(char *out, size_t capacity, const char *value)
+    {
+      snprintf(out, capacity, "%s", value ? value : "");
+    }
+
+    void dispatch_wifi_state_locked()
+    {
+      if (!callbacks_.dispatch_transport_json || !last_state_)
+      {
+        return;
+      }
+      char payload[WIFI_STATE_PAYLOAD_CAPACITY];
+      int length = snprintf(payload, sizeof(payload), "{\"event\":\"wifi_state\",\"state\":\"%s\"", last_state_);
+      if (last_ssid_[0] != '\0')
+      {
+        length += snprintf(payload + length, sizeof(payload) - length, ",\"ssid\":\"%s\"", last_ssid_);
+      }
+      if (last_message_[0] != '\0')
+      {
+        length += snprintf(payload + length, sizeof(payload) - length, ",\"message\":\"%s\"", last_message_);
+      }
+      snprintf(payload + length, sizeof(payload) - length, "}");
+      callbacks_.dispatch_transport_json(payload);
+    }
+
+    void publish_wifi_state(const char *state, const char *ssid, const char *message)
+    {
+      WifiStateLock lock;
+      if (ssid)
+      {
+        copy_bounded(last_ssid_, sizeof(last_ssid_), ssid);
+      }
+      copy_bounded(last_message_, sizeof(last_message_), message);
+      last_state_ = state;
+      dispatch_wifi_state_locked();
+    }
+
+    bool connect_to_station(const char *ssid, const char *password, bool keep_ap_active)
+    {
+      publish_wifi_state("connecting", ssid, nullptr);
+      const firmware_sim::Options &options = firmware_sim::options();
+      vTaskDelay(pdMS_TO_TICKS(options.wifi_connect_ms));
+      if (!options.wifi_reachable)
+      {
+        publish_wifi_state("failed", ssid, "Connection timed out");
+        return false;
+      }
+
+      if (callbacks_.save_credentials && !callbacks_.save_credentials(String(ssid), String(password)))
+      {
+        publish_wifi_state("failed", ssid, "Failed to save WiFi credentials");
+        return false;
+      }
+      {
+        WifiStateLock lock;
+        if (!keep_ap_active)
+        {
+          configuration_mode_ = false;
+        }
+      }
+      if (callbacks_.send_event)
+      {
+        callbacks_.send_event("wifi_sta_connected", ssid);
+      }
+      publish_wifi_state("connected", ssid, nullptr);
+      return true;
+    }
+
+    void wifi_connect_task(void *param)
+    {
+      (void)param;
+      for (;;)
+      {
+        WifiConnectRequest request = {};
+        if (xQueueReceive(wifi_connect_request_queue_, &request, portMAX_DELAY) != pdPASS)
+        {
+          continue;
+        }
+        wifi_connect_busy_ = true;
+        bool connected = connect_to_station(request.ssid, request.password, request.keep_ap_active);
+        wifi_connect_busy_ = false;
+        if (!connected && !request.keep_ap_active)
+        {
+          start_ap();
+          if (callbacks_.send_event)
+          {
+            callbacks_.send_event("wifi_config_mode", nullptr);
+          }
+        }
+      }
+    }
+  } // namespace
+
+  void init(const Callbacks &callbacks)
+  {
+    callbacks_ = callbacks;
+    WifiStateLock lock;
+    configuration_mode_ = false;
+    last_state_ = nullptr;
+    last_ssid_[0] = '\0';
+    last_message_[0] = '\0';
+  }
+
+  bool schedule_connect(const String &ssid, const String &password, bool keep_ap_active)
+  {
+    if (ssid.isEmpty() || wifi_connect_busy_)
+    {
+      return false;
+    }
+    if (!wifi_connect_request_queue_)
+    {
+      wifi_connect_request_queue_ = xQueueCreate(1, sizeof(WifiConnectRequest));
+      xTaskCreate(wifi_connect_task, "wifi_connect", WIFI_CONNECT_STACK_BYTES, nullptr, 1, &wifi_connect_task_handle_);
+    }
+    if (uxQueueMessagesWaiting(wifi_connect_request_queue_) > 0)
+    {
+      return false;
+    }
+    WifiConnectRequest request = {};
+    request.keep_ap_active = keep_ap_active;
+    copy_bounded(request.ssid, sizeof(request.ssid), ssid.c_str());
+    copy_bounded(request.password, sizeof(request.password), password.c_str());
+    return xQueueSend(wifi_connect_request_queue_, &request, 0) == pdPASS;
+  }
+
+  bool connect_saved_credentials()
+  {
+    String ssid;
+    String password;
+    if (!callbacks_.load_credentials || !callbacks_.load_credentials(ssid, password) || ssid.isEmpty())
+    {
+      return false;
+    }
+    return connect_to_station(ssid.c_str(), password.c_str(), false);
+  }
+
+  void start_ap()
+  {
+    {
+      WifiStateLock lock;
+      configuration_mode_ = true;
+    }
+    publish_wifi_state("ap", CONFIG_AP_SSID, nullptr);
+  }
+
+  void stop_ap()
+  {
+    {
+      WifiStateLock lock;
+      configuration_mode_ = false;
+    }
+    publish_wifi_state("idle", nullptr, nullptr);
+  }
+
+  bool set_power_save(bool enabled)
+  {
+    // No radio to put to sleep; the log shows the profile taking effect.
+    fprintf(stderr, "firmware_sim: wifi power save %s\n", enabled ? "on" : "off");
+#if defined(CONFIG_BT_ENABLED)
+    (void)enabled;
+    const SleepMode mode = SleepMode::MinModem;
+#else
+    const SleepMode mode = enabled ? SleepMode::MinModem : SleepMode::None;
+#endif
+    return sleep_mode_ == mode || set_sleep(mode);
+  }
+
+  bool is_configuration_mode()
+  {
+    WifiStateLock lock;
+    return configuration_mode_;
+  }
+
+  void append_state_json(JsonVariant doc)
+  {
+    WifiStateLock lock;
+    if (doc.isNull())
+    {
+      return;
+    }
+    doc["state"] = last_state_ ? last_state_ : "";
+    if (last_ssid_[0] != '\0')
+    {
+      doc["ssid"] = static_cast<const char *>(last_ssid_);
+    }
+    if (last_message_[0] != '\0')
+    {
+      doc["message"] = static_cast<const char *>(last_message_);
+    }
+  }
+
+  void send_cached_state()
+  {
+    WifiStateLock lock;
+    dispatch_wifi_state_locked();
+  }
+
+  void process()
+  {
+  }
+
+  void process_dns()
+  {
+  }
+
+  void on_event(WiFiEvent_t event, WiFiEventInfo_t info)
+  {
+    (void)event;
+    (void)info;
+  }
+
+  bool scan_networks(JsonArray results, String &error_message, int &error_code)
+  {
+    // The firmware holds the state lock for the whole scan; keep that so the stall shows.
+    WifiStateLock lock;
+    vTaskDelay(pdMS_TO_TICKS(firmware_sim::options().wifi_scan_ms));
+    for (const SimNetwork &network : SIM_NETWORKS)
+    {
+      JsonObject entry = results.add<JsonObject>();
+      entry["ssid"] = network.ssid;
+      entry["rssi"] = network.rssi;
+      entry["channel"] = network.channel;
+      entry["auth"] = network.auth;
+    }
+    error_message = "";
+    error_code = 0;
+    return true;
+  }
+} // namespace wifi_manager
@@ -0,0 +1,410 @@
+#include "fleet.h"
+
+#include <glob.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "json_scan.h"
+
+namespace fleet
+{
+  namespace
+  {
+    // Epoll tags below this are device indices; watched descriptors start here.
+    constexpr uint64_t kWatchTagBase = 1ULL << 32;
+
+    std::string short_name(const DeviceSpec &spec)
+    {
+      if (spec.kind == hostlink::LinkKind::WebSocket)
+      {
+        return spec.target.substr(0, spec.target.find('/'));
+      }
+      size_t slash = spec.target.rfind('/');
+      std::string name = slash == std::string::npos ? spec.target : spec.target.substr(slash + 1);
+      // A pty such as /dev/pts/3 would be "3" and read as an index; keep its directory.
+      if (slash != std::string::npos && !name.empty() &&
+          name.find_first_not_of("0123456789") == std::string::npos)
+      {
+        size_t parent = spec.target.rfind('/', slash - 1);
+        parent = (slash == 0 || parent == std::string::npos) ? 0 : parent + 1;
+        name = spec.target.substr(parent, slash - parent) + name;
+      }
+      return name;
+    }
+
+    std::string string_field(const hostlink::JsonMembers &members, const char *key)
+    {
+      std::string value;
+      const std::string *raw = hostlink::json_find(members, key);
+      if (raw)
+      {
+        hostlink::json_to_string(*raw, value);
+      }
+      return value;
+    }
+  } // namespace
+
+  bool Device::connected() const
+  {
+    return link.fd() >= 0;
+  }
+
+  const char *ble_state_to_string(BleState state)
+  {
+    switch (state)
+    {
+    case BleState::Connected:
+      return "connected";
+    case BleState::Disconnected:
+      return "disconnected";
+    case BleState::Unknown:
+    default:
+      return "?";
+    }
+  }
+
+  std::vector<std::string> discover(const std::string &pattern)
+  {
+    std::vector<std::string> paths;
+    glob_t matches = {};
+    if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+    {
+      for (size_t index = 0; index < matches.gl_pathc; ++index)
+      {
+        paths.push_back(matches.gl_pathv[index]);
+      }
+    }
+    globfree(&matches);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+  }
+
+  Fleet::Fleet()
+  {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  }
+
+  Fleet::~Fleet()
+  {
+    devices_.clear();
+    if (epoll_fd_ >= 0)
+    {
+      close(epoll_fd_);
+    }
+  }
+
+  size_t Fleet::add(const DeviceSpec &spec)
+  {
+    auto device = std::make_unique<Device>();
+    device->spec = spec;
+    device->name = short_name(spec);
+    devices_.push_back(std::move(device));
+    return devices_.size() - 1;
+  }
+
+  void Fleet::set_reopen_ms(uint32_t reopen_ms)
+  {
+    reopen_ms_ = reopen_ms;
+  }
+
+  bool Fleet::start(std::string &error)
+  {
+    if (epoll_fd_ < 0)
+    {
+      error = std::string("epoll_create1: ") + strerror(errno);
+      return false;
+    }
+    for (size_t index = 0; index < devices_.size(); ++index)
+    {
+      open_device(index);
+    }
+    return true;
+  }
+
+  bool Fleet::open_device(size_t index)
+  {
+    Device &device = *devices_[index];
+    device.next_open_ns = hostlink::now_ns() + static_cast<int64_t>(reopen_ms_) * 1000000;
+    bool opened = device.spec.kind == hostlink::LinkKind::WebSocket
+                      ? device.link.open_websocket(device.spec.target, device.open_error)
+                      : device.link.open_serial(device.spec.target, device.spec.baud, device.open_error);
+    if (!opened)
+    {
+      return false;
+    }
+    device.open_error.clear();
+    device.write_armed = false;
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, device.link.fd(), &event);
+    return true;
+  }
+
+  void Fleet::close_device(size_t index, const char *reason)
+  {
+    Device &device = *devices_[index];
+    if (!device.connected())
+    {
+      return;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, device.link.fd(), nullptr);
+    device.link.close();
+    device.open_error = reason;
+    // Whatever was in flight will never be answered; the state is stale until the device
+    // speaks again.
+    device.errors += device.pending.size();
+    device.pending.clear();
+    device.ready = false;
+    device.ble = BleState::Unknown;
+    device.next_open_ns = hostlink::now_ns() + static_cast<int64_t>(reopen_ms_) * 1000000;
+    ++device.reconnects;
+  }
+
+  std::vector<size_t> Fleet::select(const std::string &selector, std::string &unknown) const
+  {
+    std::vector<size_t> targets;
+    unknown.clear();
+    if (selector.empty() || selector == "all")
+    {
+      for (size_t index = 0; index < devices_.size(); ++index)
+      {
+        targets.push_back(index);
+      }
+      return targets;
+    }
+    size_t start = 0;
+    while (start <= selector.size())
+    {
+      size_t comma = selector.find(',', start);
+      std::string item = selector.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+      bool found = false;
+      for (size_t index = 0; !found && index < devices_.size(); ++index)
+      {
+        if (devices_[index]->name == item || devices_[index]->spec.target == item)
+        {
+          targets.push_back(index);
+          found = true;
+        }
+      }
+      char *end = nullptr;
+      unsigned long number = strtoul(item.c_str(), &end, 10);
+      if (!found && !item.empty() && *end == '\0' && number < devices_.size())
+      {
+        targets.push_back(number);
+        found = true;
+      }
+      if (!found && !item.empty())
+      {
+        unknown += unknown.empty() ? item : "," + item;
+      }
+      if (comma == std::string::npos)
+      {
+        break;
+      }
+      start = comma + 1;
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    return targets;
+  }
+
+  size_t Fleet::send(const std::vector<size_t> &targets, const std::string &command)
+  {
+    size_t accepted = 0;
+    int64_t now = hostlink::now_ns();
+    for (size_t index : targets)
+    {
+      Device &device = *devices_[index];
+      if (!device.connected())
+      {
+        continue;
+      }
+      device.link.send(command);
+      device.pending.push_back(now);
+      ++device.sent;
+      ++accepted;
+      if (!device.link.flush())
+      {
+        close_device(index, strerror(errno));
+        continue;
+      }
+      update_write_interest(index);
+    }
+    return accepted;
+  }
+
+  void Fleet::watch(int fd, std::function<void()> on_readable)
+  {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = kWatchTagBase + watched_.size();
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    watched_.emplace_back(fd, std::move(on_readable));
+  }
+
+  void Fleet::update_write_interest(size_t index)
+  {
+    Device &device = *devices_[index];
+    if (device.connected() && device.link.wants_write() != device.write_armed)
+    {
+      device.write_armed = device.link.wants_write();
+      epoll_event event = {};
+      event.events = EPOLLIN | (device.write_armed ? EPOLLOUT : 0u);
+      event.data.u64 = index;
+      epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, device.link.fd(), &event);
+    }
+  }
+
+  void Fleet::on_message(size_t index, const std::string &message)
+  {
+    Device &device = *devices_[index];
+    int64_t now = hostlink::now_ns();
+    hostlink::JsonMembers members;
+    if (!hostlink::json_members(message, members))
+    {
+      return;
+    }
+    std::string status = string_field(members, "status");
+    if (!status.empty())
+    {
+      if (device.pending.empty())
+      {
+        ++device.unmatched;
+      }
+      else
+      {
+        device.latency_us.record((now - device.pending.front()) / 1000);
+        device.pending.pop_front();
+        status == "ok" ? ++device.ok : ++device.errors;
+      }
+      device.last_reply = message;
+      if (on_reply)
+      {
+        on_reply(index, message);
+      }
+      return;
+    }
+
+    std::string event = string_field(members, "event");
+    if (event.empty())
+    {
+      return;
+    }
+    ++device.events;
+    device.last_event_ns = now;
+    if (event == "ready")
+    {
+      device.ready = true;
+    }
+    else if (event == "ble_connected")
+    {
+      device.ble = BleState::Connected;
+    }
+    else if (event == "ble_disconnected")
+    {
+      device.ble = BleState::Disconnected;
+    }
+    else if (event == "wifi_state")
+    {
+      device.wifi_state = string_field(members, "state");
+      device.wifi_ssid = string_field(members, "ssid");
+    }
+    if (on_event)
+    {
+      on_event(index, message);
+    }
+  }
+
+  void Fleet::poll(int timeout_ms)
+  {
+    int64_t now = hostlink::now_ns();
+    for (const auto &device : devices_)
+    {
+      if (!device->connected() && device->spec.kind == hostlink::LinkKind::Serial)
+      {
+        timeout_ms = static_cast<int>(
+            std::min<int64_t>(timeout_ms, std::max<int64_t>(0, (device->next_open_ns - now) / 1000000 + 1)));
+      }
+    }
+
+    epoll_event events[64];
+    int count = epoll_wait(epoll_fd_, events, 64, timeout_ms);
+    for (int event_index = 0; event_index < count; ++event_index)
+    {
+      uint64_t tag = events[event_index].data.u64;
+      if (tag >= kWatchTagBase)
+      {
+        watched_[tag - kWatchTagBase].second();
+        continue;
+      }
+      size_t index = static_cast<size_t>(tag);
+      Device &device = *devices_[index];
+      if (!device.connected())
+      {
+        continue;
+      }
+      uint32_t flags = events[event_index].events;
+      if ((flags & EPOLLOUT) && !device.link.flush())
+      {
+        close_device(index, strerror(errno));
+        continue;
+      }
+      if (flags & (EPOLLIN | EPOLLHUP | EPOLLERR))
+      {
+        if (!device.link.read([this, index](const std::string &message) { on_message(index, message); }))
+        {
+          close_device(index, "connection closed");
+          continue;
+        }
+      }
+      update_write_interest(index);
+    }
+
+    now = hostlink::now_ns();
+    for (size_t index = 0; index < devices_.size(); ++index)
+    {
+      Device &device = *devices_[index];
+      if (!device.connected() && device.spec.kind == hostlink::LinkKind::Serial && now >= device.next_open_ns)
+      {
+        open_device(index);
+      }
+    }
+  }
+
+  size_t Fleet::size() const
+  {
+    return devices_.size();
+  }
+
+  const Device &Fleet::device(size_t index) const
+  {
+    return *devices_[index];
+  }
+
+  size_t Fleet::outstanding() const
+  {
+    size_t total = 0;
+    for (const auto &device : devices_)
+    {
+      total += device->pending.size();
+    }
+    return total;
+  }
+
+  void Fleet::reset_counters()
+  {
+    for (auto &device : devices_)
+    {
+      device->sent = device->ok = device->errors = device->unmatched = 0;
+      device->pending.clear();
+      device->latency_us.reset();
+    }
+  }
+} // namespace fleet
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hdr_histogram.h"
+#include "link.h"
+
+// Many bridges on one epoll loop. Each device is a hostlink::Link (UART/pty or
+// WebSocket) with its own reply FIFO, latency histogram and the state it last announced
+// through ready, ble_connected/ble_disconnected and wifi_state events. The firmware has
+// no query for BLE or Wi-Fi state, so both stay unknown until the device reports a change.
+namespace fleet
+{
+  enum class BleState : uint8_t
+  {
+    Unknown = 0,
+    Connected,
+    Disconnected
+  };
+
+  struct DeviceSpec
+  {
+    hostlink::LinkKind kind = hostlink::LinkKind::Serial;
+    // Device path, or host:port[/path] for a WebSocket.
+    std::string target;
+    uint32_t baud = 115200;
+  };
+
+  struct Device
+  {
+    DeviceSpec spec;
+    // Short name for tables and selectors: the path's basename or host:port. A numeric
+    // basename keeps its directory ("pts3" for /dev/pts/3) so it never reads as an index.
+    std::string name;
+    hostlink::Link link;
+    bool write_armed = false;
+    int64_t next_open_ns = 0;
+    std::string open_error;
+
+    bool ready = false;
+    BleState ble = BleState::Unknown;
+    std::string wifi_state;
+    std::string wifi_ssid;
+    int64_t last_event_ns = 0;
+
+    uint64_t sent = 0;
+    uint64_t ok = 0;
+    uint64_t errors = 0;
+    uint64_t events = 0;
+    uint64_t unmatched = 0;
+    uint64_t reconnects = 0;
+    std::deque<int64_t> pending;
+    hostlink::HdrHistogram latency_us;
+    std::string last_reply;
+
+    bool connected() const;
+  };
+
+  const char *ble_state_to_string(BleState state);
+
+  // Paths matching a glob such as /dev/ttyUSB*, sorted.
+  std::vector<std::string> discover(const std::string &pattern);
+
+  class Fleet
+  {
+  public:
+    Fleet();
+    ~Fleet();
+    Fleet(const Fleet &) = delete;
+    Fleet &operator=(const Fleet &) = delete;
+
+    size_t add(const DeviceSpec &spec);
+    // Opens every device. Ones that fail are reported in open_error and, for UARTs,
+    // retried every reopen_ms; a WebSocket connect blocks, so those are not retried.
+    bool start(std::string &error);
+    void set_reopen_ms(uint32_t reopen_ms);
+
+    // "all", or a comma-separated list of indices and device names. An entry matching a
+    // name or path is never taken as an index. Unknown entries are returned in `unknown`.
+    std::vector<size_t> select(const std::string &selector, std::string &unknown) const;
+    // Queues `command` on each target that is connected; returns how many took it.
+    size_t send(const std::vector<size_t> &targets, const std::string &command);
+    // Extra descriptor served by the same loop (stdin, a timer, ...).
+    void watch(int fd, std::function<void()> on_readable);
+    void poll(int timeout_ms);
+
+    size_t size() const;
+    const Device &device(size_t index) const;
+    // Commands sent and not yet answered, over all devices.
+    size_t outstanding() const;
+    void reset_counters();
+
+    // Called for every reply and event after the device state is updated.
+    std::function<void(size_t index, const std::string &reply)> on_reply;
+    std::function<void(size_t index, const std::string &event)> on_event;
+
+  private:
+    bool open_device(size_t index);
+    void close_device(size_t index, const char *reason);
+    void on_message(size_t index, const std::string &message);
+    void update_write_interest(size_t index);
+
+    std::vector<std::unique_ptr<Device>> devices_;
+    std::vector<std::pair<int, std::function<void()>>> watched_;
+    int epoll_fd_ = -1;
+    uint32_t reopen_ms_ = 1000;
+  };
+} // namespace fleet
@@ -0,0 +1,126 @@
+// Runs a Fleet against pty stand-ins in one thread: event tracking, broadcast and
+// targeted sends, the per-device reply FIFO, and losing a device.
+
+#include "fleet.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pty_device.h"
+
+namespace
+{
+  int failures = 0;
+
+  void expect(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s\n", what);
+      ++failures;
+    }
+  }
+
+  void pump(fleet::Fleet &fleet, std::vector<std::unique_ptr<fleet::PtyDevice>> &devices, int rounds)
+  {
+    for (int round = 0; round < rounds; ++round)
+    {
+      fleet.poll(1);
+      for (auto &device : devices)
+      {
+        if (device)
+        {
+          device->service();
+        }
+      }
+    }
+  }
+} // namespace
+
+int main()
+{
+  std::vector<std::unique_ptr<fleet::PtyDevice>> devices;
+  fleet::Fleet fleet;
+  for (int index = 0; index < 6; ++index)
+  {
+    auto device = std::make_unique<fleet::PtyDevice>();
+    std::string error;
+    if (!device->open(error))
+    {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    device->set_reply_delay_us(200);
+    fleet::DeviceSpec spec;
+    spec.target = device->path();
+    fleet.add(spec);
+    devices.push_back(std::move(device));
+  }
+  devices[0]->emit("{\"event\":\"ready\"}");
+  devices[0]->emit("{\"event\":\"ble_connected\"}");
+  devices[1]->emit("{\"event\":\"wifi_state\",\"state\":\"connected\",\"ssid\":\"rack\"}");
+  devices[2]->emit("{\"event\":\"ble_connected\"}");
+  devices[2]->emit("{\"event\":\"ble_disconnected\"}");
+
+  std::string error;
+  fleet.set_reopen_ms(50);
+  expect(fleet.start(error), "fleet starts");
+  pump(fleet, devices, 20);
+  expect(fleet.device(0).ready && fleet.device(0).ble == fleet::BleState::Connected, "ready and ble tracked");
+  expect(fleet.device(1).wifi_state == "connected" && fleet.device(1).wifi_ssid == "rack", "wifi_state tracked");
+  expect(fleet.device(2).ble == fleet::BleState::Disconnected, "latest ble event wins");
+  expect(fleet.device(3).ble == fleet::BleState::Unknown && !fleet.device(3).ready, "silent device stays unknown");
+
+  std::string unknown;
+  std::vector<size_t> all = fleet.select("all", unknown);
+  expect(all.size() == 6, "all selects every device");
+  std::vector<size_t> some = fleet.select("1," + fleet.device(3).name + ",nope", unknown);
+  expect(some.size() == 2 && some[0] == 1 && some[1] == 3 && unknown == "nope", "selector by index and name");
+
+  // Pty names are numbers; they must not shadow or be shadowed by indices.
+  fleet::Fleet named;
+  for (const char *path : {"/dev/pts/1", "/dev/pts/0", "/dev/ttyUSB0"})
+  {
+    fleet::DeviceSpec spec;
+    spec.target = path;
+    named.add(spec);
+  }
+  expect(named.device(0).name == "pts1" && named.device(2).name == "ttyUSB0", "numeric basenames keep their directory");
+  std::vector<size_t> byIndex = named.select("1", unknown);
+  expect(byIndex.size() == 1 && byIndex[0] == 1, "a number selects by index");
+  std::vector<size_t> byName = named.select("pts1,/dev/pts/0", unknown);
+  expect(byName.size() == 2 && byName[0] == 0 && byName[1] == 1 && unknown.empty(), "names and paths select exactly");
+
+  for (int tick = 0; tick < 50; ++tick)
+  {
+    fleet.send(all, "{\"device\":\"mouse\",\"action\":\"move\",\"dx\":1}");
+  }
+  fleet.send(some, "{\"device\":\"toaster\"}");
+  pump(fleet, devices, 200);
+  expect(fleet.outstanding() == 0, "every command answered");
+  uint64_t ok = 0;
+  for (size_t index = 0; index < fleet.size(); ++index)
+  {
+    ok += fleet.device(index).ok;
+    expect(fleet.device(index).latency_us.count() == fleet.device(index).sent, "latency per reply");
+  }
+  expect(ok == 300, "broadcast replies counted");
+  expect(fleet.device(1).errors == 1 && fleet.device(3).errors == 1 && fleet.device(0).errors == 0,
+         "targeted error replies counted per device");
+
+  // Unplugging a device closes its link without disturbing the others.
+  devices[4].reset();
+  pump(fleet, devices, 5);
+  expect(!fleet.device(4).connected(), "lost device closed");
+  expect(fleet.send(all, "{\"device\":\"system\",\"action\":\"memory\"}") == 5, "send skips the lost device");
+  pump(fleet, devices, 50);
+  expect(fleet.outstanding() == 0, "remaining devices answer");
+
+  if (failures == 0)
+  {
+    printf("fleet: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,449 @@
+// Fleet controller: holds connections to many bridges at once (UARTs and WebSocket
+// sessions) on one event loop, tracks what each one last reported, and broadcasts or
+// targets commands.
+//
+//   fleet --discover '/dev/ttyUSB*'                       status table
+//   fleet --ws 10.0.0.21:80 --ws 10.0.0.22:80 --command '{"device":"system","action":"memory"}'
+//   fleet --devices rack3.txt --command '{"device":"mouse","action":"move","dx":1}' --rate 100 --duration 10
+//   fleet --devices rack3.txt --shell
+//
+// With --rate, the command is sent to every target on a fixed schedule and the report
+// lists per-device and aggregate reply throughput and latency. Replies are matched first
+// in, first out per device, as the firmware carries no request id.
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fleet.h"
+
+namespace
+{
+  using fleet::Device;
+  using fleet::DeviceSpec;
+  using fleet::Fleet;
+  using hostlink::HdrHistogram;
+  using hostlink::LinkKind;
+
+  struct Options
+  {
+    std::vector<DeviceSpec> devices;
+    std::vector<std::string> discover;
+    uint32_t baud = 115200;
+    std::string target = "all";
+    std::string command;
+    double rate_hz = 0;
+    double duration_s = 10;
+    uint32_t settle_ms = 1500;
+    uint32_t wait_ms = 2000;
+    bool shell = false;
+    bool json = false;
+  };
+
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s [--serial PATH]... [--ws HOST:PORT[/PATH]]... [--discover GLOB]... [--devices FILE]\n"
+            "          [--baud N] [--target all|INDEX|NAME[,...]] [--settle-ms N]\n"
+            "          [--command JSON [--wait-ms N] [--rate HZ --duration S] [--json]] [--shell]\n"
+            "Without devices, /dev/ttyUSB* and /dev/ttyACM* are discovered. FILE lists one device per\n"
+            "line: a path, or ws://HOST:PORT[/PATH]; # starts a comment.\n",
+            program);
+  }
+
+  DeviceSpec parse_target(const std::string &text, uint32_t baud)
+  {
+    DeviceSpec spec;
+    spec.baud = baud;
+    if (text.compare(0, 5, "ws://") == 0)
+    {
+      spec.kind = LinkKind::WebSocket;
+      spec.target = text.substr(5);
+    }
+    else
+    {
+      spec.kind = LinkKind::Serial;
+      spec.target = text;
+    }
+    return spec;
+  }
+
+  bool load_device_file(const char *path, Options &options)
+  {
+    std::ifstream file(path);
+    if (!file)
+    {
+      fprintf(stderr, "fleet: cannot read %s\n", path);
+      return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+      line = line.substr(0, line.find('#'));
+      line.erase(0, line.find_first_not_of(" \t\r"));
+      line.erase(line.find_last_not_of(" \t\r") + 1);
+      if (!line.empty())
+      {
+        options.devices.push_back(parse_target(line, options.baud));
+      }
+    }
+    return true;
+  }
+
+  bool parse_options(int argc, char **argv, Options &options)
+  {
+    for (int index = 1; index < argc; ++index)
+    {
+      std::string flag = argv[index];
+      if (flag == "--shell")
+      {
+        options.shell = true;
+        continue;
+      }
+      if (flag == "--json")
+      {
+        options.json = true;
+        continue;
+      }
+      if (index + 1 >= argc)
+      {
+        return false;
+      }
+      const char *value = argv[++index];
+      if (flag == "--serial")
+        options.devices.push_back(parse_target(value, options.baud));
+      else if (flag == "--ws")
+        options.devices.push_back(parse_target(std::string("ws://") + value, options.baud));
+      else if (flag == "--discover")
+        options.discover.push_back(value);
+      else if (flag == "--devices")
+      {
+        if (!load_device_file(value, options))
+          return false;
+      }
+      else if (flag == "--baud")
+        options.baud = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--target")
+        options.target = value;
+      else if (flag == "--command")
+        options.command = value;
+      else if (flag == "--rate")
+        options.rate_hz = strtod(value, nullptr);
+      else if (flag == "--duration")
+        options.duration_s = strtod(value, nullptr);
+      else if (flag == "--settle-ms")
+        options.settle_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--wait-ms")
+        options.wait_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+    // --baud applies to every UART, wherever it appears on the command line.
+    for (DeviceSpec &spec : options.devices)
+    {
+      spec.baud = options.baud;
+    }
+    return options.rate_hz >= 0 && (options.rate_hz == 0 || !options.command.empty());
+  }
+
+  void run_for(Fleet &fleet, int64_t duration_ns)
+  {
+    int64_t deadline = hostlink::now_ns() + duration_ns;
+    for (int64_t now = hostlink::now_ns(); now < deadline; now = hostlink::now_ns())
+    {
+      fleet.poll(static_cast<int>((deadline - now) / 1000000) + 1);
+    }
+  }
+
+  void drain(Fleet &fleet, uint32_t wait_ms)
+  {
+    int64_t deadline = hostlink::now_ns() + static_cast<int64_t>(wait_ms) * 1000000;
+    while (fleet.outstanding() > 0 && hostlink::now_ns() < deadline)
+    {
+      fleet.poll(10);
+    }
+  }
+
+  double ms(int64_t microseconds)
+  {
+    return microseconds / 1000.0;
+  }
+
+  void print_status(const Fleet &fleet)
+  {
+    printf("%-3s %-22s %-4s %-10s %-6s %-13s %-16s %8s %8s %6s\n", "#", "device", "link", "state", "ready", "ble",
+           "wifi", "sent", "ok", "err");
+    for (size_t index = 0; index < fleet.size(); ++index)
+    {
+      const Device &device = fleet.device(index);
+      std::string wifi = device.wifi_state.empty() ? "?" : device.wifi_state;
+      if (!device.wifi_ssid.empty())
+      {
+        wifi += "(" + device.wifi_ssid + ")";
+      }
+      printf("%-3zu %-22s %-4s %-10s %-6s %-13s %-16s %8llu %8llu %6llu\n", index, device.name.c_str(),
+             device.spec.kind == LinkKind::WebSocket ? "ws" : "uart", device.connected() ? "open" : "closed",
+             device.ready ? "yes" : "?", fleet::ble_state_to_string(device.ble), wifi.c_str(),
+             static_cast<unsigned long long>(device.sent), static_cast<unsigned long long>(device.ok),
+             static_cast<unsigned long long>(device.errors));
+      if (!device.connected() && !device.open_error.empty())
+      {
+        printf("    %s\n", device.open_error.c_str());
+      }
+    }
+  }
+
+  void print_load_report(const Fleet &fleet, double elapsed_s, bool json)
+  {
+    HdrHistogram total;
+    uint64_t sent = 0, ok = 0, errors = 0, lost = 0;
+    if (json)
+    {
+      printf("{\"elapsedS\":%.3f,\"devices\":[", elapsed_s);
+    }
+    else
+    {
+      printf("%-3s %-22s %8s %8s %6s %6s %9s %9s %9s %10s\n", "#", "device", "sent", "ok", "err", "lost", "p50 ms",
+             "p99 ms", "max ms", "replies/s");
+    }
+    for (size_t index = 0; index < fleet.size(); ++index)
+    {
+      const Device &device = fleet.device(index);
+      double throughput = elapsed_s > 0 ? (device.ok + device.errors) / elapsed_s : 0;
+      if (json)
+      {
+        printf("%s{\"name\":\"%s\",\"sent\":%llu,\"ok\":%llu,\"error\":%llu,\"lost\":%zu,\"p50Ms\":%.3f,"
+               "\"p99Ms\":%.3f,\"maxMs\":%.3f,\"repliesPerS\":%.1f}",
+               index ? "," : "", device.name.c_str(), static_cast<unsigned long long>(device.sent),
+               static_cast<unsigned long long>(device.ok), static_cast<unsigned long long>(device.errors),
+               device.pending.size(), ms(device.latency_us.value_at_percentile(50)),
+               ms(device.latency_us.value_at_percentile(99)), ms(device.latency_us.max()), throughput);
+      }
+      else
+      {
+        printf("%-3zu %-22s %8llu %8llu %6llu %6zu %9.2f %9.2f %9.2f %10.1f\n", index, device.name.c_str(),
+               static_cast<unsigned long long>(device.sent), static_cast<unsigned long long>(device.ok),
+               static_cast<unsigned long long>(device.errors), device.pending.size(),
+               ms(device.latency_us.value_at_percentile(50)), ms(device.latency_us.value_at_percentile(99)),
+               ms(device.latency_us.max()), throughput);
+      }
+      total.merge(device.latency_us);
+      sent += device.sent;
+      ok += device.ok;
+      errors += device.errors;
+      lost += device.pending.size();
+    }
+    double throughput = elapsed_s > 0 ? (ok + errors) / elapsed_s : 0;
+    if (json)
+    {
+      printf("],\"total\":{\"sent\":%llu,\"ok\":%llu,\"error\":%llu,\"lost\":%llu,\"p50Ms\":%.3f,\"p99Ms\":%.3f,"
+             "\"p999Ms\":%.3f,\"maxMs\":%.3f,\"repliesPerS\":%.1f}}\n",
+             static_cast<unsigned long long>(sent), static_cast<unsigned long long>(ok),
+             static_cast<unsigned long long>(errors), static_cast<unsigned long long>(lost),
+             ms(total.value_at_percentile(50)), ms(total.value_at_percentile(99)), ms(total.value_at_percentile(99.9)),
+             ms(total.max()), throughput);
+    }
+    else
+    {
+      printf("%-3s %-22s %8llu %8llu %6llu %6llu %9.2f %9.2f %9.2f %10.1f\n", "", "total",
+             static_cast<unsigned long long>(sent), static_cast<unsigned long long>(ok),
+             static_cast<unsigned long long>(errors), static_cast<unsigned long long>(lost),
+             ms(total.value_at_percentile(50)), ms(total.value_at_percentile(99)), ms(total.max()), throughput);
+    }
+  }
+
+  // Open-loop: each tick sends the command to every target whether or not the previous
+  // one was answered, so a slow device shows up as latency and lost replies.
+  int run_load(Fleet &fleet, const Options &options, const std::vector<size_t> &targets)
+  {
+    fleet.reset_counters();
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int64_t interval_ns = static_cast<int64_t>(1e9 / options.rate_hz);
+    itimerspec schedule = {};
+    schedule.it_interval.tv_sec = interval_ns / 1000000000;
+    schedule.it_interval.tv_nsec = interval_ns % 1000000000;
+    schedule.it_value = schedule.it_interval;
+    uint64_t total_ticks = static_cast<uint64_t>(options.rate_hz * options.duration_s);
+    uint64_t ticks = 0;
+    fleet.watch(timer_fd, [&]() {
+      uint64_t expirations = 0;
+      if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+      {
+        return;
+      }
+      // Ticks missed while the loop was busy are sent late rather than skipped.
+      for (; expirations > 0 && ticks < total_ticks; --expirations, ++ticks)
+      {
+        fleet.send(targets, options.command);
+      }
+    });
+
+    int64_t start_ns = hostlink::now_ns();
+    timerfd_settime(timer_fd, 0, &schedule, nullptr);
+    while (ticks < total_ticks)
+    {
+      fleet.poll(100);
+    }
+    schedule = {};
+    timerfd_settime(timer_fd, 0, &schedule, nullptr);
+    drain(fleet, options.wait_ms);
+    int64_t last_reply_ns = hostlink::now_ns();
+    print_load_report(fleet, (last_reply_ns - start_ns) / 1e9, options.json);
+    return 0;
+  }
+
+  int run_once(Fleet &fleet, const Options &options, const std::vector<size_t> &targets)
+  {
+    fleet.on_reply = [&fleet](size_t index, const std::string &reply) {
+      printf("[%s] %s\n", fleet.device(index).name.c_str(), reply.c_str());
+    };
+    size_t accepted = fleet.send(targets, options.command);
+    drain(fleet, options.wait_ms);
+    size_t unanswered = fleet.outstanding();
+    if (accepted < targets.size() || unanswered > 0)
+    {
+      fprintf(stderr, "fleet: %zu of %zu targets answered\n", accepted - unanswered, targets.size());
+      return 1;
+    }
+    return 0;
+  }
+
+  int run_shell(Fleet &fleet)
+  {
+    fleet.on_reply = [&fleet](size_t index, const std::string &reply) {
+      printf("[%s] %s\n", fleet.device(index).name.c_str(), reply.c_str());
+      fflush(stdout);
+    };
+    fleet.on_event = fleet.on_reply;
+    bool done = false;
+    std::string input;
+    fleet.watch(STDIN_FILENO, [&]() {
+      char buffer[4096];
+      ssize_t got = read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (got <= 0)
+      {
+        done = true;
+        return;
+      }
+      input.append(buffer, static_cast<size_t>(got));
+      size_t newline;
+      while ((newline = input.find('\n')) != std::string::npos)
+      {
+        std::string line = input.substr(0, newline);
+        input.erase(0, newline + 1);
+        if (line.empty())
+        {
+          continue;
+        }
+        if (line == "quit" || line == "exit")
+        {
+          done = true;
+        }
+        else if (line == "status")
+        {
+          print_status(fleet);
+        }
+        else if (line == "reset")
+        {
+          fleet.reset_counters();
+        }
+        else
+        {
+          // "<selector> <json>", or bare JSON for every device.
+          size_t brace = line.find('{');
+          std::string selector = brace == std::string::npos ? line : line.substr(0, brace);
+          selector.erase(selector.find_last_not_of(' ') + 1);
+          std::string unknown;
+          std::vector<size_t> targets = fleet.select(selector, unknown);
+          if (brace == std::string::npos || !unknown.empty())
+          {
+            printf("usage: status | reset | quit | [all|INDEX|NAME[,...]] {json}%s%s\n",
+                   unknown.empty() ? "" : "  unknown device: ", unknown.c_str());
+          }
+          else
+          {
+            printf("sent to %zu of %zu\n", fleet.send(targets, line.substr(brace)), targets.size());
+          }
+        }
+        fflush(stdout);
+      }
+    });
+    while (!done)
+    {
+      fleet.poll(1000);
+    }
+    drain(fleet, 1000);
+    return 0;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parse_options(argc, argv, options))
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+  if (options.devices.empty() && options.discover.empty())
+  {
+    options.discover = {"/dev/ttyUSB*", "/dev/ttyACM*"};
+  }
+  for (const std::string &pattern : options.discover)
+  {
+    for (const std::string &path : fleet::discover(pattern))
+    {
+      options.devices.push_back(parse_target(path, options.baud));
+    }
+  }
+  if (options.devices.empty())
+  {
+    fprintf(stderr, "fleet: no devices\n");
+    return 1;
+  }
+
+  Fleet fleet;
+  for (const DeviceSpec &spec : options.devices)
+  {
+    fleet.add(spec);
+  }
+  std::string error;
+  if (!fleet.start(error))
+  {
+    fprintf(stderr, "fleet: %s\n", error.c_str());
+    return 1;
+  }
+  std::string unknown;
+  std::vector<size_t> targets = fleet.select(options.target, unknown);
+  if (!unknown.empty())
+  {
+    fprintf(stderr, "fleet: unknown device %s\n", unknown.c_str());
+    return 2;
+  }
+
+  // Let connections settle and collect whatever the devices announce on open.
+  run_for(fleet, static_cast<int64_t>(options.settle_ms) * 1000000);
+
+  if (options.shell)
+  {
+    return run_shell(fleet);
+  }
+  if (options.command.empty())
+  {
+    print_status(fleet);
+    return 0;
+  }
+  if (options.rate_hz > 0)
+  {
+    return run_load(fleet, options, targets);
+  }
+  return run_once(fleet, options, targets);
+}
@@ -0,0 +1,120 @@
+// Stands up N fake bridges on pseudo-terminals for trying the fleet controller without a
+// rack. Each one "boots" (ready, wifi_state, ble_connected) and then answers commands;
+// --ble-flap-ms toggles the BLE link of one device at a time.
+//
+//   fleet_stub --count 16 --reply-delay-us 800 --devices-out /tmp/rack.txt &
+//   fleet --devices /tmp/rack.txt --command '{"device":"mouse","action":"move","dx":1}' --rate 200
+
+#include <poll.h>
+#include <signal.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "link.h"
+#include "pty_device.h"
+
+namespace
+{
+  volatile sig_atomic_t stop_requested = 0;
+
+  void on_signal(int)
+  {
+    stop_requested = 1;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t count = 4;
+  uint32_t reply_delay_us = 0;
+  uint32_t flap_ms = 0;
+  std::string devices_out;
+  for (int index = 1; index + 1 < argc; index += 2)
+  {
+    std::string flag = argv[index];
+    const char *value = argv[index + 1];
+    if (flag == "--count")
+      count = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    else if (flag == "--reply-delay-us")
+      reply_delay_us = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    else if (flag == "--ble-flap-ms")
+      flap_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+    else if (flag == "--devices-out")
+      devices_out = value;
+    else
+    {
+      fprintf(stderr, "usage: %s [--count N] [--reply-delay-us N] [--ble-flap-ms N] [--devices-out FILE]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<std::unique_ptr<fleet::PtyDevice>> devices;
+  FILE *list = devices_out.empty() ? stdout : fopen(devices_out.c_str(), "w");
+  if (!list)
+  {
+    perror(devices_out.c_str());
+    return 1;
+  }
+  for (uint32_t index = 0; index < count; ++index)
+  {
+    auto device = std::make_unique<fleet::PtyDevice>();
+    std::string error;
+    if (!device->open(error))
+    {
+      fprintf(stderr, "fleet_stub: %s\n", error.c_str());
+      return 1;
+    }
+    device->set_reply_delay_us(reply_delay_us);
+    device->emit("{\"event\":\"ready\"}");
+    device->emit("{\"event\":\"wifi_state\",\"state\":\"connected\",\"ssid\":\"rack\"}");
+    device->emit("{\"event\":\"ble_connected\"}");
+    fprintf(list, "%s\n", device->path().c_str());
+    devices.push_back(std::move(device));
+  }
+  if (list != stdout)
+  {
+    fclose(list);
+  }
+  fflush(stdout);
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  std::vector<pollfd> waiters(devices.size());
+  std::vector<bool> ble_up(devices.size(), true);
+  int64_t next_flap_ns = hostlink::now_ns() + static_cast<int64_t>(flap_ms) * 1000000;
+  size_t flap_index = 0;
+  while (!stop_requested)
+  {
+    int64_t now = hostlink::now_ns();
+    int64_t wake_ns = flap_ms ? next_flap_ns : now + 1000000000LL;
+    for (size_t index = 0; index < devices.size(); ++index)
+    {
+      waiters[index] = {devices[index]->fd(), POLLIN, 0};
+      int64_t due = devices[index]->next_due_ns();
+      if (due != 0 && due < wake_ns)
+      {
+        wake_ns = due;
+      }
+    }
+    int timeout_ms = static_cast<int>(std::max<int64_t>(0, (wake_ns - now + 999999) / 1000000));
+    ::poll(waiters.data(), waiters.size(), timeout_ms);
+    for (auto &device : devices)
+    {
+      device->service();
+    }
+    if (flap_ms && hostlink::now_ns() >= next_flap_ns)
+    {
+      ble_up[flap_index] = !ble_up[flap_index];
+      devices[flap_index]->emit(ble_up[flap_index] ? "{\"event\":\"ble_connected\"}"
+                                                   : "{\"event\":\"ble_disconnected\"}");
+      flap_index = (flap_index + 1) % devices.size();
+      next_flap_ns += static_cast<int64_t>(flap_ms) * 1000000;
+    }
+  }
+  return 0;
+}
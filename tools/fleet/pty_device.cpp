@@ -0,0 +1,155 @@
+#include "pty_device.h"
+
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <strings.h>
+
+#include "json_scan.h"
+#include "link.h"
+
+namespace fleet
+{
+  PtyDevice::~PtyDevice()
+  {
+    if (master_ >= 0)
+    {
+      close(master_);
+    }
+    if (slave_ >= 0)
+    {
+      close(slave_);
+    }
+  }
+
+  bool PtyDevice::open(std::string &error)
+  {
+    char name[128];
+    if (openpty(&master_, &slave_, name, nullptr, nullptr) != 0)
+    {
+      error = std::string("openpty: ") + strerror(errno);
+      return false;
+    }
+    // Raw on both ends so lines pass through untouched; the slave stays open here so the
+    // master does not see EIO between clients.
+    termios tty = {};
+    if (tcgetattr(slave_, &tty) == 0)
+    {
+      cfmakeraw(&tty);
+      tcsetattr(slave_, TCSANOW, &tty);
+    }
+    fcntl(master_, F_SETFL, fcntl(master_, F_GETFL) | O_NONBLOCK);
+    path_ = name;
+    return true;
+  }
+
+  const std::string &PtyDevice::path() const
+  {
+    return path_;
+  }
+
+  int PtyDevice::fd() const
+  {
+    return master_;
+  }
+
+  void PtyDevice::set_reply_delay_us(uint32_t delay_us)
+  {
+    reply_delay_us_ = delay_us;
+  }
+
+  uint64_t PtyDevice::commands() const
+  {
+    return commands_;
+  }
+
+  int64_t PtyDevice::next_due_ns() const
+  {
+    return replies_.empty() ? 0 : replies_.front().due_ns;
+  }
+
+  void PtyDevice::write_line(const std::string &line)
+  {
+    std::string framed = line + "\n";
+    size_t offset = 0;
+    while (offset < framed.size())
+    {
+      ssize_t written = write(master_, framed.data() + offset, framed.size() - offset);
+      if (written <= 0)
+      {
+        // Nobody is draining the pty; like a UART with no reader, the rest is lost.
+        return;
+      }
+      offset += static_cast<size_t>(written);
+    }
+  }
+
+  void PtyDevice::emit(const std::string &line)
+  {
+    write_line(line);
+  }
+
+  std::string PtyDevice::reply_for(const std::string &command) const
+  {
+    hostlink::JsonMembers members;
+    if (!hostlink::json_members(command, members))
+    {
+      return "{\"status\":\"error\",\"message\":\"JSON parse error: InvalidInput\"}";
+    }
+    const std::string *raw = hostlink::json_find(members, "device");
+    if (!raw)
+    {
+      raw = hostlink::json_find(members, "type");
+    }
+    std::string device;
+    if (!raw || !hostlink::json_to_string(*raw, device))
+    {
+      return "{\"status\":\"error\",\"message\":\"Command missing device/type field\"}";
+    }
+    static const char *const kDevices[] = {"keyboard", "mouse", "consumer", "media", "system"};
+    for (const char *known : kDevices)
+    {
+      if (strcasecmp(device.c_str(), known) == 0)
+      {
+        return "{\"status\":\"ok\"}";
+      }
+    }
+    return "{\"status\":\"error\",\"message\":" + hostlink::json_quote("Unknown device type: " + device) + "}";
+  }
+
+  void PtyDevice::service()
+  {
+    char buffer[4096];
+    ssize_t got;
+    while ((got = read(master_, buffer, sizeof(buffer))) > 0)
+    {
+      rx_.append(buffer, static_cast<size_t>(got));
+    }
+    int64_t now = hostlink::now_ns();
+    size_t newline;
+    while ((newline = rx_.find('\n')) != std::string::npos)
+    {
+      std::string command = rx_.substr(0, newline);
+      rx_.erase(0, newline + 1);
+      if (!command.empty() && command.back() == '\r')
+      {
+        command.pop_back();
+      }
+      if (command.empty())
+      {
+        continue;
+      }
+      ++commands_;
+      replies_.push_back(Reply{now + static_cast<int64_t>(reply_delay_us_) * 1000, reply_for(command)});
+    }
+    while (!replies_.empty() && replies_.front().due_ns <= now)
+    {
+      write_line(replies_.front().line);
+      replies_.pop_front();
+    }
+  }
+} // namespace fleet
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+// Stand-in for one bridge on the far side of a pseudo-terminal, for exercising fleet
+// tooling without hardware. It answers every command line the way the firmware does
+// ({"status":"ok"}, or an error for bad JSON or an unknown device) after an optional
+// delay, and emits whatever events it is told to. Single-threaded: call service() when
+// fd() is readable or next_due_ns() has passed.
+namespace fleet
+{
+  class PtyDevice
+  {
+  public:
+    PtyDevice() = default;
+    ~PtyDevice();
+    PtyDevice(const PtyDevice &) = delete;
+    PtyDevice &operator=(const PtyDevice &) = delete;
+
+    bool open(std::string &error);
+    const std::string &path() const;
+    int fd() const;
+
+    void set_reply_delay_us(uint32_t delay_us);
+    // Writes `line` right away, ahead of replies still waiting for their delay.
+    void emit(const std::string &line);
+    // Reads pending commands and writes the replies that are due.
+    void service();
+    // When the oldest delayed reply is due, or 0 when none is waiting.
+    int64_t next_due_ns() const;
+    uint64_t commands() const;
+
+  private:
+    struct Reply
+    {
+      int64_t due_ns;
+      std::string line;
+    };
+
+    std::string reply_for(const std::string &command) const;
+    void write_line(const std::string &line);
+
+    int master_ = -1;
+    int slave_ = -1;
+    std::string path_;
+    std::string rx_;
+    std::deque<Reply> replies_;
+    uint32_t reply_delay_us_ = 0;
+    uint64_t commands_ = 0;
+  };
+} // namespace fleet
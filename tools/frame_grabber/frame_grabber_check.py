@@ -0,0 +1,94 @@
+"""Checks the frame_grabber module against the synthetic source: frames arrive as
+shaped buffers without copies, stale frames are dropped rather than queued, and held
+frames are never overwritten. Also checks the TemplateMatcher binding on BGR, luma and
+Frame inputs, and the ChangeDetector binding."""
+
+import os
+import random
+import sys
+import time
+
+import frame_grabber
+
+failures = 0
+
+
+def expect(condition, what):
+    global failures
+    if not condition:
+        print(f"FAIL {what}", file=sys.stderr)
+        failures += 1
+
+
+with frame_grabber.Grabber("synthetic:64x48@200") as grabber:
+    first = grabber.latest(timeout=1.0)
+    expect(first is not None, "first frame arrives")
+    view = memoryview(first)
+    expect(view.shape == (48, 64, 3) and view.format == "B", "BGR buffer shape")
+    expect(view.obj is first and not view.readonly, "buffer exported in place")
+    expect(first.timestamp_ns <= time.monotonic_ns(), "monotonic timestamps")
+
+    # Hold the first frame and scribble on it while capture runs on.
+    view[0, 0, 0] = 7
+    snapshot = bytes(view)
+    time.sleep(0.2)
+    latest = grabber.latest(timeout=1.0)
+    expect(latest.sequence > first.sequence + 10, "latest frame wins")
+    expect(bytes(memoryview(first)) == snapshot, "held frame is not overwritten")
+    stats = grabber.stats()
+    expect(stats["dropped"] > 10 and stats["delivered"] == 2, "stale frames dropped, not queued")
+    expect(stats["slots"] <= 4, "slot pool stays small")
+
+    # Without `after`, each call waits for a frame it has not returned yet.
+    again = grabber.latest(timeout=1.0)
+    expect(again.sequence > latest.sequence, "latest() moves forward")
+    expect(grabber.latest(timeout=0, after=again.sequence + 1000) is None, "timeout returns None")
+    expect(len(os.read(grabber.fileno(), 8)) == 8, "eventfd counts frames")
+
+with frame_grabber.Grabber("synthetic:32x32@100", color=False) as gray:
+    expect(memoryview(gray.latest(timeout=1.0)).shape == (32, 32), "luma buffer shape")
+expect(gray.closed, "context manager closes")
+
+try:
+    frame_grabber.Grabber("nonsense:")
+    expect(False, "bad spec raises")
+except RuntimeError:
+    pass
+
+# A 40x30 patch cut from random BGR noise is found exactly, then by tracking.
+random.seed(1)
+width, height = 160, 120
+noise = bytes(random.randrange(256) for _ in range(width * height * 3))
+patch = b"".join(noise[((50 + y) * width + 70) * 3:((50 + y) * width + 110) * 3] for y in range(30))
+image = memoryview(noise).cast("B", (height, width, 3))
+matcher = frame_grabber.TemplateMatcher(memoryview(patch).cast("B", (30, 40, 3)), scales=(0.9, 1.0))
+hit = matcher.find(image)
+expect(hit is not None and (hit.x, hit.y, hit.width, hit.height) == (70, 50, 40, 30), "template found")
+expect(hit is not None and hit.score == 0 and not hit.tracked, "exact full search")
+again = matcher.find(image)
+expect(again is not None and again.tracked and again.x == 70, "second find tracks")
+gray = memoryview(bytes(noise[::3])).cast("B", (height, width))
+expect(matcher.find(gray) is None, "luma of a different image does not match")
+with frame_grabber.Grabber("synthetic:160x120@100") as grabber:
+    matcher.find(grabber.latest(timeout=1.0))
+try:
+    matcher.find(b"not an image")
+    expect(False, "1-D buffer rejected")
+except TypeError:
+    pass
+
+# A small edit marks its tile; comparing the same frame again marks none.
+detector = frame_grabber.ChangeDetector(tile=32)
+expect(detector.update(image) == (20, 20), "first frame changes every tile")
+expect(detector.update(image) == (0, 20), "same frame changes nothing")
+edited = bytearray(noise)
+for y in range(40, 48):
+    for x in range(100, 108):
+        edited[(y * width + x) * 3] ^= 0xFF
+expect(detector.update(memoryview(edited).cast("B", (height, width, 3))) == (1, 20), "edit changes one tile")
+rows, columns, flags = detector.changed_map()
+expect((rows, columns) == (4, 5) and flags[1 * columns + 3] == 1, "changed map locates the edit")
+
+if failures == 0:
+    print("frame_grabber: all checks passed")
+sys.exit(1 if failures else 0)
@@ -0,0 +1,683 @@
+// CPython bindings for frame_grabber::Grabber.
+//
+//   import frame_grabber, numpy as np
+//   grabber = frame_grabber.Grabber("cmd:1280x720:bgr24:ffmpeg -i udp://127.0.0.1:11000 "
+//                                   "-f rawvideo -pix_fmt bgr24 -")
+//   frame = grabber.latest(timeout=1.0)   # newer than the last frame latest() returned
+//   image = np.asarray(frame)              # (720, 1280, 3) uint8 view of the slot, no copy
+//
+// A Frame keeps its slot out of the capture rotation for as long as it, or any array or
+// memoryview made from it, is alive. Waiting in latest() releases the GIL.
+//
+// TemplateMatcher wraps vision::TemplateMatcher for automation hooks:
+//
+//   button = frame_grabber.TemplateMatcher(cv2.imread("ok.png"), scales=(0.9, 1.0, 1.1))
+//   hit = button.find(frame)               # Match(x, y, width, height, scale, score, tracked)
+//
+// ChangeDetector wraps vision::TileDiff for pacing the WebRTC preview:
+//
+//   detector = frame_grabber.ChangeDetector(tile=32, threshold=2.0)
+//   changed, tiles = detector.update(frame)
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "grabber.h"
+#include "template_match.h"
+#include "tile_diff.h"
+
+namespace
+{
+  struct GrabberObject
+  {
+    PyObject_HEAD
+    frame_grabber::Grabber *grabber;
+    uint64_t last_sequence;
+  };
+
+  struct FrameObject
+  {
+    PyObject_HEAD
+    std::shared_ptr<vision::Frame> *frame;
+    int ndim;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+  };
+
+  struct DetectorObject
+  {
+    PyObject_HEAD
+    vision::TileDiff *diff;
+  };
+
+  struct MatcherObject
+  {
+    PyObject_HEAD
+    vision::TemplateMatcher *matcher;
+    // Luma copy of the last image passed to find(), reused between calls.
+    vision::Frame *scratch;
+  };
+
+  PyTypeObject frame_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+  PyTypeObject grabber_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+  PyTypeObject matcher_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+  PyTypeObject detector_type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+  PyTypeObject match_type;
+
+  PyStructSequence_Field match_fields[] = {
+      {"x", "Left edge of the match in frame pixels."},
+      {"y", "Top edge of the match in frame pixels."},
+      {"width", "Matched width, the template's width times `scale`."},
+      {"height", "Matched height."},
+      {"scale", "Template scale that matched."},
+      {"score", "Mean absolute difference per pixel; 0 is identical."},
+      {"tracked", "True when found in the window around the previous match."},
+      {nullptr, nullptr},
+  };
+  PyStructSequence_Desc match_desc = {"frame_grabber.Match", "A template match.", match_fields, 7};
+
+  // ---- Frame ----
+
+  PyObject *wrap_frame(std::shared_ptr<vision::Frame> frame)
+  {
+    FrameObject *self = PyObject_New(FrameObject, &frame_type);
+    if (!self)
+    {
+      return nullptr;
+    }
+    bool color = !frame->bgr.empty();
+    self->ndim = color ? 3 : 2;
+    self->shape[0] = frame->height;
+    self->shape[1] = frame->width;
+    self->shape[2] = 3;
+    self->strides[0] = static_cast<Py_ssize_t>(frame->width) * (color ? 3 : 1);
+    self->strides[1] = color ? 3 : 1;
+    self->strides[2] = 1;
+    self->frame = new std::shared_ptr<vision::Frame>(std::move(frame));
+    return reinterpret_cast<PyObject *>(self);
+  }
+
+  void frame_dealloc(FrameObject *self)
+  {
+    delete self->frame;
+    PyObject_Free(self);
+  }
+
+  int frame_getbuffer(FrameObject *self, Py_buffer *view, int flags)
+  {
+    vision::Frame &frame = **self->frame;
+    std::vector<uint8_t> &pixels = frame.bgr.empty() ? frame.luma : frame.bgr;
+    view->buf = pixels.data();
+    view->obj = reinterpret_cast<PyObject *>(self);
+    Py_INCREF(view->obj);
+    view->len = static_cast<Py_ssize_t>(pixels.size());
+    // Writable: the capture thread never touches a slot that is referenced.
+    view->readonly = 0;
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>("B") : nullptr;
+    view->ndim = (flags & PyBUF_ND) ? self->ndim : 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+  }
+
+  PyBufferProcs frame_buffer_procs = {reinterpret_cast<getbufferproc>(frame_getbuffer), nullptr};
+
+  PyObject *frame_width(FrameObject *self, void *)
+  {
+    return PyLong_FromLong((*self->frame)->width);
+  }
+
+  PyObject *frame_height(FrameObject *self, void *)
+  {
+    return PyLong_FromLong((*self->frame)->height);
+  }
+
+  PyObject *frame_channels(FrameObject *self, void *)
+  {
+    return PyLong_FromLong(self->ndim == 3 ? 3 : 1);
+  }
+
+  PyObject *frame_sequence(FrameObject *self, void *)
+  {
+    return PyLong_FromUnsignedLongLong((*self->frame)->sequence);
+  }
+
+  PyObject *frame_timestamp_ns(FrameObject *self, void *)
+  {
+    return PyLong_FromLongLong((*self->frame)->timestamp_ns);
+  }
+
+  PyGetSetDef frame_getset[] = {
+      {"width", reinterpret_cast<getter>(frame_width), nullptr, "Width in pixels.", nullptr},
+      {"height", reinterpret_cast<getter>(frame_height), nullptr, "Height in pixels.", nullptr},
+      {"channels", reinterpret_cast<getter>(frame_channels), nullptr, "3 for BGR, 1 for luma.", nullptr},
+      {"sequence", reinterpret_cast<getter>(frame_sequence), nullptr, "Capture counter, from 1.", nullptr},
+      {"timestamp_ns", reinterpret_cast<getter>(frame_timestamp_ns), nullptr,
+       "CLOCK_MONOTONIC capture time (time.monotonic_ns()).", nullptr},
+      {nullptr, nullptr, nullptr, nullptr, nullptr},
+  };
+
+  // ---- Grabber ----
+
+  frame_grabber::Grabber *checked(GrabberObject *self)
+  {
+    if (!self->grabber)
+    {
+      PyErr_SetString(PyExc_ValueError, "grabber is closed");
+    }
+    return self->grabber;
+  }
+
+  int grabber_init(GrabberObject *self, PyObject *args, PyObject *kwargs)
+  {
+    static const char *keywords[] = {"source", "color", nullptr};
+    const char *spec = nullptr;
+    int color = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|p", const_cast<char **>(keywords), &spec, &color))
+    {
+      return -1;
+    }
+    std::string error;
+    std::unique_ptr<vision::FrameSource> source =
+        vision::open_frame_source(spec, error, color ? vision::Channels::Bgr : vision::Channels::Luma);
+    if (!source)
+    {
+      PyErr_SetString(PyExc_RuntimeError, error.c_str());
+      return -1;
+    }
+    auto grabber = new frame_grabber::Grabber(std::move(source));
+    if (!grabber->start(error))
+    {
+      delete grabber;
+      PyErr_SetString(PyExc_RuntimeError, error.c_str());
+      return -1;
+    }
+    delete self->grabber;
+    self->grabber = grabber;
+    self->last_sequence = 0;
+    return 0;
+  }
+
+  PyObject *grabber_close(GrabberObject *self, PyObject *)
+  {
+    frame_grabber::Grabber *grabber = self->grabber;
+    self->grabber = nullptr;
+    if (grabber)
+    {
+      // Joining the capture thread can take up to one source read.
+      Py_BEGIN_ALLOW_THREADS
+      delete grabber;
+      Py_END_ALLOW_THREADS
+    }
+    Py_RETURN_NONE;
+  }
+
+  void grabber_dealloc(GrabberObject *self)
+  {
+    delete self->grabber;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+  }
+
+  PyObject *grabber_latest(GrabberObject *self, PyObject *args, PyObject *kwargs)
+  {
+    static const char *keywords[] = {"timeout", "after", nullptr};
+    PyObject *timeout_object = Py_None;
+    PyObject *after_object = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|OO", const_cast<char **>(keywords), &timeout_object,
+                                     &after_object))
+    {
+      return nullptr;
+    }
+    frame_grabber::Grabber *grabber = checked(self);
+    if (!grabber)
+    {
+      return nullptr;
+    }
+    int timeout_ms = -1;
+    if (timeout_object != Py_None)
+    {
+      double seconds = PyFloat_AsDouble(timeout_object);
+      if (seconds == -1.0 && PyErr_Occurred())
+      {
+        return nullptr;
+      }
+      timeout_ms = seconds < 0 ? -1 : static_cast<int>(seconds * 1000.0 + 0.5);
+    }
+    uint64_t after = self->last_sequence;
+    if (after_object != Py_None)
+    {
+      after = PyLong_AsUnsignedLongLong(after_object);
+      if (PyErr_Occurred())
+      {
+        return nullptr;
+      }
+    }
+
+    std::shared_ptr<vision::Frame> frame;
+    Py_BEGIN_ALLOW_THREADS
+    frame = grabber->latest(after, timeout_ms);
+    Py_END_ALLOW_THREADS
+    if (!frame)
+    {
+      if (grabber->ended())
+      {
+        std::string error = grabber->error();
+        PyErr_SetString(PyExc_RuntimeError, error.empty() ? "frame source stopped" : error.c_str());
+        return nullptr;
+      }
+      Py_RETURN_NONE;
+    }
+    self->last_sequence = frame->sequence;
+    return wrap_frame(std::move(frame));
+  }
+
+  PyObject *grabber_fileno(GrabberObject *self, PyObject *)
+  {
+    frame_grabber::Grabber *grabber = checked(self);
+    return grabber ? PyLong_FromLong(grabber->notify_fd()) : nullptr;
+  }
+
+  PyObject *grabber_stats(GrabberObject *self, PyObject *)
+  {
+    frame_grabber::Grabber *grabber = checked(self);
+    if (!grabber)
+    {
+      return nullptr;
+    }
+    frame_grabber::Stats stats = grabber->stats();
+    return Py_BuildValue("{s:K,s:K,s:K,s:n}", "captured", static_cast<unsigned long long>(stats.captured),
+                         "delivered", static_cast<unsigned long long>(stats.delivered), "dropped",
+                         static_cast<unsigned long long>(stats.dropped), "slots",
+                         static_cast<Py_ssize_t>(stats.slots));
+  }
+
+  PyObject *grabber_enter(GrabberObject *self, PyObject *)
+  {
+    Py_INCREF(self);
+    return reinterpret_cast<PyObject *>(self);
+  }
+
+  PyObject *grabber_exit(GrabberObject *self, PyObject *)
+  {
+    return grabber_close(self, nullptr);
+  }
+
+  PyObject *grabber_source(GrabberObject *self, void *)
+  {
+    frame_grabber::Grabber *grabber = checked(self);
+    return grabber ? PyUnicode_FromString(grabber->describe().c_str()) : nullptr;
+  }
+
+  PyObject *grabber_closed(GrabberObject *self, void *)
+  {
+    return PyBool_FromLong(self->grabber == nullptr);
+  }
+
+  PyMethodDef grabber_methods[] = {
+      {"latest", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(grabber_latest)),
+       METH_VARARGS | METH_KEYWORDS,
+       "latest(timeout=None, after=None) -> Frame | None\n\n"
+       "The newest frame with a sequence above `after` (default: the last frame this method\n"
+       "returned). Waits up to `timeout` seconds, forever when None; 0 polls. Returns None on\n"
+       "timeout and raises RuntimeError once the source has ended."},
+      {"fileno", reinterpret_cast<PyCFunction>(grabber_fileno), METH_NOARGS,
+       "eventfd that counts captured frames; read 8 bytes from it to clear it."},
+      {"stats", reinterpret_cast<PyCFunction>(grabber_stats), METH_NOARGS,
+       "Dict of captured, delivered and dropped frame counts and the slot pool size."},
+      {"close", reinterpret_cast<PyCFunction>(grabber_close), METH_NOARGS,
+       "Stop capturing. Not to be called while another thread waits in latest()."},
+      {"__enter__", reinterpret_cast<PyCFunction>(grabber_enter), METH_NOARGS, nullptr},
+      {"__exit__", reinterpret_cast<PyCFunction>(grabber_exit), METH_VARARGS, nullptr},
+      {nullptr, nullptr, 0, nullptr},
+  };
+
+  PyGetSetDef grabber_getset[] = {
+      {"source", reinterpret_cast<getter>(grabber_source), nullptr, "Description of the frame source.", nullptr},
+      {"closed", reinterpret_cast<getter>(grabber_closed), nullptr, "True after close().", nullptr},
+      {nullptr, nullptr, nullptr, nullptr, nullptr},
+  };
+
+  // ---- TemplateMatcher ----
+
+  // Copies a (height, width) luma or (height, width, 3) BGR uint8 buffer into `frame` as
+  // luma. Any exporter works: numpy arrays, Frame objects, bytes-like images.
+  bool load_luma(PyObject *object, vision::Frame &frame)
+  {
+    Py_buffer view;
+    if (PyObject_GetBuffer(object, &view, PyBUF_RECORDS_RO) < 0)
+    {
+      return false;
+    }
+    bool color = view.ndim == 3 && view.shape[2] == 3 && view.strides[2] == 1 && view.strides[1] == 3;
+    bool gray = view.ndim == 2 && view.strides[1] == 1;
+    if ((!color && !gray) || view.itemsize != 1 || view.shape[0] <= 0 || view.shape[1] <= 0)
+    {
+      PyBuffer_Release(&view);
+      PyErr_SetString(PyExc_TypeError, "expected a (height, width) or (height, width, 3) uint8 image "
+                                       "with contiguous rows");
+      return false;
+    }
+    int width = static_cast<int>(view.shape[1]);
+    int height = static_cast<int>(view.shape[0]);
+    if (frame.width != width || frame.height != height)
+    {
+      frame.resize(width, height);
+    }
+    for (int y = 0; y < height; ++y)
+    {
+      const uint8_t *in = static_cast<const uint8_t *>(view.buf) + y * view.strides[0];
+      uint8_t *out = frame.row(y);
+      if (gray)
+      {
+        memcpy(out, in, static_cast<size_t>(width));
+        continue;
+      }
+      // Same BT.601 weights as the frame sources use.
+      for (int x = 0; x < width; ++x, in += 3)
+      {
+        out[x] = static_cast<uint8_t>((in[0] * 29 + in[1] * 150 + in[2] * 77) >> 8);
+      }
+    }
+    PyBuffer_Release(&view);
+    return true;
+  }
+
+  int matcher_init(MatcherObject *self, PyObject *args, PyObject *kwargs)
+  {
+    static const char *keywords[] = {"template", "scales", "roi", "max_score", "track_radius", nullptr};
+    PyObject *template_object = nullptr;
+    PyObject *scales_object = nullptr;
+    PyObject *roi_object = Py_None;
+    vision::MatchOptions options;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOdi", const_cast<char **>(keywords), &template_object,
+                                     &scales_object, &roi_object, &options.max_score, &options.track_radius))
+    {
+      return -1;
+    }
+    if (scales_object)
+    {
+      PyObject *sequence = PySequence_Fast(scales_object, "scales must be a sequence of numbers");
+      if (!sequence)
+      {
+        return -1;
+      }
+      options.scales.clear();
+      for (Py_ssize_t index = 0; index < PySequence_Fast_GET_SIZE(sequence); ++index)
+      {
+        double scale = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(sequence, index));
+        if (scale <= 0)
+        {
+          Py_DECREF(sequence);
+          if (!PyErr_Occurred())
+          {
+            PyErr_SetString(PyExc_ValueError, "scales must be positive");
+          }
+          return -1;
+        }
+        options.scales.push_back(scale);
+      }
+      Py_DECREF(sequence);
+    }
+    if (roi_object != Py_None &&
+        !PyArg_ParseTuple(roi_object, "iiii;roi must be (x, y, width, height)", &options.roi.x, &options.roi.y,
+                          &options.roi.width, &options.roi.height))
+    {
+      return -1;
+    }
+    vision::Frame templ;
+    if (!load_luma(template_object, templ))
+    {
+      return -1;
+    }
+    delete self->matcher;
+    self->matcher = new vision::TemplateMatcher(templ, options);
+    if (!self->scratch)
+    {
+      self->scratch = new vision::Frame();
+    }
+    return 0;
+  }
+
+  void matcher_dealloc(MatcherObject *self)
+  {
+    delete self->matcher;
+    delete self->scratch;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+  }
+
+  PyObject *matcher_find(MatcherObject *self, PyObject *image)
+  {
+    if (!self->matcher)
+    {
+      PyErr_SetString(PyExc_ValueError, "TemplateMatcher is not initialised");
+      return nullptr;
+    }
+    if (!load_luma(image, *self->scratch))
+    {
+      return nullptr;
+    }
+    vision::Match match;
+    Py_BEGIN_ALLOW_THREADS
+    match = self->matcher->find(*self->scratch);
+    Py_END_ALLOW_THREADS
+    if (!match.found)
+    {
+      Py_RETURN_NONE;
+    }
+    PyObject *result = PyStructSequence_New(&match_type);
+    if (!result)
+    {
+      return nullptr;
+    }
+    PyStructSequence_SET_ITEM(result, 0, PyLong_FromLong(match.x));
+    PyStructSequence_SET_ITEM(result, 1, PyLong_FromLong(match.y));
+    PyStructSequence_SET_ITEM(result, 2, PyLong_FromLong(match.width));
+    PyStructSequence_SET_ITEM(result, 3, PyLong_FromLong(match.height));
+    PyStructSequence_SET_ITEM(result, 4, PyFloat_FromDouble(match.scale));
+    PyStructSequence_SET_ITEM(result, 5, PyFloat_FromDouble(match.score));
+    PyStructSequence_SET_ITEM(result, 6, PyBool_FromLong(match.tracked));
+    return result;
+  }
+
+  PyObject *matcher_reset(MatcherObject *self, PyObject *)
+  {
+    if (self->matcher)
+    {
+      self->matcher->reset_tracking();
+    }
+    Py_RETURN_NONE;
+  }
+
+  PyMethodDef matcher_methods[] = {
+      {"find", reinterpret_cast<PyCFunction>(matcher_find), METH_O,
+       "find(image) -> Match | None\n\n"
+       "Best match of the template in `image`, a (height, width, 3) BGR or (height, width)\n"
+       "luma uint8 array, or None when nothing scores at or below max_score. After a hit the\n"
+       "next call searches around it first. Releases the GIL while searching."},
+      {"reset", reinterpret_cast<PyCFunction>(matcher_reset), METH_NOARGS,
+       "Forget the previous match so the next find() searches the whole ROI."},
+      {nullptr, nullptr, 0, nullptr},
+  };
+
+  // ---- ChangeDetector ----
+
+  int detector_init(DetectorObject *self, PyObject *args, PyObject *kwargs)
+  {
+    static const char *keywords[] = {"tile", "threshold", "row_step", nullptr};
+    vision::TileDiffOptions options;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|idi", const_cast<char **>(keywords), &options.tile,
+                                     &options.threshold, &options.row_step))
+    {
+      return -1;
+    }
+    if (options.tile < 4 || options.row_step < 1 || options.threshold < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "tile must be at least 4, row_step at least 1, threshold not negative");
+      return -1;
+    }
+    delete self->diff;
+    self->diff = new vision::TileDiff(options);
+    return 0;
+  }
+
+  void detector_dealloc(DetectorObject *self)
+  {
+    delete self->diff;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+  }
+
+  PyObject *detector_update(DetectorObject *self, PyObject *image)
+  {
+    if (!self->diff)
+    {
+      PyErr_SetString(PyExc_ValueError, "ChangeDetector is not initialised");
+      return nullptr;
+    }
+    Py_buffer view;
+    if (PyObject_GetBuffer(image, &view, PyBUF_RECORDS_RO) < 0)
+    {
+      return nullptr;
+    }
+    int channels = view.ndim == 3 ? static_cast<int>(view.shape[2]) : 1;
+    bool packed = view.ndim == 2 ? view.strides[1] == 1
+                                 : view.ndim == 3 && view.strides[2] == 1 && view.strides[1] == channels;
+    if (!packed || view.itemsize != 1 || view.shape[0] <= 0 || view.shape[1] <= 0)
+    {
+      PyBuffer_Release(&view);
+      PyErr_SetString(PyExc_TypeError, "expected a (height, width) or (height, width, channels) uint8 image "
+                                       "with packed pixels");
+      return nullptr;
+    }
+    vision::TileChanges changes;
+    // Compared in place; the exporter keeps the pixels alive until the release below.
+    Py_BEGIN_ALLOW_THREADS
+    changes = self->diff->update(static_cast<const uint8_t *>(view.buf), view.strides[0],
+                                 static_cast<int>(view.shape[1]), static_cast<int>(view.shape[0]), channels);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    return Py_BuildValue("(ii)", changes.changed, changes.tiles);
+  }
+
+  PyObject *detector_reset(DetectorObject *self, PyObject *)
+  {
+    if (self->diff)
+    {
+      self->diff->reset();
+    }
+    Py_RETURN_NONE;
+  }
+
+  PyObject *detector_changed_map(DetectorObject *self, PyObject *)
+  {
+    if (!self->diff)
+    {
+      PyErr_SetString(PyExc_ValueError, "ChangeDetector is not initialised");
+      return nullptr;
+    }
+    const std::vector<uint8_t> &flags = self->diff->changed();
+    return Py_BuildValue("(iiy#)", self->diff->rows(), self->diff->columns(), reinterpret_cast<const char *>(flags.data()),
+                         static_cast<Py_ssize_t>(flags.size()));
+  }
+
+  PyMethodDef detector_methods[] = {
+      {"update", reinterpret_cast<PyCFunction>(detector_update), METH_O,
+       "update(image) -> (changed, tiles)\n\n"
+       "Compare `image`, a (height, width[, channels]) uint8 array, with the reference tile by\n"
+       "tile and take the changed tiles into the reference. The first image, and any image of a\n"
+       "new shape, changes every tile. Releases the GIL while comparing."},
+      {"reset", reinterpret_cast<PyCFunction>(detector_reset), METH_NOARGS,
+       "Forget the reference, so the next update() changes every tile."},
+      {"changed_map", reinterpret_cast<PyCFunction>(detector_changed_map), METH_NOARGS,
+       "(rows, columns, flags): one byte per tile from the last update(), row-major, 1 if changed."},
+      {nullptr, nullptr, 0, nullptr},
+  };
+
+  PyModuleDef module_def = {
+      PyModuleDef_HEAD_INIT,
+      "frame_grabber",
+      "Capture thread with a latest-frame-wins buffer; frames export their pixels without copying.\n"
+      "Also a native template matcher for automation hooks and a tile change detector.",
+      -1,
+      nullptr,
+      nullptr,
+      nullptr,
+      nullptr,
+      nullptr,
+  };
+} // namespace
+
+PyMODINIT_FUNC PyInit_frame_grabber()
+{
+  frame_type.tp_name = "frame_grabber.Frame";
+  frame_type.tp_basicsize = sizeof(FrameObject);
+  frame_type.tp_flags = Py_TPFLAGS_DEFAULT;
+  frame_type.tp_doc = "One captured frame: a (height, width, 3) BGR or (height, width) luma buffer.";
+  frame_type.tp_dealloc = reinterpret_cast<destructor>(frame_dealloc);
+  frame_type.tp_as_buffer = &frame_buffer_procs;
+  frame_type.tp_getset = frame_getset;
+
+  grabber_type.tp_name = "frame_grabber.Grabber";
+  grabber_type.tp_basicsize = sizeof(GrabberObject);
+  grabber_type.tp_flags = Py_TPFLAGS_DEFAULT;
+  grabber_type.tp_doc = "Grabber(source, color=True): capture `source` (a vision frame source spec) on a thread.";
+  grabber_type.tp_new = PyType_GenericNew;
+  grabber_type.tp_init = reinterpret_cast<initproc>(grabber_init);
+  grabber_type.tp_dealloc = reinterpret_cast<destructor>(grabber_dealloc);
+  grabber_type.tp_methods = grabber_methods;
+  grabber_type.tp_getset = grabber_getset;
+
+  matcher_type.tp_name = "frame_grabber.TemplateMatcher";
+  matcher_type.tp_basicsize = sizeof(MatcherObject);
+  matcher_type.tp_flags = Py_TPFLAGS_DEFAULT;
+  matcher_type.tp_doc = "TemplateMatcher(template, scales=(1.0,), roi=None, max_score=12.0, track_radius=24):\n"
+                        "multi-scale SAD template search over luma, with tracking between calls.";
+  matcher_type.tp_new = PyType_GenericNew;
+  matcher_type.tp_init = reinterpret_cast<initproc>(matcher_init);
+  matcher_type.tp_dealloc = reinterpret_cast<destructor>(matcher_dealloc);
+  matcher_type.tp_methods = matcher_methods;
+
+  detector_type.tp_name = "frame_grabber.ChangeDetector";
+  detector_type.tp_basicsize = sizeof(DetectorObject);
+  detector_type.tp_flags = Py_TPFLAGS_DEFAULT;
+  detector_type.tp_doc = "ChangeDetector(tile=32, threshold=2.0, row_step=2): tile-wise change detection\n"
+                         "between successive frames.";
+  detector_type.tp_new = PyType_GenericNew;
+  detector_type.tp_init = reinterpret_cast<initproc>(detector_init);
+  detector_type.tp_dealloc = reinterpret_cast<destructor>(detector_dealloc);
+  detector_type.tp_methods = detector_methods;
+
+  if (PyType_Ready(&frame_type) < 0 || PyType_Ready(&grabber_type) < 0 || PyType_Ready(&matcher_type) < 0 ||
+      PyType_Ready(&detector_type) < 0 ||
+      (!match_type.tp_name && PyStructSequence_InitType2(&match_type, &match_desc) < 0))
+  {
+    return nullptr;
+  }
+  PyObject *module = PyModule_Create(&module_def);
+  if (!module)
+  {
+    return nullptr;
+  }
+  Py_INCREF(&frame_type);
+  Py_INCREF(&grabber_type);
+  Py_INCREF(&matcher_type);
+  Py_INCREF(&match_type);
+  Py_INCREF(&detector_type);
+  if (PyModule_AddObject(module, "Frame", reinterpret_cast<PyObject *>(&frame_type)) < 0 ||
+      PyModule_AddObject(module, "Grabber", reinterpret_cast<PyObject *>(&grabber_type)) < 0 ||
+      PyModule_AddObject(module, "TemplateMatcher", reinterpret_cast<PyObject *>(&matcher_type)) < 0 ||
+      PyModule_AddObject(module, "Match", reinterpret_cast<PyObject *>(&match_type)) < 0 ||
+      PyModule_AddObject(module, "ChangeDetector", reinterpret_cast<PyObject *>(&detector_type)) < 0 ||
+      PyModule_AddStringConstant(module, "template_isa", vision::template_match_isa()) < 0)
+  {
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
@@ -0,0 +1,153 @@
+#include "grabber.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace frame_grabber
+{
+  Grabber::Grabber(std::unique_ptr<vision::FrameSource> source) : source_(std::move(source))
+  {
+    description_ = source_->describe();
+  }
+
+  Grabber::~Grabber()
+  {
+    stop();
+    if (notify_fd_ >= 0)
+    {
+      close(notify_fd_);
+    }
+  }
+
+  bool Grabber::start(std::string &error)
+  {
+    notify_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (notify_fd_ < 0)
+    {
+      error = std::string("eventfd: ") + strerror(errno);
+      return false;
+    }
+    back_ = free_slot();
+    thread_ = std::thread(&Grabber::run, this);
+    return true;
+  }
+
+  void Grabber::stop()
+  {
+    stopping_ = true;
+    if (thread_.joinable())
+    {
+      thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ended_ = true;
+    published_.notify_all();
+  }
+
+  std::shared_ptr<vision::Frame> Grabber::free_slot()
+  {
+    // The pool's own reference is the only one left on a free slot; back_ and latest_
+    // count as references, so neither is picked.
+    for (const std::shared_ptr<vision::Frame> &slot : slots_)
+    {
+      if (slot.use_count() == 1)
+      {
+        return slot;
+      }
+    }
+    slots_.push_back(std::make_shared<vision::Frame>());
+    stats_.slots = slots_.size();
+    return slots_.back();
+  }
+
+  void Grabber::run()
+  {
+    while (!stopping_)
+    {
+      // The slot is ours alone until it is published, so capture runs unlocked.
+      int result = source_->read(*back_, 100);
+      if (result == 0)
+      {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (result < 0)
+      {
+        ended_ = true;
+        error_ = source_->error();
+        published_.notify_all();
+        return;
+      }
+      back_->sequence = ++sequence_;
+      ++stats_.captured;
+      if (!latest_read_)
+      {
+        ++stats_.dropped;
+      }
+      latest_ = std::move(back_);
+      latest_read_ = false;
+      back_ = free_slot();
+      published_.notify_all();
+      // Wakes event loops; the counter only saturates if nobody reads it for 2^64 frames.
+      uint64_t one = 1;
+      ssize_t written = write(notify_fd_, &one, sizeof(one));
+      (void)written;
+    }
+  }
+
+  std::shared_ptr<vision::Frame> Grabber::latest(uint64_t after, int timeout_ms)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ready = [this, after]() { return ended_ || (latest_ && latest_->sequence > after); };
+    if (timeout_ms < 0)
+    {
+      published_.wait(lock, ready);
+    }
+    else if (timeout_ms > 0)
+    {
+      published_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    if (!latest_ || latest_->sequence <= after)
+    {
+      return nullptr;
+    }
+    if (!latest_read_)
+    {
+      latest_read_ = true;
+      ++stats_.delivered;
+    }
+    return latest_;
+  }
+
+  int Grabber::notify_fd() const
+  {
+    return notify_fd_;
+  }
+
+  bool Grabber::ended() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ended_;
+  }
+
+  std::string Grabber::error() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+  std::string Grabber::describe() const
+  {
+    return description_;
+  }
+
+  Stats Grabber::stats() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+} // namespace frame_grabber
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_source.h"
+
+// A capture thread in front of a vision::FrameSource that keeps only the newest frame.
+//
+// Frames live in a pool of slots. The thread always owns one slot to capture into; when a
+// frame completes it becomes the latest and the thread moves on to any slot nobody holds.
+// Readers get a shared reference to the latest slot and may keep it as long as they like
+// (the Python module hands its memory out without copying); the thread never writes a
+// slot that is referenced. With one reader holding one frame that is a triple buffer; a
+// reader that keeps more frames alive grows the pool instead of stalling capture. A
+// frame replaced before anyone read it is counted as dropped.
+namespace frame_grabber
+{
+  struct Stats
+  {
+    uint64_t captured = 0;
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    size_t slots = 0;
+  };
+
+  class Grabber
+  {
+  public:
+    explicit Grabber(std::unique_ptr<vision::FrameSource> source);
+    ~Grabber();
+    Grabber(const Grabber &) = delete;
+    Grabber &operator=(const Grabber &) = delete;
+
+    // False with `error` set when the notification descriptor cannot be created.
+    bool start(std::string &error);
+    void stop();
+
+    // The latest frame if its sequence is above `after`, waiting up to timeout_ms for one
+    // (0 polls, negative waits indefinitely). Null on timeout or once the source ended.
+    // Sequence numbers are the grabber's own and start at 1.
+    std::shared_ptr<vision::Frame> latest(uint64_t after, int timeout_ms);
+
+    // An eventfd whose counter goes up by one per captured frame, for event loops. The
+    // owner of the loop reads it to clear it; latest() does not.
+    int notify_fd() const;
+    // True once the source ended or failed; error() says why.
+    bool ended() const;
+    std::string error() const;
+    std::string describe() const;
+    Stats stats() const;
+
+  private:
+    void run();
+    std::shared_ptr<vision::Frame> free_slot();
+
+    std::unique_ptr<vision::FrameSource> source_;
+    std::string description_;
+    mutable std::mutex mutex_;
+    std::condition_variable published_;
+    std::vector<std::shared_ptr<vision::Frame>> slots_;
+    std::shared_ptr<vision::Frame> back_;
+    std::shared_ptr<vision::Frame> latest_;
+    bool latest_read_ = true;
+    bool ended_ = false;
+    std::string error_;
+    Stats stats_;
+    uint64_t sequence_ = 0;
+    int notify_fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+  };
+} // namespace frame_grabber
@@ -0,0 +1,748 @@
+#include "bridge.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "json_scan.h"
+#include "pointer_protocol.h"
+
+namespace hid_bridge
+{
+  namespace
+  {
+    using hostlink::json_find;
+    using hostlink::json_members;
+    using hostlink::json_quote;
+    using hostlink::json_to_int;
+    using hostlink::json_to_string;
+    using hostlink::JsonMembers;
+    using hostlink::Link;
+
+    constexpr uint64_t kTagDevice = 1;
+    constexpr uint64_t kTagUnixListener = 2;
+    constexpr uint64_t kTagWsListener = 3;
+    constexpr uint64_t kFirstClientId = 16;
+    // A client that stops reading is dropped rather than buffered without bound.
+    constexpr size_t kMaxClientBacklog = 1 << 20;
+    constexpr int kHandshakeTimeoutMs = 1000;
+    // Mouse.move() takes signed chars, so larger coalesced moves go out in steps.
+    constexpr long long kMaxMouseStep = 127;
+
+    long long clamp_step(long long value)
+    {
+      return std::max(-kMaxMouseStep, std::min(kMaxMouseStep, value));
+    }
+
+    long long int_field(const JsonMembers &members, const char *key)
+    {
+      long long value = 0;
+      const std::string *raw = json_find(members, key);
+      return raw && json_to_int(*raw, value) ? value : 0;
+    }
+
+    // server.py accepts a single name or a list for "buttons" and "keys".
+    std::string list_field(const JsonMembers &members, const char *key, const char *fallback)
+    {
+      const std::string *raw = json_find(members, key);
+      if (!raw || *raw == "null")
+      {
+        return fallback;
+      }
+      if (raw->front() == '"')
+      {
+        return "[" + *raw + "]";
+      }
+      return *raw;
+    }
+
+    std::string ack(const std::string &type, const std::string &request_id)
+    {
+      return "{\"status\":\"ok\",\"type\":" + json_quote(type) + ",\"requestId\":" + request_id + "}";
+    }
+
+    std::string error_reply(const std::string &type, const std::string &request_id, const std::string &detail)
+    {
+      return "{\"status\":\"error\",\"type\":" + json_quote(type) + ",\"requestId\":" + request_id +
+             ",\"detail\":" + json_quote(detail) + "}";
+    }
+  } // namespace
+
+  Bridge::Bridge(const Config &config) : config_(config), next_client_id_(kFirstClientId)
+  {
+    if (config_.window == 0)
+    {
+      config_.window = 1;
+    }
+  }
+
+  Bridge::~Bridge()
+  {
+    clients_.clear();
+    device_.close();
+    if (unix_listener_ >= 0)
+    {
+      close(unix_listener_);
+      unlink(config_.socket_path.c_str());
+    }
+    if (ws_listener_ >= 0)
+    {
+      close(ws_listener_);
+    }
+    if (epoll_fd_ >= 0)
+    {
+      close(epoll_fd_);
+    }
+  }
+
+  bool Bridge::start(std::string &error)
+  {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0)
+    {
+      error = std::string("epoll_create1: ") + strerror(errno);
+      return false;
+    }
+
+    if (!config_.socket_path.empty())
+    {
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      if (config_.socket_path.size() >= sizeof(address.sun_path))
+      {
+        error = config_.socket_path + ": path too long";
+        return false;
+      }
+      memcpy(address.sun_path, config_.socket_path.c_str(), config_.socket_path.size() + 1);
+      unlink(config_.socket_path.c_str());
+      unix_listener_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (unix_listener_ < 0 || bind(unix_listener_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+          listen(unix_listener_, 16) != 0)
+      {
+        error = config_.socket_path + ": " + strerror(errno);
+        return false;
+      }
+      watch(unix_listener_, kTagUnixListener, EPOLLIN, false);
+    }
+
+    if (config_.ws_port != 0)
+    {
+      sockaddr_in address = {};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(config_.ws_port);
+      if (inet_pton(AF_INET, config_.ws_host.c_str(), &address.sin_addr) != 1)
+      {
+        error = config_.ws_host + ": not an IPv4 address";
+        return false;
+      }
+      ws_listener_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      int one = 1;
+      if (ws_listener_ >= 0)
+      {
+        setsockopt(ws_listener_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      }
+      if (ws_listener_ < 0 || bind(ws_listener_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+          listen(ws_listener_, 16) != 0)
+      {
+        error = config_.ws_host + ":" + std::to_string(config_.ws_port) + ": " + strerror(errno);
+        return false;
+      }
+      watch(ws_listener_, kTagWsListener, EPOLLIN, false);
+    }
+
+    std::string open_error;
+    if (!open_device(open_error))
+    {
+      fprintf(stderr, "[hid_bridge] %s; retrying every %u ms\n", open_error.c_str(), config_.reopen_ms);
+      last_open_error_ = open_error;
+    }
+    return true;
+  }
+
+  bool Bridge::device_open() const
+  {
+    return device_.fd() >= 0;
+  }
+
+  const Stats &Bridge::stats() const
+  {
+    return stats_;
+  }
+
+  void Bridge::watch(int fd, uint64_t tag, uint32_t events, bool modify)
+  {
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = tag;
+    epoll_ctl(epoll_fd_, modify ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+  }
+
+  bool Bridge::open_device(std::string &error)
+  {
+    next_open_ns_ = hostlink::now_ns() + static_cast<int64_t>(config_.reopen_ms) * 1000000;
+    if (config_.device_path.empty())
+    {
+      error = "no device configured";
+      return false;
+    }
+    if (!device_.open_serial(config_.device_path, config_.baud, error))
+    {
+      return false;
+    }
+    watch(device_.fd(), kTagDevice, EPOLLIN, false);
+    device_write_armed_ = false;
+    last_open_error_.clear();
+    fprintf(stderr, "[hid_bridge] opened %s at %u baud\n", config_.device_path.c_str(), config_.baud);
+    broadcast("{\"type\":\"device\",\"connected\":true,\"port\":" + json_quote(config_.device_path) +
+              ",\"baud\":" + std::to_string(config_.baud) + "}");
+    return true;
+  }
+
+  void Bridge::close_device(const char *reason)
+  {
+    if (!device_open())
+    {
+      return;
+    }
+    fprintf(stderr, "[hid_bridge] %s: %s\n", device_.label().c_str(), reason);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, device_.fd(), nullptr);
+    device_.close();
+    for (const InFlight &entry : in_flight_)
+    {
+      fail(entry.waiter, reason);
+    }
+    for (const Queued &entry : queued_)
+    {
+      fail(entry.waiter, reason);
+    }
+    in_flight_.clear();
+    queued_.clear();
+    mouse_ = MouseDelta();
+    next_open_ns_ = hostlink::now_ns() + static_cast<int64_t>(config_.reopen_ms) * 1000000;
+    broadcast("{\"type\":\"device\",\"connected\":false,\"port\":" + json_quote(config_.device_path) +
+              ",\"detail\":" + json_quote(reason) + "}");
+  }
+
+  void Bridge::accept_clients(int listener, bool websocket)
+  {
+    for (;;)
+    {
+      int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0)
+      {
+        return;
+      }
+      auto client = std::make_unique<Client>();
+      if (websocket)
+      {
+        // The upgrade is read synchronously; browsers send it right after connecting.
+        std::string error;
+        if (!client->link.accept_websocket(fd, kHandshakeTimeoutMs, error))
+        {
+          fprintf(stderr, "[hid_bridge] %s\n", error.c_str());
+          continue;
+        }
+      }
+      else
+      {
+        client->link.adopt_stream(fd, "unix client (fd " + std::to_string(fd) + ")");
+      }
+      uint64_t id = next_client_id_++;
+      watch(fd, id, EPOLLIN, false);
+      if (config_.verbose)
+      {
+        fprintf(stderr, "[hid_bridge] %s connected\n", client->link.label().c_str());
+      }
+      client->link.send("{\"type\":\"hello\",\"status\":\"ok\",\"port\":" + json_quote(config_.device_path) +
+                        ",\"baud\":" + std::to_string(config_.baud) +
+                        ",\"connected\":" + (device_open() ? "true" : "false") + "}");
+      clients_[id] = std::move(client);
+      ++stats_.clients_accepted;
+    }
+  }
+
+  void Bridge::drop_client(uint64_t id)
+  {
+    auto found = clients_.find(id);
+    if (found == clients_.end())
+    {
+      return;
+    }
+    if (config_.verbose)
+    {
+      fprintf(stderr, "[hid_bridge] %s disconnected\n", found->second->link.label().c_str());
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, found->second->link.fd(), nullptr);
+    clients_.erase(found);
+    // Replies still owed to this client are discarded when they arrive.
+  }
+
+  void Bridge::send_to(uint64_t id, const std::string &message)
+  {
+    auto found = clients_.find(id);
+    if (found != clients_.end())
+    {
+      found->second->link.send(message);
+    }
+  }
+
+  void Bridge::broadcast(const std::string &message)
+  {
+    for (auto &entry : clients_)
+    {
+      entry.second->link.send(message);
+    }
+  }
+
+  void Bridge::fail(const Waiter &waiter, const char *detail)
+  {
+    if (waiter.client_id != 0)
+    {
+      send_to(waiter.client_id, "{\"type\":\"reply\",\"status\":\"error\",\"requestId\":" + waiter.request_id +
+                                    ",\"detail\":" + json_quote(detail) + "}");
+    }
+  }
+
+  void Bridge::on_client_message(uint64_t id, const std::string &message)
+  {
+    ++stats_.client_messages;
+    if (!message.empty() && static_cast<uint8_t>(message[0]) == pointer_protocol::kFrameStart)
+    {
+      on_pointer_frame(id, message);
+      return;
+    }
+    JsonMembers members;
+    if (!json_members(message, members))
+    {
+      send_to(id, "{\"status\":\"error\",\"detail\":\"Invalid JSON\"}");
+      return;
+    }
+    const std::string *raw_request_id = json_find(members, "requestId");
+    std::string request_id = raw_request_id ? *raw_request_id : "null";
+    const std::string *raw_type = json_find(members, "type");
+    std::string type;
+    if (!raw_type || !json_to_string(*raw_type, type) || type.empty())
+    {
+      if (raw_request_id)
+      {
+        send_to(id, "{\"status\":\"error\",\"detail\":\"Missing message type\",\"requestId\":" + request_id + "}");
+      }
+      return;
+    }
+
+    if (type == "ping")
+    {
+      if (raw_request_id)
+      {
+        send_to(id, ack(type, request_id));
+      }
+      return;
+    }
+    if (type == "stats")
+    {
+      send_to(id, "{\"type\":\"stats\",\"status\":\"ok\",\"requestId\":" + request_id +
+                      ",\"connected\":" + (device_open() ? "true" : "false") +
+                      ",\"clientMessages\":" + std::to_string(stats_.client_messages) +
+                      ",\"deviceCommands\":" + std::to_string(stats_.device_commands) +
+                      ",\"coalescedMoves\":" + std::to_string(stats_.coalesced_moves) +
+                      ",\"pointerFrames\":" + std::to_string(stats_.pointer_frames) +
+                      ",\"rejectedFrames\":" + std::to_string(stats_.rejected_frames) +
+                      ",\"replies\":" + std::to_string(stats_.replies) +
+                      ",\"expired\":" + std::to_string(stats_.expired) +
+                      ",\"unmatched\":" + std::to_string(stats_.unmatched) +
+                      ",\"events\":" + std::to_string(stats_.events) +
+                      ",\"inFlight\":" + std::to_string(in_flight_.size()) +
+                      ",\"queued\":" + std::to_string(queued_.size()) + "}");
+      return;
+    }
+    if (type == "config")
+    {
+      std::string port = config_.device_path;
+      const std::string *raw_port = json_find(members, "port");
+      if (raw_port)
+      {
+        json_to_string(*raw_port, port);
+      }
+      long long baud = config_.baud;
+      const std::string *raw_baud = json_find(members, "baud");
+      if (raw_baud)
+      {
+        json_to_int(*raw_baud, baud);
+      }
+      reconfigure(id, port, baud, request_id);
+      return;
+    }
+
+    if (!device_open())
+    {
+      std::string detail = "Serial device " + config_.device_path + " is not open";
+      if (type == "command")
+      {
+        send_to(id, "{\"type\":\"reply\",\"status\":\"error\",\"requestId\":" + request_id +
+                        ",\"detail\":" + json_quote(detail) + "}");
+      }
+      else if (raw_request_id)
+      {
+        send_to(id, error_reply(type, request_id, detail));
+      }
+      return;
+    }
+
+    if (type == "command")
+    {
+      const std::string *payload = json_find(members, "payload");
+      if (!payload || payload->front() != '{')
+      {
+        send_to(id, "{\"type\":\"reply\",\"status\":\"error\",\"requestId\":" + request_id +
+                        ",\"detail\":\"payload must be a JSON object\"}");
+        return;
+      }
+      Waiter waiter;
+      if (raw_request_id)
+      {
+        waiter.client_id = id;
+        waiter.request_id = request_id;
+      }
+      enqueue(*payload, waiter);
+      return;
+    }
+
+    if (type == "mouse_move")
+    {
+      add_mouse_move(int_field(members, "dx"), int_field(members, "dy"), int_field(members, "wheel"),
+                     int_field(members, "pan"));
+    }
+    else if (type == "mouse_click" || type == "mouse_press" || type == "mouse_release")
+    {
+      enqueue("{\"device\":\"mouse\",\"action\":\"" + type.substr(6) +
+                  "\",\"buttons\":" + list_field(members, "buttons", "[\"left\"]") + "}",
+              Waiter());
+    }
+    else if (type == "mouse_release_all")
+    {
+      enqueue("{\"device\":\"mouse\",\"action\":\"releaseAll\"}", Waiter());
+    }
+    else if (type == "keyboard_press" || type == "keyboard_release")
+    {
+      std::string keys = list_field(members, "keys", "[]");
+      if (keys != "[]")
+      {
+        enqueue("{\"device\":\"keyboard\",\"action\":\"" + type.substr(9) + "\",\"keys\":" + keys + "}", Waiter());
+      }
+    }
+    else if (type == "keyboard_release_all")
+    {
+      enqueue("{\"device\":\"keyboard\",\"action\":\"releaseAll\"}", Waiter());
+    }
+    else
+    {
+      if (raw_request_id)
+      {
+        send_to(id, error_reply(type, request_id, "Unsupported message type: " + type));
+      }
+      return;
+    }
+    // Input is acknowledged once it is queued, as server.py does; the device's own reply
+    // is only counted.
+    if (raw_request_id)
+    {
+      send_to(id, ack(type, request_id));
+    }
+  }
+
+  void Bridge::on_pointer_frame(uint64_t id, const std::string &frame)
+  {
+    pointer_protocol::Status status =
+        pointer_protocol::validate(reinterpret_cast<const uint8_t *>(frame.data()), frame.size());
+    if (status != pointer_protocol::Status::Ok)
+    {
+      ++stats_.rejected_frames;
+      send_to(id, "{\"status\":\"error\",\"detail\":" +
+                      json_quote(std::string("Invalid pointer frame: ") + pointer_protocol::status_to_string(status)) +
+                      "}");
+      return;
+    }
+    if (!device_open())
+    {
+      // Frames are sent every animation frame with no request id; dropping them quietly
+      // matches what the device does while BLE is down.
+      return;
+    }
+    ++stats_.pointer_frames;
+    materialise_mouse();
+    Queued entry;
+    entry.line = frame;
+    entry.binary = true;
+    queued_.push_back(std::move(entry));
+  }
+
+  void Bridge::reconfigure(uint64_t id, const std::string &port, long long baud, const std::string &request_id)
+  {
+    std::string previous_path = config_.device_path;
+    uint32_t previous_baud = config_.baud;
+    close_device("reconfigured");
+    config_.device_path = port;
+    config_.baud = static_cast<uint32_t>(baud);
+    std::string error;
+    bool opened = open_device(error);
+    if (!opened)
+    {
+      // Like SerialBridge.connect(), a port that will not open leaves the old one in use.
+      config_.device_path = previous_path;
+      config_.baud = previous_baud;
+      std::string ignored;
+      open_device(ignored);
+    }
+    if (opened)
+    {
+      send_to(id, "{\"type\":\"config\",\"status\":\"ok\",\"requestId\":" + request_id +
+                      ",\"port\":" + json_quote(port) + ",\"baud\":" + std::to_string(baud) + "}");
+    }
+    else
+    {
+      send_to(id, "{\"type\":\"config\",\"status\":\"error\",\"requestId\":" + request_id +
+                      ",\"detail\":" + json_quote("Unable to open serial port " + error) + "}");
+    }
+  }
+
+  void Bridge::enqueue(std::string line, Waiter waiter)
+  {
+    // A move summed so far happened before this command and must reach the device first.
+    materialise_mouse();
+    queued_.push_back(Queued{std::move(line), std::move(waiter)});
+  }
+
+  void Bridge::add_mouse_move(long long dx, long long dy, long long wheel, long long pan)
+  {
+    if (mouse_.pending)
+    {
+      ++stats_.coalesced_moves;
+    }
+    mouse_.dx += dx;
+    mouse_.dy += dy;
+    mouse_.wheel += wheel;
+    mouse_.pan += pan;
+    mouse_.pending = true;
+  }
+
+  void Bridge::materialise_mouse()
+  {
+    if (!mouse_.pending)
+    {
+      return;
+    }
+    do
+    {
+      long long dx = clamp_step(mouse_.dx);
+      long long dy = clamp_step(mouse_.dy);
+      long long wheel = clamp_step(mouse_.wheel);
+      long long pan = clamp_step(mouse_.pan);
+      queued_.push_back(Queued{"{\"device\":\"mouse\",\"action\":\"move\",\"dx\":" + std::to_string(dx) +
+                                   ",\"dy\":" + std::to_string(dy) + ",\"wheel\":" + std::to_string(wheel) +
+                                   ",\"pan\":" + std::to_string(pan) + "}",
+                               Waiter()});
+      mouse_.dx -= dx;
+      mouse_.dy -= dy;
+      mouse_.wheel -= wheel;
+      mouse_.pan -= pan;
+    } while (mouse_.dx != 0 || mouse_.dy != 0 || mouse_.wheel != 0 || mouse_.pan != 0);
+    mouse_.pending = false;
+  }
+
+  void Bridge::pump()
+  {
+    if (!device_open())
+    {
+      return;
+    }
+    int64_t now = hostlink::now_ns();
+    while (in_flight_.size() < config_.window)
+    {
+      if (queued_.empty())
+      {
+        if (!mouse_.pending)
+        {
+          break;
+        }
+        materialise_mouse();
+      }
+      Queued &next = queued_.front();
+      if (next.binary)
+      {
+        device_.send_binary(next.line);
+      }
+      else
+      {
+        device_.send(next.line);
+        in_flight_.push_back(InFlight{now, std::move(next.waiter)});
+        ++stats_.device_commands;
+      }
+      queued_.pop_front();
+    }
+  }
+
+  void Bridge::on_device_line(const std::string &line)
+  {
+    JsonMembers members;
+    if (!json_members(line, members))
+    {
+      if (config_.verbose)
+      {
+        fprintf(stderr, "[hid_bridge] device: %s\n", line.c_str());
+      }
+      return;
+    }
+    if (json_find(members, "status"))
+    {
+      if (in_flight_.empty())
+      {
+        ++stats_.unmatched;
+        return;
+      }
+      Waiter waiter = std::move(in_flight_.front().waiter);
+      in_flight_.pop_front();
+      ++stats_.replies;
+      if (waiter.client_id != 0)
+      {
+        send_to(waiter.client_id, "{\"type\":\"reply\",\"status\":\"ok\",\"requestId\":" + waiter.request_id +
+                                      ",\"response\":" + line + "}");
+      }
+      return;
+    }
+    if (json_find(members, "event"))
+    {
+      ++stats_.events;
+      broadcast("{\"type\":\"event\",\"data\":" + line + "}");
+    }
+  }
+
+  void Bridge::expire(int64_t now)
+  {
+    int64_t timeout_ns = static_cast<int64_t>(config_.reply_timeout_ms) * 1000000;
+    while (!in_flight_.empty() && now - in_flight_.front().sent_ns >= timeout_ns)
+    {
+      fail(in_flight_.front().waiter, "No reply from device");
+      in_flight_.pop_front();
+      ++stats_.expired;
+    }
+  }
+
+  void Bridge::update_write_interest()
+  {
+    if (device_open())
+    {
+      if (!device_.flush())
+      {
+        close_device(strerror(errno));
+      }
+      else if (device_.wants_write() != device_write_armed_)
+      {
+        device_write_armed_ = device_.wants_write();
+        watch(device_.fd(), kTagDevice, EPOLLIN | (device_write_armed_ ? EPOLLOUT : 0u), true);
+      }
+    }
+
+    std::vector<uint64_t> dropped;
+    for (auto &entry : clients_)
+    {
+      Client &client = *entry.second;
+      if (!client.link.flush() || client.link.pending_bytes() > kMaxClientBacklog)
+      {
+        dropped.push_back(entry.first);
+      }
+      else if (client.link.wants_write() != client.write_armed)
+      {
+        client.write_armed = client.link.wants_write();
+        watch(client.link.fd(), entry.first, EPOLLIN | (client.write_armed ? EPOLLOUT : 0u), true);
+      }
+    }
+    for (uint64_t id : dropped)
+    {
+      drop_client(id);
+    }
+  }
+
+  void Bridge::poll(int timeout_ms)
+  {
+    int64_t now = hostlink::now_ns();
+    if (!in_flight_.empty())
+    {
+      int64_t due_ns = in_flight_.front().sent_ns + static_cast<int64_t>(config_.reply_timeout_ms) * 1000000;
+      timeout_ms = std::min<int64_t>(timeout_ms, std::max<int64_t>(0, (due_ns - now) / 1000000 + 1));
+    }
+    if (!device_open() && !config_.device_path.empty())
+    {
+      timeout_ms = std::min<int64_t>(timeout_ms, std::max<int64_t>(0, (next_open_ns_ - now) / 1000000 + 1));
+    }
+
+    epoll_event events[32];
+    int count = epoll_wait(epoll_fd_, events, 32, timeout_ms);
+    for (int index = 0; index < count; ++index)
+    {
+      uint64_t tag = events[index].data.u64;
+      uint32_t flags = events[index].events;
+      if (tag == kTagUnixListener)
+      {
+        accept_clients(unix_listener_, false);
+      }
+      else if (tag == kTagWsListener)
+      {
+        accept_clients(ws_listener_, true);
+      }
+      else if (tag == kTagDevice)
+      {
+        if (!device_open())
+        {
+          continue;
+        }
+        if (flags & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+          if (!device_.read([this](const std::string &line) { on_device_line(line); }))
+          {
+            close_device("device closed");
+          }
+        }
+      }
+      else
+      {
+        auto found = clients_.find(tag);
+        if (found == clients_.end())
+        {
+          continue;
+        }
+        if (flags & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+          bool alive = found->second->link.read(
+              [this, tag](const std::string &message) { on_client_message(tag, message); });
+          if (!alive)
+          {
+            drop_client(tag);
+          }
+        }
+      }
+    }
+
+    now = hostlink::now_ns();
+    expire(now);
+    if (!device_open() && !config_.device_path.empty() && now >= next_open_ns_)
+    {
+      std::string error;
+      if (!open_device(error) && error != last_open_error_)
+      {
+        fprintf(stderr, "[hid_bridge] %s\n", error.c_str());
+        last_open_error_ = error;
+      }
+    }
+    pump();
+    update_write_interest();
+  }
+} // namespace hid_bridge
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "link.h"
+
+// Native replacement for the SerialBridge in web/server.py: one epoll loop owns the UART
+// and serves any number of local clients over a Unix socket (one JSON object per line)
+// and, optionally, a WebSocket port. Both speak the /ws/hid vocabulary of server.py plus
+// "command" (forward a raw payload and route the device's reply back by requestId),
+// "config" and "stats".
+//
+// Up to `window` commands are written to the device back to back without waiting or
+// flushing per message. Mouse moves that arrive while the window is full, or behind
+// other queued commands, are summed into one pending move, so a burst of pointer events
+// costs one UART line per free slot instead of one per event. The firmware answers every
+// command in order and carries no request id, so replies are matched to commands first
+// in, first out; a reply that never comes is written off after reply_timeout_ms.
+//
+// Binary pointer frames (src/pointer_protocol.h) from a client are checked and forwarded
+// unchanged, in order with everything else. The firmware does not answer them, so they
+// take no window slot and nothing waits for them.
+namespace hid_bridge
+{
+  struct Config
+  {
+    std::string device_path;
+    uint32_t baud = 115200;
+    // Unix socket for local clients; empty disables it.
+    std::string socket_path;
+    std::string ws_host = "127.0.0.1";
+    // 0 disables the WebSocket listener.
+    uint16_t ws_port = 0;
+    uint32_t window = 8;
+    uint32_t reply_timeout_ms = 1000;
+    // Delay between attempts to reopen a missing or unplugged device.
+    uint32_t reopen_ms = 1000;
+    bool verbose = false;
+  };
+
+  struct Stats
+  {
+    uint64_t client_messages = 0;
+    uint64_t device_commands = 0;
+    // Mouse moves folded into another move instead of getting their own line.
+    uint64_t coalesced_moves = 0;
+    uint64_t pointer_frames = 0;
+    // Binary messages that were not a well-formed pointer frame.
+    uint64_t rejected_frames = 0;
+    uint64_t replies = 0;
+    uint64_t expired = 0;
+    uint64_t unmatched = 0;
+    uint64_t events = 0;
+    uint64_t clients_accepted = 0;
+  };
+
+  class Bridge
+  {
+  public:
+    explicit Bridge(const Config &config);
+    ~Bridge();
+    Bridge(const Bridge &) = delete;
+    Bridge &operator=(const Bridge &) = delete;
+
+    // Opens the listeners. A device that cannot be opened yet is retried from poll().
+    bool start(std::string &error);
+    // Waits up to timeout_ms for activity and handles all of it.
+    void poll(int timeout_ms);
+
+    bool device_open() const;
+    const Stats &stats() const;
+
+  private:
+    struct Client
+    {
+      hostlink::Link link;
+      bool write_armed = false;
+    };
+
+    // Who is waiting for a device reply; client_id 0 means nobody.
+    struct Waiter
+    {
+      uint64_t client_id = 0;
+      std::string request_id;
+    };
+
+    struct Queued
+    {
+      std::string line;
+      Waiter waiter;
+      // A pointer frame: written raw and never answered.
+      bool binary = false;
+    };
+
+    struct InFlight
+    {
+      int64_t sent_ns;
+      Waiter waiter;
+    };
+
+    struct MouseDelta
+    {
+      long long dx = 0;
+      long long dy = 0;
+      long long wheel = 0;
+      long long pan = 0;
+      bool pending = false;
+    };
+
+    bool open_device(std::string &error);
+    void close_device(const char *reason);
+    void accept_clients(int listener, bool websocket);
+    void drop_client(uint64_t id);
+
+    void on_client_message(uint64_t id, const std::string &message);
+    void on_pointer_frame(uint64_t id, const std::string &frame);
+    void on_device_line(const std::string &line);
+    void reconfigure(uint64_t id, const std::string &port, long long baud, const std::string &request_id);
+
+    void enqueue(std::string line, Waiter waiter);
+    void add_mouse_move(long long dx, long long dy, long long wheel, long long pan);
+    void materialise_mouse();
+    void pump();
+    void expire(int64_t now);
+
+    void send_to(uint64_t id, const std::string &message);
+    void fail(const Waiter &waiter, const char *detail);
+    void broadcast(const std::string &message);
+    void update_write_interest();
+    void watch(int fd, uint64_t tag, uint32_t events, bool modify);
+
+    Config config_;
+    Stats stats_;
+    int epoll_fd_ = -1;
+    int unix_listener_ = -1;
+    int ws_listener_ = -1;
+    hostlink::Link device_;
+    bool device_write_armed_ = false;
+    int64_t next_open_ns_ = 0;
+    std::string last_open_error_;
+    std::unordered_map<uint64_t, std::unique_ptr<Client>> clients_;
+    uint64_t next_client_id_;
+    std::deque<Queued> queued_;
+    std::deque<InFlight> in_flight_;
+    MouseDelta mouse_;
+  };
+} // namespace hid_bridge
@@ -0,0 +1,286 @@
+// Drives a Bridge against a pty standing in for the firmware: checks that mouse moves
+// are coalesced behind a full window without losing distance or reordering them against
+// other commands, that device replies reach the client that asked, and that a missing
+// reply is written off, and that binary pointer frames reach the device byte for byte.
+
+#include "bridge.h"
+
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "json_scan.h"
+#include "link.h"
+#include "pointer_protocol.h"
+
+namespace
+{
+  int failures = 0;
+
+  void expect(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s\n", what);
+      ++failures;
+    }
+  }
+
+  // The firmware's end of the pty.
+  struct FakeDevice
+  {
+    int master = -1;
+    std::string rx;
+
+    void fill()
+    {
+      char buffer[4096];
+      ssize_t got;
+      while ((got = read(master, buffer, sizeof(buffer))) > 0)
+      {
+        rx.append(buffer, static_cast<size_t>(got));
+      }
+    }
+
+    std::vector<std::string> read_lines()
+    {
+      fill();
+      std::vector<std::string> lines;
+      size_t newline;
+      while ((newline = rx.find('\n')) != std::string::npos)
+      {
+        lines.push_back(rx.substr(0, newline));
+        rx.erase(0, newline + 1);
+      }
+      return lines;
+    }
+
+    std::string read_raw()
+    {
+      fill();
+      std::string bytes;
+      bytes.swap(rx);
+      return bytes;
+    }
+
+    void write_line(const std::string &line)
+    {
+      std::string framed = line + "\n";
+      if (write(master, framed.data(), framed.size()) != static_cast<ssize_t>(framed.size()))
+      {
+        fprintf(stderr, "FAIL short pty write\n");
+        ++failures;
+      }
+    }
+  };
+
+  std::string field(const std::string &message, const char *key)
+  {
+    hostlink::JsonMembers members;
+    if (!hostlink::json_members(message, members))
+    {
+      return std::string();
+    }
+    const std::string *raw = hostlink::json_find(members, key);
+    return raw ? *raw : std::string();
+  }
+} // namespace
+
+int main()
+{
+  FakeDevice device;
+  int slave = -1;
+  char slave_path[128];
+  if (openpty(&device.master, &slave, slave_path, nullptr, nullptr) != 0)
+  {
+    perror("openpty");
+    return 1;
+  }
+  fcntl(device.master, F_SETFL, fcntl(device.master, F_GETFL) | O_NONBLOCK);
+
+  hid_bridge::Config config;
+  config.device_path = slave_path;
+  config.socket_path = "/tmp/hid_bridge_check." + std::to_string(getpid()) + ".sock";
+  config.window = 2;
+  config.reply_timeout_ms = 200;
+  hid_bridge::Bridge bridge(config);
+  std::string error;
+  if (!bridge.start(error) || !bridge.device_open())
+  {
+    fprintf(stderr, "bridge start: %s\n", error.c_str());
+    return 1;
+  }
+
+  int client_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", config.socket_path.c_str());
+  if (connect(client_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+  {
+    perror("connect");
+    return 1;
+  }
+  hostlink::Link client;
+  client.adopt_stream(client_fd, "check client");
+  std::vector<std::string> received;
+  auto collect = [&]() {
+    client.read([&](const std::string &message) { received.push_back(message); });
+  };
+
+  // 50 moves of 10 px, then a click and a command that wants the device's reply. The
+  // device does not answer yet, so only `window` lines may go out.
+  for (int index = 0; index < 50; ++index)
+  {
+    client.send("{\"type\":\"mouse_move\",\"dx\":10,\"dy\":-3,\"requestId\":" + std::to_string(index) + "}");
+  }
+  client.send("{\"type\":\"mouse_click\",\"buttons\":\"right\"}");
+  client.send("{\"type\":\"command\",\"payload\":{\"device\":\"system\",\"action\":\"ping\"},\"requestId\":\"q1\"}");
+  client.flush();
+  for (int round = 0; round < 20; ++round)
+  {
+    bridge.poll(5);
+  }
+  std::vector<std::string> lines = device.read_lines();
+  expect(lines.size() == 2, "window limits unanswered commands");
+
+  // Answer everything, one line at a time, with an event in between.
+  std::vector<std::string> all_lines = lines;
+  bool sent_event = false;
+  for (int round = 0; round < 400 && all_lines.size() < 200; ++round)
+  {
+    for (size_t index = 0; index < lines.size(); ++index)
+    {
+      if (!sent_event)
+      {
+        device.write_line("{\"event\":\"ble_connected\"}");
+        sent_event = true;
+      }
+      device.write_line("{\"status\":\"ok\"}");
+    }
+    bridge.poll(5);
+    lines = device.read_lines();
+    all_lines.insert(all_lines.end(), lines.begin(), lines.end());
+    collect();
+    if (lines.empty() && field(received.empty() ? std::string() : received.back(), "type") == "\"reply\"")
+    {
+      break;
+    }
+  }
+
+  long long total_dx = 0;
+  long long total_dy = 0;
+  size_t moves = 0;
+  size_t click_index = 0;
+  size_t ping_index = 0;
+  for (size_t index = 0; index < all_lines.size(); ++index)
+  {
+    const std::string &line = all_lines[index];
+    if (field(line, "action") == "\"move\"")
+    {
+      long long dx = 0;
+      long long dy = 0;
+      hostlink::json_to_int(field(line, "dx"), dx);
+      hostlink::json_to_int(field(line, "dy"), dy);
+      expect(dx <= 127 && dx >= -127 && dy <= 127 && dy >= -127, "move step fits a HID report");
+      expect(click_index == 0, "moves precede the click");
+      total_dx += dx;
+      total_dy += dy;
+      ++moves;
+    }
+    else if (field(line, "action") == "\"click\"")
+    {
+      expect(field(line, "buttons") == "[\"right\"]", "single button becomes a list");
+      click_index = index;
+    }
+    else if (field(line, "action") == "\"ping\"")
+    {
+      ping_index = index;
+    }
+  }
+  expect(total_dx == 500 && total_dy == -150, "coalescing keeps the total distance");
+  expect(moves < 50, "moves were coalesced");
+  expect(click_index > 0 && ping_index == click_index + 1, "commands keep their order");
+  expect(bridge.stats().coalesced_moves > 0, "coalesced moves counted");
+
+  size_t acks = 0;
+  bool got_reply = false;
+  bool got_event = false;
+  for (const std::string &message : received)
+  {
+    std::string type = field(message, "type");
+    if (type == "\"mouse_move\"" && field(message, "status") == "\"ok\"")
+    {
+      ++acks;
+    }
+    else if (type == "\"reply\"")
+    {
+      got_reply = field(message, "requestId") == "\"q1\"" && field(message, "response") == "{\"status\":\"ok\"}";
+    }
+    else if (type == "\"event\"")
+    {
+      got_event = field(message, "data") == "{\"event\":\"ble_connected\"}";
+    }
+  }
+  expect(acks == 50, "every move with a requestId is acknowledged");
+  expect(got_reply, "device reply routed by requestId");
+  expect(got_event, "device events broadcast");
+
+  // A command the device never answers is failed after reply_timeout_ms.
+  received.clear();
+  client.send("{\"type\":\"command\",\"payload\":{\"device\":\"system\",\"action\":\"ping\"},\"requestId\":9}");
+  client.flush();
+  for (int round = 0; round < 100; ++round)
+  {
+    bridge.poll(10);
+    collect();
+    if (!received.empty())
+    {
+      break;
+    }
+  }
+  device.read_lines();
+  expect(received.size() == 1 && field(received[0], "status") == "\"error\"" && field(received[0], "requestId") == "9",
+         "unanswered command expires");
+  expect(bridge.stats().expired == 1, "expiry counted");
+
+  // A pointer frame goes out unchanged right after the command queued before it, even
+  // though that command's reply is still outstanding; a corrupt one is refused. The move's
+  // dx of 10 is a '\n' byte, which must not split the frame.
+  received.clear();
+  uint8_t buffer[pointer_protocol::kMaxFrameBytes];
+  pointer_protocol::FrameWriter writer(buffer, sizeof(buffer));
+  writer.move(10, -3);
+  writer.record(pointer_protocol::RecordType::ButtonsPress, 1);
+  std::string frame(reinterpret_cast<const char *>(buffer), writer.finish());
+  std::string corrupt = frame;
+  corrupt.back() = static_cast<char>(corrupt.back() + 1);
+  client.send("{\"type\":\"mouse_click\"}");
+  client.send_binary(frame);
+  client.send_binary(corrupt);
+  client.flush();
+  std::string raw;
+  for (int round = 0; round < 20; ++round)
+  {
+    bridge.poll(5);
+    raw += device.read_raw();
+    collect();
+  }
+  std::string click_line = "{\"device\":\"mouse\",\"action\":\"click\",\"buttons\":[\"left\"]}\n";
+  expect(raw == click_line + frame, "pointer frame forwarded verbatim and in order");
+  expect(bridge.stats().pointer_frames == 1 && bridge.stats().rejected_frames == 1, "pointer frames counted");
+  expect(received.size() == 1 && field(received[0], "status") == "\"error\"", "corrupt frame refused");
+
+  close(slave);
+  if (failures == 0)
+  {
+    printf("hid_bridge: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
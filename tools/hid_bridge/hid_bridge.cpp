@@ -0,0 +1,124 @@
+// Serial bridge daemon: owns the UART to the firmware and serves local clients over a
+// Unix socket and/or a WebSocket port, replacing the per-message write/flush/readline
+// path of web/server.py's SerialBridge. See bridge.h for the protocol and flow control.
+//
+//   hid_bridge --serial /dev/ttyUSB0 --baud 921600 --socket /tmp/hid_bridge.sock
+//   hid_bridge --serial /dev/pts/5 --ws-port 8765 --window 4
+//
+// web/server.py uses it when HID_BRIDGE_SOCKET names the socket.
+
+#include <signal.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "bridge.h"
+
+namespace
+{
+  volatile sig_atomic_t stop_requested = 0;
+
+  void on_signal(int)
+  {
+    stop_requested = 1;
+  }
+
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s --serial PATH [--baud N] [--socket PATH] [--ws-host ADDR] [--ws-port N]\n"
+            "          [--window N] [--reply-timeout-ms N] [--reopen-ms N] [--verbose]\n",
+            program);
+  }
+
+  bool parse_options(int argc, char **argv, hid_bridge::Config &config)
+  {
+    for (int index = 1; index < argc; ++index)
+    {
+      std::string flag = argv[index];
+      if (flag == "--verbose")
+      {
+        config.verbose = true;
+        continue;
+      }
+      if (index + 1 >= argc)
+      {
+        return false;
+      }
+      const char *value = argv[++index];
+      if (flag == "--serial")
+        config.device_path = value;
+      else if (flag == "--baud")
+        config.baud = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--socket")
+        config.socket_path = value;
+      else if (flag == "--ws-host")
+        config.ws_host = value;
+      else if (flag == "--ws-port")
+        config.ws_port = static_cast<uint16_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--window")
+        config.window = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--reply-timeout-ms")
+        config.reply_timeout_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--reopen-ms")
+        config.reopen_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+    if (config.socket_path.empty() && config.ws_port == 0)
+    {
+      config.socket_path = "/tmp/hid_bridge.sock";
+    }
+    return !config.device_path.empty();
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  hid_bridge::Config config;
+  if (!parse_options(argc, argv, config))
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  struct sigaction action = {};
+  action.sa_handler = on_signal;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  hid_bridge::Bridge bridge(config);
+  std::string error;
+  if (!bridge.start(error))
+  {
+    fprintf(stderr, "hid_bridge: %s\n", error.c_str());
+    return 1;
+  }
+  if (!config.socket_path.empty())
+  {
+    fprintf(stderr, "[hid_bridge] listening on %s\n", config.socket_path.c_str());
+  }
+  if (config.ws_port != 0)
+  {
+    fprintf(stderr, "[hid_bridge] WebSocket on ws://%s:%u/ws/hid\n", config.ws_host.c_str(), config.ws_port);
+  }
+
+  while (!stop_requested)
+  {
+    bridge.poll(1000);
+  }
+
+  const hid_bridge::Stats &stats = bridge.stats();
+  fprintf(stderr,
+          "[hid_bridge] client messages %llu, device commands %llu, coalesced moves %llu, replies %llu, "
+          "expired %llu, unmatched %llu, events %llu\n",
+          static_cast<unsigned long long>(stats.client_messages),
+          static_cast<unsigned long long>(stats.device_commands),
+          static_cast<unsigned long long>(stats.coalesced_moves), static_cast<unsigned long long>(stats.replies),
+          static_cast<unsigned long long>(stats.expired), static_cast<unsigned long long>(stats.unmatched),
+          static_cast<unsigned long long>(stats.events));
+  return 0;
+}
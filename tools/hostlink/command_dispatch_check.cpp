@@ -0,0 +1,95 @@
+// Resolves every registered (device, action) row through the firmware's dispatch table:
+// each row finds its own command, device names match in any case, unregistered actions fall
+// through to the device's any_action, and every command has at least one way in.
+
+#include <cstdio>
+#include <cstring>
+
+#include "command_dispatch.h"
+
+namespace
+{
+  int failures = 0;
+
+  void expect(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s\n", what);
+      ++failures;
+    }
+  }
+} // namespace
+
+int main()
+{
+  using command_dispatch::Command;
+  using command_dispatch::DeviceName;
+
+  bool reachable[command_dispatch::kCommandCount] = {};
+  for (const command_dispatch::Route &route : command_dispatch::kRoutes)
+  {
+    const DeviceName *device = nullptr;
+    for (const DeviceName &name : command_dispatch::kDevices)
+    {
+      if (name.device == route.device)
+      {
+        device = command_dispatch::find_device(name.name);
+        break;
+      }
+    }
+    expect(device && device->device == route.device, "route device is registered");
+    if (!device)
+    {
+      continue;
+    }
+    if (command_dispatch::find_command(*device, route.action) != route.command)
+    {
+      fprintf(stderr, "FAIL route %s does not resolve\n", route.action);
+      ++failures;
+    }
+    reachable[static_cast<size_t>(route.command)] = true;
+  }
+  for (const DeviceName &device : command_dispatch::kDevices)
+  {
+    if (device.any_action != Command::None)
+    {
+      reachable[static_cast<size_t>(device.any_action)] = true;
+    }
+  }
+  for (size_t index = 0; index < command_dispatch::kCommandCount; ++index)
+  {
+    if (!reachable[index])
+    {
+      fprintf(stderr, "FAIL command %zu has no route\n", index);
+      ++failures;
+    }
+  }
+
+  const DeviceName *keyboard = command_dispatch::find_device("KeyBoard");
+  expect(keyboard && keyboard->device == command_dispatch::Device::Keyboard, "device names ignore case");
+  expect(command_dispatch::find_device("keyboards") == nullptr && command_dispatch::find_device("key") == nullptr,
+         "device names match whole");
+  expect(keyboard && command_dispatch::find_command(*keyboard, "click") == command_dispatch::find_command(*keyboard, "tap"),
+         "aliases share a command");
+  expect(keyboard && command_dispatch::find_command(*keyboard, "Tap") == Command::None, "actions keep their case");
+  expect(keyboard && command_dispatch::find_command(*keyboard, "move") == Command::None, "actions belong to a device");
+  expect(keyboard && command_dispatch::find_command(*keyboard, "") == Command::None, "empty action");
+
+  const DeviceName *media = command_dispatch::find_device("media");
+  expect(media && command_dispatch::find_command(*media, "anything") == Command::ConsumerSend, "any_action fallback");
+
+  size_t used = 0;
+  for (const command_dispatch::Bucket &bucket : command_dispatch::kBuckets.buckets)
+  {
+    used += (bucket.first != command_dispatch::kNoRoute) + (bucket.second != command_dispatch::kNoRoute);
+  }
+  expect(used == command_dispatch::kRouteCount, "every row has a slot");
+
+  if (failures == 0)
+  {
+    printf("command_dispatch: %zu routes in %zu buckets (seed %u), all checks passed\n", command_dispatch::kRouteCount,
+           command_dispatch::kBucketCount, static_cast<unsigned>(command_dispatch::kRouteSeed));
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include "hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace hostlink
+{
+  namespace
+  {
+    int bit_length(uint64_t value)
+    {
+      return value == 0 ? 0 : 64 - __builtin_clzll(value);
+    }
+  } // namespace
+
+  HdrHistogram::HdrHistogram(int64_t highest_trackable, int significant_digits)
+      : highest_trackable_(std::max<int64_t>(highest_trackable, 2))
+  {
+    significant_digits = std::min(std::max(significant_digits, 1), 5);
+    int64_t largest_single_unit = 2 * static_cast<int64_t>(std::pow(10, significant_digits));
+    int sub_bucket_count_magnitude = bit_length(static_cast<uint64_t>(largest_single_unit - 1));
+    sub_bucket_half_count_magnitude_ = std::max(sub_bucket_count_magnitude, 1) - 1;
+    sub_bucket_count_ = int64_t(1) << (sub_bucket_half_count_magnitude_ + 1);
+    sub_bucket_half_count_ = sub_bucket_count_ / 2;
+    sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+    int buckets = 1;
+    int64_t smallest_untrackable = sub_bucket_count_;
+    while (smallest_untrackable <= highest_trackable_)
+    {
+      if (smallest_untrackable > INT64_MAX / 2)
+      {
+        ++buckets;
+        break;
+      }
+      smallest_untrackable <<= 1;
+      ++buckets;
+    }
+    counts_.assign(static_cast<size_t>((buckets + 1) * sub_bucket_half_count_), 0);
+  }
+
+  size_t HdrHistogram::index_of(int64_t value) const
+  {
+    int bucket = bit_length(static_cast<uint64_t>(value | sub_bucket_mask_)) - (sub_bucket_half_count_magnitude_ + 1);
+    int64_t sub_bucket = value >> bucket;
+    return static_cast<size_t>(((bucket + 1) << sub_bucket_half_count_magnitude_) + (sub_bucket - sub_bucket_half_count_));
+  }
+
+  int64_t HdrHistogram::value_of(size_t index) const
+  {
+    int64_t bucket = static_cast<int64_t>(index >> sub_bucket_half_count_magnitude_) - 1;
+    int64_t sub_bucket = static_cast<int64_t>(index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+    if (bucket < 0)
+    {
+      sub_bucket -= sub_bucket_half_count_;
+      bucket = 0;
+    }
+    return sub_bucket << bucket;
+  }
+
+  int64_t HdrHistogram::highest_equivalent(int64_t value) const
+  {
+    int bucket = bit_length(static_cast<uint64_t>(value | sub_bucket_mask_)) - (sub_bucket_half_count_magnitude_ + 1);
+    int64_t lowest = (value >> bucket) << bucket;
+    return lowest + (int64_t(1) << bucket) - 1;
+  }
+
+  void HdrHistogram::record(int64_t value)
+  {
+    value = std::min(std::max<int64_t>(value, 0), highest_trackable_);
+    size_t index = std::min(index_of(value), counts_.size() - 1);
+    ++counts_[index];
+    ++total_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+  }
+
+  void HdrHistogram::merge(const HdrHistogram &other)
+  {
+    if (other.total_ == 0)
+    {
+      return;
+    }
+    for (size_t index = 0; index < other.counts_.size(); ++index)
+    {
+      if (other.counts_[index] == 0)
+      {
+        continue;
+      }
+      int64_t value = other.value_of(index);
+      size_t target = std::min(index_of(std::min(value, highest_trackable_)), counts_.size() - 1);
+      counts_[target] += other.counts_[index];
+    }
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+  }
+
+  void HdrHistogram::reset()
+  {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    min_ = INT64_MAX;
+    max_ = 0;
+    sum_ = 0;
+  }
+
+  uint64_t HdrHistogram::count() const
+  {
+    return total_;
+  }
+
+  int64_t HdrHistogram::min() const
+  {
+    return total_ ? min_ : 0;
+  }
+
+  int64_t HdrHistogram::max() const
+  {
+    return max_;
+  }
+
+  double HdrHistogram::mean() const
+  {
+    return total_ ? static_cast<double>(sum_ / total_) : 0.0;
+  }
+
+  int64_t HdrHistogram::value_at_percentile(double percentile) const
+  {
+    if (total_ == 0)
+    {
+      return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    // The epsilon keeps 99.9 % of 1000 at 999 rather than rounding up to 1000.
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_) - 1e-9));
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t index = 0; index < counts_.size(); ++index)
+    {
+      seen += counts_[index];
+      if (seen >= target)
+      {
+        return std::min(highest_equivalent(value_of(index)), max_);
+      }
+    }
+    return max_;
+  }
+} // namespace hostlink
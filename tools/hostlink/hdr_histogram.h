@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Log-linear latency histogram in the HdrHistogram layout: every power-of-two range is
+// split into the same number of linear sub-buckets, so any recorded value is reported
+// to within 10^-significant_digits of itself across the whole trackable range.
+namespace hostlink
+{
+  class HdrHistogram
+  {
+  public:
+    // Values above highest_trackable are clamped to it; significant_digits is 1..5.
+    explicit HdrHistogram(int64_t highest_trackable = 60000000, int significant_digits = 3);
+
+    void record(int64_t value);
+    void merge(const HdrHistogram &other);
+    void reset();
+
+    uint64_t count() const;
+    int64_t min() const;
+    int64_t max() const;
+    double mean() const;
+    // Smallest recorded-equivalent value at or above `percentile` (0..100) of the samples.
+    int64_t value_at_percentile(double percentile) const;
+
+  private:
+    size_t index_of(int64_t value) const;
+    int64_t value_of(size_t index) const;
+    int64_t highest_equivalent(int64_t value) const;
+
+    int64_t highest_trackable_;
+    int sub_bucket_half_count_magnitude_ = 0;
+    int64_t sub_bucket_count_ = 0;
+    int64_t sub_bucket_half_count_ = 0;
+    int64_t sub_bucket_mask_ = 0;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    int64_t min_ = INT64_MAX;
+    int64_t max_ = 0;
+    long double sum_ = 0;
+  };
+} // namespace hostlink
@@ -0,0 +1,68 @@
+// Checks HdrHistogram percentiles against exact answers on known distributions.
+
+#include "hdr_histogram.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+  int failures = 0;
+
+  void expect_within(const char *what, int64_t actual, int64_t expected, double relative)
+  {
+    double error = expected == 0 ? static_cast<double>(actual) : (actual - expected) / static_cast<double>(expected);
+    if (error < -relative || error > relative)
+    {
+      fprintf(stderr, "FAIL %s: got %lld, expected %lld\n", what, static_cast<long long>(actual),
+              static_cast<long long>(expected));
+      ++failures;
+    }
+  }
+} // namespace
+
+int main()
+{
+  hostlink::HdrHistogram uniform(60000000, 3);
+  for (int64_t value = 1; value <= 100000; ++value)
+  {
+    uniform.record(value);
+  }
+  expect_within("uniform p50", uniform.value_at_percentile(50), 50000, 0.001);
+  expect_within("uniform p99", uniform.value_at_percentile(99), 99000, 0.001);
+  expect_within("uniform p99.9", uniform.value_at_percentile(99.9), 99900, 0.001);
+  expect_within("uniform max", uniform.value_at_percentile(100), 100000, 0.0);
+  expect_within("uniform min", uniform.min(), 1, 0.0);
+
+  // 999 fast samples and one stall: the stall must show at p99.9 and above only.
+  hostlink::HdrHistogram tail;
+  for (int index = 0; index < 999; ++index)
+  {
+    tail.record(250);
+  }
+  tail.record(4000000);
+  expect_within("tail p99", tail.value_at_percentile(99), 250, 0.0);
+  expect_within("tail p99.9", tail.value_at_percentile(99.9), 250, 0.0);
+  expect_within("tail p100", tail.value_at_percentile(100), 4000000, 0.001);
+
+  hostlink::HdrHistogram merged;
+  merged.merge(uniform);
+  merged.merge(tail);
+  if (merged.count() != uniform.count() + tail.count())
+  {
+    fprintf(stderr, "FAIL merge count\n");
+    ++failures;
+  }
+  expect_within("merged max", merged.max(), 4000000, 0.0);
+
+  hostlink::HdrHistogram clamped(1000, 3);
+  clamped.record(5000);
+  expect_within("clamped", clamped.max(), 1000, 0.0);
+
+  if (failures == 0)
+  {
+    printf("hdr_histogram: ok\n");
+  }
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
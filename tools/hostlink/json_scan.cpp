@@ -0,0 +1,280 @@
+#include "json_scan.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace hostlink
+{
+  namespace
+  {
+    void skip_space(const std::string &text, size_t &position)
+    {
+      while (position < text.size() && text[position] != '\0' && strchr(" \t\r\n", text[position]))
+      {
+        ++position;
+      }
+    }
+
+    bool skip_string(const std::string &text, size_t &position)
+    {
+      ++position;
+      while (position < text.size())
+      {
+        char c = text[position++];
+        if (c == '\\')
+        {
+          ++position;
+        }
+        else if (c == '"')
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool skip_value(const std::string &text, size_t &position)
+    {
+      skip_space(text, position);
+      if (position >= text.size())
+      {
+        return false;
+      }
+      char c = text[position];
+      if (c == '"')
+      {
+        return skip_string(text, position);
+      }
+      if (c == '{' || c == '[')
+      {
+        int depth = 0;
+        while (position < text.size())
+        {
+          char current = text[position];
+          if (current == '"')
+          {
+            if (!skip_string(text, position))
+            {
+              return false;
+            }
+            continue;
+          }
+          ++position;
+          if (current == '{' || current == '[')
+          {
+            ++depth;
+          }
+          else if (current == '}' || current == ']')
+          {
+            if (--depth == 0)
+            {
+              return true;
+            }
+          }
+        }
+        return false;
+      }
+      size_t start = position;
+      while (position < text.size() && !strchr(",}] \t\r\n", text[position]))
+      {
+        ++position;
+      }
+      return position > start;
+    }
+
+    void append_utf8(std::string &out, unsigned code_point)
+    {
+      if (code_point < 0x80)
+      {
+        out += static_cast<char>(code_point);
+      }
+      else if (code_point < 0x800)
+      {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+      }
+      else
+      {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+      }
+    }
+  } // namespace
+
+  bool json_members(const std::string &text, JsonMembers &members)
+  {
+    members.clear();
+    size_t position = 0;
+    skip_space(text, position);
+    if (position >= text.size() || text[position] != '{')
+    {
+      return false;
+    }
+    ++position;
+    skip_space(text, position);
+    if (position < text.size() && text[position] == '}')
+    {
+      return true;
+    }
+    while (position < text.size())
+    {
+      skip_space(text, position);
+      if (position >= text.size() || text[position] != '"')
+      {
+        return false;
+      }
+      size_t key_start = position;
+      if (!skip_string(text, position))
+      {
+        return false;
+      }
+      std::string key;
+      if (!json_to_string(text.substr(key_start, position - key_start), key))
+      {
+        return false;
+      }
+      skip_space(text, position);
+      if (position >= text.size() || text[position] != ':')
+      {
+        return false;
+      }
+      ++position;
+      skip_space(text, position);
+      size_t value_start = position;
+      if (!skip_value(text, position))
+      {
+        return false;
+      }
+      members.emplace_back(key, text.substr(value_start, position - value_start));
+      skip_space(text, position);
+      if (position < text.size() && text[position] == ',')
+      {
+        ++position;
+        continue;
+      }
+      return position < text.size() && text[position] == '}';
+    }
+    return false;
+  }
+
+  const std::string *json_find(const JsonMembers &members, const char *key)
+  {
+    for (const auto &member : members)
+    {
+      if (member.first == key)
+      {
+        return &member.second;
+      }
+    }
+    return nullptr;
+  }
+
+  bool json_to_int(const std::string &raw, long long &out)
+  {
+    if (raw.empty())
+    {
+      return false;
+    }
+    char *end = nullptr;
+    double value = strtod(raw.c_str(), &end);
+    if (end != raw.c_str() + raw.size())
+    {
+      return false;
+    }
+    out = static_cast<long long>(value);
+    return true;
+  }
+
+  bool json_to_string(const std::string &raw, std::string &out)
+  {
+    out.clear();
+    if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"')
+    {
+      return false;
+    }
+    for (size_t index = 1; index + 1 < raw.size(); ++index)
+    {
+      char c = raw[index];
+      if (c != '\\')
+      {
+        out += c;
+        continue;
+      }
+      if (++index >= raw.size() - 1)
+      {
+        return false;
+      }
+      switch (raw[index])
+      {
+      case 'n':
+        out += '\n';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'u':
+        if (index + 4 >= raw.size() - 1)
+        {
+          return false;
+        }
+        append_utf8(out, static_cast<unsigned>(strtoul(raw.substr(index + 1, 4).c_str(), nullptr, 16)));
+        index += 4;
+        break;
+      default:
+        out += raw[index];
+        break;
+      }
+    }
+    return true;
+  }
+
+  std::string json_quote(const std::string &value)
+  {
+    std::string out = "\"";
+    for (unsigned char c : value)
+    {
+      switch (c)
+      {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (c < 0x20)
+        {
+          char escaped[8];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          out += escaped;
+        }
+        else
+        {
+          out += static_cast<char>(c);
+        }
+      }
+    }
+    out += '"';
+    return out;
+  }
+} // namespace hostlink
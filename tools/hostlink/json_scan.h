@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for the host tools to route messages: a top-level object is split
+// into members whose values stay raw JSON text, so payloads can be forwarded untouched
+// and only the fields a tool looks at are decoded.
+namespace hostlink
+{
+  using JsonMembers = std::vector<std::pair<std::string, std::string>>;
+
+  // False unless `text` is a single JSON object.
+  bool json_members(const std::string &text, JsonMembers &members);
+  // Raw value of `key`, or nullptr.
+  const std::string *json_find(const JsonMembers &members, const char *key);
+
+  bool json_to_int(const std::string &raw, long long &out);
+  // Decodes a JSON string value (\uXXXX escapes become UTF-8); false for other types.
+  bool json_to_string(const std::string &raw, std::string &out);
+  std::string json_quote(const std::string &value);
+} // namespace hostlink
@@ -0,0 +1,638 @@
+#include "link.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+#include <random>
+
+#include "pointer_protocol.h"
+
+namespace hostlink
+{
+  namespace
+  {
+    constexpr size_t kMaxFrameBytes = 1 << 20;
+
+    std::string base64(const uint8_t *data, size_t length)
+    {
+      static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      std::string out;
+      for (size_t i = 0; i < length; i += 3)
+      {
+        uint32_t chunk = uint32_t(data[i]) << 16;
+        if (i + 1 < length)
+          chunk |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < length)
+          chunk |= data[i + 2];
+        out.push_back(kAlphabet[(chunk >> 18) & 0x3F]);
+        out.push_back(kAlphabet[(chunk >> 12) & 0x3F]);
+        out.push_back(i + 1 < length ? kAlphabet[(chunk >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < length ? kAlphabet[chunk & 0x3F] : '=');
+      }
+      return out;
+    }
+
+    uint32_t rotate_left(uint32_t value, int bits)
+    {
+      return (value << bits) | (value >> (32 - bits));
+    }
+
+    void sha1(const std::string &message, uint8_t digest[20])
+    {
+      uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+      std::string padded = message;
+      padded.push_back(static_cast<char>(0x80));
+      while (padded.size() % 64 != 56)
+      {
+        padded.push_back('\0');
+      }
+      uint64_t bit_length = static_cast<uint64_t>(message.size()) * 8;
+      for (int shift = 56; shift >= 0; shift -= 8)
+      {
+        padded.push_back(static_cast<char>(bit_length >> shift));
+      }
+      for (size_t block = 0; block < padded.size(); block += 64)
+      {
+        uint32_t words[80];
+        for (int i = 0; i < 16; ++i)
+        {
+          const uint8_t *bytes = reinterpret_cast<const uint8_t *>(padded.data() + block + i * 4);
+          words[i] = (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+        }
+        for (int i = 16; i < 80; ++i)
+        {
+          words[i] = rotate_left(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; ++i)
+        {
+          uint32_t f, k;
+          if (i < 20)
+          {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+          }
+          else if (i < 40)
+          {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+          }
+          else if (i < 60)
+          {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+          }
+          else
+          {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+          }
+          uint32_t next = rotate_left(a, 5) + f + e + k + words[i];
+          e = d;
+          d = c;
+          c = rotate_left(b, 30);
+          b = a;
+          a = next;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+      }
+      for (int i = 0; i < 5; ++i)
+      {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+      }
+    }
+
+    // Value of an HTTP header in a raw request, matched case-insensitively.
+    std::string header_value(const std::string &request, const char *name)
+    {
+      size_t name_length = strlen(name);
+      size_t line = request.find("\r\n");
+      while (line != std::string::npos && line + 2 < request.size())
+      {
+        size_t start = line + 2;
+        size_t end = request.find("\r\n", start);
+        if (end == std::string::npos || end == start)
+        {
+          break;
+        }
+        if (end - start > name_length && request[start + name_length] == ':' &&
+            strncasecmp(request.c_str() + start, name, name_length) == 0)
+        {
+          size_t value = start + name_length + 1;
+          while (value < end && request[value] == ' ')
+          {
+            ++value;
+          }
+          return request.substr(value, end - value);
+        }
+        line = end;
+      }
+      return std::string();
+    }
+
+    speed_t baud_constant(uint32_t baud)
+    {
+      switch (baud)
+      {
+      case 9600:
+        return B9600;
+      case 19200:
+        return B19200;
+      case 38400:
+        return B38400;
+      case 57600:
+        return B57600;
+      case 230400:
+        return B230400;
+      case 460800:
+        return B460800;
+      case 921600:
+        return B921600;
+      case 115200:
+      default:
+        return B115200;
+      }
+    }
+
+    bool set_nonblocking(int fd)
+    {
+      int flags = fcntl(fd, F_GETFL, 0);
+      return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+  } // namespace
+
+  int64_t now_ns()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+  }
+
+  Link::~Link()
+  {
+    close();
+  }
+
+  bool Link::open_websocket(const std::string &target, std::string &error)
+  {
+    close();
+    kind_ = LinkKind::WebSocket;
+    server_ = false;
+    label_ = "ws://" + target;
+
+    std::string host_port = target;
+    std::string path = "/ws/hid";
+    size_t slash = target.find('/');
+    if (slash != std::string::npos)
+    {
+      host_port = target.substr(0, slash);
+      path = target.substr(slash);
+    }
+    size_t colon = host_port.rfind(':');
+    std::string host = colon == std::string::npos ? host_port : host_port.substr(0, colon);
+    std::string port = colon == std::string::npos ? "80" : host_port.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    int resolved = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if (resolved != 0)
+    {
+      error = label_ + ": " + gai_strerror(resolved);
+      return false;
+    }
+    for (addrinfo *address = addresses; address; address = address->ai_next)
+    {
+      fd_ = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+      if (fd_ >= 0 && connect(fd_, address->ai_addr, address->ai_addrlen) == 0)
+      {
+        break;
+      }
+      if (fd_ >= 0)
+      {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+    freeaddrinfo(addresses);
+    if (fd_ < 0)
+    {
+      error = label_ + ": " + strerror(errno);
+      return false;
+    }
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint8_t nonce[16];
+    std::random_device random;
+    for (uint8_t &byte : nonce)
+    {
+      byte = static_cast<uint8_t>(random());
+    }
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host_port +
+                          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " +
+                          base64(nonce, sizeof(nonce)) + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (::send(fd_, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size()))
+    {
+      error = label_ + ": handshake write failed";
+      close();
+      return false;
+    }
+
+    std::string response;
+    size_t end = std::string::npos;
+    while ((end = response.find("\r\n\r\n")) == std::string::npos && response.size() < 4096)
+    {
+      char buffer[512];
+      ssize_t got = recv(fd_, buffer, sizeof(buffer), 0);
+      if (got <= 0)
+      {
+        error = label_ + ": connection closed during handshake";
+        close();
+        return false;
+      }
+      response.append(buffer, static_cast<size_t>(got));
+    }
+    if (response.compare(0, 12, "HTTP/1.1 101") != 0)
+    {
+      error = label_ + ": upgrade refused: " + response.substr(0, response.find("\r\n"));
+      close();
+      return false;
+    }
+    // Frames the server sent right behind the 101 stay buffered for read().
+    rx_ = response.substr(end + 4);
+    set_nonblocking(fd_);
+    return true;
+  }
+
+  bool Link::open_serial(const std::string &path, uint32_t baud, std::string &error)
+  {
+    close();
+    kind_ = LinkKind::Serial;
+    label_ = path;
+    fd_ = ::open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd_ < 0)
+    {
+      error = path + ": " + strerror(errno);
+      return false;
+    }
+    termios tty = {};
+    if (tcgetattr(fd_, &tty) == 0)
+    {
+      cfmakeraw(&tty);
+      cfsetispeed(&tty, baud_constant(baud));
+      cfsetospeed(&tty, baud_constant(baud));
+      tty.c_cflag |= CLOCAL | CREAD;
+      tcsetattr(fd_, TCSANOW, &tty);
+    }
+    return true;
+  }
+
+  bool Link::accept_websocket(int fd, int timeout_ms, std::string &error)
+  {
+    close();
+    kind_ = LinkKind::WebSocket;
+    server_ = true;
+    fd_ = fd;
+    label_ = "ws client " + std::to_string(fd);
+    set_nonblocking(fd_);
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::string request;
+    size_t end = std::string::npos;
+    int64_t deadline = now_ns() + static_cast<int64_t>(timeout_ms) * 1000000;
+    while ((end = request.find("\r\n\r\n")) == std::string::npos && request.size() < 8192)
+    {
+      int remaining_ms = static_cast<int>((deadline - now_ns()) / 1000000);
+      pollfd waiter = {fd_, POLLIN, 0};
+      if (remaining_ms <= 0 || poll(&waiter, 1, remaining_ms) <= 0)
+      {
+        error = label_ + ": no upgrade request";
+        close();
+        return false;
+      }
+      char buffer[1024];
+      ssize_t got = recv(fd_, buffer, sizeof(buffer), 0);
+      if (got <= 0 && !(got < 0 && (errno == EAGAIN || errno == EINTR)))
+      {
+        error = label_ + ": connection closed during handshake";
+        close();
+        return false;
+      }
+      if (got > 0)
+      {
+        request.append(buffer, static_cast<size_t>(got));
+      }
+    }
+    std::string key = header_value(request, "Sec-WebSocket-Key");
+    if (end == std::string::npos || key.empty())
+    {
+      static const char kRefusal[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      ::send(fd_, kRefusal, sizeof(kRefusal) - 1, MSG_NOSIGNAL);
+      error = label_ + ": not a WebSocket upgrade";
+      close();
+      return false;
+    }
+    size_t path_start = request.find(' ') + 1;
+    label_ = "ws " + request.substr(path_start, request.find(' ', path_start) - path_start) + " (fd " +
+             std::to_string(fd_) + ")";
+
+    uint8_t digest[20];
+    sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+    tx_ = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " +
+          base64(digest, sizeof(digest)) + "\r\n\r\n";
+    // Frames the client pipelined behind the request stay buffered for read().
+    rx_ = request.substr(end + 4);
+    return true;
+  }
+
+  void Link::adopt_stream(int fd, const std::string &label)
+  {
+    close();
+    kind_ = LinkKind::Stream;
+    fd_ = fd;
+    label_ = label;
+    set_nonblocking(fd_);
+  }
+
+  void Link::close()
+  {
+    if (fd_ >= 0)
+    {
+      ::close(fd_);
+    }
+    fd_ = -1;
+    tx_.clear();
+    tx_offset_ = 0;
+    rx_.clear();
+  }
+
+  int Link::fd() const
+  {
+    return fd_;
+  }
+
+  LinkKind Link::kind() const
+  {
+    return kind_;
+  }
+
+  const std::string &Link::label() const
+  {
+    return label_;
+  }
+
+  void Link::send_frame(uint8_t opcode, const char *data, size_t length)
+  {
+    // Client frames must be masked; a fixed key is enough since nothing here is secret.
+    // Server frames must not be.
+    static const uint8_t kMask[4] = {0x5A, 0xC3, 0x96, 0x3C};
+    uint8_t mask_bit = server_ ? 0x00 : 0x80;
+    tx_.push_back(static_cast<char>(0x80 | opcode));
+    if (length < 126)
+    {
+      tx_.push_back(static_cast<char>(mask_bit | length));
+    }
+    else if (length <= 0xFFFF)
+    {
+      tx_.push_back(static_cast<char>(mask_bit | 126));
+      tx_.push_back(static_cast<char>(length >> 8));
+      tx_.push_back(static_cast<char>(length));
+    }
+    else
+    {
+      tx_.push_back(static_cast<char>(mask_bit | 127));
+      for (int shift = 56; shift >= 0; shift -= 8)
+      {
+        tx_.push_back(static_cast<char>(static_cast<uint64_t>(length) >> shift));
+      }
+    }
+    if (server_)
+    {
+      tx_.append(data, length);
+      return;
+    }
+    tx_.append(reinterpret_cast<const char *>(kMask), sizeof(kMask));
+    for (size_t index = 0; index < length; ++index)
+    {
+      tx_.push_back(static_cast<char>(data[index] ^ kMask[index % 4]));
+    }
+  }
+
+  void Link::send(const std::string &message)
+  {
+    if (kind_ == LinkKind::WebSocket)
+    {
+      send_frame(0x1, message.data(), message.size());
+    }
+    else
+    {
+      tx_ += message;
+      tx_ += '\n';
+    }
+  }
+
+  void Link::send_binary(const std::string &frame)
+  {
+    if (kind_ == LinkKind::WebSocket)
+    {
+      send_frame(0x2, frame.data(), frame.size());
+    }
+    else
+    {
+      tx_ += frame;
+    }
+  }
+
+  bool Link::flush()
+  {
+    while (tx_offset_ < tx_.size())
+    {
+      ssize_t written = kind_ != LinkKind::Serial
+                            ? ::send(fd_, tx_.data() + tx_offset_, tx_.size() - tx_offset_, MSG_NOSIGNAL)
+                            : ::write(fd_, tx_.data() + tx_offset_, tx_.size() - tx_offset_);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+      }
+      tx_offset_ += static_cast<size_t>(written);
+    }
+    tx_.clear();
+    tx_offset_ = 0;
+    return true;
+  }
+
+  bool Link::wants_write() const
+  {
+    return tx_offset_ < tx_.size();
+  }
+
+  size_t Link::pending_bytes() const
+  {
+    return tx_.size() - tx_offset_;
+  }
+
+  bool Link::read(const std::function<void(const std::string &message)> &on_message)
+  {
+    char buffer[16384];
+    for (;;)
+    {
+      ssize_t got = ::read(fd_, buffer, sizeof(buffer));
+      if (got > 0)
+      {
+        rx_.append(buffer, static_cast<size_t>(got));
+        continue;
+      }
+      if (got == 0)
+      {
+        // A pty whose other side closed reads 0 as well; both mean the device is gone.
+        // Deliver what was already complete first.
+        kind_ == LinkKind::WebSocket ? parse_websocket(on_message) : parse_lines(on_message);
+        return false;
+      }
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+      {
+        break;
+      }
+      return false;
+    }
+    return kind_ == LinkKind::WebSocket ? parse_websocket(on_message) : parse_lines(on_message);
+  }
+
+  bool Link::parse_lines(const std::function<void(const std::string &message)> &on_message)
+  {
+    size_t start = 0;
+    for (;;)
+    {
+      // A pointer frame can only start where a line would and is delimited by its length,
+      // since its records may contain '\n'.
+      if (start < rx_.size() && static_cast<uint8_t>(rx_[start]) == pointer_protocol::kFrameStart)
+      {
+        size_t size = pointer_protocol::frame_size(reinterpret_cast<const uint8_t *>(rx_.data()) + start,
+                                                   rx_.size() - start);
+        if (size == 0 || rx_.size() - start < size)
+        {
+          break;
+        }
+        on_message(rx_.substr(start, size));
+        start += size;
+        continue;
+      }
+      size_t newline = rx_.find('\n', start);
+      if (newline == std::string::npos)
+      {
+        break;
+      }
+      size_t end = newline;
+      if (end > start && rx_[end - 1] == '\r')
+      {
+        --end;
+      }
+      if (end > start)
+      {
+        on_message(rx_.substr(start, end - start));
+      }
+      start = newline + 1;
+    }
+    rx_.erase(0, start);
+    return true;
+  }
+
+  bool Link::parse_websocket(const std::function<void(const std::string &message)> &on_message)
+  {
+    size_t offset = 0;
+    for (;;)
+    {
+      if (rx_.size() - offset < 2)
+      {
+        break;
+      }
+      const uint8_t *head = reinterpret_cast<const uint8_t *>(rx_.data() + offset);
+      uint8_t opcode = head[0] & 0x0F;
+      bool masked = (head[1] & 0x80) != 0;
+      uint64_t length = head[1] & 0x7F;
+      size_t header = 2;
+      if (length == 126)
+      {
+        if (rx_.size() - offset < 4)
+          break;
+        length = (uint64_t(head[2]) << 8) | head[3];
+        header = 4;
+      }
+      else if (length == 127)
+      {
+        if (rx_.size() - offset < 10)
+          break;
+        length = 0;
+        for (int index = 0; index < 8; ++index)
+        {
+          length = (length << 8) | head[2 + index];
+        }
+        header = 10;
+      }
+      if (length > kMaxFrameBytes)
+      {
+        return false;
+      }
+      size_t mask_bytes = masked ? 4 : 0;
+      if (rx_.size() - offset < header + mask_bytes + length)
+      {
+        break;
+      }
+      std::string payload = rx_.substr(offset + header + mask_bytes, static_cast<size_t>(length));
+      if (masked)
+      {
+        for (size_t index = 0; index < payload.size(); ++index)
+        {
+          payload[index] ^= rx_[offset + header + index % 4];
+        }
+      }
+      offset += header + mask_bytes + static_cast<size_t>(length);
+
+      switch (opcode)
+      {
+      case 0x1:
+      case 0x2:
+        on_message(payload);
+        break;
+      case 0x8:
+        rx_.erase(0, offset);
+        return false;
+      case 0x9:
+        send_frame(0xA, payload.data(), payload.size());
+        break;
+      default:
+        break;
+      }
+    }
+    rx_.erase(0, offset);
+    return true;
+  }
+} // namespace hostlink
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// One connection carrying the JSON command protocol: a WebSocket session on /ws or
+// /ws/hid, a UART (or pty) with one JSON object per line, or a local stream socket framed
+// the same way. Links are non-blocking after open so many of them can share one epoll
+// loop: queue messages with send(), call flush() when the fd is writable and read() when
+// it is readable.
+namespace hostlink
+{
+  enum class LinkKind : uint8_t
+  {
+    WebSocket = 0,
+    Serial,
+    Stream
+  };
+
+  class Link
+  {
+  public:
+    Link() = default;
+    ~Link();
+    Link(const Link &) = delete;
+    Link &operator=(const Link &) = delete;
+
+    // "host:port[/path]" (path defaults to /ws/hid). Connects and completes the upgrade
+    // synchronously; false with `error` set on failure.
+    bool open_websocket(const std::string &target, std::string &error);
+    // Device path of a UART or pty, switched to raw mode at `baud`.
+    bool open_serial(const std::string &path, uint32_t baud, std::string &error);
+    // Server side of a WebSocket: answers the upgrade request on an accepted socket, waiting
+    // at most timeout_ms for it. Frames sent from here on are unmasked.
+    bool accept_websocket(int fd, int timeout_ms, std::string &error);
+    // Takes ownership of a connected stream socket carrying one message per line.
+    void adopt_stream(int fd, const std::string &label);
+    void close();
+
+    int fd() const;
+    LinkKind kind() const;
+    const std::string &label() const;
+
+    // Frames one message (a WebSocket text frame or a line) into the send buffer.
+    void send(const std::string &message);
+    // Queues a binary pointer frame (pointer_protocol.h): a WebSocket binary frame, or the
+    // raw bytes on a line-based link, where the start byte marks it.
+    void send_binary(const std::string &frame);
+    // Writes as much of the send buffer as the fd takes; false on a write error.
+    bool flush();
+    bool wants_write() const;
+    size_t pending_bytes() const;
+
+    // Reads what is available and calls on_message for every complete message: a text or
+    // binary WebSocket frame, a line, or a pointer frame on a line-based link. Returns
+    // false once the peer closed or the read failed.
+    bool read(const std::function<void(const std::string &message)> &on_message);
+
+  private:
+    bool parse_websocket(const std::function<void(const std::string &message)> &on_message);
+    bool parse_lines(const std::function<void(const std::string &message)> &on_message);
+    void send_frame(uint8_t opcode, const char *data, size_t length);
+
+    int fd_ = -1;
+    LinkKind kind_ = LinkKind::WebSocket;
+    bool server_ = false;
+    std::string label_;
+    std::string tx_;
+    size_t tx_offset_ = 0;
+    std::string rx_;
+  };
+
+  // Monotonic clock in nanoseconds, shared by the tools that time round trips.
+  int64_t now_ns();
+} // namespace hostlink
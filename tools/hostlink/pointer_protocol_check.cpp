@@ -0,0 +1,106 @@
+// Round-trips records through the firmware's pointer frame codec: what FrameWriter builds,
+// FrameReader collects byte by byte and decode() applies in order, and a damaged frame
+// applies nothing.
+
+#include <cstdio>
+#include <string>
+
+#include "pointer_protocol.h"
+
+namespace
+{
+  int failures = 0;
+  std::string applied;
+
+  void expect(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s\n", what);
+      ++failures;
+    }
+  }
+
+  void note(const char *format, int a, int b = 0, int c = 0, int d = 0)
+  {
+    char text[64];
+    snprintf(text, sizeof(text), format, a, b, c, d);
+    applied += text;
+  }
+
+  pointer_protocol::Sink recording_sink()
+  {
+    pointer_protocol::Sink sink;
+    sink.move = [](int dx, int dy, int wheel, int pan) { note("m%d,%d,%d,%d ", dx, dy, wheel, pan); };
+    sink.buttons_press = [](uint8_t mask) { note("bp%d ", mask); };
+    sink.buttons_release = [](uint8_t mask) { note("br%d ", mask); };
+    sink.key_press = [](uint8_t code) { note("kp%d ", code); };
+    sink.key_release = [](uint8_t code) { note("kr%d ", code); };
+    sink.release_all = []() { applied += "ra "; };
+    return sink;
+  }
+} // namespace
+
+int main()
+{
+  using pointer_protocol::RecordType;
+  using pointer_protocol::Status;
+
+  uint8_t frame[pointer_protocol::kMaxFrameBytes];
+  pointer_protocol::FrameWriter writer(frame, sizeof(frame));
+  writer.move(10, -127);
+  writer.scroll(-1, 2);
+  writer.record(RecordType::ButtonsPress, 1);
+  writer.record(RecordType::KeyPress, 0x80);
+  writer.record(RecordType::KeyRelease, 'a');
+  writer.record(RecordType::ButtonsRelease, 1);
+  writer.release_all();
+  size_t size = writer.finish();
+  expect(size == 3 + 3 + 3 + 2 * 4 + 1, "frame size");
+
+  pointer_protocol::FrameReader reader;
+  expect(frame[0] == pointer_protocol::kFrameStart, "start byte");
+  reader.begin();
+  size_t complete_at = 0;
+  for (size_t index = 1; index < size; ++index)
+  {
+    if (reader.push(frame[index]))
+    {
+      complete_at = index;
+    }
+  }
+  expect(complete_at == size - 1 && !reader.active() && reader.size() == size, "reader stops at the frame end");
+
+  size_t records = 0;
+  Status status = pointer_protocol::decode(reader.frame(), reader.size(), recording_sink(), &records);
+  expect(status == Status::Ok && records == 7, "frame decodes");
+  expect(applied == "m10,-127,0,0 m0,0,-1,2 bp1 kp128 kr97 br1 ra ", "records applied in order");
+
+  for (size_t index = 1; index < size; ++index)
+  {
+    uint8_t damaged[pointer_protocol::kMaxFrameBytes];
+    for (size_t copy = 0; copy < size; ++copy)
+    {
+      damaged[copy] = frame[copy];
+    }
+    damaged[index] ^= 0x40;
+    applied.clear();
+    status = pointer_protocol::decode(damaged, size, recording_sink());
+    expect(status != Status::Ok && applied.empty(), "a damaged frame applies nothing");
+  }
+
+  // A record cut short by the length byte is caught even with a matching checksum.
+  uint8_t truncated[] = {pointer_protocol::kFrameStart, 2, 0x01, 5, 0};
+  truncated[4] = pointer_protocol::checksum(truncated + 2, 2);
+  expect(pointer_protocol::validate(truncated, sizeof(truncated)) == Status::TruncatedRecord, "truncated record");
+  uint8_t unknown[] = {pointer_protocol::kFrameStart, 1, 0x7F, 0};
+  unknown[3] = pointer_protocol::checksum(unknown + 2, 1);
+  expect(pointer_protocol::validate(unknown, sizeof(unknown)) == Status::UnknownRecord, "unknown record");
+  expect(pointer_protocol::validate(frame, size - 1) == Status::BadLength, "short frame");
+
+  if (failures == 0)
+  {
+    printf("pointer_protocol: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,499 @@
+// Open-loop load generator for the JSON command protocol. It drives one or more
+// WebSocket sessions (/ws/hid) and/or a UART or pty with a weighted mix of mouse moves,
+// key taps, consumer keys, text writes and echoes at a fixed total rate, and records the
+// time from each command's scheduled send to its {"status":...} reply in HDR histograms.
+// Echo does no HID work, so its latency is the link and parser round trip under the
+// firmware's active network profile.
+//
+//   loadgen --ws 192.168.1.50:80 --sessions 4 --rate 500 --duration 20
+//   loadgen --serial /dev/ttyUSB0 --baud 921600 --mix mouse=80,key=20
+//
+// The firmware answers commands in the order it dequeues them and carries no request id,
+// so replies are matched to commands first-in first-out per transport. WebSocket replies
+// all go to the most recently connected session, which is why every session feeds the
+// same queue. A silently dropped command shifts later matches onto earlier send times,
+// so latencies under drops err on the high side; the drop count makes that visible.
+// Timing from the scheduled (not the actual) send time keeps a stalled writer from
+// hiding latency (no coordinated omission).
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "hdr_histogram.h"
+#include "link.h"
+
+namespace
+{
+  using hostlink::HdrHistogram;
+  using hostlink::Link;
+  using hostlink::LinkKind;
+
+  enum CommandType : uint8_t
+  {
+    kMouse = 0,
+    kKey,
+    kConsumer,
+    kText,
+    kEcho,
+    kCommandTypeCount
+  };
+
+  const char *const kCommandNames[kCommandTypeCount] = {"mouse", "key", "consumer", "text", "echo"};
+
+  struct Options
+  {
+    std::vector<std::string> ws_targets;
+    uint32_t sessions = 1;
+    std::string serial_path;
+    uint32_t baud = 115200;
+    double rate_hz = 200;
+    double duration_s = 10;
+    uint32_t weights[kCommandTypeCount] = {70, 20, 0, 10, 0};
+    uint32_t text_length = 16;
+    uint32_t drain_ms = 2000;
+    uint32_t seed = 1;
+    bool json = false;
+  };
+
+  struct Pending
+  {
+    int64_t scheduled_ns;
+    CommandType type;
+  };
+
+  struct TypeStats
+  {
+    uint64_t sent = 0;
+    uint64_t ok = 0;
+    uint64_t errors = 0;
+    HdrHistogram latency_us;
+  };
+
+  struct Run
+  {
+    std::vector<std::unique_ptr<Link>> links;
+    // One reply queue per transport; see the header comment.
+    std::deque<Pending> pending[2];
+    TypeStats stats[kCommandTypeCount];
+    uint64_t events = 0;
+    uint64_t unmatched = 0;
+    uint64_t link_failures = 0;
+    int64_t last_reply_ns = 0;
+  };
+
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s [--ws HOST:PORT[/PATH]]... [--sessions N] [--serial PATH] [--baud N]\n"
+            "          [--rate HZ] [--duration S] [--mix mouse=70,key=20,consumer=0,text=10,echo=0]\n"
+            "          [--text-length N] [--drain-ms N] [--seed N] [--json]\n",
+            program);
+  }
+
+  bool parse_mix(const std::string &text, Options &options)
+  {
+    uint32_t weights[kCommandTypeCount] = {};
+    size_t start = 0;
+    while (start < text.size())
+    {
+      size_t comma = text.find(',', start);
+      std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+      size_t equals = item.find('=');
+      if (equals == std::string::npos)
+      {
+        return false;
+      }
+      std::string name = item.substr(0, equals);
+      int type = -1;
+      for (int index = 0; index < kCommandTypeCount; ++index)
+      {
+        if (name == kCommandNames[index])
+        {
+          type = index;
+        }
+      }
+      if (type < 0)
+      {
+        return false;
+      }
+      weights[type] = static_cast<uint32_t>(strtoul(item.c_str() + equals + 1, nullptr, 10));
+      if (comma == std::string::npos)
+      {
+        break;
+      }
+      start = comma + 1;
+    }
+    uint32_t total = 0;
+    for (uint32_t weight : weights)
+    {
+      total += weight;
+    }
+    if (total == 0)
+    {
+      return false;
+    }
+    std::copy(std::begin(weights), std::end(weights), options.weights);
+    return true;
+  }
+
+  bool parse_options(int argc, char **argv, Options &options)
+  {
+    for (int index = 1; index < argc; ++index)
+    {
+      std::string flag = argv[index];
+      if (flag == "--json")
+      {
+        options.json = true;
+        continue;
+      }
+      if (index + 1 >= argc)
+      {
+        return false;
+      }
+      const char *value = argv[++index];
+      if (flag == "--ws")
+        options.ws_targets.push_back(value);
+      else if (flag == "--sessions")
+        options.sessions = static_cast<uint32_t>(std::max(1L, strtol(value, nullptr, 10)));
+      else if (flag == "--serial")
+        options.serial_path = value;
+      else if (flag == "--baud")
+        options.baud = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--rate")
+        options.rate_hz = strtod(value, nullptr);
+      else if (flag == "--duration")
+        options.duration_s = strtod(value, nullptr);
+      else if (flag == "--mix")
+      {
+        if (!parse_mix(value, options))
+          return false;
+      }
+      else if (flag == "--text-length")
+        options.text_length = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--drain-ms")
+        options.drain_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--seed")
+        options.seed = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else
+        return false;
+    }
+    return options.rate_hz > 0 && options.duration_s > 0 &&
+           (!options.ws_targets.empty() || !options.serial_path.empty());
+  }
+
+  std::string make_command(CommandType type, std::mt19937 &random, uint32_t text_length)
+  {
+    char buffer[128];
+    switch (type)
+    {
+    case kMouse:
+    {
+      std::uniform_int_distribution<int> delta(-8, 8);
+      snprintf(buffer, sizeof(buffer), "{\"device\":\"mouse\",\"action\":\"move\",\"x\":%d,\"y\":%d}", delta(random),
+               delta(random));
+      return buffer;
+    }
+    case kKey:
+    {
+      std::uniform_int_distribution<int> letter('a', 'z');
+      snprintf(buffer, sizeof(buffer), "{\"device\":\"keyboard\",\"action\":\"tap\",\"key\":\"%c\",\"holdMs\":1}",
+               static_cast<char>(letter(random)));
+      return buffer;
+    }
+    case kConsumer:
+      return "{\"device\":\"consumer\",\"key\":\"VOLUME_UP\",\"gapMs\":0}";
+    case kEcho:
+      return "{\"device\":\"system\",\"action\":\"echo\"}";
+    case kText:
+    default:
+    {
+      std::uniform_int_distribution<int> letter('a', 'z');
+      std::string text;
+      for (uint32_t index = 0; index < text_length; ++index)
+      {
+        text.push_back(static_cast<char>(letter(random)));
+      }
+      return "{\"device\":\"keyboard\",\"action\":\"write\",\"text\":\"" + text + "\",\"charDelayMs\":0}";
+    }
+    }
+  }
+
+  void handle_message(Run &run, LinkKind kind, const std::string &message)
+  {
+    int64_t now = hostlink::now_ns();
+    size_t status = message.find("\"status\":\"");
+    if (status == std::string::npos)
+    {
+      ++run.events;
+      return;
+    }
+    std::deque<Pending> &queue = run.pending[static_cast<size_t>(kind)];
+    if (queue.empty())
+    {
+      ++run.unmatched;
+      return;
+    }
+    Pending pending = queue.front();
+    queue.pop_front();
+    run.last_reply_ns = now;
+    TypeStats &stats = run.stats[pending.type];
+    if (message.compare(status + 10, 2, "ok") == 0)
+    {
+      ++stats.ok;
+    }
+    else
+    {
+      ++stats.errors;
+    }
+    stats.latency_us.record((now - pending.scheduled_ns) / 1000);
+  }
+
+  void update_interest(int epoll_fd, Link &link, size_t index)
+  {
+    epoll_event event = {};
+    event.events = EPOLLIN | (link.wants_write() ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.u64 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, link.fd(), &event);
+  }
+
+  void service_link(Run &run, int epoll_fd, size_t index, uint32_t events)
+  {
+    Link &link = *run.links[index];
+    if (link.fd() < 0)
+    {
+      return;
+    }
+    bool alive = true;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+    {
+      LinkKind kind = link.kind();
+      alive = link.read([&run, kind](const std::string &message) { handle_message(run, kind, message); });
+    }
+    if (alive && !link.flush())
+    {
+      alive = false;
+    }
+    if (!alive)
+    {
+      fprintf(stderr, "loadgen: %s closed\n", link.label().c_str());
+      ++run.link_failures;
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, link.fd(), nullptr);
+      link.close();
+      return;
+    }
+    update_interest(epoll_fd, link, index);
+  }
+
+  double ms(int64_t us)
+  {
+    return static_cast<double>(us) / 1000.0;
+  }
+
+  void report(const Run &run, const Options &options, double elapsed_s)
+  {
+    HdrHistogram all;
+    uint64_t sent = 0;
+    uint64_t ok = 0;
+    uint64_t errors = 0;
+    for (const TypeStats &stats : run.stats)
+    {
+      all.merge(stats.latency_us);
+      sent += stats.sent;
+      ok += stats.ok;
+      errors += stats.errors;
+    }
+    uint64_t dropped = sent - ok - errors;
+
+    if (options.json)
+    {
+      printf("{\"durationS\":%.3f,\"targetHz\":%.1f,\"links\":%zu,\"sent\":%llu,\"ok\":%llu,\"errors\":%llu,"
+             "\"dropped\":%llu,\"ackHz\":%.1f,\"events\":%llu,\"types\":{",
+             elapsed_s, options.rate_hz, run.links.size(), static_cast<unsigned long long>(sent),
+             static_cast<unsigned long long>(ok), static_cast<unsigned long long>(errors),
+             static_cast<unsigned long long>(dropped), (ok + errors) / elapsed_s,
+             static_cast<unsigned long long>(run.events));
+      bool first = true;
+      for (int type = 0; type <= kCommandTypeCount; ++type)
+      {
+        bool total = type == kCommandTypeCount;
+        const HdrHistogram &histogram = total ? all : run.stats[type].latency_us;
+        if (!total && run.stats[type].sent == 0)
+        {
+          continue;
+        }
+        printf("%s\"%s\":{\"acked\":%llu,\"p50Us\":%lld,\"p99Us\":%lld,\"p999Us\":%lld,\"maxUs\":%lld}", first ? "" : ",",
+               total ? "all" : kCommandNames[type], static_cast<unsigned long long>(histogram.count()),
+               static_cast<long long>(histogram.value_at_percentile(50)),
+               static_cast<long long>(histogram.value_at_percentile(99)),
+               static_cast<long long>(histogram.value_at_percentile(99.9)), static_cast<long long>(histogram.max()));
+        first = false;
+      }
+      printf("}}\n");
+      return;
+    }
+
+    printf("loadgen: %.1f s at %.0f/s over %zu link(s)\n", elapsed_s, options.rate_hz, run.links.size());
+    printf("%-9s %9s %9s %7s %7s %9s %9s %9s %9s\n", "type", "sent", "ok", "error", "drop", "p50 ms", "p99 ms",
+           "p999 ms", "max ms");
+    for (int type = 0; type <= kCommandTypeCount; ++type)
+    {
+      bool total = type == kCommandTypeCount;
+      const HdrHistogram &histogram = total ? all : run.stats[type].latency_us;
+      uint64_t type_sent = total ? sent : run.stats[type].sent;
+      uint64_t type_ok = total ? ok : run.stats[type].ok;
+      uint64_t type_errors = total ? errors : run.stats[type].errors;
+      if (type_sent == 0)
+      {
+        continue;
+      }
+      printf("%-9s %9llu %9llu %7llu %7llu %9.2f %9.2f %9.2f %9.2f\n", total ? "all" : kCommandNames[type],
+             static_cast<unsigned long long>(type_sent), static_cast<unsigned long long>(type_ok),
+             static_cast<unsigned long long>(type_errors),
+             static_cast<unsigned long long>(type_sent - type_ok - type_errors), ms(histogram.value_at_percentile(50)),
+             ms(histogram.value_at_percentile(99)), ms(histogram.value_at_percentile(99.9)), ms(histogram.max()));
+    }
+    printf("throughput: %.1f acks/s, %llu events, %llu unmatched replies, %llu link failures\n",
+           (ok + errors) / elapsed_s, static_cast<unsigned long long>(run.events),
+           static_cast<unsigned long long>(run.unmatched), static_cast<unsigned long long>(run.link_failures));
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parse_options(argc, argv, options))
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  Run run;
+  std::string error;
+  for (const std::string &target : options.ws_targets)
+  {
+    for (uint32_t session = 0; session < options.sessions; ++session)
+    {
+      auto link = std::make_unique<Link>();
+      if (!link->open_websocket(target, error))
+      {
+        fprintf(stderr, "loadgen: %s\n", error.c_str());
+        return 1;
+      }
+      run.links.push_back(std::move(link));
+    }
+  }
+  if (!options.serial_path.empty())
+  {
+    auto link = std::make_unique<Link>();
+    if (!link->open_serial(options.serial_path, options.baud, error))
+    {
+      fprintf(stderr, "loadgen: %s\n", error.c_str());
+      return 1;
+    }
+    run.links.push_back(std::move(link));
+  }
+
+  int epoll_fd = epoll_create1(0);
+  int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  const uint64_t kTimerTag = UINT64_MAX;
+  epoll_event timer_event = {};
+  timer_event.events = EPOLLIN;
+  timer_event.data.u64 = kTimerTag;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event);
+  for (size_t index = 0; index < run.links.size(); ++index)
+  {
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, run.links[index]->fd(), &event);
+  }
+
+  std::mt19937 random(options.seed);
+  std::discrete_distribution<int> pick_type(std::begin(options.weights), std::end(options.weights));
+  const int64_t interval_ns = static_cast<int64_t>(1e9 / options.rate_hz);
+  const uint64_t total_commands = static_cast<uint64_t>(options.rate_hz * options.duration_s);
+  const int64_t start_ns = hostlink::now_ns();
+  uint64_t issued = 0;
+  size_t next_link = 0;
+  int64_t drain_deadline_ns = 0;
+
+  for (;;)
+  {
+    int64_t now = hostlink::now_ns();
+    while (issued < total_commands && start_ns + static_cast<int64_t>(issued) * interval_ns <= now)
+    {
+      // Skip links that failed; stop issuing if none are left.
+      size_t attempts = 0;
+      while (run.links[next_link]->fd() < 0 && attempts++ < run.links.size())
+      {
+        next_link = (next_link + 1) % run.links.size();
+      }
+      if (run.links[next_link]->fd() < 0)
+      {
+        issued = total_commands;
+        break;
+      }
+      Link &link = *run.links[next_link];
+      CommandType type = static_cast<CommandType>(pick_type(random));
+      link.send(make_command(type, random, options.text_length));
+      run.pending[static_cast<size_t>(link.kind())].push_back(
+          Pending{start_ns + static_cast<int64_t>(issued) * interval_ns, type});
+      ++run.stats[type].sent;
+      ++issued;
+      service_link(run, epoll_fd, next_link, 0);
+      next_link = (next_link + 1) % run.links.size();
+    }
+
+    if (issued >= total_commands)
+    {
+      if (drain_deadline_ns == 0)
+      {
+        drain_deadline_ns = now + static_cast<int64_t>(options.drain_ms) * 1000000;
+      }
+      if ((run.pending[0].empty() && run.pending[1].empty()) || now >= drain_deadline_ns)
+      {
+        break;
+      }
+    }
+
+    int64_t wake_ns = issued < total_commands ? start_ns + static_cast<int64_t>(issued) * interval_ns : drain_deadline_ns;
+    itimerspec timer = {};
+    timer.it_value.tv_sec = wake_ns / 1000000000;
+    timer.it_value.tv_nsec = wake_ns % 1000000000;
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr);
+
+    epoll_event events[64];
+    int ready = epoll_wait(epoll_fd, events, 64, -1);
+    for (int index = 0; index < ready; ++index)
+    {
+      if (events[index].data.u64 == kTimerTag)
+      {
+        uint64_t expirations;
+        ssize_t ignored = read(timer_fd, &expirations, sizeof(expirations));
+        (void)ignored;
+        continue;
+      }
+      service_link(run, epoll_fd, static_cast<size_t>(events[index].data.u64), events[index].events);
+    }
+  }
+
+  // Up to the last reply, so the drain wait does not dilute the throughput figure.
+  int64_t end_ns = run.last_reply_ns ? run.last_reply_ns : hostlink::now_ns();
+  double elapsed_s = static_cast<double>(end_ns - start_ns) / 1e9;
+  report(run, options, elapsed_s);
+  close(timer_fd);
+  close(epoll_fd);
+  return run.link_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,415 @@
+// Input-to-photon latency probe. It sends a HID action through the bridge, watches
+// captured frames of the controlled screen for the pixel change it causes, and records the
+// time from the send to the first changed frame. Trials alternate between the action
+// and its undo (by default a 100 px cursor jump right, then back), so every trial starts
+// from the same picture.
+//
+//   photon_probe --source v4l2:/dev/video0 --serial /dev/ttyUSB0 --roi 0,0,1920,200
+//   photon_probe --source synthetic:640x360@60:30-50 --expect-ms 28,70
+//
+// Before each trial the probe waits --interval-ms and then for two consecutive frames that
+// agree, and keeps the last one as the reference. After the send, the first frame stamped
+// at or after the send time in which at least --min-changed pixels of the region differ
+// from the reference by more than --pixel-threshold ends the trial. Results are quantised
+// to the capture frame interval, which the report prints alongside. Bridge acknowledgements
+// are read between frames, so their times carry the same granularity.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "frame_source.h"
+#include "hdr_histogram.h"
+#include "link.h"
+#include "region_diff.h"
+
+namespace
+{
+  using hostlink::HdrHistogram;
+
+  struct Options
+  {
+    std::string source;
+    std::string serial_path;
+    std::string ws_target;
+    uint32_t baud = 115200;
+    std::string action = "{\"device\":\"mouse\",\"action\":\"move\",\"x\":100,\"y\":0}";
+    std::string undo = "{\"device\":\"mouse\",\"action\":\"move\",\"x\":-100,\"y\":0}";
+    vision::Rect roi;
+    uint8_t pixel_threshold = 24;
+    uint32_t min_changed = 64;
+    uint32_t trials = 50;
+    uint32_t interval_ms = 250;
+    uint32_t timeout_ms = 1000;
+    std::string csv_path;
+    bool json = false;
+    double expect_min_ms = -1;
+    double expect_max_ms = -1;
+  };
+
+  struct Probe
+  {
+    std::unique_ptr<vision::FrameSource> source;
+    hostlink::Link link;
+    std::deque<int64_t> pending;
+    HdrHistogram photon_us;
+    HdrHistogram ack_us;
+    uint64_t timeouts = 0;
+    uint64_t unsettled = 0;
+    uint64_t frames = 0;
+    int64_t first_frame_ns = 0;
+    int64_t last_frame_ns = 0;
+    int64_t last_ack_us = -1;
+    FILE *csv = nullptr;
+  };
+
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s --source SPEC [--serial PATH [--baud N] | --ws HOST:PORT[/PATH]]\n"
+            "          [--action JSON] [--undo JSON|\"\"] [--roi X,Y,W,H] [--pixel-threshold N]\n"
+            "          [--min-changed N] [--trials N] [--interval-ms N] [--timeout-ms N]\n"
+            "          [--csv PATH] [--json] [--expect-ms MIN,MAX]\n"
+            "sources: synthetic[:WxH][@FPS][:MIN-MAX], v4l2:/dev/videoN[:WxH],\n"
+            "         raw:WxH:FORMAT:PATH, cmd:WxH:FORMAT:COMMAND (gray, bgr24, rgb24, yuyv)\n",
+            program);
+  }
+
+  bool parse_options(int argc, char **argv, Options &options)
+  {
+    for (int index = 1; index < argc; ++index)
+    {
+      std::string flag = argv[index];
+      if (flag == "--json")
+      {
+        options.json = true;
+        continue;
+      }
+      if (index + 1 >= argc)
+      {
+        return false;
+      }
+      const char *value = argv[++index];
+      if (flag == "--source")
+        options.source = value;
+      else if (flag == "--serial")
+        options.serial_path = value;
+      else if (flag == "--ws")
+        options.ws_target = value;
+      else if (flag == "--baud")
+        options.baud = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--action")
+        options.action = value;
+      else if (flag == "--undo")
+        options.undo = value;
+      else if (flag == "--roi")
+      {
+        vision::Rect &roi = options.roi;
+        if (sscanf(value, "%d,%d,%d,%d", &roi.x, &roi.y, &roi.width, &roi.height) != 4)
+          return false;
+      }
+      else if (flag == "--pixel-threshold")
+        options.pixel_threshold = static_cast<uint8_t>(std::min(254UL, strtoul(value, nullptr, 10)));
+      else if (flag == "--min-changed")
+        options.min_changed = static_cast<uint32_t>(std::max(1UL, strtoul(value, nullptr, 10)));
+      else if (flag == "--trials")
+        options.trials = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--interval-ms")
+        options.interval_ms = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--timeout-ms")
+        options.timeout_ms = static_cast<uint32_t>(std::max(1UL, strtoul(value, nullptr, 10)));
+      else if (flag == "--csv")
+        options.csv_path = value;
+      else if (flag == "--expect-ms")
+      {
+        if (sscanf(value, "%lf,%lf", &options.expect_min_ms, &options.expect_max_ms) != 2)
+          return false;
+      }
+      else
+        return false;
+    }
+    return !options.source.empty() && options.trials > 0 && !options.action.empty() &&
+           (options.serial_path.empty() || options.ws_target.empty());
+  }
+
+  // Drains replies from the bridge without blocking. The firmware answers in order, so
+  // the oldest send owns each {"status":...}.
+  void service_link(Probe &probe)
+  {
+    if (probe.link.fd() < 0)
+    {
+      return;
+    }
+    bool alive = probe.link.flush() && probe.link.read([&probe](const std::string &message) {
+      if (message.find("\"status\"") == std::string::npos || probe.pending.empty())
+      {
+        return;
+      }
+      probe.last_ack_us = (hostlink::now_ns() - probe.pending.front()) / 1000;
+      probe.ack_us.record(probe.last_ack_us);
+      probe.pending.pop_front();
+    });
+    if (!alive)
+    {
+      fprintf(stderr, "photon_probe: %s closed\n", probe.link.label().c_str());
+      probe.link.close();
+    }
+  }
+
+  // Next frame from the source, with the link serviced while waiting. 1, 0 on timeout, -1
+  // when the source ended.
+  int next_frame(Probe &probe, vision::Frame &frame, int timeout_ms)
+  {
+    int result = probe.source->read(frame, std::min(timeout_ms, 20));
+    service_link(probe);
+    if (result == 1)
+    {
+      if (probe.frames++ == 0)
+      {
+        probe.first_frame_ns = frame.timestamp_ns;
+      }
+      probe.last_frame_ns = frame.timestamp_ns;
+    }
+    return result;
+  }
+
+  // Waits out the interval, then for the screen to hold still. Leaves the reference in
+  // `reference`; false when the source ended.
+  bool settle(Probe &probe, const Options &options, vision::Frame &reference)
+  {
+    vision::Frame frame;
+    int64_t interval_end = hostlink::now_ns() + static_cast<int64_t>(options.interval_ms) * 1000000;
+    int64_t give_up = interval_end + static_cast<int64_t>(options.timeout_ms) * 1000000;
+    bool have_reference = false;
+    for (;;)
+    {
+      int64_t now = hostlink::now_ns();
+      int result = next_frame(probe, frame, 20);
+      if (result < 0)
+      {
+        return false;
+      }
+      if (result == 0)
+      {
+        if (now >= give_up)
+        {
+          if (!have_reference)
+          {
+            fprintf(stderr, "photon_probe: no frames from %s\n", probe.source->describe().c_str());
+            return false;
+          }
+          ++probe.unsettled;
+          return true;
+        }
+        continue;
+      }
+      bool still = have_reference &&
+                   vision::count_changed(reference, frame, options.roi, options.pixel_threshold) < options.min_changed;
+      std::swap(reference, frame);
+      have_reference = true;
+      if (now >= interval_end && (still || now >= give_up))
+      {
+        probe.unsettled += still ? 0 : 1;
+        return true;
+      }
+    }
+  }
+
+  // One trial: send, then wait for the first changed frame. False when the source ended.
+  bool run_trial(Probe &probe, const Options &options, uint32_t trial, const vision::Frame &reference)
+  {
+    const std::string &command = (trial % 2 == 1 && !options.undo.empty()) ? options.undo : options.action;
+    int64_t sent_ns = hostlink::now_ns();
+    if (probe.link.fd() >= 0)
+    {
+      probe.link.send(command);
+      probe.pending.push_back(sent_ns);
+      service_link(probe);
+    }
+    probe.source->on_input(sent_ns);
+    probe.last_ack_us = -1;
+
+    vision::Frame frame;
+    int64_t deadline = sent_ns + static_cast<int64_t>(options.timeout_ms) * 1000000;
+    int64_t photon_us = -1;
+    uint32_t changed = 0;
+    while (hostlink::now_ns() < deadline)
+    {
+      int result = next_frame(probe, frame, 20);
+      if (result < 0)
+      {
+        return false;
+      }
+      if (result == 0 || frame.timestamp_ns < sent_ns)
+      {
+        continue;
+      }
+      changed = vision::count_changed(reference, frame, options.roi, options.pixel_threshold);
+      if (changed >= options.min_changed)
+      {
+        photon_us = (frame.timestamp_ns - sent_ns) / 1000;
+        break;
+      }
+    }
+    if (photon_us >= 0)
+    {
+      probe.photon_us.record(photon_us);
+    }
+    else
+    {
+      ++probe.timeouts;
+    }
+    if (probe.csv)
+    {
+      fprintf(probe.csv, "%u,%s,%lld,%lld,%lld,%u\n", trial, command == options.action ? "action" : "undo",
+              static_cast<long long>(sent_ns), static_cast<long long>(probe.last_ack_us),
+              static_cast<long long>(photon_us), changed);
+    }
+    return true;
+  }
+
+  double ms(int64_t us)
+  {
+    return static_cast<double>(us) / 1000.0;
+  }
+
+  double frame_interval_ms(const Probe &probe)
+  {
+    return probe.frames > 1 ? static_cast<double>(probe.last_frame_ns - probe.first_frame_ns) / 1e6 /
+                                  static_cast<double>(probe.frames - 1)
+                            : 0.0;
+  }
+
+  void report(const Probe &probe, const Options &options, uint32_t trials)
+  {
+    const HdrHistogram *histograms[2] = {&probe.photon_us, &probe.ack_us};
+    const char *names[2] = {"photon", "ack"};
+    if (options.json)
+    {
+      printf("{\"source\":\"%s\",\"trials\":%u,\"timeouts\":%llu,\"unsettled\":%llu,\"frameIntervalMs\":%.2f",
+             probe.source->describe().c_str(), trials, static_cast<unsigned long long>(probe.timeouts),
+             static_cast<unsigned long long>(probe.unsettled), frame_interval_ms(probe));
+      for (int index = 0; index < 2; ++index)
+      {
+        const HdrHistogram &histogram = *histograms[index];
+        printf(",\"%s\":{\"count\":%llu,\"minUs\":%lld,\"p50Us\":%lld,\"p90Us\":%lld,\"p99Us\":%lld,\"maxUs\":%lld}",
+               names[index], static_cast<unsigned long long>(histogram.count()),
+               static_cast<long long>(histogram.count() ? histogram.min() : 0),
+               static_cast<long long>(histogram.value_at_percentile(50)),
+               static_cast<long long>(histogram.value_at_percentile(90)),
+               static_cast<long long>(histogram.value_at_percentile(99)), static_cast<long long>(histogram.max()));
+      }
+      printf("}\n");
+      return;
+    }
+
+    printf("photon_probe: %s, %u trials, frame interval %.2f ms (%s kernels)\n", probe.source->describe().c_str(),
+           trials, frame_interval_ms(probe), vision::region_diff_isa());
+    printf("%-8s %7s %9s %9s %9s %9s %9s\n", "", "count", "min ms", "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int index = 0; index < 2; ++index)
+    {
+      const HdrHistogram &histogram = *histograms[index];
+      if (histogram.count() == 0)
+      {
+        continue;
+      }
+      printf("%-8s %7llu %9.2f %9.2f %9.2f %9.2f %9.2f\n", names[index],
+             static_cast<unsigned long long>(histogram.count()), ms(histogram.min()),
+             ms(histogram.value_at_percentile(50)), ms(histogram.value_at_percentile(90)),
+             ms(histogram.value_at_percentile(99)), ms(histogram.max()));
+    }
+    printf("timeouts: %llu, unsettled references: %llu\n", static_cast<unsigned long long>(probe.timeouts),
+           static_cast<unsigned long long>(probe.unsettled));
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parse_options(argc, argv, options))
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  Probe probe;
+  std::string error;
+  probe.source = vision::open_frame_source(options.source, error);
+  if (!probe.source)
+  {
+    fprintf(stderr, "photon_probe: %s\n", error.c_str());
+    return 1;
+  }
+  bool opened = true;
+  if (!options.serial_path.empty())
+  {
+    opened = probe.link.open_serial(options.serial_path, options.baud, error);
+  }
+  else if (!options.ws_target.empty())
+  {
+    opened = probe.link.open_websocket(options.ws_target, error);
+  }
+  else if (options.source.compare(0, 9, "synthetic") != 0)
+  {
+    fprintf(stderr, "photon_probe: no --serial or --ws; only watching for changes\n");
+  }
+  if (!opened)
+  {
+    fprintf(stderr, "photon_probe: %s\n", error.c_str());
+    return 1;
+  }
+  if (!options.csv_path.empty())
+  {
+    probe.csv = fopen(options.csv_path.c_str(), "w");
+    if (!probe.csv)
+    {
+      fprintf(stderr, "photon_probe: %s: %s\n", options.csv_path.c_str(), strerror(errno));
+      return 1;
+    }
+    fprintf(probe.csv, "trial,command,sent_ns,ack_us,photon_us,changed_pixels\n");
+  }
+
+  vision::Frame reference;
+  uint32_t trials = 0;
+  for (; trials < options.trials; ++trials)
+  {
+    if (!settle(probe, options, reference) || !run_trial(probe, options, trials, reference))
+    {
+      if (!probe.source->error().empty())
+      {
+        fprintf(stderr, "photon_probe: %s\n", probe.source->error().c_str());
+      }
+      break;
+    }
+  }
+  // Collect the last acknowledgement.
+  for (int round = 0; round < 50 && !probe.pending.empty() && probe.link.fd() >= 0; ++round)
+  {
+    usleep(10000);
+    service_link(probe);
+  }
+  if (probe.csv)
+  {
+    fclose(probe.csv);
+  }
+  report(probe, options, trials);
+
+  if (options.expect_min_ms >= 0)
+  {
+    double p50 = ms(probe.photon_us.value_at_percentile(50));
+    if (probe.photon_us.count() == 0 || p50 < options.expect_min_ms || p50 > options.expect_max_ms)
+    {
+      fprintf(stderr, "photon_probe: p50 %.2f ms outside %.1f..%.1f ms\n", p50, options.expect_min_ms,
+              options.expect_max_ms);
+      return 1;
+    }
+  }
+  return trials == options.trials ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+// Runs the template matcher over a recorded corpus and reports how long each find()
+// takes and how often it hits, so matcher settings can be tuned against real captures.
+//
+//   template_bench --corpus 'cmd:1280x720:gray:ffmpeg -loglevel error -i run1.mp4 -f rawvideo -pix_fmt gray -'
+//                  --template button.pgm --scales 0.9,1,1.1
+//   template_bench --corpus v4l2:/dev/video0 --template-from 600,400,80,48 --frames 600 --csv hits.csv
+//
+// Only find() is timed; decoding and capture are not. --template-from cuts the template
+// out of the first corpus frame, which is handy for a quick look at a new recording.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_source.h"
+#include "hdr_histogram.h"
+#include "link.h"
+#include "template_match.h"
+
+namespace
+{
+  using hostlink::HdrHistogram;
+
+  struct Options
+  {
+    std::vector<std::string> corpora;
+    std::string template_path;
+    vision::Rect template_from;
+    vision::MatchOptions match;
+    uint32_t frames = 0;
+    std::string csv_path;
+    bool json = false;
+  };
+
+  struct Totals
+  {
+    uint64_t frames = 0;
+    uint64_t found = 0;
+    uint64_t tracked = 0;
+    uint64_t positions = 0;
+    HdrHistogram find_ns{10000000000LL, 3};
+  };
+
+  void print_usage(const char *program)
+  {
+    fprintf(stderr,
+            "usage: %s --corpus SPEC [--corpus SPEC]... (--template FILE.pgm | --template-from X,Y,W,H)\n"
+            "          [--scales S,S,...] [--roi X,Y,W,H] [--max-score F] [--levels N] [--candidates N]\n"
+            "          [--radius N] [--frames N] [--csv PATH] [--json]\n"
+            "corpus specs are frame sources: v4l2:, raw:, cmd: or synthetic (see photon_probe)\n",
+            program);
+  }
+
+  bool parse_rect(const char *text, vision::Rect &rect)
+  {
+    return sscanf(text, "%d,%d,%d,%d", &rect.x, &rect.y, &rect.width, &rect.height) == 4 && rect.width > 0 &&
+           rect.height > 0;
+  }
+
+  bool parse_options(int argc, char **argv, Options &options)
+  {
+    for (int index = 1; index < argc; ++index)
+    {
+      std::string flag = argv[index];
+      if (flag == "--json")
+      {
+        options.json = true;
+        continue;
+      }
+      if (index + 1 >= argc)
+      {
+        return false;
+      }
+      const char *value = argv[++index];
+      if (flag == "--corpus")
+        options.corpora.push_back(value);
+      else if (flag == "--template")
+        options.template_path = value;
+      else if (flag == "--template-from")
+      {
+        if (!parse_rect(value, options.template_from))
+          return false;
+      }
+      else if (flag == "--scales")
+      {
+        options.match.scales.clear();
+        for (const char *cursor = value; *cursor;)
+        {
+          char *end = nullptr;
+          double scale = strtod(cursor, &end);
+          if (end == cursor || scale <= 0)
+            return false;
+          options.match.scales.push_back(scale);
+          cursor = *end == ',' ? end + 1 : end;
+        }
+      }
+      else if (flag == "--roi")
+      {
+        if (!parse_rect(value, options.match.roi))
+          return false;
+      }
+      else if (flag == "--max-score")
+        options.match.max_score = strtod(value, nullptr);
+      else if (flag == "--levels")
+        options.match.max_pyramid_levels = static_cast<int>(strtol(value, nullptr, 10));
+      else if (flag == "--candidates")
+        options.match.candidates = static_cast<int>(strtol(value, nullptr, 10));
+      else if (flag == "--radius")
+        options.match.track_radius = static_cast<int>(strtol(value, nullptr, 10));
+      else if (flag == "--frames")
+        options.frames = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+      else if (flag == "--csv")
+        options.csv_path = value;
+      else
+        return false;
+    }
+    return !options.corpora.empty() && !options.match.scales.empty() &&
+           (options.template_path.empty() != (options.template_from.width == 0));
+  }
+
+  // Binary PGM (P5) or PPM (P6, reduced to luma), 8 bits per sample.
+  bool load_pnm(const std::string &path, vision::Frame &frame, std::string &error)
+  {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+      error = path + ": " + strerror(errno);
+      return false;
+    }
+    char magic[3] = {};
+    int width = 0, height = 0, max_value = 0;
+    bool ok = fscanf(file, "%2s", magic) == 1 && (strcmp(magic, "P5") == 0 || strcmp(magic, "P6") == 0);
+    // Header fields may be separated by comments.
+    int *fields[3] = {&width, &height, &max_value};
+    for (int field = 0; ok && field < 3; ++field)
+    {
+      int next;
+      while ((next = fgetc(file)) == '#' || next == ' ' || next == '\n' || next == '\r' || next == '\t')
+      {
+        if (next == '#')
+        {
+          while ((next = fgetc(file)) != '\n' && next != EOF)
+          {
+          }
+        }
+      }
+      ungetc(next, file);
+      ok = fscanf(file, "%d", fields[field]) == 1;
+    }
+    ok = ok && fgetc(file) != EOF && width > 0 && height > 0 && max_value > 0 && max_value < 256;
+    if (ok)
+    {
+      int channels = magic[1] == '6' ? 3 : 1;
+      std::vector<uint8_t> data(static_cast<size_t>(width) * static_cast<size_t>(height) * channels);
+      ok = fread(data.data(), 1, data.size(), file) == data.size();
+      frame.resize(width, height);
+      for (size_t pixel = 0; ok && pixel < frame.luma.size(); ++pixel)
+      {
+        const uint8_t *in = data.data() + pixel * channels;
+        frame.luma[pixel] = channels == 1 ? in[0] : static_cast<uint8_t>((in[2] * 29 + in[1] * 150 + in[0] * 77) >> 8);
+      }
+    }
+    fclose(file);
+    if (!ok)
+    {
+      error = path + ": not an 8-bit binary PGM or PPM";
+    }
+    return ok;
+  }
+
+  void crop(const vision::Frame &frame, const vision::Rect &rect, vision::Frame &out)
+  {
+    vision::Rect clipped = vision::clip_rect(rect, frame.width, frame.height);
+    out.resize(clipped.width, clipped.height);
+    for (int y = 0; y < clipped.height; ++y)
+    {
+      memcpy(out.row(y), frame.row(clipped.y + y) + clipped.x, static_cast<size_t>(clipped.width));
+    }
+  }
+
+  double us(int64_t ns)
+  {
+    return static_cast<double>(ns) / 1000.0;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parse_options(argc, argv, options))
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  std::string error;
+  vision::Frame templ;
+  if (!options.template_path.empty() && !load_pnm(options.template_path, templ, error))
+  {
+    fprintf(stderr, "template_bench: %s\n", error.c_str());
+    return 1;
+  }
+  FILE *csv = nullptr;
+  if (!options.csv_path.empty())
+  {
+    csv = fopen(options.csv_path.c_str(), "w");
+    if (!csv)
+    {
+      fprintf(stderr, "template_bench: %s: %s\n", options.csv_path.c_str(), strerror(errno));
+      return 1;
+    }
+    fprintf(csv, "corpus,frame,found,tracked,x,y,width,height,scale,score,find_us\n");
+  }
+
+  Totals totals;
+  std::unique_ptr<vision::TemplateMatcher> matcher;
+  if (templ.width > 0)
+  {
+    matcher = std::make_unique<vision::TemplateMatcher>(templ, options.match);
+  }
+  for (size_t corpus = 0; corpus < options.corpora.size(); ++corpus)
+  {
+    std::unique_ptr<vision::FrameSource> source = vision::open_frame_source(options.corpora[corpus], error);
+    if (!source)
+    {
+      fprintf(stderr, "template_bench: %s\n", error.c_str());
+      return 1;
+    }
+    if (matcher)
+    {
+      matcher->reset_tracking();
+    }
+    vision::Frame frame;
+    for (uint64_t index = 0; options.frames == 0 || totals.frames < options.frames; ++index)
+    {
+      int result = source->read(frame, 5000);
+      if (result <= 0)
+      {
+        if (result == 0)
+        {
+          fprintf(stderr, "template_bench: %s: no frame in 5 s\n", source->describe().c_str());
+        }
+        break;
+      }
+      if (!matcher)
+      {
+        crop(frame, options.template_from, templ);
+        matcher = std::make_unique<vision::TemplateMatcher>(templ, options.match);
+      }
+      uint64_t positions_before = matcher->positions();
+      int64_t start = hostlink::now_ns();
+      vision::Match match = matcher->find(frame);
+      int64_t elapsed = hostlink::now_ns() - start;
+      totals.find_ns.record(elapsed);
+      totals.positions += matcher->positions() - positions_before;
+      ++totals.frames;
+      totals.found += match.found ? 1 : 0;
+      totals.tracked += match.tracked ? 1 : 0;
+      if (csv)
+      {
+        fprintf(csv, "%zu,%llu,%d,%d,%d,%d,%d,%d,%.3f,%.2f,%.1f\n", corpus, static_cast<unsigned long long>(index),
+                match.found ? 1 : 0, match.tracked ? 1 : 0, match.x, match.y, match.width, match.height, match.scale,
+                match.score, us(elapsed));
+      }
+    }
+  }
+  if (csv)
+  {
+    fclose(csv);
+  }
+  if (totals.frames == 0)
+  {
+    fprintf(stderr, "template_bench: no frames\n");
+    return 1;
+  }
+
+  const HdrHistogram &find_ns = totals.find_ns;
+  double positions_per_frame = static_cast<double>(totals.positions) / static_cast<double>(totals.frames);
+  if (options.json)
+  {
+    printf("{\"isa\":\"%s\",\"template\":[%d,%d],\"scales\":%zu,\"frames\":%llu,\"found\":%llu,\"tracked\":%llu,"
+           "\"positionsPerFrame\":%.0f,\"findUs\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f,\"mean\":%.1f}}\n",
+           vision::template_match_isa(), templ.width, templ.height, options.match.scales.size(),
+           static_cast<unsigned long long>(totals.frames), static_cast<unsigned long long>(totals.found),
+           static_cast<unsigned long long>(totals.tracked), positions_per_frame,
+           us(find_ns.value_at_percentile(50)), us(find_ns.value_at_percentile(90)),
+           us(find_ns.value_at_percentile(99)), us(find_ns.max()), find_ns.mean() / 1000.0);
+    return 0;
+  }
+  printf("template_bench: %dx%d template, %zu scale(s), %s kernels\n", templ.width, templ.height,
+         options.match.scales.size(), vision::template_match_isa());
+  printf("frames %llu, found %llu (%llu by tracking), %.0f positions per frame\n",
+         static_cast<unsigned long long>(totals.frames), static_cast<unsigned long long>(totals.found),
+         static_cast<unsigned long long>(totals.tracked), positions_per_frame);
+  printf("find(): p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n", us(find_ns.value_at_percentile(50)),
+         us(find_ns.value_at_percentile(90)), us(find_ns.value_at_percentile(99)), us(find_ns.max()));
+  return 0;
+}
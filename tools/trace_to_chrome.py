@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""
+Convert an ESP32 BLE HID trace dump into Chrome about:tracing / Perfetto JSON.
+
+The firmware keeps a small binary event ring per core (see src/trace.h). Grab it
+either over HTTP:
+
+    curl -o trace.bin http://<device>/api/trace
+    python3 tools/trace_to_chrome.py trace.bin -o trace.json
+
+or over UART, by sending {"device":"system","action":"trace"} and saving the
+output (the "[ESP32] " prefix printed by test/ble_hid_uart_client.py is fine):
+
+    python3 test/ble_hid_uart_client.py --listen-for 3 raw '{"device":"system","action":"trace"}' > uart.log
+    python3 tools/trace_to_chrome.py uart.log -o trace.json
+
+Open the result in chrome://tracing or https://ui.perfetto.dev.
+"""
+
+from __future__ import annotations
+
+import argparse
+import base64
+import json
+import struct
+import sys
+from dataclasses import dataclass
+from typing import Dict, Iterable, List, Optional
+
+DUMP_MAGIC = 0x43525448
+HEADER = struct.Struct("<IHHHHII")
+CORE_HEADER = struct.Struct("<B3xI")
+EVENT = struct.Struct("<IBBHI")
+
+EVENT_NAMES = {
+    1: "ws_frame_received",
+    2: "ws_frame_sent",
+    3: "queue_enqueue",
+    4: "queue_dequeue",
+    5: "queue_drop",
+    6: "parse_start",
+    7: "parse_end",
+    8: "command_end",
+    9: "hid_report",
+    10: "wifi_event",
+    11: "task_wake",
+    12: "task_idle",
+}
+QUEUE_NAMES = {0: "command queue", 1: "event queue"}
+TASK_NAMES = {1: "transport_pump", 2: "http_ws_task", 3: "wifi_connect", 4: "gamepad"}
+HID_REPORT_NAMES = {
+    0: "keyboard_press",
+    1: "keyboard_release",
+    2: "keyboard_write",
+    3: "keyboard_release_all",
+    4: "consumer",
+    5: "mouse_move",
+    6: "mouse_buttons",
+    7: "gamepad",
+    8: "system_control",
+}
+DEVICE_NAMES = {0: "unknown", 1: "keyboard", 2: "mouse", 3: "consumer", 4: "system", 5: "pointer", 6: "gamepad"}
+WS_FRAME_TYPES = {0: "continue", 1: "text", 2: "binary", 8: "close", 9: "ping", 10: "pong"}
+
+
+@dataclass
+class Event:
+    timestamp_us: int
+    type: int
+    core: int
+    arg16: int
+    arg32: int
+
+
+def _decode_uart_log(text: str) -> bytes:
+    chunks: Dict[int, bytes] = {}
+    for line in text.splitlines():
+        start = line.find("{")
+        if start < 0:
+            continue
+        try:
+            message = json.loads(line[start:])
+        except json.JSONDecodeError:
+            continue
+        if message.get("event") != "trace":
+            continue
+        chunks[int(message.get("seq", len(chunks)))] = base64.b64decode(message.get("data", ""))
+    if not chunks:
+        raise SystemExit("no trace chunks found in log")
+    expected = list(range(max(chunks) + 1))
+    missing = [seq for seq in expected if seq not in chunks]
+    if missing:
+        raise SystemExit(f"trace log is missing chunks {missing}")
+    return b"".join(chunks[seq] for seq in expected)
+
+
+def load_dump(path: str) -> bytes:
+    with open(path, "rb") as handle:
+        raw = handle.read()
+    if len(raw) >= 4 and struct.unpack_from("<I", raw)[0] == DUMP_MAGIC:
+        return raw
+    return _decode_uart_log(raw.decode("utf-8", errors="replace"))
+
+
+def parse_dump(raw: bytes) -> List[List[Event]]:
+    if len(raw) < HEADER.size:
+        raise SystemExit("trace dump is truncated")
+    magic, version, event_size, core_count, _per_core, _total, _now = HEADER.unpack_from(raw)
+    if magic != DUMP_MAGIC:
+        raise SystemExit("not a trace dump (bad magic)")
+    if version != 1 or event_size != EVENT.size:
+        raise SystemExit(f"unsupported trace dump version {version} (event size {event_size})")
+
+    offset = HEADER.size
+    cores: List[List[Event]] = []
+    for _ in range(core_count):
+        core, count = CORE_HEADER.unpack_from(raw, offset)
+        offset += CORE_HEADER.size
+        events: List[Event] = []
+        wrap = 0
+        previous: Optional[int] = None
+        for _index in range(count):
+            timestamp, event_type, event_core, arg16, arg32 = EVENT.unpack_from(raw, offset)
+            offset += EVENT.size
+            if event_type == 0:
+                continue
+            # Timestamps are the low 32 bits of esp_timer; unwrap them per core.
+            if previous is not None and timestamp + wrap < previous - (1 << 31):
+                wrap += 1 << 32
+            previous = timestamp + wrap
+            events.append(Event(previous, event_type, core, arg16, arg32))
+        cores.append(events)
+    return cores
+
+
+def event_args(event: Event) -> dict:
+    if event.type in (1,):
+        return {"frame": WS_FRAME_TYPES.get(event.arg16, event.arg16), "bytes": event.arg32}
+    if event.type == 2:
+        return {"ok": event.arg16 == 0, "bytes": event.arg32}
+    if event.type in (3, 4):
+        return {"queue": QUEUE_NAMES.get(event.arg16, event.arg16), "depth": event.arg32}
+    if event.type == 5:
+        return {"queue": QUEUE_NAMES.get(event.arg16, event.arg16), "bytes": event.arg32}
+    if event.type == 9:
+        return {"report": HID_REPORT_NAMES.get(event.arg16, event.arg16), "value": event.arg32}
+    if event.type == 10:
+        return {"event": event.arg16, "reason": event.arg32}
+    if event.type in (11, 12):
+        return {"task": TASK_NAMES.get(event.arg16, event.arg16)}
+    return {"arg16": event.arg16, "arg32": event.arg32}
+
+
+def to_chrome(cores: Iterable[List[Event]]) -> dict:
+    trace_events: List[dict] = [
+        {"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "ESP32 BLE HID"}},
+    ]
+    for core_index, events in enumerate(cores):
+        tid = core_index
+        trace_events.append(
+            {"name": "thread_name", "ph": "M", "pid": 0, "tid": tid, "args": {"name": f"core {core_index}"}}
+        )
+        command_start: Optional[Event] = None
+        parse_start: Optional[Event] = None
+
+        def close_command(end: Event, device: Optional[int]) -> None:
+            nonlocal command_start
+            if command_start is None:
+                return
+            args = {"bytes": command_start.arg32}
+            if device is not None:
+                args["device"] = DEVICE_NAMES.get(device, device)
+            trace_events.append(
+                {
+                    "name": "command",
+                    "ph": "X",
+                    "pid": 0,
+                    "tid": tid,
+                    "ts": command_start.timestamp_us,
+                    "dur": max(end.timestamp_us - command_start.timestamp_us, 0),
+                    "args": args,
+                }
+            )
+            command_start = None
+
+        for event in events:
+            name = EVENT_NAMES.get(event.type, f"type_{event.type}")
+            if event.type == 6:
+                if command_start is not None:
+                    close_command(event, None)
+                command_start = event
+                parse_start = event
+                continue
+            if event.type == 7:
+                if parse_start is not None:
+                    trace_events.append(
+                        {
+                            "name": "parse",
+                            "ph": "X",
+                            "pid": 0,
+                            "tid": tid,
+                            "ts": parse_start.timestamp_us,
+                            "dur": max(event.timestamp_us - parse_start.timestamp_us, 0),
+                            "args": {"error": event.arg16 != 0},
+                        }
+                    )
+                    parse_start = None
+                if event.arg16 != 0:
+                    close_command(event, None)
+                continue
+            if event.type == 8:
+                close_command(event, event.arg16)
+                continue
+            if event.type in (3, 4):
+                trace_events.append(
+                    {
+                        "name": QUEUE_NAMES.get(event.arg16, f"queue {event.arg16}"),
+                        "ph": "C",
+                        "pid": 0,
+                        "ts": event.timestamp_us,
+                        "args": {"depth": event.arg32},
+                    }
+                )
+            trace_events.append(
+                {
+                    "name": name,
+                    "ph": "i",
+                    "s": "t",
+                    "pid": 0,
+                    "tid": tid,
+                    "ts": event.timestamp_us,
+                    "args": event_args(event),
+                }
+            )
+    return {"traceEvents": trace_events, "displayTimeUnit": "ms"}
+
+
+def build_parser() -> argparse.ArgumentParser:
+    parser = argparse.ArgumentParser(description="Convert an ESP32 trace dump to Chrome trace JSON.")
+    parser.add_argument("input", help="binary dump from /api/trace or a UART log containing trace chunks")
+    parser.add_argument("-o", "--output", help="output JSON path (default: stdout)")
+    return parser
+
+
+def main(argv: Optional[Iterable[str]] = None) -> int:
+    args = build_parser().parse_args(list(argv) if argv is not None else None)
+    cores = parse_dump(load_dump(args.input))
+    result = to_chrome(cores)
+    serialized = json.dumps(result)
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as handle:
+            handle.write(serialized)
+        total = sum(len(events) for events in cores)
+        print(f"[trace] wrote {total} events from {len(cores)} core(s) to {args.output}")
+    else:
+        sys.stdout.write(serialized)
+    return 0
+
+
+if __name__ == "__main__":  # pragma: no cover
+    sys.exit(main())
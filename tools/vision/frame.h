@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vision
+{
+  // Which planes a source fills in. Luma is what the kernels here read; BGR is for
+  // consumers that display or re-encode the picture (the Python frame grabber).
+  enum class Channels : uint8_t
+  {
+    Luma = 1,
+    Bgr = 2,
+    LumaAndBgr = 3
+  };
+
+  inline bool has_channel(Channels set, Channels channel)
+  {
+    return (static_cast<uint8_t>(set) & static_cast<uint8_t>(channel)) != 0;
+  }
+
+  // One 8-bit luma image. Colour is dropped on capture: every consumer here (change
+  // detection, latency probing, matching) works on brightness alone.
+  struct Frame
+  {
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    std::vector<uint8_t> luma;
+    // Packed B, G, R rows of width * 3 bytes; empty unless the source was asked for BGR.
+    std::vector<uint8_t> bgr;
+    // CLOCK_MONOTONIC capture time; see FrameSource for what "capture" means per source.
+    int64_t timestamp_ns = 0;
+    uint64_t sequence = 0;
+
+    void resize(int new_width, int new_height, Channels channels = Channels::Luma)
+    {
+      width = new_width;
+      height = new_height;
+      stride = new_width;
+      size_t pixels = static_cast<size_t>(new_width) * static_cast<size_t>(new_height);
+      luma.resize(has_channel(channels, Channels::Luma) ? pixels : 0);
+      bgr.resize(has_channel(channels, Channels::Bgr) ? pixels * 3 : 0);
+    }
+    uint8_t *bgr_row(int y)
+    {
+      return bgr.data() + static_cast<size_t>(y) * static_cast<size_t>(width) * 3;
+    }
+    const uint8_t *row(int y) const
+    {
+      return luma.data() + static_cast<size_t>(y) * static_cast<size_t>(stride);
+    }
+    uint8_t *row(int y)
+    {
+      return luma.data() + static_cast<size_t>(y) * static_cast<size_t>(stride);
+    }
+  };
+
+  struct Rect
+  {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+  };
+
+  // `rect` clipped to the frame; an empty rect means the whole frame.
+  Rect clip_rect(const Rect &rect, int width, int height);
+} // namespace vision
@@ -0,0 +1,760 @@
+#include "frame_source.h"
+
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <vector>
+
+namespace vision
+{
+  namespace
+  {
+    enum class PixelFormat : uint8_t
+    {
+      Gray = 0,
+      Bgr24,
+      Rgb24,
+      Yuyv,
+      Uyvy
+    };
+
+    bool parse_size(const std::string &text, int &width, int &height)
+    {
+      return sscanf(text.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+    }
+
+    bool parse_pixel_format(const std::string &text, PixelFormat &format)
+    {
+      if (text == "gray" || text == "grey" || text == "gray8")
+        format = PixelFormat::Gray;
+      else if (text == "bgr24")
+        format = PixelFormat::Bgr24;
+      else if (text == "rgb24")
+        format = PixelFormat::Rgb24;
+      else if (text == "yuyv" || text == "yuyv422")
+        format = PixelFormat::Yuyv;
+      else if (text == "uyvy" || text == "uyvy422")
+        format = PixelFormat::Uyvy;
+      else
+        return false;
+      return true;
+    }
+
+    size_t bytes_per_pixel_x2(PixelFormat format)
+    {
+      switch (format)
+      {
+      case PixelFormat::Gray:
+        return 2;
+      case PixelFormat::Yuyv:
+      case PixelFormat::Uyvy:
+        return 4;
+      case PixelFormat::Bgr24:
+      case PixelFormat::Rgb24:
+      default:
+        return 6;
+      }
+    }
+
+    // Converts one row of `format` pixels to luma. BT.601 weights in 8-bit fixed point.
+    void row_to_luma(PixelFormat format, const uint8_t *in, uint8_t *out, int width)
+    {
+      switch (format)
+      {
+      case PixelFormat::Gray:
+        memcpy(out, in, static_cast<size_t>(width));
+        break;
+      case PixelFormat::Bgr24:
+        for (int x = 0; x < width; ++x, in += 3)
+        {
+          out[x] = static_cast<uint8_t>((in[0] * 29 + in[1] * 150 + in[2] * 77) >> 8);
+        }
+        break;
+      case PixelFormat::Rgb24:
+        for (int x = 0; x < width; ++x, in += 3)
+        {
+          out[x] = static_cast<uint8_t>((in[2] * 29 + in[1] * 150 + in[0] * 77) >> 8);
+        }
+        break;
+      case PixelFormat::Yuyv:
+        for (int x = 0; x < width; ++x)
+        {
+          out[x] = in[x * 2];
+        }
+        break;
+      case PixelFormat::Uyvy:
+        for (int x = 0; x < width; ++x)
+        {
+          out[x] = in[x * 2 + 1];
+        }
+        break;
+      }
+    }
+
+    inline uint8_t clamp_byte(int value)
+    {
+      return static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+    }
+
+    // BT.601 limited-range YCbCr to packed BGR.
+    inline void yuv_to_bgr(int y, int u, int v, uint8_t *out)
+    {
+      int c = 298 * (y - 16) + 128;
+      int d = u - 128;
+      int e = v - 128;
+      out[0] = clamp_byte((c + 516 * d) >> 8);
+      out[1] = clamp_byte((c - 100 * d - 208 * e) >> 8);
+      out[2] = clamp_byte((c + 409 * e) >> 8);
+    }
+
+    // Converts one row of `format` pixels to packed BGR.
+    void row_to_bgr(PixelFormat format, const uint8_t *in, uint8_t *out, int width)
+    {
+      switch (format)
+      {
+      case PixelFormat::Gray:
+        for (int x = 0; x < width; ++x, out += 3)
+        {
+          out[0] = out[1] = out[2] = in[x];
+        }
+        break;
+      case PixelFormat::Bgr24:
+        memcpy(out, in, static_cast<size_t>(width) * 3);
+        break;
+      case PixelFormat::Rgb24:
+        for (int x = 0; x < width; ++x, in += 3, out += 3)
+        {
+          out[0] = in[2];
+          out[1] = in[1];
+          out[2] = in[0];
+        }
+        break;
+      case PixelFormat::Yuyv:
+      case PixelFormat::Uyvy:
+      {
+        // Two pixels share one U and one V: Y0 U Y1 V or U Y0 V Y1.
+        bool yuyv = format == PixelFormat::Yuyv;
+        for (int x = 0; x < width; x += 2, in += 4)
+        {
+          int y0 = yuyv ? in[0] : in[1];
+          int u = yuyv ? in[1] : in[0];
+          int y1 = yuyv ? in[2] : in[3];
+          int v = yuyv ? in[3] : in[2];
+          yuv_to_bgr(y0, u, v, out + x * 3);
+          if (x + 1 < width)
+          {
+            yuv_to_bgr(y1, u, v, out + (x + 1) * 3);
+          }
+        }
+        break;
+      }
+      }
+    }
+
+    // One row of a 4:2:0 picture (NV12 or YU12) to packed BGR. `u` and `v` point at the
+    // chroma row covering it; chroma samples are `step` bytes apart.
+    void planar_row_to_bgr(const uint8_t *luma, const uint8_t *u, const uint8_t *v, int step, uint8_t *out, int width)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        yuv_to_bgr(luma[x], u[(x / 2) * step], v[(x / 2) * step], out + x * 3);
+      }
+    }
+
+    // Waits for `fd` to turn readable; false on timeout.
+    bool wait_readable(int fd, int timeout_ms)
+    {
+      pollfd waiter = {fd, POLLIN, 0};
+      int ready;
+      do
+      {
+        ready = poll(&waiter, 1, timeout_ms);
+      } while (ready < 0 && errno == EINTR);
+      return ready > 0;
+    }
+
+    class SyntheticSource : public FrameSource
+    {
+    public:
+      SyntheticSource(int width, int height, double fps, int latency_min_ms, int latency_max_ms, Channels channels)
+          : width_(width), height_(height), channels_(channels), random_(1),
+            latency_(static_cast<int64_t>(latency_min_ms) * 1000000, static_cast<int64_t>(latency_max_ms) * 1000000)
+      {
+        interval_ns_ = static_cast<int64_t>(1e9 / std::max(1.0, fps));
+        next_frame_ns_ = monotonic_ns();
+        background_.resize(width_, height_);
+        scratch_.resize(width_, height_);
+        std::uniform_int_distribution<int> noise(-2, 2);
+        noise_.resize(background_.luma.size() + kNoiseSlack);
+        for (int8_t &value : noise_)
+        {
+          value = static_cast<int8_t>(noise(random_));
+        }
+        for (int y = 0; y < height_; ++y)
+        {
+          for (int x = 0; x < width_; ++x)
+          {
+            background_.row(y)[x] = static_cast<uint8_t>(40 + ((x / 8 + y / 8) % 2) * 30 + (x * 60) / width_);
+          }
+        }
+        char text[96];
+        snprintf(text, sizeof(text), "synthetic %dx%d@%.0f, %d-%d ms", width_, height_, fps, latency_min_ms,
+                 latency_max_ms);
+        description_ = text;
+      }
+
+      int read(Frame &frame, int timeout_ms) override
+      {
+        int64_t now = monotonic_ns();
+        if (next_frame_ns_ - now > static_cast<int64_t>(timeout_ms) * 1000000)
+        {
+          sleep_until(now + static_cast<int64_t>(timeout_ms) * 1000000);
+          return 0;
+        }
+        sleep_until(next_frame_ns_);
+        int64_t frame_ns = next_frame_ns_;
+        // A late reader skips frames rather than replaying the backlog, like a capture
+        // device whose ring overflowed.
+        now = monotonic_ns();
+        next_frame_ns_ += interval_ns_ * std::max<int64_t>(1, (now - next_frame_ns_) / interval_ns_ + 1);
+
+        while (!moves_.empty() && moves_.front() <= frame_ns)
+        {
+          moves_.erase(moves_.begin());
+          cursor_right_ = !cursor_right_;
+        }
+        frame.resize(width_, height_, channels_);
+        // Sensor-like noise from a precomputed table at a random offset; drawing a random
+        // number per pixel would cap large frames well under 60 fps.
+        const int8_t *noise = noise_.data() + std::uniform_int_distribution<size_t>(0, kNoiseSlack)(random_);
+        for (size_t index = 0; index < scratch_.luma.size(); ++index)
+        {
+          scratch_.luma[index] = static_cast<uint8_t>(background_.luma[index] + noise[index]);
+        }
+        int size = std::max(8, height_ / 16);
+        int left = cursor_right_ ? width_ * 3 / 4 : width_ / 4;
+        for (int y = height_ / 2; y < std::min(height_, height_ / 2 + size); ++y)
+        {
+          memset(scratch_.row(y) + left, 235, static_cast<size_t>(std::min(size, width_ - left)));
+        }
+        if (has_channel(channels_, Channels::Bgr))
+        {
+          for (int y = 0; y < height_; ++y)
+          {
+            row_to_bgr(PixelFormat::Gray, scratch_.row(y), frame.bgr_row(y), width_);
+          }
+        }
+        if (has_channel(channels_, Channels::Luma))
+        {
+          frame.luma.swap(scratch_.luma);
+        }
+        frame.timestamp_ns = frame_ns;
+        frame.sequence = ++sequence_;
+        return 1;
+      }
+
+      void on_input(int64_t time_ns) override
+      {
+        moves_.push_back(time_ns + latency_(random_));
+        std::sort(moves_.begin(), moves_.end());
+      }
+
+      std::string describe() const override
+      {
+        return description_;
+      }
+
+    private:
+      static void sleep_until(int64_t time_ns)
+      {
+        timespec deadline = {static_cast<time_t>(time_ns / 1000000000), static_cast<long>(time_ns % 1000000000)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+        {
+        }
+      }
+
+      int width_;
+      int height_;
+      Channels channels_;
+      int64_t interval_ns_;
+      int64_t next_frame_ns_;
+      static constexpr size_t kNoiseSlack = 4096;
+
+      Frame background_;
+      Frame scratch_;
+      std::vector<int8_t> noise_;
+      std::mt19937 random_;
+      std::uniform_int_distribution<int64_t> latency_;
+      std::vector<int64_t> moves_;
+      bool cursor_right_ = false;
+      uint64_t sequence_ = 0;
+      std::string description_;
+    };
+
+    // Raw frames over a file descriptor (file, FIFO, stdin or a child's stdout).
+    class RawSource : public FrameSource
+    {
+    public:
+      RawSource(int fd, pid_t child, int width, int height, PixelFormat format, Channels channels,
+                std::string description)
+          : fd_(fd), child_(child), width_(width), height_(height), format_(format), channels_(channels),
+            description_(std::move(description))
+      {
+        frame_bytes_ = static_cast<size_t>(width) * static_cast<size_t>(height) * bytes_per_pixel_x2(format) / 2;
+        pending_.resize(frame_bytes_);
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+      }
+
+      ~RawSource() override
+      {
+        if (fd_ > STDERR_FILENO)
+        {
+          close(fd_);
+        }
+        if (child_ > 0)
+        {
+          kill(child_, SIGTERM);
+          waitpid(child_, nullptr, 0);
+        }
+      }
+
+      int read(Frame &frame, int timeout_ms) override
+      {
+        int64_t deadline = monotonic_ns() + static_cast<int64_t>(timeout_ms) * 1000000;
+        for (;;)
+        {
+          ssize_t got = ::read(fd_, pending_.data() + filled_, frame_bytes_ - filled_);
+          if (got > 0)
+          {
+            filled_ += static_cast<size_t>(got);
+            if (filled_ == frame_bytes_)
+            {
+              convert(frame);
+              return 1;
+            }
+            continue;
+          }
+          if (got == 0)
+          {
+            error_ = description_ + ": end of stream";
+            return -1;
+          }
+          if (errno != EAGAIN && errno != EINTR)
+          {
+            error_ = description_ + ": " + strerror(errno);
+            return -1;
+          }
+          int remaining_ms = static_cast<int>((deadline - monotonic_ns()) / 1000000);
+          if (remaining_ms <= 0 && timeout_ms >= 0)
+          {
+            return 0;
+          }
+          if (!wait_readable(fd_, std::max(0, remaining_ms)))
+          {
+            return 0;
+          }
+        }
+      }
+
+      std::string describe() const override
+      {
+        return description_;
+      }
+
+    private:
+      void convert(Frame &frame)
+      {
+        frame.timestamp_ns = monotonic_ns();
+        frame.sequence = ++sequence_;
+        filled_ = 0;
+        size_t row_bytes = frame_bytes_ / static_cast<size_t>(height_);
+        if (format_ == PixelFormat::Bgr24 && channels_ == Channels::Bgr)
+        {
+          // The frame takes the filled buffer and hands back its old one for the next read.
+          frame.resize(width_, height_, channels_);
+          frame.bgr.swap(pending_);
+          return;
+        }
+        frame.resize(width_, height_, channels_);
+        for (int y = 0; y < height_; ++y)
+        {
+          const uint8_t *row = pending_.data() + row_bytes * static_cast<size_t>(y);
+          if (has_channel(channels_, Channels::Luma))
+          {
+            row_to_luma(format_, row, frame.row(y), width_);
+          }
+          if (has_channel(channels_, Channels::Bgr))
+          {
+            row_to_bgr(format_, row, frame.bgr_row(y), width_);
+          }
+        }
+      }
+
+      int fd_;
+      pid_t child_;
+      int width_;
+      int height_;
+      PixelFormat format_;
+      Channels channels_;
+      size_t frame_bytes_ = 0;
+      size_t filled_ = 0;
+      std::vector<uint8_t> pending_;
+      uint64_t sequence_ = 0;
+      std::string description_;
+    };
+
+    class V4l2Source : public FrameSource
+    {
+    public:
+      explicit V4l2Source(Channels channels) : channels_(channels)
+      {
+      }
+
+      ~V4l2Source() override
+      {
+        if (fd_ >= 0)
+        {
+          v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+          ioctl(fd_, VIDIOC_STREAMOFF, &type);
+        }
+        for (const Mapping &mapping : mappings_)
+        {
+          munmap(mapping.start, mapping.length);
+        }
+        if (fd_ >= 0)
+        {
+          close(fd_);
+        }
+      }
+
+      bool open(const std::string &path, int width, int height, std::string &error)
+      {
+        description_ = "v4l2 " + path;
+        fd_ = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd_ < 0)
+        {
+          error = path + ": " + strerror(errno);
+          return false;
+        }
+        v4l2_format format = {};
+        format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (xioctl(VIDIOC_G_FMT, &format) != 0)
+        {
+          error = path + ": VIDIOC_G_FMT: " + strerror(errno);
+          return false;
+        }
+        if (width > 0)
+        {
+          format.fmt.pix.width = static_cast<uint32_t>(width);
+          format.fmt.pix.height = static_cast<uint32_t>(height);
+        }
+        // Keep the device's own format when it is one we read; otherwise ask for YUYV.
+        if (!supported(format.fmt.pix.pixelformat))
+        {
+          format.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+        }
+        format.fmt.pix.field = V4L2_FIELD_ANY;
+        if (xioctl(VIDIOC_S_FMT, &format) != 0 || !supported(format.fmt.pix.pixelformat))
+        {
+          error = path + ": no YUYV, UYVY, GREY, NV12 or YU12 capture format";
+          return false;
+        }
+        pixel_format_ = format.fmt.pix.pixelformat;
+        width_ = static_cast<int>(format.fmt.pix.width);
+        height_ = static_cast<int>(format.fmt.pix.height);
+        bytes_per_line_ = static_cast<int>(format.fmt.pix.bytesperline);
+        if (bytes_per_line_ == 0)
+        {
+          bytes_per_line_ = pixel_format_ == V4L2_PIX_FMT_YUYV || pixel_format_ == V4L2_PIX_FMT_UYVY ? width_ * 2 : width_;
+        }
+
+        v4l2_requestbuffers request = {};
+        request.count = 4;
+        request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        request.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(VIDIOC_REQBUFS, &request) != 0 || request.count < 2)
+        {
+          error = path + ": VIDIOC_REQBUFS: " + strerror(errno);
+          return false;
+        }
+        for (uint32_t index = 0; index < request.count; ++index)
+        {
+          v4l2_buffer buffer = {};
+          buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+          buffer.memory = V4L2_MEMORY_MMAP;
+          buffer.index = index;
+          if (xioctl(VIDIOC_QUERYBUF, &buffer) != 0)
+          {
+            error = path + ": VIDIOC_QUERYBUF: " + strerror(errno);
+            return false;
+          }
+          void *start = mmap(nullptr, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, buffer.m.offset);
+          if (start == MAP_FAILED)
+          {
+            error = path + ": mmap: " + strerror(errno);
+            return false;
+          }
+          mappings_.push_back(Mapping{start, buffer.length});
+          if (xioctl(VIDIOC_QBUF, &buffer) != 0)
+          {
+            error = path + ": VIDIOC_QBUF: " + strerror(errno);
+            return false;
+          }
+        }
+        v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        if (xioctl(VIDIOC_STREAMON, &type) != 0)
+        {
+          error = path + ": VIDIOC_STREAMON: " + strerror(errno);
+          return false;
+        }
+        char size[32];
+        snprintf(size, sizeof(size), " %dx%d", width_, height_);
+        description_ += size;
+        return true;
+      }
+
+      int read(Frame &frame, int timeout_ms) override
+      {
+        if (!wait_readable(fd_, timeout_ms))
+        {
+          return 0;
+        }
+        v4l2_buffer buffer = {};
+        buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buffer.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(VIDIOC_DQBUF, &buffer) != 0)
+        {
+          if (errno == EAGAIN)
+          {
+            return 0;
+          }
+          error_ = description_ + ": VIDIOC_DQBUF: " + strerror(errno);
+          return -1;
+        }
+        const uint8_t *data = static_cast<const uint8_t *>(mappings_[buffer.index].start);
+        frame.resize(width_, height_, channels_);
+        PixelFormat row_format = pixel_format_ == V4L2_PIX_FMT_YUYV   ? PixelFormat::Yuyv
+                                 : pixel_format_ == V4L2_PIX_FMT_UYVY ? PixelFormat::Uyvy
+                                                                      : PixelFormat::Gray;
+        bool planar = pixel_format_ == V4L2_PIX_FMT_NV12 || pixel_format_ == V4L2_PIX_FMT_YUV420;
+        size_t luma_bytes = static_cast<size_t>(bytes_per_line_) * static_cast<size_t>(height_);
+        for (int y = 0; y < height_; ++y)
+        {
+          // NV12 and YU12 start with a full-resolution Y plane.
+          const uint8_t *row = data + static_cast<size_t>(y) * static_cast<size_t>(bytes_per_line_);
+          if (has_channel(channels_, Channels::Luma))
+          {
+            row_to_luma(row_format, row, frame.row(y), width_);
+          }
+          if (!has_channel(channels_, Channels::Bgr))
+          {
+            continue;
+          }
+          if (!planar)
+          {
+            row_to_bgr(row_format, row, frame.bgr_row(y), width_);
+          }
+          else if (pixel_format_ == V4L2_PIX_FMT_NV12)
+          {
+            const uint8_t *chroma = data + luma_bytes + static_cast<size_t>(y / 2) * static_cast<size_t>(bytes_per_line_);
+            planar_row_to_bgr(row, chroma, chroma + 1, 2, frame.bgr_row(y), width_);
+          }
+          else
+          {
+            size_t chroma_stride = static_cast<size_t>(bytes_per_line_ / 2);
+            const uint8_t *u = data + luma_bytes + static_cast<size_t>(y / 2) * chroma_stride;
+            const uint8_t *v = u + chroma_stride * static_cast<size_t>(height_ / 2);
+            planar_row_to_bgr(row, u, v, 1, frame.bgr_row(y), width_);
+          }
+        }
+        bool monotonic = (buffer.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+        frame.timestamp_ns = monotonic ? static_cast<int64_t>(buffer.timestamp.tv_sec) * 1000000000LL +
+                                             static_cast<int64_t>(buffer.timestamp.tv_usec) * 1000
+                                       : monotonic_ns();
+        frame.sequence = buffer.sequence;
+        xioctl(VIDIOC_QBUF, &buffer);
+        return 1;
+      }
+
+      std::string describe() const override
+      {
+        return description_;
+      }
+
+    private:
+      struct Mapping
+      {
+        void *start;
+        size_t length;
+      };
+
+      static bool supported(uint32_t pixel_format)
+      {
+        return pixel_format == V4L2_PIX_FMT_YUYV || pixel_format == V4L2_PIX_FMT_UYVY ||
+               pixel_format == V4L2_PIX_FMT_GREY || pixel_format == V4L2_PIX_FMT_NV12 ||
+               pixel_format == V4L2_PIX_FMT_YUV420;
+      }
+
+      int xioctl(unsigned long request, void *argument)
+      {
+        int result;
+        do
+        {
+          result = ioctl(fd_, request, argument);
+        } while (result < 0 && errno == EINTR);
+        return result;
+      }
+
+      Channels channels_;
+      int fd_ = -1;
+      int width_ = 0;
+      int height_ = 0;
+      int bytes_per_line_ = 0;
+      uint32_t pixel_format_ = 0;
+      std::vector<Mapping> mappings_;
+      std::string description_;
+    };
+
+    // Splits "a:b:rest" into at most `count` fields; the last keeps any further colons.
+    std::vector<std::string> split_fields(const std::string &text, size_t count)
+    {
+      std::vector<std::string> fields;
+      size_t start = 0;
+      while (fields.size() + 1 < count)
+      {
+        size_t colon = text.find(':', start);
+        if (colon == std::string::npos)
+        {
+          break;
+        }
+        fields.push_back(text.substr(start, colon - start));
+        start = colon + 1;
+      }
+      fields.push_back(text.substr(start));
+      return fields;
+    }
+  } // namespace
+
+  int64_t monotonic_ns()
+  {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+  }
+
+  std::unique_ptr<FrameSource> open_frame_source(const std::string &spec, std::string &error, Channels channels)
+  {
+    if (spec.compare(0, 9, "synthetic") == 0)
+    {
+      int width = 640, height = 360, latency_min = 30, latency_max = 50;
+      double fps = 60;
+      for (const std::string &field : split_fields(spec, 8))
+      {
+        if (field.find('x') != std::string::npos)
+        {
+          size_t at = field.find('@');
+          parse_size(field.substr(0, at), width, height);
+          if (at != std::string::npos)
+          {
+            fps = strtod(field.c_str() + at + 1, nullptr);
+          }
+        }
+        else if (field[0] == '@')
+        {
+          fps = strtod(field.c_str() + 1, nullptr);
+        }
+        else if (field.find('-') != std::string::npos)
+        {
+          sscanf(field.c_str(), "%d-%d", &latency_min, &latency_max);
+        }
+      }
+      if (width < 32 || height < 32 || latency_max < latency_min)
+      {
+        error = spec + ": bad synthetic spec";
+        return nullptr;
+      }
+      return std::make_unique<SyntheticSource>(width, height, fps, latency_min, latency_max, channels);
+    }
+
+    if (spec.compare(0, 5, "v4l2:") == 0)
+    {
+      std::vector<std::string> fields = split_fields(spec.substr(5), 2);
+      int width = 0, height = 0;
+      if (fields.size() == 2 && !parse_size(fields[1], width, height))
+      {
+        error = spec + ": bad size";
+        return nullptr;
+      }
+      auto source = std::make_unique<V4l2Source>(channels);
+      if (!source->open(fields[0], width, height, error))
+      {
+        return nullptr;
+      }
+      return source;
+    }
+
+    bool command = spec.compare(0, 4, "cmd:") == 0;
+    if (command || spec.compare(0, 4, "raw:") == 0)
+    {
+      std::vector<std::string> fields = split_fields(spec.substr(4), 3);
+      int width = 0, height = 0;
+      PixelFormat format;
+      if (fields.size() != 3 || !parse_size(fields[0], width, height) || !parse_pixel_format(fields[1], format))
+      {
+        error = spec + ": expected WxH:FORMAT:" + (command ? "COMMAND" : "PATH");
+        return nullptr;
+      }
+      int fd = -1;
+      pid_t child = -1;
+      if (command)
+      {
+        int pipe_fds[2];
+        if (pipe2(pipe_fds, O_CLOEXEC) != 0)
+        {
+          error = std::string("pipe: ") + strerror(errno);
+          return nullptr;
+        }
+        child = fork();
+        if (child == 0)
+        {
+          dup2(pipe_fds[1], STDOUT_FILENO);
+          execl("/bin/sh", "sh", "-c", fields[2].c_str(), static_cast<char *>(nullptr));
+          _exit(127);
+        }
+        close(pipe_fds[1]);
+        fd = pipe_fds[0];
+      }
+      else if (fields[2] == "-")
+      {
+        fd = STDIN_FILENO;
+      }
+      else
+      {
+        fd = ::open(fields[2].c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+          error = fields[2] + ": " + strerror(errno);
+          return nullptr;
+        }
+      }
+      return std::make_unique<RawSource>(fd, child, width, height, format, channels,
+                                         (command ? "cmd " : "raw ") + fields[0] + " " + fields[1]);
+    }
+
+    error = spec + ": unknown source (synthetic, v4l2:, raw: or cmd:)";
+    return nullptr;
+  }
+} // namespace vision
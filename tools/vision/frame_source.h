@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "frame.h"
+
+// Frame sources for the host video tools. Specs:
+//
+//   synthetic[:WxH][@FPS][:MIN-MAX]  built-in screen: a textured background with a cursor
+//                                    block that moves MIN..MAX ms (default 30-50) after
+//                                    each on_input(), on the next frame boundary
+//   v4l2:/dev/videoN[:WxH]           V4L2 capture (YUYV, UYVY, GREY, NV12 or YU12), e.g. a
+//                                    capture card or uxplay -vs v4l2sink
+//   raw:WxH:FORMAT:PATH              raw frames (gray, bgr24, rgb24 or yuyv) from a file,
+//                                    FIFO or "-" for stdin
+//   cmd:WxH:FORMAT:COMMAND           the same from a command's stdout, e.g.
+//                                    ffmpeg -i udp://... -f rawvideo -pix_fmt gray -
+//
+// Sources fill the planes named by `channels`. Raw bgr24 input asked for BGR alone is
+// read straight into the frame's buffer with no conversion pass.
+//
+// Timestamps are CLOCK_MONOTONIC. V4L2 buffers carry the driver's capture time; raw and
+// command sources can only stamp a frame when its last byte arrives, so decoder and pipe
+// buffering count as latency there.
+namespace vision
+{
+  class FrameSource
+  {
+  public:
+    virtual ~FrameSource() = default;
+    // 1 when `frame` holds a new frame, 0 when none arrived within timeout_ms, -1 when
+    // the source ended or failed (see error()).
+    virtual int read(Frame &frame, int timeout_ms) = 0;
+    // Tells a synthetic source that input went out at `time_ns`; real sources ignore it.
+    virtual void on_input(int64_t time_ns)
+    {
+      (void)time_ns;
+    }
+    virtual std::string describe() const = 0;
+    const std::string &error() const
+    {
+      return error_;
+    }
+
+  protected:
+    std::string error_;
+  };
+
+  std::unique_ptr<FrameSource> open_frame_source(const std::string &spec, std::string &error,
+                                                 Channels channels = Channels::Luma);
+
+  int64_t monotonic_ns();
+} // namespace vision
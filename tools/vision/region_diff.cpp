@@ -0,0 +1,126 @@
+#include "region_diff.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace vision
+{
+  Rect clip_rect(const Rect &rect, int width, int height)
+  {
+    if (rect.width <= 0 || rect.height <= 0)
+    {
+      return Rect{0, 0, width, height};
+    }
+    Rect clipped;
+    clipped.x = std::max(0, std::min(rect.x, width));
+    clipped.y = std::max(0, std::min(rect.y, height));
+    clipped.width = std::max(0, std::min(rect.x + rect.width, width) - clipped.x);
+    clipped.height = std::max(0, std::min(rect.y + rect.height, height) - clipped.y);
+    return clipped;
+  }
+
+  uint64_t sum_abs_diff_rows(const uint8_t *a, int a_stride, const uint8_t *b, int b_stride, int width, int height)
+  {
+    uint64_t total = 0;
+    for (int y = 0; y < height; ++y)
+    {
+      const uint8_t *row_a = a + static_cast<ptrdiff_t>(y) * a_stride;
+      const uint8_t *row_b = b + static_cast<ptrdiff_t>(y) * b_stride;
+      int x = 0;
+#if defined(__SSE2__)
+      __m128i sums = _mm_setzero_si128();
+      for (; x + 16 <= width; x += 16)
+      {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row_a + x));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row_b + x));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(va, vb));
+      }
+      total += static_cast<uint64_t>(_mm_cvtsi128_si64(sums)) +
+               static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sums, sums)));
+#elif defined(__ARM_NEON)
+      uint32x4_t sums = vdupq_n_u32(0);
+      for (; x + 16 <= width; x += 16)
+      {
+        uint8x16_t difference = vabdq_u8(vld1q_u8(row_a + x), vld1q_u8(row_b + x));
+        sums = vpadalq_u16(sums, vpaddlq_u8(difference));
+      }
+      total += vaddvq_u32(sums);
+#endif
+      for (; x < width; ++x)
+      {
+        total += static_cast<uint64_t>(std::abs(row_a[x] - row_b[x]));
+      }
+    }
+    return total;
+  }
+
+  uint32_t count_changed_rows(const uint8_t *a, int a_stride, const uint8_t *b, int b_stride, int width, int height,
+                              uint8_t threshold)
+  {
+    uint32_t total = 0;
+    for (int y = 0; y < height; ++y)
+    {
+      const uint8_t *row_a = a + static_cast<ptrdiff_t>(y) * a_stride;
+      const uint8_t *row_b = b + static_cast<ptrdiff_t>(y) * b_stride;
+      int x = 0;
+#if defined(__SSE2__)
+      const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold));
+      const __m128i zero = _mm_setzero_si128();
+      for (; x + 16 <= width; x += 16)
+      {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row_a + x));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row_b + x));
+        __m128i difference = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        // Lanes at or under the threshold saturate to zero.
+        __m128i unchanged = _mm_cmpeq_epi8(_mm_subs_epu8(difference, limit), zero);
+        total += 16 - static_cast<uint32_t>(__builtin_popcount(_mm_movemask_epi8(unchanged)));
+      }
+#elif defined(__ARM_NEON)
+      const uint8x16_t limit = vdupq_n_u8(threshold);
+      for (; x + 16 <= width; x += 16)
+      {
+        uint8x16_t difference = vabdq_u8(vld1q_u8(row_a + x), vld1q_u8(row_b + x));
+        // Each changed lane is 0xFF; shifting leaves 1 per lane to add up.
+        total += vaddvq_u8(vshrq_n_u8(vcgtq_u8(difference, limit), 7));
+      }
+#endif
+      for (; x < width; ++x)
+      {
+        total += std::abs(row_a[x] - row_b[x]) > threshold ? 1 : 0;
+      }
+    }
+    return total;
+  }
+
+  uint64_t sum_abs_diff(const Frame &a, const Frame &b, const Rect &rect)
+  {
+    Rect clipped = clip_rect(rect, std::min(a.width, b.width), std::min(a.height, b.height));
+    return sum_abs_diff_rows(a.row(clipped.y) + clipped.x, a.stride, b.row(clipped.y) + clipped.x, b.stride,
+                             clipped.width, clipped.height);
+  }
+
+  uint32_t count_changed(const Frame &a, const Frame &b, const Rect &rect, uint8_t threshold)
+  {
+    Rect clipped = clip_rect(rect, std::min(a.width, b.width), std::min(a.height, b.height));
+    return count_changed_rows(a.row(clipped.y) + clipped.x, a.stride, b.row(clipped.y) + clipped.x, b.stride,
+                              clipped.width, clipped.height, threshold);
+  }
+
+  const char *region_diff_isa()
+  {
+#if defined(__SSE2__)
+    return "sse2";
+#elif defined(__ARM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+  }
+} // namespace vision
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+#include "frame.h"
+
+// Pixel-difference kernels over a rectangle of two equally sized luma frames. They use
+// SSE2 on x86-64 and NEON on AArch64 (16 pixels per step), with a scalar tail and
+// fallback; region_diff_isa() names the one compiled in.
+namespace vision
+{
+  // Sum of |a - b| over the rectangle.
+  uint64_t sum_abs_diff(const Frame &a, const Frame &b, const Rect &rect);
+  // Pixels in the rectangle where |a - b| > threshold.
+  uint32_t count_changed(const Frame &a, const Frame &b, const Rect &rect, uint8_t threshold);
+
+  // Raw-pointer forms, for callers that hold rows of their own.
+  uint64_t sum_abs_diff_rows(const uint8_t *a, int a_stride, const uint8_t *b, int b_stride, int width, int height);
+  uint32_t count_changed_rows(const uint8_t *a, int a_stride, const uint8_t *b, int b_stride, int width, int height,
+                              uint8_t threshold);
+
+  const char *region_diff_isa();
+} // namespace vision
@@ -0,0 +1,68 @@
+// Checks the vectorised region-diff kernels against a plain per-pixel loop on random
+// frames, over rectangles whose widths hit every tail length.
+
+#include "region_diff.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+  int failures = 0;
+
+  void expect(bool condition, const char *what, const vision::Rect &rect)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s at %d,%d %dx%d\n", what, rect.x, rect.y, rect.width, rect.height);
+      ++failures;
+    }
+  }
+} // namespace
+
+int main()
+{
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> byte(0, 255);
+  vision::Frame a;
+  vision::Frame b;
+  a.resize(101, 37);
+  b.resize(101, 37);
+  for (size_t index = 0; index < a.luma.size(); ++index)
+  {
+    a.luma[index] = static_cast<uint8_t>(byte(random));
+    // Mostly small differences, so the threshold matters.
+    b.luma[index] = static_cast<uint8_t>(index % 5 == 0 ? byte(random) : a.luma[index] ^ (byte(random) & 7));
+  }
+
+  for (int width = 1; width <= 70; ++width)
+  {
+    vision::Rect rect{width % 13, width % 7, width, 30};
+    uint64_t sum = 0;
+    uint32_t changed = 0;
+    for (int y = rect.y; y < rect.y + rect.height; ++y)
+    {
+      for (int x = rect.x; x < rect.x + rect.width; ++x)
+      {
+        int difference = std::abs(a.row(y)[x] - b.row(y)[x]);
+        sum += static_cast<uint64_t>(difference);
+        changed += difference > 6 ? 1 : 0;
+      }
+    }
+    expect(vision::sum_abs_diff(a, b, rect) == sum, "sum_abs_diff", rect);
+    expect(vision::count_changed(a, b, rect, 6) == changed, "count_changed", rect);
+  }
+
+  vision::Rect outside{90, 30, 50, 50};
+  vision::Rect clipped = vision::clip_rect(outside, a.width, a.height);
+  expect(clipped.width == 11 && clipped.height == 7, "clip_rect", outside);
+  expect(vision::count_changed(a, a, vision::Rect{}, 0) == 0, "identical frames", outside);
+
+  if (failures == 0)
+  {
+    printf("region_diff (%s): all checks passed\n", vision::region_diff_isa());
+  }
+  return failures == 0 ? 0 : 1;
+}
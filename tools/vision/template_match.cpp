@@ -0,0 +1,469 @@
+#include "template_match.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace vision
+{
+  namespace
+  {
+    using Image = TemplateMatcher::Image;
+
+    // SAD of a template (rows of `padded_width` bytes, a multiple of 32) against the frame
+    // under it, with frame bytes past the template's width masked off. Stops after the row
+    // where the sum first exceeds `limit` and returns the partial sum.
+    using SadRowsFn = uint32_t (*)(const uint8_t *frame, int frame_stride, const uint8_t *templ, int templ_stride,
+                                   const uint8_t *mask, int padded_width, int height, uint32_t limit);
+
+    uint32_t sad_rows_scalar(const uint8_t *frame, int frame_stride, const uint8_t *templ, int templ_stride,
+                             const uint8_t *mask, int padded_width, int height, uint32_t limit)
+    {
+      uint32_t total = 0;
+      for (int y = 0; y < height; ++y)
+      {
+        const uint8_t *frame_row = frame + static_cast<ptrdiff_t>(y) * frame_stride;
+        const uint8_t *templ_row = templ + static_cast<ptrdiff_t>(y) * templ_stride;
+        for (int x = 0; x < padded_width; ++x)
+        {
+          int difference = (frame_row[x] & mask[x]) - templ_row[x];
+          total += static_cast<uint32_t>(difference < 0 ? -difference : difference);
+        }
+        if (total > limit)
+        {
+          break;
+        }
+      }
+      return total;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("sse2"))) uint32_t sad_rows_sse2(const uint8_t *frame, int frame_stride,
+                                                           const uint8_t *templ, int templ_stride,
+                                                           const uint8_t *mask, int padded_width, int height,
+                                                           uint32_t limit)
+    {
+      uint32_t total = 0;
+      for (int y = 0; y < height; ++y)
+      {
+        const uint8_t *frame_row = frame + static_cast<ptrdiff_t>(y) * frame_stride;
+        const uint8_t *templ_row = templ + static_cast<ptrdiff_t>(y) * templ_stride;
+        __m128i sums = _mm_setzero_si128();
+        for (int x = 0; x < padded_width; x += 16)
+        {
+          __m128i pixels = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frame_row + x)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + x)));
+          sums = _mm_add_epi64(sums, _mm_sad_epu8(pixels, _mm_loadu_si128(reinterpret_cast<const __m128i *>(templ_row + x))));
+        }
+        total += static_cast<uint32_t>(_mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+        if (total > limit)
+        {
+          break;
+        }
+      }
+      return total;
+    }
+
+    __attribute__((target("avx2"))) uint32_t sad_rows_avx2(const uint8_t *frame, int frame_stride,
+                                                           const uint8_t *templ, int templ_stride,
+                                                           const uint8_t *mask, int padded_width, int height,
+                                                           uint32_t limit)
+    {
+      uint32_t total = 0;
+      for (int y = 0; y < height; ++y)
+      {
+        const uint8_t *frame_row = frame + static_cast<ptrdiff_t>(y) * frame_stride;
+        const uint8_t *templ_row = templ + static_cast<ptrdiff_t>(y) * templ_stride;
+        __m256i sums = _mm256_setzero_si256();
+        for (int x = 0; x < padded_width; x += 32)
+        {
+          __m256i pixels = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(frame_row + x)),
+                                            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + x)));
+          sums = _mm256_add_epi64(
+              sums, _mm256_sad_epu8(pixels, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(templ_row + x))));
+        }
+        __m128i folded = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        total += static_cast<uint32_t>(_mm_cvtsi128_si32(folded) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(folded, folded)));
+        if (total > limit)
+        {
+          break;
+        }
+      }
+      return total;
+    }
+#elif defined(__ARM_NEON)
+    uint32_t sad_rows_neon(const uint8_t *frame, int frame_stride, const uint8_t *templ, int templ_stride,
+                           const uint8_t *mask, int padded_width, int height, uint32_t limit)
+    {
+      uint32_t total = 0;
+      for (int y = 0; y < height; ++y)
+      {
+        const uint8_t *frame_row = frame + static_cast<ptrdiff_t>(y) * frame_stride;
+        const uint8_t *templ_row = templ + static_cast<ptrdiff_t>(y) * templ_stride;
+        uint32x4_t sums = vdupq_n_u32(0);
+        for (int x = 0; x < padded_width; x += 16)
+        {
+          uint8x16_t pixels = vandq_u8(vld1q_u8(frame_row + x), vld1q_u8(mask + x));
+          sums = vpadalq_u16(sums, vpaddlq_u8(vabdq_u8(pixels, vld1q_u8(templ_row + x))));
+        }
+        total += vaddvq_u32(sums);
+        if (total > limit)
+        {
+          break;
+        }
+      }
+      return total;
+    }
+#endif
+
+    struct SadKernel
+    {
+      SadRowsFn function;
+      const char *name;
+    };
+
+    SadKernel pick_sad_kernel()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2"))
+      {
+        return {sad_rows_avx2, "avx2"};
+      }
+      if (__builtin_cpu_supports("sse2"))
+      {
+        return {sad_rows_sse2, "sse2"};
+      }
+#elif defined(__ARM_NEON)
+      return {sad_rows_neon, "neon"};
+#endif
+      return {sad_rows_scalar, "scalar"};
+    }
+
+    const SadKernel kSadKernel = pick_sad_kernel();
+
+    // dst = src halved in both directions, each pixel the rounded mean of a 2x2 block.
+    void downsample(const Image &src, Image &dst)
+    {
+      dst.resize(src.width / 2, src.height / 2);
+      for (int y = 0; y < dst.height; ++y)
+      {
+        const uint8_t *top = src.row(2 * y);
+        const uint8_t *bottom = src.row(2 * y + 1);
+        uint8_t *out = dst.row(y);
+        int x = 0;
+#if defined(__SSE2__)
+        // Padding keeps the 32-byte source reads inside the row.
+        const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+        for (; x < dst.width; x += 16)
+        {
+          __m128i a = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(top + 2 * x)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(bottom + 2 * x)));
+          __m128i b = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(top + 2 * x + 16)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(bottom + 2 * x + 16)));
+          __m128i a_pairs = _mm_avg_epu16(_mm_and_si128(a, low_bytes), _mm_srli_epi16(a, 8));
+          __m128i b_pairs = _mm_avg_epu16(_mm_and_si128(b, low_bytes), _mm_srli_epi16(b, 8));
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(a_pairs, b_pairs));
+        }
+#elif defined(__ARM_NEON)
+        for (; x < dst.width; x += 8)
+        {
+          uint8x16_t rows = vrhaddq_u8(vld1q_u8(top + 2 * x), vld1q_u8(bottom + 2 * x));
+          vst1_u8(out + x, vrshrn_n_u16(vpaddlq_u8(rows), 1));
+        }
+#endif
+        for (; x < dst.width; ++x)
+        {
+          int rows_a = (top[2 * x] + bottom[2 * x] + 1) / 2;
+          int rows_b = (top[2 * x + 1] + bottom[2 * x + 1] + 1) / 2;
+          out[x] = static_cast<uint8_t>((rows_a + rows_b + 1) / 2);
+        }
+      }
+    }
+
+    void resize_bilinear(const Frame &src, int width, int height, Image &dst)
+    {
+      dst.resize(width, height);
+      std::fill(dst.pixels.begin(), dst.pixels.end(), 0);
+      double x_ratio = width > 1 ? static_cast<double>(src.width - 1) / (width - 1) : 0.0;
+      double y_ratio = height > 1 ? static_cast<double>(src.height - 1) / (height - 1) : 0.0;
+      for (int y = 0; y < height; ++y)
+      {
+        double source_y = y * y_ratio;
+        int y0 = static_cast<int>(source_y);
+        int y1 = std::min(y0 + 1, src.height - 1);
+        double fy = source_y - y0;
+        for (int x = 0; x < width; ++x)
+        {
+          double source_x = x * x_ratio;
+          int x0 = static_cast<int>(source_x);
+          int x1 = std::min(x0 + 1, src.width - 1);
+          double fx = source_x - x0;
+          double top = src.row(y0)[x0] * (1 - fx) + src.row(y0)[x1] * fx;
+          double bottom = src.row(y1)[x0] * (1 - fx) + src.row(y1)[x1] * fx;
+          dst.row(y)[x] = static_cast<uint8_t>(top * (1 - fy) + bottom * fy + 0.5);
+        }
+      }
+    }
+
+    void make_mask(int width, int stride, Image &mask)
+    {
+      mask.width = width;
+      mask.height = 1;
+      mask.stride = stride;
+      mask.pixels.assign(static_cast<size_t>(stride), 0);
+      std::fill(mask.pixels.begin(), mask.pixels.begin() + width, 0xFF);
+    }
+
+    int padded_width(int width)
+    {
+      return (width + 31) & ~31;
+    }
+  } // namespace
+
+  void TemplateMatcher::Image::resize(int new_width, int new_height)
+  {
+    width = new_width;
+    height = new_height;
+    // Room for a padded template row read at the last position, and for the 32-byte
+    // reads of downsample() at the end of a row.
+    stride = padded_width(new_width) + 64;
+    pixels.resize(static_cast<size_t>(stride) * static_cast<size_t>(std::max(1, new_height)));
+  }
+
+  TemplateMatcher::TemplateMatcher(const Frame &templ, const MatchOptions &options) : options_(options)
+  {
+    options_.candidates = std::max(1, options_.candidates);
+    if (options_.scales.empty())
+    {
+      options_.scales.push_back(1.0);
+    }
+    for (double scale : options_.scales)
+    {
+      int width = static_cast<int>(std::lround(templ.width * scale));
+      int height = static_cast<int>(std::lround(templ.height * scale));
+      if (width < 4 || height < 4)
+      {
+        continue;
+      }
+      ScaledTemplate scaled;
+      scaled.scale = scale;
+      scaled.levels.emplace_back();
+      resize_bilinear(templ, width, height, scaled.levels.back());
+      while (static_cast<int>(scaled.levels.size()) <= options_.max_pyramid_levels &&
+             std::min(scaled.levels.back().width, scaled.levels.back().height) / 2 >= options_.min_pyramid_size)
+      {
+        Image next;
+        downsample(scaled.levels.back(), next);
+        // Downsampling reads past the width; clear what it wrote there.
+        for (int y = 0; y < next.height; ++y)
+        {
+          std::fill(next.row(y) + next.width, next.row(y) + next.stride, 0);
+        }
+        scaled.levels.push_back(std::move(next));
+      }
+      for (const Image &level : scaled.levels)
+      {
+        scaled.masks.emplace_back();
+        make_mask(level.width, level.stride, scaled.masks.back());
+      }
+      templates_.push_back(std::move(scaled));
+    }
+  }
+
+  void TemplateMatcher::reset_tracking()
+  {
+    last_ = Match();
+  }
+
+  int TemplateMatcher::coarsest_level(size_t scale_index) const
+  {
+    return static_cast<int>(templates_[scale_index].levels.size()) - 1;
+  }
+
+  void TemplateMatcher::load_frame(const Frame &frame)
+  {
+    frame_levels_.resize(std::max<size_t>(frame_levels_.size(), 1));
+    Image &base = frame_levels_[0];
+    base.resize(frame.width, frame.height);
+    for (int y = 0; y < frame.height; ++y)
+    {
+      memcpy(base.row(y), frame.row(y), static_cast<size_t>(frame.width));
+    }
+    built_levels_ = 1;
+  }
+
+  // Coarser levels are only built when a full search needs them.
+  void TemplateMatcher::ensure_frame_level(int level)
+  {
+    if (static_cast<int>(frame_levels_.size()) <= level)
+    {
+      frame_levels_.resize(static_cast<size_t>(level) + 1);
+    }
+    for (; built_levels_ <= level; ++built_levels_)
+    {
+      downsample(frame_levels_[static_cast<size_t>(built_levels_) - 1], frame_levels_[static_cast<size_t>(built_levels_)]);
+    }
+  }
+
+  std::vector<TemplateMatcher::Candidate> TemplateMatcher::scan(size_t scale_index, int level, int x0, int y0, int x1,
+                                                                int y1, size_t keep, uint32_t limit)
+  {
+    const Image &image = frame_levels_[static_cast<size_t>(level)];
+    const Image &templ = templates_[scale_index].levels[static_cast<size_t>(level)];
+    const Image &mask = templates_[scale_index].masks[static_cast<size_t>(level)];
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, image.width - templ.width);
+    y1 = std::min(y1, image.height - templ.height);
+    int padded = padded_width(templ.width);
+
+    std::vector<Candidate> best;
+    best.reserve(keep + 1);
+    for (int y = y0; y <= y1; ++y)
+    {
+      for (int x = x0; x <= x1; ++x)
+      {
+        // Once `keep` candidates are held, anything no better than the worst is dropped
+        // as soon as its running sum says so.
+        uint32_t bound = best.size() == keep ? best.back().sad : limit;
+        uint32_t sad = kSadKernel.function(image.row(y) + x, image.stride, templ.row(0), templ.stride,
+                                           mask.pixels.data(), padded, templ.height, bound);
+        ++positions_;
+        if (sad >= bound)
+        {
+          continue;
+        }
+        Candidate candidate{x, y, sad};
+        auto at = std::upper_bound(best.begin(), best.end(), candidate,
+                                   [](const Candidate &a, const Candidate &b) { return a.sad < b.sad; });
+        best.insert(at, candidate);
+        if (best.size() > keep)
+        {
+          best.pop_back();
+        }
+      }
+    }
+    return best;
+  }
+
+  Match TemplateMatcher::search(const std::vector<size_t> &scale_indices, const Rect &window, bool tracked)
+  {
+    Match best;
+    double best_score = options_.max_score;
+    for (size_t scale_index : scale_indices)
+    {
+      const ScaledTemplate &scaled = templates_[scale_index];
+      const Image &full = scaled.levels[0];
+      if (full.width > frame_levels_[0].width || full.height > frame_levels_[0].height)
+      {
+        continue;
+      }
+      int level = tracked ? 0 : coarsest_level(scale_index);
+      ensure_frame_level(level);
+      // Coarse sums depend on how the target's phase lines up with the 2x2 grid, so a
+      // score threshold there would drop true hits; coarse levels only keep the best
+      // `candidates` and the threshold applies at full resolution.
+      auto bound_at = [&](int at_level) {
+        if (at_level > 0)
+        {
+          return UINT32_MAX;
+        }
+        return static_cast<uint32_t>(best_score * full.width * full.height) + 1;
+      };
+      std::vector<Candidate> candidates =
+          scan(scale_index, level, window.x >> level, window.y >> level, (window.x + window.width - 1) >> level,
+               (window.y + window.height - 1) >> level, level > 0 ? static_cast<size_t>(options_.candidates) : 1,
+               bound_at(level));
+      for (--level; level >= 0 && !candidates.empty(); --level)
+      {
+        std::vector<Candidate> refined;
+        for (const Candidate &candidate : candidates)
+        {
+          std::vector<Candidate> around = scan(scale_index, level, 2 * candidate.x - 1, 2 * candidate.y - 1,
+                                               2 * candidate.x + 2, 2 * candidate.y + 2, 1, bound_at(level));
+          refined.insert(refined.end(), around.begin(), around.end());
+        }
+        std::sort(refined.begin(), refined.end(), [](const Candidate &a, const Candidate &b) { return a.sad < b.sad; });
+        refined.resize(std::min(refined.size(), level > 0 ? static_cast<size_t>(options_.candidates) : size_t(1)));
+        candidates.swap(refined);
+      }
+      if (candidates.empty())
+      {
+        continue;
+      }
+      double score = static_cast<double>(candidates[0].sad) / (full.width * full.height);
+      if (score <= best_score)
+      {
+        best_score = score;
+        best.found = true;
+        best.x = candidates[0].x;
+        best.y = candidates[0].y;
+        best.width = full.width;
+        best.height = full.height;
+        best.scale = scaled.scale;
+        best.score = score;
+        best.tracked = tracked;
+        last_scale_index_ = scale_index;
+      }
+    }
+    return best;
+  }
+
+  Match TemplateMatcher::find(const Frame &frame)
+  {
+    load_frame(frame);
+    Rect roi = clip_rect(options_.roi, frame.width, frame.height);
+    if (last_.found && options_.track_radius > 0)
+    {
+      int radius = options_.track_radius;
+      Rect around{last_.x - radius, last_.y - radius, 2 * radius + 1, 2 * radius + 1};
+      int x0 = std::max(around.x, roi.x);
+      int y0 = std::max(around.y, roi.y);
+      Rect window{x0, y0, std::min(around.x + around.width, roi.x + roi.width) - x0,
+                  std::min(around.y + around.height, roi.y + roi.height) - y0};
+      if (window.width > 0 && window.height > 0)
+      {
+        // Same scale first: a target that moved but did not resize is the common case.
+        Match match = search({last_scale_index_}, window, true);
+        if (!match.found)
+        {
+          std::vector<size_t> neighbours;
+          if (last_scale_index_ > 0)
+          {
+            neighbours.push_back(last_scale_index_ - 1);
+          }
+          if (last_scale_index_ + 1 < templates_.size())
+          {
+            neighbours.push_back(last_scale_index_ + 1);
+          }
+          match = search(neighbours, window, true);
+        }
+        if (match.found)
+        {
+          last_ = match;
+          return match;
+        }
+      }
+    }
+    std::vector<size_t> all(templates_.size());
+    for (size_t index = 0; index < all.size(); ++index)
+    {
+      all[index] = index;
+    }
+    last_ = search(all, roi, false);
+    return last_;
+  }
+
+  const char *template_match_isa()
+  {
+    return kSadKernel.name;
+  }
+} // namespace vision
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame.h"
+
+// Multi-scale template matching on luma frames, for finding a UI element in the mirrored
+// screen once per frame.
+//
+// The score is the mean absolute difference per template pixel (0 = identical). Each scale
+// of the template gets an image pyramid. A search scans the coarsest level that still
+// leaves the template at least min_pyramid_size pixels on a side, then refines the best
+// candidates one level at a time. Every candidate's sum stops as soon as it exceeds the
+// worst candidate kept so far. After a hit, the next find() searches only a window around
+// it at the same and neighbouring scales, and falls back to the full search when that
+// misses. SAD rows run on AVX2 when the CPU has it, otherwise SSE2 or NEON.
+namespace vision
+{
+  struct MatchOptions
+  {
+    // Template scale factors to try, e.g. {0.8, 0.9, 1.0, 1.1, 1.25}.
+    std::vector<double> scales = {1.0};
+    // Where the template's top-left corner may lie; empty means the whole frame.
+    Rect roi;
+    // Accept a match whose score is at or below this.
+    double max_score = 12.0;
+    int max_pyramid_levels = 3;
+    int min_pyramid_size = 8;
+    // Candidates carried from the coarse level into refinement.
+    int candidates = 4;
+    // Search window half-size, in full-resolution pixels, around the previous hit. 0
+    // disables tracking.
+    int track_radius = 24;
+  };
+
+  struct Match
+  {
+    bool found = false;
+    // Top-left corner and size of the matched region in frame pixels.
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    double scale = 0;
+    double score = 0;
+    // True when the hit came from the window around the previous one.
+    bool tracked = false;
+  };
+
+  class TemplateMatcher
+  {
+  public:
+    TemplateMatcher(const Frame &templ, const MatchOptions &options);
+
+    Match find(const Frame &frame);
+    // Forgets the previous hit, so the next find() searches everything.
+    void reset_tracking();
+    // Template positions whose SAD was started since construction.
+    uint64_t positions() const
+    {
+      return positions_;
+    }
+
+    // Rows padded to a multiple of 32 bytes (zeros for templates), so the SAD kernels
+    // never need a scalar tail. Public for the kernels in the .cpp.
+    struct Image
+    {
+      int width = 0;
+      int height = 0;
+      int stride = 0;
+      std::vector<uint8_t> pixels;
+
+      void resize(int new_width, int new_height);
+      const uint8_t *row(int y) const
+      {
+        return pixels.data() + static_cast<size_t>(y) * static_cast<size_t>(stride);
+      }
+      uint8_t *row(int y)
+      {
+        return pixels.data() + static_cast<size_t>(y) * static_cast<size_t>(stride);
+      }
+    };
+
+  private:
+    struct ScaledTemplate
+    {
+      double scale;
+      // levels[0] is full resolution; levels[k] is downsampled by 2^k.
+      std::vector<Image> levels;
+      std::vector<Image> masks;
+    };
+    struct Candidate
+    {
+      int x;
+      int y;
+      uint32_t sad;
+    };
+
+    void load_frame(const Frame &frame);
+    void ensure_frame_level(int level);
+    // Best positions for template `scale_index` at `level` with top-left in the inclusive
+    // window; at most `keep` results, sorted by SAD.
+    std::vector<Candidate> scan(size_t scale_index, int level, int x0, int y0, int x1, int y1, size_t keep,
+                                uint32_t limit);
+    Match search(const std::vector<size_t> &scale_indices, const Rect &window, bool tracked);
+    int coarsest_level(size_t scale_index) const;
+
+    MatchOptions options_;
+    std::vector<ScaledTemplate> templates_;
+    std::vector<Image> frame_levels_;
+    int built_levels_ = 0;
+    Match last_;
+    size_t last_scale_index_ = 0;
+    uint64_t positions_ = 0;
+  };
+
+  const char *template_match_isa();
+} // namespace vision
@@ -0,0 +1,144 @@
+// Finds a textured patch pasted into generated frames: exact positions at one scale,
+// tracking while it moves, the right scale when it was resized, and nothing when it is
+// absent or outside the search region.
+
+#include "template_match.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+  int failures = 0;
+
+  void expect(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s\n", what);
+      ++failures;
+    }
+  }
+
+  // Smooth random shapes plus pixel noise, like a busy screen under capture noise.
+  vision::Frame make_background(int width, int height, uint32_t seed)
+  {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> coarse(0, 255);
+    std::uniform_int_distribution<int> noise(-2, 2);
+    int grid_width = width / 16 + 2;
+    int grid_height = height / 16 + 2;
+    std::vector<int> grid(static_cast<size_t>(grid_width * grid_height));
+    for (int &value : grid)
+    {
+      value = coarse(random);
+    }
+    vision::Frame frame;
+    frame.resize(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        int gx = x / 16;
+        int gy = y / 16;
+        double fx = (x % 16) / 16.0;
+        double fy = (y % 16) / 16.0;
+        double top = grid[gy * grid_width + gx] * (1 - fx) + grid[gy * grid_width + gx + 1] * fx;
+        double bottom = grid[(gy + 1) * grid_width + gx] * (1 - fx) + grid[(gy + 1) * grid_width + gx + 1] * fx;
+        int value = static_cast<int>(top * (1 - fy) + bottom * fy) + noise(random);
+        frame.row(y)[x] = static_cast<uint8_t>(std::min(255, std::max(0, value)));
+      }
+    }
+    return frame;
+  }
+
+  void paste(vision::Frame &frame, const vision::Frame &patch, int left, int top, double scale)
+  {
+    int width = static_cast<int>(std::lround(patch.width * scale));
+    int height = static_cast<int>(std::lround(patch.height * scale));
+    for (int y = 0; y < height; ++y)
+    {
+      for (int x = 0; x < width; ++x)
+      {
+        int source_x = std::min(patch.width - 1, static_cast<int>(x / scale));
+        int source_y = std::min(patch.height - 1, static_cast<int>(y / scale));
+        frame.row(top + y)[left + x] = patch.row(source_y)[source_x];
+      }
+    }
+  }
+} // namespace
+
+int main()
+{
+  // A 56x40 "button": its own texture with a bright frame round it.
+  vision::Frame button = make_background(56, 40, 99);
+  for (int x = 0; x < button.width; ++x)
+  {
+    button.row(0)[x] = button.row(button.height - 1)[x] = 250;
+  }
+  for (int y = 0; y < button.height; ++y)
+  {
+    button.row(y)[0] = button.row(y)[button.width - 1] = 250;
+  }
+  vision::Frame background = make_background(640, 360, 7);
+
+  vision::MatchOptions options;
+  vision::TemplateMatcher matcher(button, options);
+  vision::Frame frame = background;
+  paste(frame, button, 301, 203, 1.0);
+  vision::Match match = matcher.find(frame);
+  expect(match.found && match.x == 301 && match.y == 203 && !match.tracked, "exact position");
+  expect(match.score < 1.0, "exact score");
+
+  // Move 5 px right and 3 down per frame; each frame should come from tracking.
+  bool all_tracked = true;
+  bool all_exact = true;
+  for (int step = 1; step <= 10; ++step)
+  {
+    frame = background;
+    paste(frame, button, 301 + 5 * step, 203 + 3 * step, 1.0);
+    match = matcher.find(frame);
+    all_tracked = all_tracked && match.found && match.tracked;
+    all_exact = all_exact && match.x == 301 + 5 * step && match.y == 203 + 3 * step;
+  }
+  expect(all_tracked, "moving target tracked");
+  expect(all_exact, "tracked positions exact");
+
+  // A jump beyond the tracking window falls back to the full search.
+  frame = background;
+  paste(frame, button, 40, 30, 1.0);
+  match = matcher.find(frame);
+  expect(match.found && match.x == 40 && match.y == 30 && !match.tracked, "jump found by full search");
+
+  frame = background;
+  match = matcher.find(frame);
+  expect(!match.found, "absent target not found");
+
+  // Scaled copy: the matcher must pick the 1.25 template.
+  options.scales = {0.8, 1.0, 1.25};
+  vision::TemplateMatcher scaled_matcher(button, options);
+  frame = background;
+  paste(frame, button, 120, 90, 1.25);
+  match = scaled_matcher.find(frame);
+  expect(match.found && match.scale == 1.25, "scale found");
+  expect(std::abs(match.x - 120) <= 1 && std::abs(match.y - 90) <= 1, "scaled position");
+
+  // Outside the region of interest.
+  options.scales = {1.0};
+  options.roi = vision::Rect{320, 0, 320, 360};
+  vision::TemplateMatcher roi_matcher(button, options);
+  frame = background;
+  paste(frame, button, 100, 100, 1.0);
+  expect(!roi_matcher.find(frame).found, "roi excludes target");
+  paste(frame, button, 400, 100, 1.0);
+  match = roi_matcher.find(frame);
+  expect(match.found && match.x == 400 && match.y == 100, "roi includes target");
+
+  if (failures == 0)
+  {
+    printf("template_match (%s): all checks passed\n", vision::template_match_isa());
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include "tile_diff.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "region_diff.h"
+
+namespace vision
+{
+  TileDiff::TileDiff(const TileDiffOptions &options) : options_(options)
+  {
+    options_.tile = std::max(1, options_.tile);
+    options_.row_step = std::max(1, options_.row_step);
+    options_.threshold = std::max(0.0, options_.threshold);
+  }
+
+  void TileDiff::reset()
+  {
+    width_ = 0;
+    height_ = 0;
+    channels_ = 0;
+  }
+
+  TileChanges TileDiff::update(const uint8_t *pixels, ptrdiff_t stride, int width, int height, int channels)
+  {
+    const int tile = options_.tile;
+    const int row_bytes = width * channels;
+    bool fresh = width != width_ || height != height_ || channels != channels_;
+    if (fresh)
+    {
+      width_ = width;
+      height_ = height;
+      channels_ = channels;
+      columns_ = (width + tile - 1) / tile;
+      rows_ = (height + tile - 1) / tile;
+      reference_.resize(static_cast<size_t>(row_bytes) * static_cast<size_t>(height));
+      changed_.assign(static_cast<size_t>(columns_) * static_cast<size_t>(rows_), 1);
+    }
+
+    TileChanges changes;
+    changes.tiles = columns_ * rows_;
+    const int step = options_.row_step;
+    for (int row = 0; row < rows_; ++row)
+    {
+      int y0 = row * tile;
+      int tile_height = std::min(tile, height - y0);
+      int sampled_rows = (tile_height + step - 1) / step;
+      for (int column = 0; column < columns_; ++column)
+      {
+        int x0 = column * tile * channels;
+        int tile_bytes = std::min(tile * channels, row_bytes - x0);
+        const uint8_t *image = pixels + y0 * stride + x0;
+        uint8_t *reference = reference_.data() + static_cast<size_t>(y0) * row_bytes + x0;
+        uint8_t &flag = changed_[static_cast<size_t>(row) * columns_ + column];
+        if (!fresh)
+        {
+          uint64_t sum = sum_abs_diff_rows(image, static_cast<int>(stride * step), reference, row_bytes * step,
+                                           tile_bytes, sampled_rows);
+          flag = static_cast<double>(sum) > options_.threshold * tile_bytes * sampled_rows ? 1 : 0;
+        }
+        if (flag)
+        {
+          ++changes.changed;
+          for (int y = 0; y < tile_height; ++y)
+          {
+            memcpy(reference + static_cast<size_t>(y) * row_bytes, image + y * stride, static_cast<size_t>(tile_bytes));
+          }
+        }
+      }
+    }
+    return changes;
+  }
+} // namespace vision
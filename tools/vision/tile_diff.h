@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Tile-wise change detection for deciding whether a frame is worth encoding.
+//
+// The image is cut into square tiles. Each tile's mean absolute difference from a
+// reference image is computed over every `row_step`-th row. The reference keeps, per
+// tile, the pixels from the last update() in which that tile counted as changed, so a
+// slow fade accumulates until it crosses the threshold instead of slipping through
+// frame by frame. Pixels are compared as bytes, so BGR images need no conversion to luma
+// first. The sums use the region_diff kernels.
+namespace vision
+{
+  struct TileDiffOptions
+  {
+    // Tile edge in pixels.
+    int tile = 32;
+    // A tile has changed when its mean absolute difference per byte exceeds this. Decoded
+    // video flickers by a level or two even on a static screen.
+    double threshold = 2.0;
+    // Compare every n-th row. Full rows are still copied into the reference.
+    int row_step = 2;
+  };
+
+  struct TileChanges
+  {
+    int changed = 0;
+    int tiles = 0;
+  };
+
+  class TileDiff
+  {
+  public:
+    explicit TileDiff(const TileDiffOptions &options = TileDiffOptions());
+
+    // Compares `height` rows of `width` pixels of `channels` bytes each with the
+    // reference and copies changed tiles into it. The first image, and any image of a
+    // different shape, changes every tile.
+    TileChanges update(const uint8_t *pixels, ptrdiff_t stride, int width, int height, int channels);
+    // Forgets the reference, so the next update() changes every tile.
+    void reset();
+
+    int columns() const
+    {
+      return columns_;
+    }
+    int rows() const
+    {
+      return rows_;
+    }
+    // One flag per tile from the last update(), row-major.
+    const std::vector<uint8_t> &changed() const
+    {
+      return changed_;
+    }
+
+  private:
+    TileDiffOptions options_;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 0;
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<uint8_t> reference_;
+    std::vector<uint8_t> changed_;
+  };
+} // namespace vision
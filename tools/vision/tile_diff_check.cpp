@@ -0,0 +1,91 @@
+// Checks tile change detection: a static image changes nothing, an edit changes exactly
+// the tiles it touches, noise under the threshold is ignored, and a slow fade is caught
+// once it has accumulated.
+
+#include "tile_diff.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+  int failures = 0;
+
+  void expect(bool condition, const char *what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAIL %s\n", what);
+      ++failures;
+    }
+  }
+} // namespace
+
+int main()
+{
+  // 100x70 BGR: 4x3 tiles of 32 px, the last column and row partial.
+  const int width = 100;
+  const int height = 70;
+  const int stride = width * 3;
+  std::mt19937 random(3);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> image(static_cast<size_t>(stride) * height);
+  for (uint8_t &value : image)
+  {
+    value = static_cast<uint8_t>(byte(random));
+  }
+
+  vision::TileDiff diff;
+  vision::TileChanges first = diff.update(image.data(), stride, width, height, 3);
+  expect(first.tiles == 12 && first.changed == 12, "first image changes every tile");
+  expect(diff.update(image.data(), stride, width, height, 3).changed == 0, "same image changes nothing");
+
+  // A small edit in the bottom-right partial tile, on an odd row that sampling skips
+  // and an even row that it reads.
+  for (int x = 96; x < 100; ++x)
+  {
+    image[static_cast<size_t>(66) * stride + x * 3] ^= 0xFF;
+    image[static_cast<size_t>(67) * stride + x * 3 + 1] ^= 0xFF;
+  }
+  vision::TileChanges edit = diff.update(image.data(), stride, width, height, 3);
+  expect(edit.changed == 1 && diff.changed().back() == 1, "edit changes only its tile");
+  expect(diff.update(image.data(), stride, width, height, 3).changed == 0, "edited tile is now the reference");
+
+  // +-1 noise everywhere stays under the default threshold.
+  std::vector<uint8_t> noisy = image;
+  for (size_t index = 0; index < noisy.size(); ++index)
+  {
+    noisy[index] = static_cast<uint8_t>(noisy[index] < 255 && index % 2 ? noisy[index] + 1 : noisy[index]);
+  }
+  expect(diff.update(noisy.data(), stride, width, height, 3).changed == 0, "noise ignored");
+
+  // Brightening by one level per frame is caught within a few frames, not never.
+  std::vector<uint8_t> fade = image;
+  int frames = 0;
+  for (; frames < 10; ++frames)
+  {
+    for (uint8_t &value : fade)
+    {
+      value = static_cast<uint8_t>(value < 255 ? value + 1 : value);
+    }
+    if (diff.update(fade.data(), stride, width, height, 3).changed == 12)
+    {
+      break;
+    }
+  }
+  expect(frames < 4, "slow fade accumulates");
+
+  expect(diff.update(image.data(), width, width, height / 3, 1).changed == diff.columns() * diff.rows(),
+         "new shape changes every tile");
+  diff.reset();
+  expect(diff.update(image.data(), width, width, height / 3, 1).changed == diff.columns() * diff.rows(),
+         "reset forgets the reference");
+
+  if (failures == 0)
+  {
+    printf("tile_diff: all checks passed\n");
+  }
+  return failures == 0 ? 0 : 1;
+}
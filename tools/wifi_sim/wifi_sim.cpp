@@ -0,0 +1,899 @@
+// Host-native simulator for src/wifi_state_machine. It replays a scripted scenario against
+// a virtual radio and clock, driving the state machine exactly the way wifi_manager does
+// (connect task, event task, loop task and HTTP scans all serialised by the state lock),
+// and reports time-to-connected, time in AP mode and lock hold/wait times.
+//
+//   wifi_sim scenarios/flap.scn [more.scn ...]
+//
+// Scenario files hold one directive per line ('#' starts a comment):
+//   name <text>                 label used in the report
+//   assoc_ms <ms>               time for the station to associate and get an IP
+//   connect_timeout_ms <ms>     state machine connect timeout (default 20000)
+//   ap_shutdown_ms <ms>         delay before the AP is dropped after connecting
+//   latency <op> <ms>           radio call cost: mode, start, ap_start, ap_stop, scan
+//   router <up|down>            initial router state (default up)
+//   at <ms> connect [keep_ap]   queue a connect request (keep_ap keeps the portal up)
+//   at <ms> start_ap | stop_ap  portal bring-up / teardown
+//   at <ms> scan                Wi-Fi scan from the portal (holds the lock for its duration)
+//   at <ms> router <up|down>    router appears / disappears
+//   at <ms> drop <reason>       link loss with a disconnect reason code
+//   at <ms> fail_assoc <n> <reason>  the next n association attempts fail
+//   at <ms> end                 stop the run
+//   expect <metric> <op> <value>  op is one of == <= >=; the process exits non-zero on failure
+
+#include "wifi_state_machine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  using wifi_state_machine::ApStartResult;
+  using wifi_state_machine::ConnectProgress;
+  using wifi_state_machine::Mode;
+  using wifi_state_machine::StationStatus;
+
+  constexpr uint32_t kRetryDelayMs = 500;
+  constexpr uint32_t kConnectTaskDelayMs = 500;
+  constexpr uint32_t kLoopPeriodMs = 20;
+
+  struct Latencies
+  {
+    uint32_t mode = 40;
+    uint32_t start = 60;
+    uint32_t ap_start = 150;
+    uint32_t ap_stop = 30;
+    uint32_t scan = 2200;
+  };
+
+  struct ScriptAction
+  {
+    uint32_t at_ms = 0;
+    std::string verb;
+    std::vector<std::string> args;
+  };
+
+  struct Expectation
+  {
+    std::string metric;
+    std::string op;
+    double value = 0;
+  };
+
+  struct Scenario
+  {
+    std::string name;
+    std::string path;
+    uint32_t assoc_ms = 2500;
+    uint32_t connect_timeout_ms = wifi_state_machine::kDefaultConnectTimeoutMs;
+    uint32_t ap_shutdown_ms = wifi_state_machine::kDefaultApShutdownDelayMs;
+    bool router_up = true;
+    Latencies latencies;
+    std::vector<ScriptAction> actions;
+    std::vector<Expectation> expectations;
+  };
+
+  struct LockStats
+  {
+    uint32_t count = 0;
+    uint64_t hold_total_ms = 0;
+    uint32_t hold_max_ms = 0;
+    uint32_t wait_max_ms = 0;
+  };
+
+  // Ground truth for the virtual radio plus everything the report needs.
+  struct World
+  {
+    uint32_t now = 0;
+    Latencies latencies;
+    uint32_t assoc_ms = 0;
+
+    Mode mode = Mode::Off;
+    bool initialised = false;
+    bool started = false;
+    bool soft_ap = false;
+    bool portal = false;
+
+    bool router_up = true;
+    bool station_begun = false;
+    bool linked = false;
+    uint32_t link_generation = 0;
+    uint32_t failing_assocs = 0;
+    uint8_t fail_reason = 0;
+
+    uint32_t soft_ap_since = 0;
+    uint64_t time_in_ap_ms = 0;
+    uint32_t mode_switches = 0;
+    int64_t first_connect_request_ms = -1;
+    int64_t first_linked_ms = -1;
+    uint32_t links = 0;
+    uint32_t disconnects = 0;
+    std::map<uint8_t, uint32_t> disconnect_reasons;
+    uint32_t connect_timeouts = 0;
+
+    std::map<std::string, LockStats> locks;
+    uint32_t lock_free_at = 0;
+  };
+
+  World *world_ = nullptr;
+
+  struct Pending
+  {
+    uint32_t at_ms;
+    uint64_t sequence;
+    std::function<void()> run;
+
+    bool operator>(const Pending &other) const
+    {
+      return at_ms != other.at_ms ? at_ms > other.at_ms : sequence > other.sequence;
+    }
+  };
+
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending_;
+  uint64_t sequence_ = 0;
+
+  void schedule(uint32_t at_ms, std::function<void()> run)
+  {
+    pending_.push({at_ms, sequence_++, std::move(run)});
+  }
+
+  bool has_sta(Mode mode)
+  {
+    return mode == Mode::Sta || mode == Mode::ApSta;
+  }
+
+  bool has_ap(Mode mode)
+  {
+    return mode == Mode::Ap || mode == Mode::ApSta;
+  }
+
+  void advance(uint32_t ms)
+  {
+    world_->now += ms;
+  }
+
+  void set_soft_ap(bool up)
+  {
+    World &w = *world_;
+    if (up == w.soft_ap)
+    {
+      return;
+    }
+    if (up)
+    {
+      w.soft_ap_since = w.now;
+    }
+    else
+    {
+      w.time_in_ap_ms += w.now - w.soft_ap_since;
+    }
+    w.soft_ap = up;
+  }
+
+  void deliver_event(const char *name, std::function<void(wifi_state_machine::StateMachine &)> handler);
+  wifi_state_machine::StateMachine *machine_ = nullptr;
+
+  void lose_link(uint8_t reason);
+  void schedule_association();
+
+  // ---- Radio backend -------------------------------------------------------------------
+
+  uint32_t radio_now_ms()
+  {
+    return world_->now;
+  }
+
+  bool radio_read_mode(Mode &mode)
+  {
+    if (!world_->initialised)
+    {
+      return false;
+    }
+    mode = world_->mode;
+    return true;
+  }
+
+  void switch_mode(Mode next)
+  {
+    World &w = *world_;
+    advance(w.latencies.mode);
+    w.initialised = true;
+    if (w.mode != next)
+    {
+      ++w.mode_switches;
+    }
+    w.mode = next;
+    if (!has_ap(next))
+    {
+      set_soft_ap(false);
+    }
+    if (!has_sta(next) && w.linked)
+    {
+      lose_link(8);
+    }
+    if (!has_sta(next))
+    {
+      w.station_begun = false;
+    }
+  }
+
+  bool radio_apply_mode(Mode, Mode next)
+  {
+    switch_mode(next);
+    return true;
+  }
+
+  bool radio_start(Mode mode)
+  {
+    World &w = *world_;
+    if (!w.initialised)
+    {
+      switch_mode(mode);
+    }
+    if (!w.started)
+    {
+      advance(w.latencies.start);
+      w.started = true;
+    }
+    return true;
+  }
+
+  ApStartResult radio_start_access_point()
+  {
+    World &w = *world_;
+    advance(w.latencies.ap_start);
+    if (!has_ap(w.mode))
+    {
+      return ApStartResult::AccessPointFailed;
+    }
+    set_soft_ap(true);
+    return ApStartResult::Ok;
+  }
+
+  void radio_stop_access_point()
+  {
+    advance(world_->latencies.ap_stop);
+    set_soft_ap(false);
+  }
+
+  void radio_start_portal()
+  {
+    world_->portal = true;
+  }
+
+  void radio_stop_portal()
+  {
+    world_->portal = false;
+  }
+
+  void radio_begin_station(const char *, const char *)
+  {
+    World &w = *world_;
+    if (!has_sta(w.mode) || !w.started)
+    {
+      return;
+    }
+    w.station_begun = true;
+    if (!w.linked)
+    {
+      schedule_association();
+    }
+  }
+
+  StationStatus radio_station_status()
+  {
+    World &w = *world_;
+    if (w.linked)
+    {
+      return StationStatus::Connected;
+    }
+    if (!w.station_begun)
+    {
+      return StationStatus::Idle;
+    }
+    return w.router_up ? StationStatus::Disconnected : StationStatus::NoSsid;
+  }
+
+  void radio_reconnect_station()
+  {
+    World &w = *world_;
+    if (w.station_begun && !w.linked)
+    {
+      schedule_association();
+    }
+  }
+
+  void radio_disconnect_station(bool)
+  {
+    World &w = *world_;
+    w.station_begun = false;
+    ++w.link_generation;
+    if (w.linked)
+    {
+      lose_link(8);
+    }
+  }
+
+  // ---- Environment ---------------------------------------------------------------------
+
+  // Association completes assoc_ms after it starts unless something invalidates it first;
+  // the generation counter drops attempts superseded by a reconnect or disconnect.
+  void schedule_association()
+  {
+    World &w = *world_;
+    uint32_t generation = ++w.link_generation;
+    schedule(w.now + w.assoc_ms, [generation]()
+             {
+               World &world = *world_;
+               if (generation != world.link_generation || !world.station_begun || world.linked)
+               {
+                 return;
+               }
+               if (!world.router_up || !has_sta(world.mode))
+               {
+                 return;
+               }
+               if (world.failing_assocs > 0)
+               {
+                 --world.failing_assocs;
+                 ++world.disconnects;
+                 ++world.disconnect_reasons[world.fail_reason];
+                 deliver_event("disconnected", [](wifi_state_machine::StateMachine &machine)
+                               { machine.on_disconnected(); });
+                 // ESP-IDF auto-reconnect retries on its own.
+                 schedule_association();
+                 return;
+               }
+               world.linked = true;
+               ++world.links;
+               if (world.first_linked_ms < 0)
+               {
+                 world.first_linked_ms = world.now;
+               }
+               deliver_event("got_ip", [](wifi_state_machine::StateMachine &machine)
+                             { machine.on_got_ip(); });
+             });
+  }
+
+  void lose_link(uint8_t reason)
+  {
+    World &w = *world_;
+    if (!w.linked)
+    {
+      return;
+    }
+    w.linked = false;
+    ++w.disconnects;
+    ++w.disconnect_reasons[reason];
+    deliver_event("disconnected", [](wifi_state_machine::StateMachine &machine)
+                  { machine.on_disconnected(); });
+    if (w.station_begun && w.router_up)
+    {
+      schedule_association();
+    }
+  }
+
+  // ---- Tasks ---------------------------------------------------------------------------
+
+  // Runs `body` as one critical section under the wifi_manager state lock, accounting the
+  // wait for the lock and the hold time separately per operation.
+  void with_lock(const char *op, uint32_t requested_at, const std::function<void()> &body)
+  {
+    World &w = *world_;
+    uint32_t start = std::max(requested_at, std::max(w.lock_free_at, w.now));
+    uint32_t wait = start - requested_at;
+    w.now = start;
+    body();
+    uint32_t hold = w.now - start;
+    w.lock_free_at = w.now;
+
+    LockStats &stats = w.locks[op];
+    ++stats.count;
+    stats.hold_total_ms += hold;
+    stats.hold_max_ms = std::max(stats.hold_max_ms, hold);
+    stats.wait_max_ms = std::max(stats.wait_max_ms, wait);
+  }
+
+  void deliver_event(const char *name, std::function<void(wifi_state_machine::StateMachine &)> handler)
+  {
+    uint32_t at = world_->now;
+    std::string op = std::string("event:") + name;
+    schedule(at, [op, at, handler]()
+             { with_lock(op.c_str(), at, [&]()
+                         { handler(*machine_); }); });
+  }
+
+  void start_ap_task(uint32_t at)
+  {
+    with_lock("start_ap", at, []()
+              { machine_->start_ap(); });
+  }
+
+  void connect_poll(uint32_t at, bool keep_ap);
+
+  // Mirrors wifi_manager's wifi_connect_task and connect_to_station_internal.
+  void connect_task(uint32_t at, bool keep_ap)
+  {
+    World &w = *world_;
+    if (w.first_connect_request_ms < 0)
+    {
+      w.first_connect_request_ms = at;
+    }
+    uint32_t begin_at = at + kConnectTaskDelayMs;
+    schedule(begin_at, [begin_at, keep_ap]()
+             {
+               bool started = false;
+               with_lock("connect_begin", begin_at, [&]()
+                         { started = machine_->begin_connect("sim", "password", keep_ap); });
+               if (!started)
+               {
+                 if (!keep_ap)
+                 {
+                   start_ap_task(world_->now);
+                 }
+                 return;
+               }
+               connect_poll(world_->now, keep_ap);
+             });
+  }
+
+  void connect_poll(uint32_t at, bool keep_ap)
+  {
+    schedule(at, [at, keep_ap]()
+             {
+               ConnectProgress progress = ConnectProgress::Pending;
+               with_lock("connect_poll", at, [&]()
+                         { progress = machine_->poll_connect(); });
+               if (progress == ConnectProgress::Pending)
+               {
+                 connect_poll(world_->now + kRetryDelayMs, keep_ap);
+                 return;
+               }
+
+               bool connected = progress == ConnectProgress::Connected;
+               with_lock("connect_finish", world_->now, [&]()
+                         { machine_->finish_connect(connected, keep_ap); });
+               if (!connected)
+               {
+                 ++world_->connect_timeouts;
+                 if (!keep_ap)
+                 {
+                   start_ap_task(world_->now);
+                 }
+                 return;
+               }
+               if (!keep_ap)
+               {
+                 with_lock("connect_portal_stop", world_->now, []()
+                           { machine_->stop_captive_portal(); });
+                 with_lock("connect_schedule_sta", world_->now, []()
+                           { machine_->schedule_sta_only_transition(); });
+               }
+             });
+  }
+
+  void loop_task(uint32_t at, uint32_t end_ms)
+  {
+    if (at > end_ms)
+    {
+      return;
+    }
+    schedule(at, [at, end_ms]()
+             {
+               with_lock("loop_process", at, []()
+                         { machine_->process(); });
+               loop_task(at + kLoopPeriodMs, end_ms);
+             });
+  }
+
+  void scan_task(uint32_t at)
+  {
+    with_lock("scan", at, []()
+              {
+                if (machine_->begin_scan())
+                {
+                  advance(world_->latencies.scan);
+                  machine_->end_scan();
+                } });
+  }
+
+  // ---- Scenario parsing ----------------------------------------------------------------
+
+  bool parse_uint(const std::string &text, uint32_t &out)
+  {
+    char *end = nullptr;
+    unsigned long value = std::strtoul(text.c_str(), &end, 10);
+    if (!end || *end != '\0' || text.empty())
+    {
+      return false;
+    }
+    out = static_cast<uint32_t>(value);
+    return true;
+  }
+
+  bool load_scenario(const std::string &path, Scenario &scenario, std::string &error)
+  {
+    std::ifstream input(path);
+    if (!input)
+    {
+      error = "cannot open " + path;
+      return false;
+    }
+    scenario = Scenario();
+    scenario.path = path;
+    scenario.name = path;
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(input, line))
+    {
+      ++line_number;
+      size_t hash = line.find('#');
+      if (hash != std::string::npos)
+      {
+        line.erase(hash);
+      }
+      std::istringstream words(line);
+      std::vector<std::string> tokens;
+      std::string token;
+      while (words >> token)
+      {
+        tokens.push_back(token);
+      }
+      if (tokens.empty())
+      {
+        continue;
+      }
+
+      auto fail = [&](const std::string &message)
+      {
+        error = path + ":" + std::to_string(line_number) + ": " + message;
+        return false;
+      };
+
+      const std::string &key = tokens[0];
+      if (key == "name" && tokens.size() >= 2)
+      {
+        scenario.name = line.substr(line.find(tokens[1]));
+        scenario.name.erase(scenario.name.find_last_not_of(" \t\r") + 1);
+      }
+      else if (key == "assoc_ms" && tokens.size() == 2 && parse_uint(tokens[1], scenario.assoc_ms))
+      {
+      }
+      else if (key == "connect_timeout_ms" && tokens.size() == 2 && parse_uint(tokens[1], scenario.connect_timeout_ms))
+      {
+      }
+      else if (key == "ap_shutdown_ms" && tokens.size() == 2 && parse_uint(tokens[1], scenario.ap_shutdown_ms))
+      {
+      }
+      else if (key == "router" && tokens.size() == 2 && (tokens[1] == "up" || tokens[1] == "down"))
+      {
+        scenario.router_up = tokens[1] == "up";
+      }
+      else if (key == "latency" && tokens.size() == 3)
+      {
+        uint32_t value = 0;
+        if (!parse_uint(tokens[2], value))
+        {
+          return fail("bad latency value");
+        }
+        Latencies &l = scenario.latencies;
+        if (tokens[1] == "mode")
+          l.mode = value;
+        else if (tokens[1] == "start")
+          l.start = value;
+        else if (tokens[1] == "ap_start")
+          l.ap_start = value;
+        else if (tokens[1] == "ap_stop")
+          l.ap_stop = value;
+        else if (tokens[1] == "scan")
+          l.scan = value;
+        else
+          return fail("unknown latency '" + tokens[1] + "'");
+      }
+      else if (key == "at" && tokens.size() >= 3)
+      {
+        ScriptAction action;
+        if (!parse_uint(tokens[1], action.at_ms))
+        {
+          return fail("bad time");
+        }
+        action.verb = tokens[2];
+        action.args.assign(tokens.begin() + 3, tokens.end());
+        static const char *const verbs[] = {"connect", "start_ap", "stop_ap", "scan", "router", "drop", "fail_assoc", "end"};
+        if (std::find_if(std::begin(verbs), std::end(verbs), [&](const char *verb)
+                         { return action.verb == verb; }) == std::end(verbs))
+        {
+          return fail("unknown action '" + action.verb + "'");
+        }
+        scenario.actions.push_back(action);
+      }
+      else if (key == "expect" && tokens.size() == 4)
+      {
+        Expectation expectation;
+        expectation.metric = tokens[1];
+        expectation.op = tokens[2];
+        expectation.value = std::atof(tokens[3].c_str());
+        if (expectation.op != "==" && expectation.op != "<=" && expectation.op != ">=")
+        {
+          return fail("bad comparison '" + expectation.op + "'");
+        }
+        scenario.expectations.push_back(expectation);
+      }
+      else
+      {
+        return fail("cannot parse '" + line + "'");
+      }
+    }
+    return true;
+  }
+
+  // ---- Run and report ------------------------------------------------------------------
+
+  double mode_number(Mode mode)
+  {
+    return static_cast<double>(static_cast<uint8_t>(mode));
+  }
+
+  std::map<std::string, double> collect_metrics(const World &w, const wifi_state_machine::StateMachine &machine)
+  {
+    std::map<std::string, double> metrics;
+    metrics["time_to_connected_ms"] =
+        (w.first_linked_ms >= 0 && w.first_connect_request_ms >= 0) ? w.first_linked_ms - w.first_connect_request_ms : -1;
+    metrics["time_in_ap_ms"] = static_cast<double>(w.time_in_ap_ms);
+    metrics["mode_switches"] = w.mode_switches;
+    metrics["links"] = w.links;
+    metrics["disconnects"] = w.disconnects;
+    metrics["connect_timeouts"] = w.connect_timeouts;
+    metrics["linked"] = w.linked ? 1 : 0;
+    metrics["soft_ap"] = w.soft_ap ? 1 : 0;
+    metrics["portal"] = w.portal ? 1 : 0;
+    metrics["mode"] = mode_number(w.mode);
+    metrics["config_mode"] = machine.state().configuration_mode ? 1 : 0;
+
+    uint32_t hold_max = 0;
+    uint32_t wait_max = 0;
+    for (const auto &entry : w.locks)
+    {
+      hold_max = std::max(hold_max, entry.second.hold_max_ms);
+      wait_max = std::max(wait_max, entry.second.wait_max_ms);
+    }
+    metrics["lock_hold_max_ms"] = hold_max;
+    metrics["lock_wait_max_ms"] = wait_max;
+    auto loop = w.locks.find("loop_process");
+    metrics["loop_wait_max_ms"] = loop != w.locks.end() ? loop->second.wait_max_ms : 0;
+    return metrics;
+  }
+
+  bool check(const Expectation &expectation, double actual)
+  {
+    if (expectation.op == "==")
+      return actual == expectation.value;
+    if (expectation.op == "<=")
+      return actual <= expectation.value;
+    return actual >= expectation.value;
+  }
+
+  bool run_scenario(const Scenario &scenario)
+  {
+    World world;
+    world.latencies = scenario.latencies;
+    world.assoc_ms = scenario.assoc_ms;
+    world.router_up = scenario.router_up;
+    world_ = &world;
+    pending_ = decltype(pending_)();
+
+    wifi_state_machine::Radio radio;
+    radio.now_ms = radio_now_ms;
+    radio.read_mode = radio_read_mode;
+    radio.apply_mode = radio_apply_mode;
+    radio.start = radio_start;
+    radio.start_access_point = radio_start_access_point;
+    radio.stop_access_point = radio_stop_access_point;
+    radio.start_portal = radio_start_portal;
+    radio.stop_portal = radio_stop_portal;
+    radio.begin_station = radio_begin_station;
+    radio.station_status = radio_station_status;
+    radio.reconnect_station = radio_reconnect_station;
+    radio.disconnect_station = radio_disconnect_station;
+
+    wifi_state_machine::StateMachine machine;
+    machine.init(radio, scenario.connect_timeout_ms, scenario.ap_shutdown_ms);
+    machine_ = &machine;
+
+    uint32_t end_ms = 60000;
+    for (const ScriptAction &action : scenario.actions)
+    {
+      if (action.verb == "end")
+      {
+        end_ms = action.at_ms;
+      }
+    }
+
+    for (const ScriptAction &action : scenario.actions)
+    {
+      uint32_t at = action.at_ms;
+      if (action.verb == "connect")
+      {
+        bool keep_ap = !action.args.empty() && action.args[0] == "keep_ap";
+        schedule(at, [at, keep_ap]()
+                 { connect_task(at, keep_ap); });
+      }
+      else if (action.verb == "start_ap")
+      {
+        schedule(at, [at]()
+                 { start_ap_task(at); });
+      }
+      else if (action.verb == "stop_ap")
+      {
+        schedule(at, [at]()
+                 { with_lock("stop_ap", at, []()
+                             { machine_->stop_ap(); }); });
+      }
+      else if (action.verb == "scan")
+      {
+        schedule(at, [at]()
+                 { scan_task(at); });
+      }
+      else if (action.verb == "router")
+      {
+        bool up = !action.args.empty() && action.args[0] == "up";
+        schedule(at, [up]()
+                 {
+                   World &w = *world_;
+                   w.router_up = up;
+                   if (!up)
+                   {
+                     lose_link(201);
+                   }
+                   else if (w.station_begun && !w.linked)
+                   {
+                     schedule_association();
+                   } });
+      }
+      else if (action.verb == "drop")
+      {
+        uint32_t reason = 8;
+        if (!action.args.empty())
+        {
+          parse_uint(action.args[0], reason);
+        }
+        schedule(at, [reason]()
+                 { lose_link(static_cast<uint8_t>(reason)); });
+      }
+      else if (action.verb == "fail_assoc")
+      {
+        uint32_t count = 1;
+        uint32_t reason = 15;
+        if (!action.args.empty())
+        {
+          parse_uint(action.args[0], count);
+        }
+        if (action.args.size() > 1)
+        {
+          parse_uint(action.args[1], reason);
+        }
+        schedule(at, [count, reason]()
+                 {
+                   world_->failing_assocs = count;
+                   world_->fail_reason = static_cast<uint8_t>(reason); });
+      }
+    }
+    loop_task(0, end_ms);
+
+    while (!pending_.empty() && pending_.top().at_ms <= end_ms)
+    {
+      Pending next = pending_.top();
+      pending_.pop();
+      if (world.now < next.at_ms)
+      {
+        world.now = next.at_ms;
+      }
+      next.run();
+    }
+    if (world.now < end_ms)
+    {
+      world.now = end_ms;
+    }
+    if (world.soft_ap)
+    {
+      world.time_in_ap_ms += world.now - world.soft_ap_since;
+      world.soft_ap_since = world.now;
+    }
+
+    std::map<std::string, double> metrics = collect_metrics(world, machine);
+
+    printf("== %s (%s)\n", scenario.name.c_str(), scenario.path.c_str());
+    printf("  simulated %.1f s, final mode %s, linked %s, config mode %s\n",
+           end_ms / 1000.0,
+           wifi_state_machine::mode_to_string(world.mode),
+           world.linked ? "yes" : "no",
+           machine.state().configuration_mode ? "yes" : "no");
+    if (metrics["time_to_connected_ms"] >= 0)
+    {
+      printf("  time to connected   %8.0f ms\n", metrics["time_to_connected_ms"]);
+    }
+    else
+    {
+      printf("  time to connected        never\n");
+    }
+    printf("  time in AP          %8.0f ms\n", metrics["time_in_ap_ms"]);
+    printf("  links / disconnects %4.0f / %.0f, connect timeouts %.0f, mode switches %.0f\n",
+           metrics["links"], metrics["disconnects"], metrics["connect_timeouts"], metrics["mode_switches"]);
+    if (!world.disconnect_reasons.empty())
+    {
+      printf("  disconnect reasons ");
+      for (const auto &entry : world.disconnect_reasons)
+      {
+        printf(" %u x%u", entry.first, entry.second);
+      }
+      printf("\n");
+    }
+    printf("  %-22s %6s %9s %9s %9s\n", "lock holder", "count", "hold avg", "hold max", "wait max");
+    for (const auto &entry : world.locks)
+    {
+      const LockStats &stats = entry.second;
+      printf("  %-22s %6u %7.1fms %7ums %7ums\n",
+             entry.first.c_str(),
+             stats.count,
+             stats.count ? static_cast<double>(stats.hold_total_ms) / stats.count : 0.0,
+             stats.hold_max_ms,
+             stats.wait_max_ms);
+    }
+
+    bool ok = true;
+    for (const Expectation &expectation : scenario.expectations)
+    {
+      auto found = metrics.find(expectation.metric);
+      if (found == metrics.end())
+      {
+        printf("  FAIL unknown metric %s\n", expectation.metric.c_str());
+        ok = false;
+        continue;
+      }
+      bool passed = check(expectation, found->second);
+      printf("  %s %s %s %g (actual %g)\n",
+             passed ? "ok  " : "FAIL",
+             expectation.metric.c_str(),
+             expectation.op.c_str(),
+             expectation.value,
+             found->second);
+      ok = ok && passed;
+    }
+    world_ = nullptr;
+    machine_ = nullptr;
+    return ok;
+  }
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s scenario.scn [...]\n", argv[0]);
+    return 2;
+  }
+
+  bool ok = true;
+  for (int index = 1; index < argc; ++index)
+  {
+    Scenario scenario;
+    std::string error;
+    if (!load_scenario(argv[index], scenario, error))
+    {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 2;
+    }
+    ok = run_scenario(scenario) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -13,9 +13,11 @@ from fastapi.responses import FileResponse
 from pydantic import BaseModel
 
 from .pipeline import (
-    OpenCVVideoSource,
+    FrameRateStats,
     PeerConnectionPool,
+    build_adaptive_rate_from_env,
     build_uxplay_runner_from_env,
+    build_video_source,
     build_video_source_from_env,
     create_answer,
     load_automation_hook,
@@ -32,7 +34,9 @@ app = FastAPI(title="iOS Video Automation Bridge")
 pcs = PeerConnectionPool()
 automation_hook = load_automation_hook()
 video_config = build_video_source_from_env()
-video_source = OpenCVVideoSource(video_config)
+video_source = build_video_source(video_config)
+adaptive_rate = build_adaptive_rate_from_env()
+frame_rate_stats = FrameRateStats(encode_cost_ms=adaptive_rate.encode_cost_ms)
 uxplay_runner = build_uxplay_runner_from_env()
 uxplay_log_task: Optional[asyncio.Task[None]] = None
 
@@ -89,6 +93,8 @@ async def offer(sdp: SDPMessage) -> dict[str, str]:
             pcs=pcs,
             automation_hook=automation_hook,
             fps=video_config.fps,
+            adaptive=adaptive_rate,
+            stats=frame_rate_stats,
         )
     except Exception as exc:  # pragma: no cover - for runtime diagnostics
         raise HTTPException(status_code=500, detail=f"Failed to negotiate WebRTC: {exc}") from exc
@@ -96,5 +102,12 @@ async def offer(sdp: SDPMessage) -> dict[str, str]:
     return {"sdp": answer.sdp, "type": answer.type}
 
 
+@app.get("/stats")
+async def stats() -> dict[str, object]:
+    """Adaptive frame rate counters; all zero unless ``VIDEO_ADAPTIVE`` is set."""
+
+    return {"adaptive": adaptive_rate.enabled, **frame_rate_stats.as_dict()}
+
+
 # The FastAPI app is intentionally lightweight; mount it under an existing server
 # or run ``uvicorn video_feed.main:app`` for local development.
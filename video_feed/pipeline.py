@@ -9,14 +9,15 @@ import shlex
 import signal
 import subprocess
 import threading
-from dataclasses import dataclass
-from typing import Callable, Optional
+import time
+from dataclasses import dataclass, field
+from typing import Any, Callable, Optional, Union
 
 import cv2  # type: ignore
 import numpy as np
 from av import VideoFrame  # type: ignore
 from aiortc import RTCPeerConnection, RTCSessionDescription
-from aiortc.mediastreams import VideoStreamTrack
+from aiortc.mediastreams import VIDEO_CLOCK_RATE, VIDEO_TIME_BASE, VideoStreamTrack
 
 
 AutomationHook = Callable[[np.ndarray], np.ndarray]
@@ -41,12 +42,26 @@ def load_automation_hook() -> Optional[AutomationHook]:
     return hook  # type: ignore[return-value]
 
 
+def import_frame_grabber() -> Any:
+    """Import the native ``frame_grabber`` extension built from ``tools/frame_grabber``."""
+
+    try:
+        import frame_grabber  # type: ignore
+    except ImportError as exc:
+        raise RuntimeError(
+            "frame_grabber module not found; build tools/ with CMake and add "
+            "tools/_gate_build/frame_grabber to PYTHONPATH"
+        ) from exc
+    return frame_grabber
+
+
 @dataclass
 class VideoSourceConfig:
     url: str
     width: Optional[int] = None
     height: Optional[int] = None
     fps: float = 30.0
+    backend: str = "opencv"
 
 
 class OpenCVVideoSource:
@@ -93,29 +108,255 @@ class OpenCVVideoSource:
         return await loop.run_in_executor(None, self._read_frame)
 
 
+class NativeVideoSource:
+    """Frame source backed by the ``frame_grabber`` extension from ``tools/frame_grabber``.
+
+    Capture runs on a native thread that keeps only the newest frame, so a slow consumer
+    skips frames instead of falling behind. Frames reach numpy as views of the capture
+    buffer, without a copy; automation hooks may still modify them in place.
+    """
+
+    def __init__(self, spec: str) -> None:
+        self.spec = spec
+        self._grabber = None
+        self._lock = threading.Lock()
+        self._loop: Optional[asyncio.AbstractEventLoop] = None
+        self._waiters: list[asyncio.Future[None]] = []
+
+    def open(self) -> None:
+        with self._lock:
+            if self._grabber is not None:
+                return
+            self._grabber = import_frame_grabber().Grabber(self.spec)
+
+    def close(self) -> None:
+        with self._lock:
+            if self._grabber is None:
+                return
+            if self._loop is not None:
+                self._loop.remove_reader(self._grabber.fileno())
+                self._loop = None
+            for waiter in self._waiters:
+                waiter.cancel()
+            self._waiters.clear()
+            self._grabber.close()
+            self._grabber = None
+
+    def _on_frame(self) -> None:
+        try:
+            os.read(self._grabber.fileno(), 8)
+        except BlockingIOError:
+            pass
+        waiters, self._waiters = self._waiters, []
+        for waiter in waiters:
+            if not waiter.done():
+                waiter.set_result(None)
+
+    async def read_next(self, after: int = 0) -> tuple[np.ndarray, int]:
+        """Return the newest frame captured after sequence ``after`` and its sequence."""
+
+        grabber = self._grabber
+        if grabber is None:
+            raise RuntimeError("Video source not opened")
+        loop = asyncio.get_running_loop()
+        if self._loop is None:
+            # The grabber's eventfd wakes the loop; no executor thread sits in a read.
+            loop.add_reader(grabber.fileno(), self._on_frame)
+            self._loop = loop
+        while True:
+            frame = grabber.latest(timeout=0, after=after)
+            if frame is not None:
+                return np.asarray(frame), frame.sequence
+            waiter = loop.create_future()
+            self._waiters.append(waiter)
+            await waiter
+
+    async def read(self) -> np.ndarray:
+        frame, _ = await self.read_next()
+        return frame
+
+
+VideoSource = Union[OpenCVVideoSource, NativeVideoSource]
+
+
+@dataclass
+class AdaptiveRateConfig:
+    """Settings for pacing the preview by what changed on screen.
+
+    Each frame is compared tile by tile with the last one sent. Changed frames go out
+    as soon as ``motion_fps`` allows. Unchanged frames are dropped before conversion
+    and encoding, except that the last frame is repeated every ``1 / idle_fps`` seconds
+    so the stream stays alive.
+    """
+
+    enabled: bool = False
+    idle_fps: float = 1.0
+    motion_fps: float = 60.0
+    tile: int = 32
+    threshold: float = 2.0
+    # Per-frame encoder cost used to estimate the time saved; aiortc encodes on its own
+    # thread, out of reach of the track.
+    encode_cost_ms: float = 5.0
+
+
+@dataclass
+class FrameRateStats:
+    """Counters shared by every adaptive track, for ``GET /stats``."""
+
+    compared: int = 0
+    sent: int = 0
+    repeated: int = 0
+    skipped: int = 0
+    tiles_compared: int = 0
+    tiles_changed: int = 0
+    compare_seconds: float = 0.0
+    convert_seconds: float = 0.0
+    encode_cost_ms: float = 5.0
+    # How many compared frames had each share of their tiles changed, in tenths.
+    changed_share: list[int] = field(default_factory=lambda: [0] * 11)
+
+    def record_compare(self, changed: int, tiles: int, seconds: float) -> None:
+        self.compared += 1
+        self.tiles_compared += tiles
+        self.tiles_changed += changed
+        self.compare_seconds += seconds
+        self.changed_share[(changed * 10 + tiles - 1) // tiles if tiles else 0] += 1
+
+    def as_dict(self) -> dict[str, Any]:
+        converted = self.sent + self.repeated
+        convert_ms = 1000.0 * self.convert_seconds / converted if converted else 0.0
+        return {
+            "frames": {
+                "compared": self.compared,
+                "sent": self.sent,
+                "repeated": self.repeated,
+                "skipped": self.skipped,
+            },
+            "tiles": {
+                "compared": self.tiles_compared,
+                "changed": self.tiles_changed,
+                "changedRatio": self.tiles_changed / self.tiles_compared if self.tiles_compared else 0.0,
+                "changedShareHistogram": list(self.changed_share),
+            },
+            "compareMsPerFrame": 1000.0 * self.compare_seconds / self.compared if self.compared else 0.0,
+            "convertMsPerFrame": convert_ms,
+            # Conversion is timed here; encoding is estimated from encode_cost_ms.
+            "savedMs": {
+                "convert": convert_ms * self.skipped,
+                "encodeEstimate": self.encode_cost_ms * self.skipped,
+            },
+        }
+
+
 class AutomationVideoTrack(VideoStreamTrack):
-    """WebRTC video track that pulls frames from an OpenCV source."""
+    """WebRTC video track that pulls frames from an OpenCV or native source.
+
+    With an enabled ``AdaptiveRateConfig`` the track sends frames when the screen
+    changes rather than at a fixed rate; see that class. The automation hook still sees
+    every frame read.
+    """
 
     def __init__(
         self,
-        source: OpenCVVideoSource,
+        source: VideoSource,
         fps: float,
         automation_hook: Optional[AutomationHook] = None,
+        adaptive: Optional[AdaptiveRateConfig] = None,
+        stats: Optional[FrameRateStats] = None,
     ) -> None:
         super().__init__()
         self.source = source
         self.automation_hook = automation_hook
         self._frame_delay = 1.0 / max(fps, 1.0)
-
-    async def recv(self) -> VideoFrame:
-        frame = await self.source.read()
+        self._sequence = 0
+        if isinstance(source, NativeVideoSource):
+            # Waiting for a newer frame already paces the track.
+            self._frame_delay = 0.0
+        self._adaptive = adaptive if adaptive is not None and adaptive.enabled else None
+        self._stats = stats if stats is not None else FrameRateStats()
+        self._detector = None
+        self._last_frame: Optional[np.ndarray] = None
+        self._last_sent = 0.0
+        self._start: Optional[float] = None
+        self._pending_read: Optional[asyncio.Future[np.ndarray]] = None
+        if self._adaptive is not None:
+            self._detector = import_frame_grabber().ChangeDetector(
+                tile=self._adaptive.tile, threshold=self._adaptive.threshold
+            )
+            self._stats.encode_cost_ms = self._adaptive.encode_cost_ms
+
+    async def _read(self) -> np.ndarray:
+        if isinstance(self.source, NativeVideoSource):
+            # Each track keeps its own position so peers do not take frames from each other.
+            frame, self._sequence = await self.source.read_next(self._sequence)
+        else:
+            frame = await self.source.read()
         if self.automation_hook is not None:
             frame = self.automation_hook(frame)
+        return frame
+
+    async def _next_changed_frame(self, config: AdaptiveRateConfig) -> np.ndarray:
+        loop = asyncio.get_running_loop()
+        idle_interval = 1.0 / max(config.idle_fps, 0.01)
+        motion_interval = 1.0 / max(config.motion_fps, 1.0)
+        while True:
+            if self._pending_read is None:
+                self._pending_read = asyncio.ensure_future(self._read())
+            if self._last_frame is not None:
+                # A static source may deliver nothing at all; the repeat is due regardless.
+                # The read stays pending for the next call rather than being cancelled.
+                wait = self._last_sent + idle_interval - loop.time()
+                done, _ = await asyncio.wait({self._pending_read}, timeout=max(wait, 0.0))
+                if not done:
+                    self._stats.repeated += 1
+                    return self._last_frame
+            read, self._pending_read = self._pending_read, None
+            frame = await read
+
+            started = time.perf_counter()
+            changed, tiles = self._detector.update(frame)  # type: ignore[union-attr]
+            self._stats.record_compare(changed, tiles, time.perf_counter() - started)
+            now = loop.time()
+            if changed:
+                if now < self._last_sent + motion_interval:
+                    await asyncio.sleep(self._last_sent + motion_interval - now)
+                self._stats.sent += 1
+                return frame
+            if now >= self._last_sent + idle_interval:
+                self._stats.repeated += 1
+                return frame
+            self._stats.skipped += 1
+
+    def stop(self) -> None:
+        if self._pending_read is not None:
+            self._pending_read.cancel()
+            self._pending_read = None
+        super().stop()
+
+    def _wallclock_timestamp(self) -> tuple[int, Any]:
+        # Frames go out at irregular intervals, so timestamps follow the clock rather than
+        # advancing one fixed frame time per call as next_timestamp() does.
+        now = time.monotonic()
+        if self._start is None:
+            self._start = now
+        return int((now - self._start) * VIDEO_CLOCK_RATE), VIDEO_TIME_BASE
 
+    async def recv(self) -> VideoFrame:
+        if self._adaptive is None:
+            frame = await self._read()
+            video_frame = VideoFrame.from_ndarray(frame, format="bgr24")
+            video_frame.pts, video_frame.time_base = await self.next_timestamp()
+            if self._frame_delay:
+                await asyncio.sleep(self._frame_delay)
+            return video_frame
+
+        frame = await self._next_changed_frame(self._adaptive)
+        self._last_frame = frame
+        self._last_sent = asyncio.get_running_loop().time()
+        started = time.perf_counter()
         video_frame = VideoFrame.from_ndarray(frame, format="bgr24")
-        video_frame.pts, video_frame.time_base = await self.next_timestamp()
-        if self._frame_delay:
-            await asyncio.sleep(self._frame_delay)
+        self._stats.convert_seconds += time.perf_counter() - started
+        video_frame.pts, video_frame.time_base = self._wallclock_timestamp()
         return video_frame
 
 
@@ -192,15 +433,19 @@ class UxPlayRunner:
 
 async def create_answer(
     offer: RTCSessionDescription,
-    source: OpenCVVideoSource,
+    source: VideoSource,
     pcs: PeerConnectionPool,
     automation_hook: Optional[AutomationHook],
     fps: float,
+    adaptive: Optional[AdaptiveRateConfig] = None,
+    stats: Optional[FrameRateStats] = None,
 ) -> RTCSessionDescription:
     pc = RTCPeerConnection()
     pcs.add(pc)
 
-    track = AutomationVideoTrack(source=source, fps=fps, automation_hook=automation_hook)
+    track = AutomationVideoTrack(
+        source=source, fps=fps, automation_hook=automation_hook, adaptive=adaptive, stats=stats
+    )
     pc.addTrack(track)
 
     @pc.on("connectionstatechange")
@@ -220,14 +465,57 @@ def build_video_source_from_env() -> VideoSourceConfig:
     width = os.getenv("VIDEO_WIDTH")
     height = os.getenv("VIDEO_HEIGHT")
     fps = float(os.getenv("VIDEO_FPS", "30"))
+    backend = os.getenv("VIDEO_BACKEND", "opencv").lower()
+    if backend not in {"opencv", "native"}:
+        raise ValueError(f"VIDEO_BACKEND must be 'opencv' or 'native', not {backend!r}")
     return VideoSourceConfig(
         url=url,
         width=int(width) if width else None,
         height=int(height) if height else None,
         fps=fps,
+        backend=backend,
     )
 
 
+def build_adaptive_rate_from_env() -> AdaptiveRateConfig:
+    return AdaptiveRateConfig(
+        enabled=os.getenv("VIDEO_ADAPTIVE", "0") not in {"0", "false", "False"},
+        idle_fps=float(os.getenv("VIDEO_IDLE_FPS", "1")),
+        motion_fps=float(os.getenv("VIDEO_MOTION_FPS", "60")),
+        tile=int(os.getenv("VIDEO_TILE", "32")),
+        threshold=float(os.getenv("VIDEO_TILE_THRESHOLD", "2")),
+        encode_cost_ms=float(os.getenv("VIDEO_ENCODE_COST_MS", "5")),
+    )
+
+
+def native_grabber_spec(config: VideoSourceConfig) -> str:
+    """Translate ``VIDEO_SOURCE`` into a ``frame_grabber`` source spec.
+
+    Specs (``v4l2:``, ``cmd:``, ``raw:``, ``synthetic``) pass through. A ``/dev/video*``
+    path is captured with V4L2; anything else is decoded by an ``ffmpeg`` child process,
+    which needs ``VIDEO_WIDTH`` and ``VIDEO_HEIGHT`` to know the raw frame size.
+    """
+
+    url = config.url
+    if url.startswith(("v4l2:", "cmd:", "raw:", "synthetic")):
+        return url
+    size = f"{config.width}x{config.height}" if config.width and config.height else None
+    if url.startswith("/dev/video"):
+        return f"v4l2:{url}:{size}" if size else f"v4l2:{url}"
+    if not size:
+        raise RuntimeError("VIDEO_WIDTH and VIDEO_HEIGHT are required to decode a stream with the native backend")
+    return (
+        f"cmd:{size}:bgr24:ffmpeg -loglevel error -fflags nobuffer -flags low_delay "
+        f"-i {shlex.quote(url)} -vf scale={config.width}:{config.height} -f rawvideo -pix_fmt bgr24 -"
+    )
+
+
+def build_video_source(config: VideoSourceConfig) -> VideoSource:
+    if config.backend == "native":
+        return NativeVideoSource(native_grabber_spec(config))
+    return OpenCVVideoSource(config)
+
+
 def build_uxplay_runner_from_env() -> UxPlayRunner:
     command = os.getenv("UXPLAY_COMMAND")
     timeout = float(os.getenv("UXPLAY_SHUTDOWN_TIMEOUT", "5"))
@@ -239,14 +527,21 @@ def should_autostart_uxplay() -> bool:
 
 
 __all__ = [
+    "AdaptiveRateConfig",
     "AutomationVideoTrack",
+    "FrameRateStats",
+    "NativeVideoSource",
     "OpenCVVideoSource",
     "PeerConnectionPool",
     "UxPlayRunner",
     "VideoSourceConfig",
     "create_answer",
     "load_automation_hook",
+    "build_video_source",
     "build_video_source_from_env",
+    "build_adaptive_rate_from_env",
+    "import_frame_grabber",
+    "native_grabber_spec",
     "build_uxplay_runner_from_env",
     "should_autostart_uxplay",
 ]
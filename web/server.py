@@ -10,8 +10,10 @@ Key changes:
 
 from __future__ import annotations
 
+import itertools
 import json
 import os
+import socket
 import threading
 import time
 from pathlib import Path
@@ -26,6 +28,13 @@ from pydantic import BaseModel, Field
 DEFAULT_PORT = os.getenv("UART_PORT", "COM3")
 DEFAULT_BAUD = int(os.getenv("UART_BAUD", "115200"))
 DEFAULT_LISTEN_SECONDS = float(os.getenv("UART_LISTEN_SECONDS", "0.5"))
+# Unix socket of tools/hid_bridge; when set, the daemon owns the UART instead of this process.
+HID_BRIDGE_SOCKET = os.getenv("HID_BRIDGE_SOCKET", "")
+
+# Binary pointer frames from the overlay (src/pointer_protocol.h): 0xA5, length, records,
+# checksum. Record type -> argument bytes.
+POINTER_FRAME_START = 0xA5
+POINTER_RECORD_ARGUMENTS = {0x01: 2, 0x02: 2, 0x03: 1, 0x04: 1, 0x05: 1, 0x06: 1, 0x07: 0}
 
 BASE_DIR = Path(__file__).resolve().parent
 STATIC_DIR = BASE_DIR / "static"
@@ -40,6 +49,26 @@ def _normalize_list(value, default=None):
     return list(value)
 
 
+def pointer_frame_error(frame: bytes) -> Optional[str]:
+    """Why `frame` is not a well-formed pointer frame, or None if it is."""
+    if not frame or frame[0] != POINTER_FRAME_START:
+        return "bad start byte"
+    if len(frame) < 3 or len(frame) != frame[1] + 3:
+        return "bad length"
+    records = frame[2:-1]
+    if (len(records) + sum(records)) & 0xFF != frame[-1]:
+        return "bad checksum"
+    offset = 0
+    while offset < len(records):
+        arguments = POINTER_RECORD_ARGUMENTS.get(records[offset])
+        if arguments is None:
+            return "unknown record"
+        offset += 1 + arguments
+    if offset != len(records):
+        return "truncated record"
+    return None
+
+
 class SerialBridge:
     def __init__(self, port: str, baud: int) -> None:
         self._lock = threading.Lock()
@@ -106,6 +135,15 @@ class SerialBridge:
             self._serial.write(serialized.encode("utf-8") + b"\n")
             self._serial.flush()
 
+    def send_binary(self, frame: bytes) -> None:
+        """Write a pointer frame as is; the firmware does not answer it."""
+        self.ensure_connection()
+
+        with self._lock:
+            assert self._serial is not None
+            self._serial.write(frame)
+            self._serial.flush()
+
     def close(self) -> None:
         with self._lock:
             if self._serial and self._serial.is_open:
@@ -113,7 +151,133 @@ class SerialBridge:
             self._serial = None
 
 
-bridge = SerialBridge(port=DEFAULT_PORT, baud=DEFAULT_BAUD)
+class NativeBridge:
+    """Client for the hid_bridge daemon, with the same interface as SerialBridge.
+
+    The daemon pipelines writes and coalesces mouse moves, and routes each device reply
+    back by requestId, so send() returns as soon as its own reply arrives instead of
+    polling the port for the whole listen window.
+    """
+
+    def __init__(self, socket_path: str, port: str, baud: int) -> None:
+        self.socket_path = socket_path
+        self.port = port
+        self.baud = baud
+        self._sock: Optional[socket.socket] = None
+        self._send_lock = threading.Lock()
+        self._waiters: dict = {}
+        self._waiters_lock = threading.Lock()
+        self._ids = itertools.count(1)
+
+    def _open(self) -> None:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            sock.connect(self.socket_path)
+        except OSError as exc:
+            sock.close()
+            raise HTTPException(
+                status_code=503,
+                detail=f"hid_bridge not reachable at {self.socket_path}: {exc}",
+            ) from exc
+        self._sock = sock
+        threading.Thread(target=self._reader, args=(sock,), daemon=True).start()
+
+    def _reader(self, sock: socket.socket) -> None:
+        for line in sock.makefile("rb"):
+            try:
+                message = json.loads(line)
+            except ValueError:
+                continue
+            request_id = message.get("requestId")
+            with self._waiters_lock:
+                waiter = self._waiters.pop(request_id, None)
+            if waiter is not None:
+                waiter[1] = message
+                waiter[0].set()
+        if self._sock is sock:
+            self._sock = None
+
+    def _write(self, message: dict) -> None:
+        self._send_bytes(json.dumps(message, separators=(",", ":")).encode("utf-8") + b"\n")
+
+    def _send_bytes(self, data: bytes) -> None:
+        if self._sock is None:
+            self._open()
+        with self._send_lock:
+            assert self._sock is not None
+            try:
+                self._sock.sendall(data)
+            except OSError as exc:
+                self._sock = None
+                raise HTTPException(
+                    status_code=503, detail=f"hid_bridge connection lost: {exc}"
+                ) from exc
+
+    def _request(self, message: dict, timeout: float) -> Optional[dict]:
+        request_id = next(self._ids)
+        waiter = [threading.Event(), None]
+        with self._waiters_lock:
+            self._waiters[request_id] = waiter
+        self._write({**message, "requestId": request_id})
+        waiter[0].wait(timeout)
+        with self._waiters_lock:
+            self._waiters.pop(request_id, None)
+        return waiter[1]
+
+    def connect(self, port: Optional[str] = None, baud: Optional[int] = None) -> None:
+        port = port or self.port
+        baud = baud or self.baud
+        reply = self._request({"type": "config", "port": port, "baud": baud}, 5.0)
+        if reply is None or reply.get("status") != "ok":
+            detail = reply.get("detail") if reply else "no answer from hid_bridge"
+            raise HTTPException(status_code=400, detail=detail)
+        self.port = port
+        self.baud = baud
+
+    def ensure_connection(self) -> None:
+        if self._sock is None:
+            self._open()
+
+    def send(self, payload: dict, listen: float = DEFAULT_LISTEN_SECONDS) -> List[str]:
+        if listen <= 0:
+            self._write({"type": "command", "payload": payload})
+            return []
+        reply = self._request({"type": "command", "payload": payload}, listen)
+        if reply is None:
+            return []
+        if reply.get("status") != "ok":
+            return [json.dumps(reply, separators=(",", ":"))]
+        return [json.dumps(reply["response"], separators=(",", ":"))]
+
+    def send_fast(self, payload: dict) -> None:
+        if payload.get("device") == "mouse" and payload.get("action") == "move":
+            # Let the daemon fold this into moves it has not written yet.
+            self._write(
+                {
+                    "type": "mouse_move",
+                    "dx": payload.get("dx", 0),
+                    "dy": payload.get("dy", 0),
+                    "wheel": payload.get("wheel", 0),
+                    "pan": payload.get("pan", 0),
+                }
+            )
+        else:
+            self._write({"type": "command", "payload": payload})
+
+    def send_binary(self, frame: bytes) -> None:
+        # The daemon recognises the start byte and forwards the frame in order.
+        self._send_bytes(frame)
+
+    def close(self) -> None:
+        sock, self._sock = self._sock, None
+        if sock is not None:
+            sock.close()
+
+
+if HID_BRIDGE_SOCKET:
+    bridge = NativeBridge(HID_BRIDGE_SOCKET, port=DEFAULT_PORT, baud=DEFAULT_BAUD)
+else:
+    bridge = SerialBridge(port=DEFAULT_PORT, baud=DEFAULT_BAUD)
 
 
 class ListenMixin(BaseModel):
@@ -179,7 +343,11 @@ app.mount("/static", StaticFiles(directory=STATIC_DIR), name="static")
 @app.on_event("startup")
 def startup() -> None:
     try:
-        bridge.connect()
+        if isinstance(bridge, NativeBridge):
+            # The daemon was started on its own port; adopt it instead of reopening.
+            bridge.ensure_connection()
+        else:
+            bridge.connect()
     except HTTPException as exc:
         print(f"[server] Warning: {exc.detail}")
 
@@ -299,7 +467,28 @@ async def websocket_hid(websocket: WebSocket) -> None:
 
     try:
         while True:
-            data = await websocket.receive_json()
+            message = await websocket.receive()
+            if message["type"] == "websocket.disconnect":
+                raise WebSocketDisconnect(message.get("code", 1000))
+            frame = message.get("bytes")
+            if frame is not None:
+                # Pointer frames carry no requestId and are not acknowledged; only a
+                # rejected one is reported.
+                error = pointer_frame_error(frame)
+                try:
+                    if error is None:
+                        bridge.send_binary(frame)
+                except HTTPException as exc:
+                    error = exc.detail
+                if error is not None:
+                    await websocket.send_json(
+                        {"status": "error", "type": "pointer_frame", "detail": error}
+                    )
+                continue
+
+            data = json.loads(message.get("text") or "null")
+            if not isinstance(data, dict):
+                continue
             msg_type = data.get("type")
             request_id = data.get("requestId")
 